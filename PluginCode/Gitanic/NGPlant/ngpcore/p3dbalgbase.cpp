@@ -61,6 +61,8 @@ void               P3DBranchingAlgBase::SetRotationAngle
                                       (float               Rotation)
  {
   this->Rotation = P3DMath::Clampf(0.0f,P3DMATH_2PI,Rotation);
+
+  Touch();
  }
 
 void               P3DBranchingAlgBase::CreateBranches
@@ -75,6 +77,37 @@ void               P3DBranchingAlgBase::CreateBranches
   Factory->GenerateBranch(0.0f,&Orientation);
  }
 
+bool               P3DBranchingAlgBase::BeginBranches
+                                      (P3DBranchingCursor           *Cursor,
+                                       const P3DStemModelInstance   *Parent P3D_UNUSED_ATTR,
+                                       P3DMathRNG                   *RNG P3D_UNUSED_ATTR) const
+ {
+  Cursor->Counters[0] = 0; /* single branch is not generated yet */
+
+  return(true);
+ }
+
+bool               P3DBranchingAlgBase::NextBranch
+                                      (P3DBranchingCursor           *Cursor,
+                                       float                        *Offset,
+                                       P3DQuaternionf               *Orientation,
+                                       const P3DStemModelInstance   *Parent P3D_UNUSED_ATTR,
+                                       P3DMathRNG                   *RNG P3D_UNUSED_ATTR) const
+ {
+  if (Cursor->Counters[0] != 0)
+   {
+    return(false);
+   }
+
+  Cursor->Counters[0] = 1;
+
+  *Offset = 0.0f;
+
+  Orientation->FromAxisAndAngle(0.0f,1.0f,0.0f,Rotation);
+
+  return(true);
+ }
+
 void               P3DBranchingAlgBase::Save
                                       (P3DOutputStringStream
                                                           *TargetStream) const
@@ -96,5 +129,7 @@ void               P3DBranchingAlgBase::Load
 
   SourceStream->ReadFmtStringTagged("RotAngle","f",&FloatValue);
   SetRotationAngle(FloatValue);
+
+  Touch();
  }
 
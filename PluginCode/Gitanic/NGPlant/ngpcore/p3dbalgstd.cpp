@@ -103,6 +103,8 @@ void               P3DBranchingAlgStd::SetDensity
    {
     this->Density = Density;
    }
+
+  Touch();
  }
 
 float              P3DBranchingAlgStd::GetDensityV
@@ -115,6 +117,8 @@ void               P3DBranchingAlgStd::SetDensityV
                                       (float                         DensityV)
  {
   this->DensityV = P3DMath::Clampf(0.0f,1.0f,DensityV);
+
+  Touch();
  }
 
 unsigned_int32       P3DBranchingAlgStd::GetMinNumber
@@ -132,6 +136,8 @@ void               P3DBranchingAlgStd::SetMinNumber
    {
     MaxNumber = MinNumber;
    }
+
+  Touch();
  }
 
 bool               P3DBranchingAlgStd::IsMaxLimitEnabled
@@ -144,6 +150,8 @@ void               P3DBranchingAlgStd::SetMaxLimitEnabled
                                       (bool                          IsEnabled)
  {
   MaxLimitEnabled = IsEnabled;
+
+  Touch();
  }
 
 unsigned_int32       P3DBranchingAlgStd::GetMaxNumber
@@ -161,6 +169,8 @@ void               P3DBranchingAlgStd::SetMaxNumber
    {
     MinNumber = MaxNumber;
    }
+
+  Touch();
  }
 
 unsigned_int32       P3DBranchingAlgStd::GetMultiplicity
@@ -180,6 +190,8 @@ void               P3DBranchingAlgStd::SetMultiplicity
    {
     this->Multiplicity = 1;
    }
+
+  Touch();
  }
 
 float              P3DBranchingAlgStd::GetRevAngle
@@ -192,6 +204,8 @@ void               P3DBranchingAlgStd::SetRevAngle
                                       (float                         RevAngle)
  {
   this->RevAngle = RevAngle;
+
+  Touch();
  }
 
 float              P3DBranchingAlgStd::GetRevAngleV
@@ -204,6 +218,8 @@ void               P3DBranchingAlgStd::SetRevAngleV
                                       (float                         RevAngleV)
  {
   this->RevAngleV = P3DMath::Clampf(0.0f,1.0f,RevAngleV);
+
+  Touch();
  }
 
 float              P3DBranchingAlgStd::GetMinOffset
@@ -216,6 +232,8 @@ void               P3DBranchingAlgStd::SetMinOffset
                                       (float                         MinOffset)
  {
   this->MinOffset = P3DMath::Clampf(0.0f,1.0f,MinOffset);
+
+  Touch();
  }
 
 float              P3DBranchingAlgStd::GetMaxOffset
@@ -228,6 +246,8 @@ void               P3DBranchingAlgStd::SetMaxOffset
                                       (float                         MaxOffset)
  {
   this->MaxOffset = P3DMath::Clampf(0.0f,1.0f,MaxOffset);
+
+  Touch();
  }
 
 void               P3DBranchingAlgStd::SetDeclinationCurve
@@ -235,6 +255,8 @@ void               P3DBranchingAlgStd::SetDeclinationCurve
                                                                     *Curve)
  {
   DeclinationCurve.CopyFrom(*Curve);
+
+  Touch();
  }
 
 const P3DMathNaturalCubicSpline
@@ -254,6 +276,8 @@ void               P3DBranchingAlgStd::SetDeclinationV
                                       (float                         DeclinationV)
  {
   this->DeclinationV = P3DMath::Clampf(0.0f,1.0f,DeclinationV);
+
+  Touch();
  }
 
 float              P3DBranchingAlgStd::GetRotationAngle
@@ -266,26 +290,55 @@ void               P3DBranchingAlgStd::SetRotationAngle
                                       (float                         RotAngle)
  {
   this->Rotation = RotAngle;
+
+  Touch();
  }
 
+/* cursor layout */
+#define P3DBAlgStdBranchCount  (0) /* counters */
+#define P3DBAlgStdBranchIndex  (1)
+#define P3DBAlgStdMultIndex    (2)
+#define P3DBAlgStdCurrOffset   (0) /* values */
+#define P3DBAlgStdOffsetStep   (1)
+#define P3DBAlgStdCurrRevAngle (2)
+
 void               P3DBranchingAlgStd::CreateBranches
                                       (P3DBranchingFactory          *Factory,
                                        const P3DStemModelInstance   *Parent,
                                        P3DMathRNG                   *RNG)
+ {
+  P3DBranchingCursor                   Cursor;
+  float                                Offset;
+  P3DQuaternionf                       Orientation;
+
+  BeginBranches(&Cursor,Parent,RNG);
+
+  while (NextBranch(&Cursor,&Offset,&Orientation,Parent,RNG))
+   {
+    Factory->GenerateBranch(Offset,&Orientation);
+   }
+ }
+
+bool               P3DBranchingAlgStd::BeginBranches
+                                      (P3DBranchingCursor           *Cursor,
+                                       const P3DStemModelInstance   *Parent,
+                                       P3DMathRNG                   *RNG) const
  {
   unsigned_int32                         BranchCount;
-  float                                CurrOffset;
-  float                                OffsetStep;
-  float                                CurrRevAngle;
   float                                BranchRegionLength;
 
-  CurrRevAngle = 0.0f;
+  Cursor->Counters[P3DBAlgStdBranchCount] = 0;
+  Cursor->Counters[P3DBAlgStdBranchIndex] = 0;
+  Cursor->Counters[P3DBAlgStdMultIndex]   = 0;
+  Cursor->Values[P3DBAlgStdCurrOffset]    = 0.0f;
+  Cursor->Values[P3DBAlgStdOffsetStep]    = 0.0f;
+  Cursor->Values[P3DBAlgStdCurrRevAngle]  = 0.0f;
 
   BranchRegionLength = Parent->GetLength() * (MaxOffset - MinOffset);
 
   if (BranchRegionLength <= 0.0f)
    {
-    return;
+    return(true);
    }
 
   if (RNG != 0)
@@ -311,54 +364,103 @@ void               P3DBranchingAlgStd::CreateBranches
 
   if (BranchCount > 0)
    {
-    P3DQuaternionf                     orientation;
-    P3DQuaternionf                     decl;
-    P3DQuaternionf                     rev;
-    P3DQuaternionf                     Rot;
-    P3DQuaternionf                     TempRot;
-    float                              MultRevAngleStep;
+    Cursor->Counters[P3DBAlgStdBranchCount] = BranchCount;
+    Cursor->Values[P3DBAlgStdOffsetStep]    = (MaxOffset - MinOffset) / (BranchCount + 1);
+    Cursor->Values[P3DBAlgStdCurrOffset]    = MinOffset + Cursor->Values[P3DBAlgStdOffsetStep];
+   }
 
-    OffsetStep = (MaxOffset - MinOffset) / (BranchCount + 1);
-    CurrOffset = MinOffset + OffsetStep;
+  return(true);
+ }
 
-    MultRevAngleStep = (2.0f * P3DMATH_PI) / Multiplicity;
+bool               P3DBranchingAlgStd::NextBranch
+                                      (P3DBranchingCursor           *Cursor,
+                                       float                        *Offset,
+                                       P3DQuaternionf               *Orientation,
+                                       const P3DStemModelInstance   *Parent P3D_UNUSED_ATTR,
+                                       P3DMathRNG                   *RNG) const
+ {
+  P3DQuaternionf                       decl;
+  P3DQuaternionf                       rev;
+  P3DQuaternionf                       Rot;
+  P3DQuaternionf                       TempRot;
+  float                                MultRevAngleStep;
+  float                                BaseDeclination;
+  float                                CurrOffset;
+  double                               Units[2];
+  unsigned_int32                         UnitCount;
 
-    for (unsigned_int32 i = 0; i < BranchCount; i++)
-     {
-      float        BaseDeclination;
+  if (Cursor->Counters[P3DBAlgStdBranchIndex] >= Cursor->Counters[P3DBAlgStdBranchCount])
+   {
+    return(false);
+   }
 
-      for (unsigned_int32 MultIndex = 0; MultIndex < Multiplicity; MultIndex++)
-       {
-        BaseDeclination = DeclinationCurve.GetValue(CurrOffset);
+  /* random draws of this step (revolution angle variation if offset */
+  /* is changed and declination variation if branch is generated)    */
+  /* are fetched in single block                                     */
+  UnitCount = 0;
 
-        if (RNG != 0)
-         {
-          BaseDeclination += RNG->UniformFloat(-DeclinationV,DeclinationV) * BaseDeclination;
-         }
+  if (RNG != 0)
+   {
+    if (Cursor->Counters[P3DBAlgStdMultIndex] == Multiplicity)
+     {
+      UnitCount++;
+     }
 
-        decl.FromAxisAndAngle(0.0f,0.0f,-1.0f,P3DMATH_DEG2RAD(180.0f * BaseDeclination));
-        rev.FromAxisAndAngle(0.0f,1.0f,0.0f,CurrRevAngle + MultRevAngleStep * MultIndex);
+    if ((Cursor->Counters[P3DBAlgStdMultIndex] != Multiplicity) ||
+        (Cursor->Counters[P3DBAlgStdBranchIndex] + 1 < Cursor->Counters[P3DBAlgStdBranchCount]))
+     {
+      UnitCount++;
+     }
 
-        Rot.FromAxisAndAngle(0.0f,1.0f,0.0f,Rotation);
+    RNG->UniformUnits(Units,UnitCount);
+   }
 
-        P3DQuaternionf::CrossProduct(TempRot.q,rev.q,decl.q);
-        P3DQuaternionf::CrossProduct(orientation.q,TempRot.q,Rot.q);
+  /* all branches at current offset are generated - move to next one */
+  if (Cursor->Counters[P3DBAlgStdMultIndex] == Multiplicity)
+   {
+    if (RNG != 0)
+     {
+      Cursor->Values[P3DBAlgStdCurrRevAngle] += RevAngle + (RevAngle * P3DMathRNG::UnitToFloat(Units[0],-RevAngleV,RevAngleV));
+     }
+    else
+     {
+      Cursor->Values[P3DBAlgStdCurrRevAngle] += RevAngle;
+     }
 
-        Factory->GenerateBranch(CurrOffset,&orientation);
-       }
+    Cursor->Values[P3DBAlgStdCurrOffset] += Cursor->Values[P3DBAlgStdOffsetStep];
 
-      if (RNG != 0)
-       {
-        CurrRevAngle += RevAngle + (RevAngle * RNG->UniformFloat(-RevAngleV,RevAngleV));
-       }
-      else
-       {
-        CurrRevAngle += RevAngle;
-       }
+    Cursor->Counters[P3DBAlgStdBranchIndex]++;
+    Cursor->Counters[P3DBAlgStdMultIndex] = 0;
 
-      CurrOffset += OffsetStep;
+    if (Cursor->Counters[P3DBAlgStdBranchIndex] >= Cursor->Counters[P3DBAlgStdBranchCount])
+     {
+      return(false);
      }
    }
+
+  CurrOffset       = Cursor->Values[P3DBAlgStdCurrOffset];
+  MultRevAngleStep = (2.0f * P3DMATH_PI) / Multiplicity;
+
+  BaseDeclination = DeclinationCurve.GetValue(CurrOffset);
+
+  if (RNG != 0)
+   {
+    BaseDeclination += P3DMathRNG::UnitToFloat(Units[UnitCount - 1],-DeclinationV,DeclinationV) * BaseDeclination;
+   }
+
+  decl.FromAxisAndAngle(0.0f,0.0f,-1.0f,P3DMATH_DEG2RAD(180.0f * BaseDeclination));
+  rev.FromAxisAndAngle(0.0f,1.0f,0.0f,Cursor->Values[P3DBAlgStdCurrRevAngle] + MultRevAngleStep * Cursor->Counters[P3DBAlgStdMultIndex]);
+
+  Rot.FromAxisAndAngle(0.0f,1.0f,0.0f,Rotation);
+
+  P3DQuaternionf::CrossProduct(TempRot.q,rev.q,decl.q);
+  P3DQuaternionf::CrossProduct(Orientation->q,TempRot.q,Rot.q);
+
+  Cursor->Counters[P3DBAlgStdMultIndex]++;
+
+  *Offset = CurrOffset;
+
+  return(true);
  }
 
 void               P3DBranchingAlgStd::Save
@@ -450,5 +552,7 @@ void               P3DBranchingAlgStd::Load
   P3DLoadSplineCurve(&DeclinationCurve,SourceStream,StrValue);
   SourceStream->ReadFmtStringTagged("DeclinationV","f",&FloatValue);
   SetDeclinationV(FloatValue);
+
+  Touch();
  }
 
@@ -90,6 +90,16 @@ class P3DBranchingAlgStd : public P3DBranchingAlg
                                        const P3DStemModelInstance   *Parent,
                                        P3DMathRNG                   *RNG);
 
+  virtual bool     BeginBranches      (P3DBranchingCursor           *Cursor,
+                                       const P3DStemModelInstance   *Parent,
+                                       P3DMathRNG                   *RNG) const;
+
+  virtual bool     NextBranch         (P3DBranchingCursor           *Cursor,
+                                       float                        *Offset,
+                                       P3DQuaternionf               *Orientation,
+                                       const P3DStemModelInstance   *Parent,
+                                       P3DMathRNG                   *RNG) const;
+
   virtual void     Save               (P3DOutputStringStream
                                                           *TargetStream) const;
 
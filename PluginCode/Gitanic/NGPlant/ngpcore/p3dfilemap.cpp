@@ -0,0 +1,200 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#include <stdafx.h>
+
+#if defined(_WIN32)
+ #include <windows.h>
+#else
+ #include <sys/types.h>
+ #include <sys/stat.h>
+ #include <sys/mman.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+#endif
+
+#include <ngpcore/p3diostream.h>
+#include <ngpcore/p3dfilemap.h>
+
+                   P3DFileMapping::P3DFileMapping
+                                      ()
+ {
+  Data     = 0;
+  DataSize = 0;
+  Handle   = 0;
+ }
+
+                   P3DFileMapping::~P3DFileMapping
+                                      ()
+ {
+  Close();
+ }
+
+bool               P3DFileMapping::IsOpen
+                                      () const
+ {
+  return(Data != 0);
+ }
+
+const void        *P3DFileMapping::GetData
+                                      () const
+ {
+  return(Data);
+ }
+
+unsigned_int32       P3DFileMapping::GetDataSize
+                                      () const
+ {
+  return(DataSize);
+ }
+
+#if defined(_WIN32)
+
+void               P3DFileMapping::Open
+                                      (const char         *FileName)
+ {
+  HANDLE                               File;
+  HANDLE                               Mapping;
+  LARGE_INTEGER                        FileSize;
+  void                                *View;
+
+  Close();
+
+  File = CreateFileA(FileName,GENERIC_READ,FILE_SHARE_READ,NULL,
+                     OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+
+  if (File == INVALID_HANDLE_VALUE)
+   {
+    throw P3DExceptionIO();
+   }
+
+  if ((!GetFileSizeEx(File,&FileSize)) ||
+      (FileSize.HighPart != 0) || (FileSize.LowPart == 0))
+   {
+    CloseHandle(File);
+
+    throw P3DExceptionIO();
+   }
+
+  Mapping = CreateFileMappingA(File,NULL,PAGE_READONLY,0,0,NULL);
+
+  /* mapping keeps file open */
+  CloseHandle(File);
+
+  if (Mapping == NULL)
+   {
+    throw P3DExceptionIO();
+   }
+
+  View = MapViewOfFile(Mapping,FILE_MAP_READ,0,0,0);
+
+  if (View == NULL)
+   {
+    CloseHandle(Mapping);
+
+    throw P3DExceptionIO();
+   }
+
+  Data     = View;
+  DataSize = FileSize.LowPart;
+  Handle   = Mapping;
+ }
+
+void               P3DFileMapping::Close
+                                      ()
+ {
+  if (Data != 0)
+   {
+    UnmapViewOfFile(Data);
+    CloseHandle((HANDLE)Handle);
+   }
+
+  Data     = 0;
+  DataSize = 0;
+  Handle   = 0;
+ }
+
+#else
+
+void               P3DFileMapping::Open
+                                      (const char         *FileName)
+ {
+  int                                  File;
+  struct stat                          FileStat;
+  void                                *View;
+
+  Close();
+
+  File = open(FileName,O_RDONLY);
+
+  if (File < 0)
+   {
+    throw P3DExceptionIO();
+   }
+
+  if ((fstat(File,&FileStat) != 0) ||
+      (FileStat.st_size <= 0) ||
+      ((unsigned_int32)FileStat.st_size != FileStat.st_size))
+   {
+    close(File);
+
+    throw P3DExceptionIO();
+   }
+
+  View = mmap(NULL,FileStat.st_size,PROT_READ,MAP_SHARED,File,0);
+
+  /* mapping stays valid after descriptor is closed */
+  close(File);
+
+  if (View == MAP_FAILED)
+   {
+    throw P3DExceptionIO();
+   }
+
+  Data     = View;
+  DataSize = (unsigned_int32)FileStat.st_size;
+ }
+
+void               P3DFileMapping::Close
+                                      ()
+ {
+  if (Data != 0)
+   {
+    munmap((void*)Data,DataSize);
+   }
+
+  Data     = 0;
+  DataSize = 0;
+  Handle   = 0;
+ }
+
+#endif
+
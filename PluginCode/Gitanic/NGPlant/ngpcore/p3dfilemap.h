@@ -0,0 +1,68 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#ifndef __P3DFILEMAP_H__
+#define __P3DFILEMAP_H__
+
+#include <ngpcore/p3ddefs.h>
+
+/* Read-only memory mapping of whole file. Files larger than 4Gb */
+/* and empty files can not be mapped.                            */
+class P3D_DLL_ENTRY P3DFileMapping
+ {
+  public           :
+
+                   P3DFileMapping     ();
+                  ~P3DFileMapping     ();
+
+  /* throws P3DExceptionIO if file can not be opened or mapped */
+  void             Open               (const char         *FileName);
+  void             Close              ();
+
+  bool             IsOpen             () const;
+
+  const void      *GetData            () const;
+  unsigned_int32     GetDataSize        () const;
+
+  private          :
+
+                   P3DFileMapping     (const P3DFileMapping
+                                                          &Source);
+  P3DFileMapping  &operator =         (const P3DFileMapping
+                                                          &Source);
+
+  const void                          *Data;
+  unsigned_int32                         DataSize;
+  void                                *Handle;
+ };
+
+#endif
+
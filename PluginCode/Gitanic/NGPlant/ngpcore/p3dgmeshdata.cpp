@@ -97,13 +97,13 @@
    {
     for (Index = 0; Index < P3D_GMESH_MAX_ATTRS; Index++)
      {
-      delete VAttrValues[Index];
-      delete VAttrValueIndices[Index];
-      delete VAttrBuffersI[Index];
+      delete[] VAttrValues[Index];
+      delete[] VAttrValueIndices[Index];
+      delete[] VAttrBuffersI[Index];
      }
 
-    delete PrimitiveTypes;
-    delete IndexBufferI;
+    delete[] PrimitiveTypes;
+    delete[] IndexBufferI;
 
     throw;
    }
@@ -116,13 +116,13 @@
 
   for (Index = 0; Index < P3D_GMESH_MAX_ATTRS; Index++)
    {
-    delete VAttrValues[Index];
-    delete VAttrValueIndices[Index];
-    delete VAttrBuffersI[Index];
+    delete[] VAttrValues[Index];
+    delete[] VAttrValueIndices[Index];
+    delete[] VAttrBuffersI[Index];
    }
 
-  delete PrimitiveTypes;
-  delete IndexBufferI;
+  delete[] PrimitiveTypes;
+  delete[] IndexBufferI;
  }
 
 unsigned_int32       P3DGMeshData::GetVAttrCount
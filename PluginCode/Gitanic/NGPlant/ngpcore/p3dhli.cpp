@@ -29,10 +29,13 @@
 
 ***************************************************************************/
 
+#include <string.h>
 
+#include <ngpcore/p3dexcept.h>
 #include <ngpcore/p3dmodel.h>
 #include <ngpcore/p3dmodelstemquad.h>
 #include <ngpcore/p3dhli.h>
+#include <ngpcore/p3dthread.h>
 
 /* calculate total group count (including plant base group) */
 static
@@ -99,1333 +102,3069 @@ class P3DHLIMatFactory : public P3DMaterialFactory
    }
  };
 
-class P3DHLIBranchCalculator : public P3DBranchingFactory
+static void        P3DHLIFillCloneTransform
+                                      (const P3DStemModelInstance
+                                                          *Instance,
+                                       float             **OffsetBuffer,
+                                       float             **OrientationBuffer,
+                                       float             **ScaleBuffer)
  {
-  public           :
+  P3DMatrix4x4f  m;
+  P3DQuaternionf q;
 
-                   P3DHLIBranchCalculator
-                                      (P3DMathRNG         *RNG,
-                                       const P3DBranchModel
-                                                          *BranchModel,
-                                       const P3DStemModelInstance
-                                                          *Parent,
-                                       const P3DBranchModel
-                                                          *CountedBranch,
-                                       unsigned_int32       *Counter)
-   {
-    this->RNG           = RNG;
-    this->BranchModel   = BranchModel;
-    this->Parent        = Parent;
-    this->CountedBranch = CountedBranch;
-    this->Counter       = Counter;
-   }
+  Instance->GetWorldTransform(m.m);
 
-  virtual void     GenerateBranch     (float               Offset,
-                                       const P3DQuaternionf
-                                                          *Orientation)
+  if (OrientationBuffer != 0)
    {
-    if (BranchModel == CountedBranch)
-     {
-      (*Counter)++;
-     }
+    q.FromMatrix(m.m);
 
-    const P3DStemModel              *StemModel;
-    P3DStemModelInstance            *Instance;
-    unsigned_int32                     SubBranchIndex;
-    unsigned_int32                     SubBranchCount;
+    (*OrientationBuffer)[0] = q.q[0];
+    (*OrientationBuffer)[1] = q.q[1];
+    (*OrientationBuffer)[2] = q.q[2];
+    (*OrientationBuffer)[3] = q.q[3];
 
-    StemModel = BranchModel->GetStemModel();
+    *OrientationBuffer += 4;
+   }
 
-    if (StemModel != 0)
-     {
-      Instance = StemModel->CreateInstance(RNG,Parent,Offset,Orientation);
-     }
-    else
-     {
-      Instance = 0;
-     }
+  if (OffsetBuffer != 0)
+   {
+    (*OffsetBuffer)[0] = m.m[12];
+    (*OffsetBuffer)[1] = m.m[13];
+    (*OffsetBuffer)[2] = m.m[14];
 
-    SubBranchCount = BranchModel->GetSubBranchCount();
+    *OffsetBuffer += 3;
+   }
 
-    for (SubBranchIndex = 0; SubBranchIndex < SubBranchCount; SubBranchIndex++)
-     {
-      P3DHLIBranchCalculator         Calculator(RNG,
-                                                BranchModel->GetSubBranchModel(SubBranchIndex),
-                                                Instance,
-                                                CountedBranch,
-                                                Counter);
+  if (ScaleBuffer != 0)
+   {
+    (**ScaleBuffer) = Instance->GetScale();
 
-      const_cast<P3DBranchingAlg*>(BranchModel->GetSubBranchModel(SubBranchIndex)->GetBranchingAlg())
-       ->CreateBranches(&Calculator,Instance,RNG);
-     }
+    (*ScaleBuffer)++;
+   }
+ }
 
-    if (StemModel != 0)
-     {
-      StemModel->ReleaseInstance(Instance);
-     }
+static void        P3DHLIFillVAttr    (const P3DStemModelInstance
+                                                          *Instance,
+                                       unsigned_int32        Attr,
+                                       unsigned char     **Buffer)
+ {
+  unsigned_int32                         VAttrCount;
+  unsigned_int32                         Stride;
+
+  if      ((Attr == P3D_ATTR_VERTEX)   ||
+           (Attr == P3D_ATTR_NORMAL)   ||
+           (Attr == P3D_ATTR_TANGENT)  ||
+           (Attr == P3D_ATTR_BINORMAL))
+   {
+    Stride = sizeof(float) * 3;
+   }
+  else if (Attr == P3D_ATTR_TEXCOORD0)
+   {
+    Stride = sizeof(float) * 2;
+   }
+  else
+   {
+    return;
    }
 
-  private          :
+  VAttrCount = Instance->GetVAttrCount(Attr);
 
-  P3DMathRNG                          *RNG;
-  const P3DBranchModel                *BranchModel;
-  const P3DStemModelInstance          *Parent;
-  const P3DBranchModel                *CountedBranch;
-  unsigned_int32                        *Counter;
- };
+  Instance->GetVAttrValues(*Buffer,Stride,Attr,0,VAttrCount);
+
+  (*Buffer) += Stride * VAttrCount;
+ }
 
-class P3DHLIBranchCalculatorMulti : public P3DBranchingFactory
+static void        P3DHLIFillVAttrI   (const P3DStemModelInstance
+                                                          *Instance,
+                                       const P3DHLIVAttrFormat
+                                                          *VAttrFormat,
+                                       unsigned char     **Buffer)
  {
-  public           :
+  unsigned_int32                         VAttrCount;
 
-                   P3DHLIBranchCalculatorMulti
-                                      (P3DMathRNG         *RNG,
-                                       const P3DBranchModel
-                                                          *BranchModel,
-                                       const P3DStemModelInstance
-                                                          *Parent,
-                                       unsigned_int32        GroupIndex,
-                                       unsigned_int32       *Counters)
+  VAttrCount = Instance->GetVAttrCountI();
+
+  for (unsigned_int32 AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
    {
-    this->RNG           = RNG;
-    this->BranchModel   = BranchModel;
-    this->Parent        = Parent;
-    this->GroupIndex    = GroupIndex;
-    this->Counters      = Counters;
+    if (VAttrFormat->HasAttr(AttrIndex))
+     {
+      Instance->GetVAttrValuesI(&((*Buffer)[VAttrFormat->GetAttrOffset(AttrIndex)]),
+                                VAttrFormat->GetStride(),
+                                AttrIndex,
+                                0,
+                                VAttrCount);
+     }
    }
 
-  virtual void     GenerateBranch     (float               Offset,
-                                       const P3DQuaternionf
-                                                          *Orientation)
-   {
-    const P3DStemModel              *StemModel;
-    P3DStemModelInstance            *Instance;
-    unsigned_int32                     SubBranchIndex;
-    unsigned_int32                     SubBranchCount;
-    unsigned_int32                     SubGroupIndex;
+  (*Buffer) += VAttrFormat->GetStride() * VAttrCount;
+ }
 
-    StemModel = BranchModel->GetStemModel();
+static void        P3DHLIFillVAttrsI  (const P3DStemModelInstance
+                                                          *Instance,
+                                       const P3DHLIVAttrBuffers
+                                                          *VAttrBuffers,
+                                       void              **DataBuffers)
+ {
+  unsigned_int32                         VAttrCount;
 
-    if (StemModel != 0)
-     {
-      Instance      = StemModel->CreateInstance(RNG,Parent,Offset,Orientation);
-      SubGroupIndex = GroupIndex + 1;
+  VAttrCount = Instance->GetVAttrCountI();
 
-      Counters[GroupIndex]++;
-     }
-    else
+  for (unsigned_int32 AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+   {
+    if (VAttrBuffers->HasAttr(AttrIndex))
      {
-      Instance      = 0;
-      SubGroupIndex = 0;
+      Instance->GetVAttrValuesI
+       (&(((char*)(DataBuffers[AttrIndex]))[VAttrBuffers->GetAttrOffset(AttrIndex)]),
+         VAttrBuffers->GetAttrStride(AttrIndex),
+         AttrIndex,
+         0,
+         VAttrCount);
+
+      DataBuffers[AttrIndex] = ((char*)(DataBuffers[AttrIndex])) + VAttrBuffers->GetAttrStride(AttrIndex) * VAttrCount;
      }
+   }
+ }
+
+static void        P3DHLIFillVAttrSetI(const P3DStemModelInstance
+                                                          *Instance,
+                                       float             **VAttrBufferSet)
+ {
+  unsigned_int32                         VAttrCount;
 
-    SubBranchCount = BranchModel->GetSubBranchCount();
+  VAttrCount = Instance->GetVAttrCountI();
 
-    for (SubBranchIndex = 0; SubBranchIndex < SubBranchCount; SubBranchIndex++)
+  for (unsigned_int32 AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+   {
+    if (VAttrBufferSet[AttrIndex] != 0)
      {
-      P3DHLIBranchCalculatorMulti Calculator(RNG,
-                                             BranchModel->GetSubBranchModel(SubBranchIndex),
-                                             Instance,
-                                             SubGroupIndex,
-                                             Counters);
+      unsigned_int32                     ElementSize;
 
-      const_cast<P3DBranchingAlg*>(BranchModel->GetSubBranchModel(SubBranchIndex)->GetBranchingAlg())
-       ->CreateBranches(&Calculator,Instance,RNG);
+      ElementSize = AttrIndex == P3D_ATTR_TEXCOORD0 ? 2 : 3;
 
-      SubGroupIndex += CalcInternalGroupCount
-                        (BranchModel->GetSubBranchModel(SubBranchIndex));
-     }
+      Instance->GetVAttrValuesI(VAttrBufferSet[AttrIndex],
+                                sizeof(float) * ElementSize,
+                                AttrIndex,
+                                0,
+                                VAttrCount);
 
-    if (Instance != 0)
-     {
-      StemModel->ReleaseInstance(Instance);
+      VAttrBufferSet[AttrIndex] += ElementSize * VAttrCount;
      }
    }
+ }
 
-  private          :
-
-  P3DMathRNG                          *RNG;
-  const P3DBranchModel                *BranchModel;
-  const P3DStemModelInstance          *Parent;
-  unsigned_int32                         GroupIndex;
-  unsigned_int32                        *Counters;
- };
-
-class P3DHLIFillCloneTransformBufferHelper : public P3DBranchingFactory
+static void        P3DHLIUpdateBBox   (float              *Min,
+                                       float              *Max,
+                                       const P3DStemModelInstance
+                                                          *Instance)
  {
-  public           :
+  float                                InstMin[3];
+  float                                InstMax[3];
 
-                   P3DHLIFillCloneTransformBufferHelper
-                                      (P3DMathRNG         *RNG,
-                                       const P3DBranchModel
-                                                          *BranchModel,
-                                       const P3DStemModelInstance
-                                                          *Parent,
-                                       const P3DBranchModel
-                                                          *RequiredBranch,
-                                       float             **OffsetBuffer,
-                                       float             **OrientationBuffer,
-                                       float             **ScaleBuffer)
-   {
-    this->RNG               = RNG;
-    this->BranchModel       = BranchModel;
-    this->Parent            = Parent;
-    this->RequiredBranch    = RequiredBranch;
-    this->OffsetBuffer      = OffsetBuffer;
-    this->OrientationBuffer = OrientationBuffer;
-    this->ScaleBuffer       = ScaleBuffer;
-   }
+  Instance->GetBoundBox(InstMin,InstMax);
 
-  virtual void     GenerateBranch     (float               Offset,
-                                       const P3DQuaternionf
-                                                          *Orientation)
+  for (unsigned_int32 Axis = 0; Axis < 3; Axis++)
    {
-    const P3DStemModel                *StemModel;
-    P3DStemModelInstance              *Instance;
-
-    StemModel = BranchModel->GetStemModel();
-
-    if (StemModel != 0)
+    if      (InstMin[Axis] < Min[Axis])
      {
-      Instance = StemModel->CreateInstance(RNG,Parent,Offset,Orientation);
+      Min[Axis] = InstMin[Axis];
      }
-    else
+
+    if (InstMax[Axis] > Max[Axis])
      {
-      Instance = 0;
+      Max[Axis] = InstMax[Axis];
      }
+   }
+ }
 
-    if (BranchModel == RequiredBranch)
-     {
-      P3DMatrix4x4f  m;
-      P3DQuaternionf q;
 
-      Instance->GetWorldTransform(m.m);
+/* derive seed of independent RNG substream (used in subtree RNG mode) */
+static
+unsigned_int32       P3DHLIDeriveSeed   (unsigned_int32        Seed,
+                                       unsigned_int32        Index)
+ {
+  unsigned_int32                         Hash;
 
-      if (OrientationBuffer != 0)
-       {
-        q.FromMatrix(m.m);
+  Hash  = Seed + 0x9E3779B9U * (Index + 1);
+  Hash ^= Hash >> 16;
+  Hash *= 0x85EBCA6BU;
+  Hash ^= Hash >> 13;
+  Hash *= 0xC2B2AE35U;
+  Hash ^= Hash >> 16;
 
-        (*OrientationBuffer)[0] = q.q[0];
-        (*OrientationBuffer)[1] = q.q[1];
-        (*OrientationBuffer)[2] = q.q[2];
-        (*OrientationBuffer)[3] = q.q[3];
+  return(Hash);
+ }
 
-        *OrientationBuffer += 4;
-       }
+#define P3DHLI_ALG_STREAM_INDEX (0xFFFFFFFFU)
 
-      if (OffsetBuffer != 0)
-       {
-        (*OffsetBuffer)[0] = m.m[12];
-        (*OffsetBuffer)[1] = m.m[13];
-        (*OffsetBuffer)[2] = m.m[14];
+/* random stream of single branch (used in subtree RNG mode) */
+class P3DHLIStreamRNG
+ {
+  public           :
 
-        *OffsetBuffer += 3;
-       }
+                   P3DHLIStreamRNG    () : SimpleRNG(0), CounterRNG(0)
+   {
+    RNG = &SimpleRNG;
+   }
 
-      if (ScaleBuffer != 0)
-       {
-        (**ScaleBuffer) = Instance->GetScale();
+  P3DMathRNG      *SetStream          (bool                Counter,
+                                       unsigned_int32        Seed)
+   {
+    if (Counter)
+     {
+      CounterRNG.SetSeed(Seed);
 
-        (*ScaleBuffer)++;
-       }
+      RNG = &CounterRNG;
      }
-
-    unsigned_int32                     SubBranchIndex;
-    unsigned_int32                     SubBranchCount;
-
-    SubBranchCount = BranchModel->GetSubBranchCount();
-
-    for (SubBranchIndex = 0; SubBranchIndex < SubBranchCount; SubBranchIndex++)
+    else
      {
-      P3DHLIFillCloneTransformBufferHelper Helper(RNG,
-                                            BranchModel->GetSubBranchModel(SubBranchIndex),
-                                            Instance,
-                                            RequiredBranch,
-                                            OffsetBuffer,
-                                            OrientationBuffer,
-                                            ScaleBuffer);
+      SimpleRNG.SetSeed(Seed);
 
-      const_cast<P3DBranchingAlg*>(BranchModel->GetSubBranchModel(SubBranchIndex)->GetBranchingAlg())
-       ->CreateBranches(&Helper,Instance,RNG);
+      RNG = &SimpleRNG;
      }
 
-    if (StemModel != 0)
-     {
-      StemModel->ReleaseInstance(Instance);
-     }
+    return(RNG);
+   }
+
+  P3DMathRNG      *GetRNG             ()
+   {
+    return(RNG);
    }
 
   private          :
 
+  P3DMathRNGSimple                     SimpleRNG;
+  P3DMathRNGCounter                    CounterRNG;
   P3DMathRNG                          *RNG;
-  const P3DBranchModel                *BranchModel;
-  const P3DStemModelInstance          *Parent;
-  const P3DBranchModel                *RequiredBranch;
-  float                              **OffsetBuffer;
-  float                              **OrientationBuffer;
-  float                              **ScaleBuffer;
  };
 
-class P3DHLIFillVAttrBufferHelper : public P3DBranchingFactory
+/* per-group list of stem instances kept alive by materialized plant instance */
+/* and seeds of their random streams, used to regenerate their sub-branches.  */
+/* Instances are created and released by copy of group stem model owned by    */
+/* list, so stem models of template may be replaced and deleted while         */
+/* instances are alive                                                        */
+class P3DHLIBranchInstanceList
  {
   public           :
 
-                   P3DHLIFillVAttrBufferHelper
-                                      (P3DMathRNG         *RNG,
-                                       const P3DBranchModel
-                                                          *BranchModel,
-                                       const P3DStemModelInstance
-                                                          *Parent,
-                                       const P3DBranchModel
-                                                          *RequiredBranch,
-                                       unsigned_int32        Attr,
-                                       unsigned char     **Buffer)
+                   P3DHLIBranchInstanceList
+                                      ()
    {
-    this->RNG            = RNG;
-    this->BranchModel    = BranchModel;
-    this->Parent         = Parent;
-    this->RequiredBranch = RequiredBranch;
-    this->Attr           = Attr;
-    this->Buffer         = Buffer;
+    StemModel    = 0;
+    OwnStemModel = 0;
+    Instances    = 0;
+    Seeds     = 0;
+    Count     = 0;
+    Capacity  = 0;
    }
 
-  virtual void     GenerateBranch     (float               Offset,
-                                       const P3DQuaternionf
-                                                          *Orientation)
+                  ~P3DHLIBranchInstanceList
+                                      ()
+   {
+    Clear();
+
+    delete OwnStemModel;
+    delete[] Instances;
+    delete[] Seeds;
+   }
+
+  /* release all instances and replace stem model with copy of Source */
+  /* (may be 0)                                                       */
+  void             CopyStemModel      (const P3DStemModel *Source)
    {
-    const P3DStemModel                *StemModel;
-    P3DStemModelInstance              *Instance;
+    P3DStemModel                      *NewStemModel;
+
+    NewStemModel = Source != 0 ? Source->CreateCopy() : 0;
 
-    StemModel = BranchModel->GetStemModel();
+    Clear();
 
-    if (StemModel != 0)
+    delete OwnStemModel;
+
+    OwnStemModel = NewStemModel;
+    StemModel    = NewStemModel;
+   }
+
+  /* use stem model owned by other list, lists of subtree tasks share */
+  /* stem models of plant instance lists                              */
+  void             SetStemModel       (const P3DStemModel *StemModel)
+   {
+    this->StemModel = StemModel;
+   }
+
+  void             Append             (P3DStemModelInstance
+                                                          *Instance,
+                                       unsigned_int32        Seed)
+   {
+    if (Count == Capacity)
      {
-      Instance = StemModel->CreateInstance(RNG,Parent,Offset,Orientation);
+      Reserve(Capacity == 0 ? 16 : Capacity * 2);
      }
-    else
+
+    Instances[Count] = Instance;
+    Seeds[Count]     = Seed;
+
+    Count++;
+   }
+
+  /* move all instances from Source to the end of this list */
+  void             AppendList         (P3DHLIBranchInstanceList
+                                                          *Source)
+   {
+    if (Count + Source->Count > Capacity)
      {
-      Instance = 0;
+      Reserve(Count + Source->Count);
      }
 
-    if (BranchModel == RequiredBranch)
+    for (unsigned_int32 Index = 0; Index < Source->Count; Index++)
      {
-      unsigned_int32                     VAttrIndex;
-      unsigned_int32                     VAttrCount;
+      Instances[Count] = Source->Instances[Index];
+      Seeds[Count]     = Source->Seeds[Index];
 
-      VAttrCount = Instance->GetVAttrCount(Attr);
+      Count++;
+     }
 
-      for (VAttrIndex = 0; VAttrIndex < VAttrCount; VAttrIndex++)
-       {
-        if      (Attr == P3D_ATTR_VERTEX)
-         {
-          Instance->GetVAttrValue((float*)(*Buffer),P3D_ATTR_VERTEX,VAttrIndex);
+    Source->Count = 0;
+   }
 
-          (*Buffer) += sizeof(float) * 3;
-         }
-        else if (Attr == P3D_ATTR_NORMAL)
-         {
-          Instance->GetVAttrValue((float*)(*Buffer),P3D_ATTR_NORMAL,VAttrIndex);
+  /* release all instances (their arena memory is not reused) */
+  void             Clear              ()
+   {
+    for (unsigned_int32 Index = 0; Index < Count; Index++)
+     {
+      StemModel->ReleaseArenaInstance(Instances[Index]);
+     }
 
-          (*Buffer) += sizeof(float) * 3;
-         }
-        else if (Attr == P3D_ATTR_TEXCOORD0)
-         {
-          Instance->GetVAttrValue((float*)(*Buffer),P3D_ATTR_TEXCOORD0,VAttrIndex);
+    Count = 0;
+   }
 
-          (*Buffer) += sizeof(float) * 2;
-         }
-        else if (Attr == P3D_ATTR_TANGENT)
-         {
-          Instance->GetVAttrValue((float*)(*Buffer),P3D_ATTR_TANGENT,VAttrIndex);
+  const P3DStemModel
+                  *GetStemModel       () const
+   {
+    return(StemModel);
+   }
 
-          (*Buffer) += sizeof(float) * 3;
-         }
-        else if (Attr == P3D_ATTR_BINORMAL)
-         {
-          Instance->GetVAttrValue((float*)(*Buffer),P3D_ATTR_BINORMAL,VAttrIndex);
+  unsigned_int32     GetCount           () const
+   {
+    return(Count);
+   }
 
-          (*Buffer) += sizeof(float) * 3;
-         }
-       }
-     }
+  const P3DStemModelInstance
+                  *GetInstance        (unsigned_int32        Index) const
+   {
+    return(Instances[Index]);
+   }
+
+  unsigned_int32     GetSeed            (unsigned_int32        Index) const
+   {
+    return(Seeds[Index]);
+   }
+
+  private          :
 
-    unsigned_int32                     SubBranchIndex;
-    unsigned_int32                     SubBranchCount;
+  void             Reserve            (unsigned_int32        NewCapacity)
+   {
+    P3DStemModelInstance             **NewInstances;
+    unsigned_int32                      *NewSeeds;
 
-    SubBranchCount = BranchModel->GetSubBranchCount();
+    NewInstances = new P3DStemModelInstance*[NewCapacity];
 
-    for (SubBranchIndex = 0; SubBranchIndex < SubBranchCount; SubBranchIndex++)
+    try
      {
-      P3DHLIFillVAttrBufferHelper    Helper(RNG,
-                                            BranchModel->GetSubBranchModel(SubBranchIndex),
-                                            Instance,
-                                            RequiredBranch,
-                                            Attr,
-                                            Buffer);
+      NewSeeds = new unsigned_int32[NewCapacity];
+     }
+    catch (...)
+     {
+      delete[] NewInstances;
 
-      const_cast<P3DBranchingAlg*>(BranchModel->GetSubBranchModel(SubBranchIndex)->GetBranchingAlg())
-       ->CreateBranches(&Helper,Instance,RNG);
+      throw;
      }
 
-    if (StemModel != 0)
+    for (unsigned_int32 Index = 0; Index < Count; Index++)
      {
-      StemModel->ReleaseInstance(Instance);
+      NewInstances[Index] = Instances[Index];
+      NewSeeds[Index]     = Seeds[Index];
      }
-   }
 
-  private          :
+    delete[] Instances;
+    delete[] Seeds;
 
-  P3DMathRNG                          *RNG;
-  const P3DBranchModel                *BranchModel;
-  const P3DStemModelInstance          *Parent;
-  const P3DBranchModel                *RequiredBranch;
-  unsigned_int32                         Attr;
-  unsigned char                      **Buffer;
+    Instances = NewInstances;
+    Seeds     = NewSeeds;
+    Capacity  = NewCapacity;
+   }
+
+  const P3DStemModel                  *StemModel;
+  /* 0 if stem model is owned by other list */
+  P3DStemModel                        *OwnStemModel;
+  P3DStemModelInstance               **Instances;
+  unsigned_int32                        *Seeds;
+  unsigned_int32                         Count;
+  unsigned_int32                         Capacity;
  };
 
-class P3DHLIFillVAttrBufferIHelper : public P3DBranchingFactory
+#define P3DHLI_NO_GROUP (0xFFFFFFFFU)
+
+/* state of branch group at the moment its branches were generated */
+class P3DHLIGroupState
  {
   public           :
 
-                   P3DHLIFillVAttrBufferIHelper
-                                      (P3DMathRNG         *RNG,
-                                       const P3DBranchModel
+  void             Save               (const P3DBranchModel
                                                           *BranchModel,
-                                       const P3DStemModelInstance
-                                                          *Parent,
-                                       const P3DBranchModel
-                                                          *RequiredBranch,
-                                       const P3DHLIVAttrFormat
-                                                          *VAttrFormat,
-                                       unsigned char     **Buffer)
+                                       unsigned_int32        ParentGroup,
+                                       unsigned_int32        SubBranchIndex)
    {
-    this->RNG            = RNG;
     this->BranchModel    = BranchModel;
-    this->Parent         = Parent;
-    this->RequiredBranch = RequiredBranch;
-    this->VAttrFormat    = VAttrFormat;
-    this->Buffer         = Buffer;
+    this->ParentGroup    = ParentGroup;
+    this->SubBranchIndex = SubBranchIndex;
+
+    BranchRevision = BranchModel->GetRevision();
+    StemRevision   = BranchModel->GetStemModel() != 0 ?
+                      BranchModel->GetStemModel()->GetRevision() : 0;
+    AlgRevision    = BranchModel->GetBranchingAlg() != 0 ?
+                      BranchModel->GetBranchingAlg()->GetRevision() : 0;
    }
 
-  virtual void     GenerateBranch     (float               Offset,
-                                       const P3DQuaternionf
-                                                          *Orientation)
+  /* true if group has the same place in group hierarchy */
+  bool             IsSamePlace        (const P3DHLIGroupState
+                                                          *State) const
    {
-    const P3DStemModel                *StemModel;
-    P3DStemModelInstance              *Instance;
+    return((BranchModel    == State->BranchModel) &&
+           (ParentGroup    == State->ParentGroup) &&
+           (SubBranchIndex == State->SubBranchIndex));
+   }
 
-    StemModel = BranchModel->GetStemModel();
+  /* true if branches of group may differ from ones generated */
+  /* for State (group must have the same place)               */
+  bool             IsChanged          (const P3DHLIGroupState
+                                                          *State) const
+   {
+    return((BranchRevision != State->BranchRevision) ||
+           (StemRevision   != State->StemRevision)   ||
+           (AlgRevision    != State->AlgRevision));
+   }
 
-    if (StemModel != 0)
-     {
-      Instance = StemModel->CreateInstance(RNG,Parent,Offset,Orientation);
-     }
-    else
-     {
-      Instance = 0;
-     }
+  const P3DBranchModel                *BranchModel;
+  /* P3DHLI_NO_GROUP if parent is plant base */
+  unsigned_int32                         ParentGroup;
+  /* index of group branch model in parent branch model */
+  unsigned_int32                         SubBranchIndex;
+  /* changed when stem model is replaced, new model has its */
+  /* own revisions                                          */
+  unsigned_int32                         BranchRevision;
+  unsigned_int32                         StemRevision;
+  unsigned_int32                         AlgRevision;
+ };
 
-    if (BranchModel == RequiredBranch)
-     {
-      unsigned_int32                     VAttrIndex;
-      unsigned_int32                     VAttrCount;
+/* Visitor is called for every generated stem instance. If it returns */
+/* true, it takes ownership of the instance and instance will not be  */
+/* released after its sub-branches are generated. Arena memory of     */
+/* released instances is reused, so visitor must take ownership of    */
+/* either all instances or none of them. Seed is the seed of branch   */
+/* random stream derived from its position in plant hierarchy         */
+class P3DHLIBranchVisitor
+ {
+  public           :
 
-      VAttrCount = Instance->GetVAttrCountI();
+  virtual         ~P3DHLIBranchVisitor() {};
 
-      for (VAttrIndex = 0; VAttrIndex < VAttrCount; VAttrIndex++)
-       {
-        if (VAttrFormat->HasAttr(P3D_ATTR_VERTEX))
-         {
-          Instance->GetVAttrValueI((float*)(&((*Buffer)[VAttrFormat->GetAttrOffset(P3D_ATTR_VERTEX)])),
-                                   P3D_ATTR_VERTEX,
-                                   VAttrIndex);
-         }
+  virtual bool     Visit              (unsigned_int32        GroupIndex,
+                                       P3DStemModelInstance
+                                                          *Instance,
+                                       unsigned_int32        Seed) = 0;
+ };
 
-        if (VAttrFormat->HasAttr(P3D_ATTR_NORMAL))
-         {
-          Instance->GetVAttrValueI((float*)(&((*Buffer)[VAttrFormat->GetAttrOffset(P3D_ATTR_NORMAL)])),
-                                   P3D_ATTR_NORMAL,
-                                   VAttrIndex);
-         }
+/* Shared RNG state at entry and exit of every sub-branch list (all */
+/* branches of single sub-branch model of single parent branch),    */
+/* recorded in walk order during generation of whole plant. Until   */
+/* model is changed, any list may be generated later without        */
+/* generating preceding ones, or skipped by restoring RNG state at  */
+/* its exit. Table is not changed after recording, so it may be     */
+/* read by several walks at once                                    */
+#define P3DHLI_CHECKPOINT_SIZE (4) /* entry state, exit state, next checkpoint, group */
 
-        if (VAttrFormat->HasAttr(P3D_ATTR_TEXCOORD0))
-         {
-          Instance->GetVAttrValueI((float*)(&((*Buffer)[VAttrFormat->GetAttrOffset(P3D_ATTR_TEXCOORD0)])),
-                                   P3D_ATTR_TEXCOORD0,
-                                   VAttrIndex);
-         }
+class P3DHLICheckpointTable
+ {
+  public           :
 
-        if (VAttrFormat->HasAttr(P3D_ATTR_TANGENT))
-         {
-          Instance->GetVAttrValueI((float*)(&((*Buffer)[VAttrFormat->GetAttrOffset(P3D_ATTR_TANGENT)])),
-                                   P3D_ATTR_TANGENT,
-                                   VAttrIndex);
-         }
+                   P3DHLICheckpointTable
+                                      ()
+   {
+    States   = 0;
+    Count    = 0;
+    Capacity = 0;
+   }
 
-        if (VAttrFormat->HasAttr(P3D_ATTR_BINORMAL))
-         {
-          Instance->GetVAttrValueI((float*)(&((*Buffer)[VAttrFormat->GetAttrOffset(P3D_ATTR_BINORMAL)])),
-                                   P3D_ATTR_BINORMAL,
-                                   VAttrIndex);
-         }
+                  ~P3DHLICheckpointTable
+                                      ()
+   {
+    delete[] States;
+   }
 
-        if (VAttrFormat->HasAttr(P3D_ATTR_BILLBOARD_POS))
-         {
-          Instance->GetVAttrValueI((float*)(&((*Buffer)[VAttrFormat->GetAttrOffset(P3D_ATTR_BILLBOARD_POS)])),
-                                   P3D_ATTR_BILLBOARD_POS,
-                                   VAttrIndex);
-         }
+  /* called at list entry while recording, returns checkpoint index.  */
+  /* GroupIndex is group of list branches                             */
+  unsigned_int32     Open               (unsigned_int32        EntryState,
+                                       unsigned_int32        GroupIndex)
+   {
+    if (Count == Capacity)
+     {
+      unsigned_int32                    *NewStates;
+      unsigned_int32                     NewCapacity;
+
+      NewCapacity = Capacity == 0 ? 64 : Capacity * 2;
+      NewStates   = new unsigned_int32[NewCapacity * P3DHLI_CHECKPOINT_SIZE];
 
-        (*Buffer) += VAttrFormat->GetStride();
+      for (unsigned_int32 Index = 0; Index < Count * P3DHLI_CHECKPOINT_SIZE; Index++)
+       {
+        NewStates[Index] = States[Index];
        }
+
+      delete[] States;
+
+      States   = NewStates;
+      Capacity = NewCapacity;
      }
 
-    unsigned_int32                     SubBranchIndex;
-    unsigned_int32                     SubBranchCount;
+    States[Count * P3DHLI_CHECKPOINT_SIZE]     = EntryState;
+    States[Count * P3DHLI_CHECKPOINT_SIZE + 1] = EntryState;
+    States[Count * P3DHLI_CHECKPOINT_SIZE + 2] = Count + 1;
+    States[Count * P3DHLI_CHECKPOINT_SIZE + 3] = GroupIndex;
 
-    SubBranchCount = BranchModel->GetSubBranchCount();
+    return(Count++);
+   }
 
-    for (SubBranchIndex = 0; SubBranchIndex < SubBranchCount; SubBranchIndex++)
-     {
-      P3DHLIFillVAttrBufferIHelper   Helper(RNG,
-                                            BranchModel->GetSubBranchModel(SubBranchIndex),
-                                            Instance,
-                                            RequiredBranch,
-                                            VAttrFormat,
-                                            Buffer);
+  /* called at list exit while recording */
+  void             Close              (unsigned_int32        Checkpoint,
+                                       unsigned_int32        ExitState)
+   {
+    States[Checkpoint * P3DHLI_CHECKPOINT_SIZE + 1] = ExitState;
+    States[Checkpoint * P3DHLI_CHECKPOINT_SIZE + 2] = Count;
+   }
 
-      const_cast<P3DBranchingAlg*>(BranchModel->GetSubBranchModel(SubBranchIndex)->GetBranchingAlg())
-       ->CreateBranches(&Helper,Instance,RNG);
-     }
+  unsigned_int32     GetCount           () const
+   {
+    return(Count);
+   }
 
-    if (StemModel != 0)
-     {
-      StemModel->ReleaseInstance(Instance);
-     }
+  unsigned_int32     GetEntryState      (unsigned_int32        Checkpoint) const
+   {
+    return(States[Checkpoint * P3DHLI_CHECKPOINT_SIZE]);
+   }
+
+  unsigned_int32     GetExitState       (unsigned_int32        Checkpoint) const
+   {
+    return(States[Checkpoint * P3DHLI_CHECKPOINT_SIZE + 1]);
+   }
+
+  /* index of first checkpoint recorded after list was closed */
+  unsigned_int32     GetNext            (unsigned_int32        Checkpoint) const
+   {
+    return(States[Checkpoint * P3DHLI_CHECKPOINT_SIZE + 2]);
+   }
+
+  unsigned_int32     GetGroup           (unsigned_int32        Checkpoint) const
+   {
+    return(States[Checkpoint * P3DHLI_CHECKPOINT_SIZE + 3]);
    }
 
   private          :
 
-  P3DMathRNG                          *RNG;
-  const P3DBranchModel                *BranchModel;
-  const P3DStemModelInstance          *Parent;
-  const P3DBranchModel                *RequiredBranch;
-  const P3DHLIVAttrFormat             *VAttrFormat;
-  unsigned char                      **Buffer;
+  unsigned_int32                        *States;
+  unsigned_int32                         Count;
+  unsigned_int32                         Capacity;
  };
 
-class P3DHLIFillVAttrBuffersIHelper : public P3DBranchingFactory
+/* reads checkpoints in the same order they were recorded */
+class P3DHLICheckpointReader
  {
   public           :
 
-                   P3DHLIFillVAttrBuffersIHelper
-                                      (P3DMathRNG         *RNG,
-                                       const P3DBranchModel
-                                                          *BranchModel,
-                                       const P3DStemModelInstance
-                                                          *Parent,
-                                       const P3DBranchModel
-                                                          *RequiredBranch,
-                                       const P3DHLIVAttrBuffers
-                                                          *VAttrBuffers,
-                                       void              **DataBuffers)
+                   P3DHLICheckpointReader
+                                      (const P3DHLICheckpointTable
+                                                          *Table)
    {
-    this->RNG            = RNG;
-    this->BranchModel    = BranchModel;
-    this->Parent         = Parent;
-    this->RequiredBranch = RequiredBranch;
-    this->VAttrBuffers   = VAttrBuffers;
-    this->DataBuffers    = DataBuffers;
+    this->Table = Table;
+    Position    = 0;
    }
 
-  virtual void     GenerateBranch     (float               Offset,
-                                       const P3DQuaternionf
-                                                          *Orientation)
+  /* read checkpoint of list being entered, lists nested into it */
+  /* are read next, unless Skip is called                        */
+  void             Next               (unsigned_int32        EntryState)
    {
-    const P3DStemModel                *StemModel;
-    P3DStemModelInstance              *Instance;
-
-    StemModel = BranchModel->GetStemModel();
-
-    if (StemModel != 0)
-     {
-      Instance = StemModel->CreateInstance(RNG,Parent,Offset,Orientation);
-     }
-    else
+    if ((Position == Table->GetCount()) ||
+        (Table->GetEntryState(Position) != EntryState))
      {
-      Instance = 0;
+      throw P3DExceptionGeneric("RNG checkpoint mismatch");
      }
 
-    if (BranchModel == RequiredBranch)
-     {
-      unsigned_int32                     VAttrIndex;
-      unsigned_int32                     VAttrCount;
-
-      VAttrCount = Instance->GetVAttrCountI();
+    Position++;
+   }
 
-      for (VAttrIndex = 0; VAttrIndex < VAttrCount; VAttrIndex++)
-       {
-        if (VAttrBuffers->HasAttr(P3D_ATTR_VERTEX))
-         {
-          Instance->GetVAttrValueI
-           ((float*)(&(((char*)(DataBuffers[P3D_ATTR_VERTEX]))[VAttrBuffers->GetAttrOffset(P3D_ATTR_VERTEX)])),
-             P3D_ATTR_VERTEX,
-             VAttrIndex);
+  /* skip list which checkpoint was read last, returns RNG state at its exit */
+  unsigned_int32     Skip               ()
+   {
+    unsigned_int32                       Checkpoint;
 
-          DataBuffers[P3D_ATTR_VERTEX] = ((char*)(DataBuffers[P3D_ATTR_VERTEX])) + VAttrBuffers->GetAttrStride(P3D_ATTR_VERTEX);
-         }
+    Checkpoint = Position - 1;
+    Position   = Table->GetNext(Checkpoint);
 
-        if (VAttrBuffers->HasAttr(P3D_ATTR_NORMAL))
-         {
-          Instance->GetVAttrValueI
-           ((float*)(&(((char*)(DataBuffers[P3D_ATTR_NORMAL]))[VAttrBuffers->GetAttrOffset(P3D_ATTR_NORMAL)])),
-             P3D_ATTR_NORMAL,
-             VAttrIndex);
+    return(Table->GetExitState(Checkpoint));
+   }
 
-          DataBuffers[P3D_ATTR_NORMAL] = ((char*)(DataBuffers[P3D_ATTR_NORMAL])) + VAttrBuffers->GetAttrStride(P3D_ATTR_NORMAL);
-         }
+  private          :
 
-        if (VAttrBuffers->HasAttr(P3D_ATTR_TEXCOORD0))
-         {
-          Instance->GetVAttrValueI
-           ((float*)(&(((char*)(DataBuffers[P3D_ATTR_TEXCOORD0]))[VAttrBuffers->GetAttrOffset(P3D_ATTR_TEXCOORD0)])),
-             P3D_ATTR_TEXCOORD0,
-             VAttrIndex);
+  const P3DHLICheckpointTable         *Table;
+  unsigned_int32                         Position;
+ };
 
-          DataBuffers[P3D_ATTR_TEXCOORD0] = ((char*)(DataBuffers[P3D_ATTR_TEXCOORD0])) + VAttrBuffers->GetAttrStride(P3D_ATTR_TEXCOORD0);
-         }
+/* Copies recorded checkpoints to new table, except lists of single */
+/* group, which are recorded to new table again while they are      */
+/* regenerated. Lists enclosing them are closed when all their      */
+/* nested checkpoints are copied, so next checkpoint indices of new */
+/* table are valid                                                  */
+class P3DHLICheckpointSplicer
+ {
+  public           :
 
-        if (VAttrBuffers->HasAttr(P3D_ATTR_TANGENT))
-         {
-          Instance->GetVAttrValueI
-           ((float*)(&(((char*)(DataBuffers[P3D_ATTR_TANGENT]))[VAttrBuffers->GetAttrOffset(P3D_ATTR_TANGENT)])),
-             P3D_ATTR_TANGENT,
-             VAttrIndex);
+                   P3DHLICheckpointSplicer
+                                      (const P3DHLICheckpointTable
+                                                          *Source,
+                                       P3DHLICheckpointTable
+                                                          *Target,
+                                       unsigned_int32        MaxDepth)
+   {
+    this->Source = Source;
+    this->Target = Target;
+    Position     = 0;
+    OpenCount    = 0;
+    OpenCapacity = MaxDepth;
+    OpenLists    = new unsigned_int32[MaxDepth * 2];
+   }
 
-          DataBuffers[P3D_ATTR_TANGENT] = ((char*)(DataBuffers[P3D_ATTR_TANGENT])) + VAttrBuffers->GetAttrStride(P3D_ATTR_TANGENT);
-         }
+                  ~P3DHLICheckpointSplicer
+                                      ()
+   {
+    delete[] OpenLists;
+   }
 
-        if (VAttrBuffers->HasAttr(P3D_ATTR_BINORMAL))
-         {
-          Instance->GetVAttrValueI
-           ((float*)(&(((char*)(DataBuffers[P3D_ATTR_BINORMAL]))[VAttrBuffers->GetAttrOffset(P3D_ATTR_BINORMAL)])),
-             P3D_ATTR_BINORMAL,
-             VAttrIndex);
+  /* copy checkpoints preceding next list of GroupIndex, returns false */
+  /* if there are no more such lists (all checkpoints are copied then) */
+  bool             CopyToList         (unsigned_int32        GroupIndex,
+                                       unsigned_int32       *Checkpoint)
+   {
+    while (Position < Source->GetCount())
+     {
+      CloseLists();
 
-          DataBuffers[P3D_ATTR_BINORMAL] = ((char*)(DataBuffers[P3D_ATTR_BINORMAL])) + VAttrBuffers->GetAttrStride(P3D_ATTR_BINORMAL);
-         }
+      if (Source->GetGroup(Position) == GroupIndex)
+       {
+        *Checkpoint = Position;
 
-        if (VAttrBuffers->HasAttr(P3D_ATTR_BILLBOARD_POS))
-         {
-          Instance->GetVAttrValueI
-           ((float*)(&(((char*)(DataBuffers[P3D_ATTR_BILLBOARD_POS]))[VAttrBuffers->GetAttrOffset(P3D_ATTR_BILLBOARD_POS)])),
-             P3D_ATTR_BILLBOARD_POS,
-             VAttrIndex);
+        return(true);
+       }
 
-          DataBuffers[P3D_ATTR_BILLBOARD_POS] = ((char*)(DataBuffers[P3D_ATTR_BILLBOARD_POS])) + VAttrBuffers->GetAttrStride(P3D_ATTR_BILLBOARD_POS);
-         }
+      if (OpenCount == OpenCapacity)
+       {
+        throw P3DExceptionGeneric("RNG checkpoint mismatch");
        }
+
+      OpenLists[OpenCount * 2]     = Position;
+      OpenLists[OpenCount * 2 + 1] = Target->Open(Source->GetEntryState(Position),
+                                                  Source->GetGroup(Position));
+
+      OpenCount++;
+      Position++;
      }
 
-    unsigned_int32                     SubBranchIndex;
-    unsigned_int32                     SubBranchCount;
+    CloseLists();
 
-    SubBranchCount = BranchModel->GetSubBranchCount();
+    return(false);
+   }
 
-    for (SubBranchIndex = 0; SubBranchIndex < SubBranchCount; SubBranchIndex++)
-     {
-      P3DHLIFillVAttrBuffersIHelper  Helper(RNG,
-                                            BranchModel->GetSubBranchModel(SubBranchIndex),
-                                            Instance,
-                                            RequiredBranch,
-                                            VAttrBuffers,
-                                            DataBuffers);
+  /* skip list returned by CopyToList and its nested checkpoints */
+  void             SkipList           (unsigned_int32        Checkpoint)
+   {
+    Position = Source->GetNext(Checkpoint);
+   }
 
-      const_cast<P3DBranchingAlg*>(BranchModel->GetSubBranchModel(SubBranchIndex)->GetBranchingAlg())
-       ->CreateBranches(&Helper,Instance,RNG);
-     }
+  private          :
 
-    if (StemModel != 0)
+  /* close copied lists which end before current position */
+  void             CloseLists         ()
+   {
+    while ((OpenCount > 0) &&
+           (Source->GetNext(OpenLists[(OpenCount - 1) * 2]) <= Position))
      {
-      StemModel->ReleaseInstance(Instance);
+      OpenCount--;
+
+      Target->Close(OpenLists[OpenCount * 2 + 1],
+                    Source->GetExitState(OpenLists[OpenCount * 2]));
      }
    }
 
-  private          :
+  const P3DHLICheckpointTable         *Source;
+  P3DHLICheckpointTable               *Target;
+  unsigned_int32                         Position;
+  /* pairs of source and target checkpoints of lists being copied */
+  unsigned_int32                        *OpenLists;
+  unsigned_int32                         OpenCount;
+  unsigned_int32                         OpenCapacity;
+ };
+
+class P3DHLISubtreeTaskList;
+
+class P3DHLIWalkContext
+ {
+  public           :
 
+  P3DHLIBranchVisitor                 *Visitor;
+  /* stem instances are allocated from here */
+  P3DMemoryArena                      *Arena;
+  /* RNG shared by the whole walk, 0 if randomness is disabled */
   P3DMathRNG                          *RNG;
-  const P3DBranchModel                *BranchModel;
-  const P3DStemModelInstance          *Parent;
-  const P3DBranchModel                *RequiredBranch;
-  const P3DHLIVAttrBuffers            *VAttrBuffers;
-  void                               **DataBuffers;
+  /* if true, every branch uses its own RNG stream derived from its path */
+  bool                                 SubtreeRNG;
+  /* if true, branch streams are produced by P3DMathRNGCounter */
+  bool                                 CounterRNG;
+  /* if not 0, sub-branches of branches at SplitDepth are not */
+  /* generated but queued here                                */
+  P3DHLISubtreeTaskList               *Tasks;
+  unsigned_int32                         SplitDepth;
+  /* same as RNG if all branches share single LCG stream, 0 otherwise */
+  P3DMathRNGSimple                    *SharedRNG;
+  /* must be specified if SharedRNG is used and sub-branch lists may be */
+  /* queued or skipped                                                  */
+  P3DHLICheckpointReader              *Checkpoints;
+  /* if not 0, SharedRNG states of all sub-branch lists are recorded */
+  /* here, all branches are generated in this case                   */
+  P3DHLICheckpointTable               *NewCheckpoints;
+  /* if not P3DHLI_NO_GROUP, sub-branch lists which subtrees do not */
+  /* contain branches of this group are skipped                     */
+  unsigned_int32                         RequiredGroup;
+  /* if not 0, stem instances of every group are created and released */
+  /* by stem model of its item, otherwise by stem models of template  */
+  const P3DHLIBranchInstanceList      *StemModels;
  };
 
-class P3DHLIFillVAttrBuffersIMultiHelper : public P3DBranchingFactory
+/* branching factory used for algorithms which do not support step-by-step */
+/* generation - every generated branch is walked by separate engine call   */
+class P3DHLIBranchWalker : public P3DBranchingFactory
  {
   public           :
 
-                   P3DHLIFillVAttrBuffersIMultiHelper
-                                      (P3DMathRNG         *RNG,
+                   P3DHLIBranchWalker (const P3DHLIWalkContext
+                                                          *Context,
                                        const P3DBranchModel
                                                           *BranchModel,
                                        const P3DStemModelInstance
                                                           *Parent,
                                        unsigned_int32        GroupIndex,
-                                       P3DHLIVAttrBufferSet
-                                                          *VAttrBufferSetArray)
+                                       unsigned_int32        Depth,
+                                       unsigned_int32        StreamSeed)
    {
-    this->RNG                 = RNG;
-    this->BranchModel         = BranchModel;
-    this->Parent              = Parent;
-    this->GroupIndex          = GroupIndex;
-    this->VAttrBufferSetArray = VAttrBufferSetArray;
+    this->Context     = Context;
+    this->BranchModel = BranchModel;
+    this->Parent      = Parent;
+    this->GroupIndex  = GroupIndex;
+    this->Depth       = Depth;
+    this->StreamSeed  = StreamSeed;
+
+    BranchOrdinal = 0;
    }
 
   virtual void     GenerateBranch     (float               Offset,
                                        const P3DQuaternionf
-                                                          *Orientation)
-   {
-    const P3DStemModel                *StemModel;
-    P3DStemModelInstance              *Instance;
+                                                          *Orientation);
+
+  private          :
+
+  const P3DHLIWalkContext             *Context;
+  const P3DBranchModel                *BranchModel;
+  const P3DStemModelInstance          *Parent;
+  unsigned_int32                         GroupIndex;
+  unsigned_int32                         Depth;
+  unsigned_int32                         StreamSeed;
+  unsigned_int32                         BranchOrdinal;
+ };
+
+/* task which catches exceptions thrown during execution, so they  */
+/* can be rethrown in calling thread after all tasks are completed */
+class P3DHLITask : public P3DTask
+ {
+  public           :
 
-    StemModel = BranchModel->GetStemModel();
+                   P3DHLITask         ()
+   {
+    Failed          = false;
+    ErrorMessage[0] = 0;
+   }
 
-    if (StemModel != 0)
+  virtual void     Run                ()
+   {
+    try
      {
-      Instance = StemModel->CreateInstance(RNG,Parent,Offset,Orientation);
+      Execute();
      }
-    else
+    catch (P3DException &Exception)
      {
-      Instance = 0;
+      SetError(Exception.GetMessage());
      }
-
-    if (Instance != 0)
+    catch (...)
      {
-      unsigned_int32                     VAttrIndex;
-      unsigned_int32                     VAttrCount;
+      SetError("out of memory");
+     }
+   }
 
-      VAttrCount = Instance->GetVAttrCountI();
+  virtual void     Execute            () = 0;
 
-      for (VAttrIndex = 0; VAttrIndex < VAttrCount; VAttrIndex++)
-       {
-        if (VAttrBufferSetArray[GroupIndex][P3D_ATTR_VERTEX] != 0)
-         {
-          Instance->GetVAttrValueI
-           (VAttrBufferSetArray[GroupIndex][P3D_ATTR_VERTEX],
-            P3D_ATTR_VERTEX,
-            VAttrIndex);
+  bool             IsFailed           () const
+   {
+    return(Failed);
+   }
 
-          VAttrBufferSetArray[GroupIndex][P3D_ATTR_VERTEX] += 3;
-         }
+  const char      *GetErrorMessage    () const
+   {
+    return(ErrorMessage);
+   }
 
-        if (VAttrBufferSetArray[GroupIndex][P3D_ATTR_NORMAL] != 0)
-         {
-          Instance->GetVAttrValueI
-           (VAttrBufferSetArray[GroupIndex][P3D_ATTR_NORMAL],
-            P3D_ATTR_NORMAL,
-            VAttrIndex);
+  private          :
 
-          VAttrBufferSetArray[GroupIndex][P3D_ATTR_NORMAL] += 3;
-         }
+  void             SetError           (const char         *Message)
+   {
+    strncpy(ErrorMessage,Message,sizeof(ErrorMessage) - 1);
 
-        if (VAttrBufferSetArray[GroupIndex][P3D_ATTR_TEXCOORD0] != 0)
-         {
-          Instance->GetVAttrValueI
-           (VAttrBufferSetArray[GroupIndex][P3D_ATTR_TEXCOORD0],
-            P3D_ATTR_TEXCOORD0,
-            VAttrIndex);
+    ErrorMessage[sizeof(ErrorMessage) - 1] = 0;
 
-          VAttrBufferSetArray[GroupIndex][P3D_ATTR_TEXCOORD0] += 2;
-         }
+    Failed = true;
+   }
 
-        if (VAttrBufferSetArray[GroupIndex][P3D_ATTR_TANGENT] != 0)
-         {
-          Instance->GetVAttrValueI
-           (VAttrBufferSetArray[GroupIndex][P3D_ATTR_TANGENT],
-            P3D_ATTR_TANGENT,
-            VAttrIndex);
+  bool                                 Failed;
+  char                                 ErrorMessage[P3DExceptionGenericMessageMaxLen + 1];
+ };
 
-          VAttrBufferSetArray[GroupIndex][P3D_ATTR_TANGENT] += 3;
-         }
+class P3DHLISubtreeTask : public P3DHLITask
+ {
+  public           :
 
-        if (VAttrBufferSetArray[GroupIndex][P3D_ATTR_BINORMAL] != 0)
-         {
-          Instance->GetVAttrValueI
-           (VAttrBufferSetArray[GroupIndex][P3D_ATTR_BINORMAL],
-            P3D_ATTR_BINORMAL,
-            VAttrIndex);
+                   P3DHLISubtreeTask  ()
+   {
+    Branches = 0;
+   }
 
-          VAttrBufferSetArray[GroupIndex][P3D_ATTR_BINORMAL] += 3;
-         }
+                  ~P3DHLISubtreeTask  ()
+   {
+    delete[] Branches;
+   }
 
-        if (VAttrBufferSetArray[GroupIndex][P3D_ATTR_BILLBOARD_POS] != 0)
-         {
-          Instance->GetVAttrValueI
-           (VAttrBufferSetArray[GroupIndex][P3D_ATTR_BILLBOARD_POS],
-            P3D_ATTR_BILLBOARD_POS,
-            VAttrIndex);
+  virtual void     Execute            ();
 
-          VAttrBufferSetArray[GroupIndex][P3D_ATTR_BILLBOARD_POS] += 3;
-         }
-       }
-     }
+  /* sub-branch list parameters */
+  const P3DHLIWalkContext             *Context;
+  const P3DBranchModel                *SubBranchModel;
+  unsigned_int32                         SubBranchIndex;
+  const P3DStemModelInstance          *Parent;
+  unsigned_int32                         SubGroupIndex;
+  unsigned_int32                         Depth;
+  unsigned_int32                         Seed;
+  /* shared RNG state at list entry (if shared RNG is used) */
+  unsigned_int32                         RNGState;
+
+  /* results */
+  P3DHLIBranchInstanceList            *Branches;
+  P3DMemoryArena                       Arena;
+ };
+
+class P3DHLISubtreeTaskList
+ {
+  public           :
 
-    unsigned_int32                     SubBranchIndex;
-    unsigned_int32                     SubBranchCount;
-    unsigned_int32                     SubGroupIndex;
+                   P3DHLISubtreeTaskList
+                                      ()
+   {
+    Tasks    = 0;
+    Count    = 0;
+    Capacity = 0;
+   }
 
-    if (StemModel != 0)
-     {
-      SubGroupIndex = GroupIndex + 1;
-     }
-    else
+                  ~P3DHLISubtreeTaskList
+                                      ()
+   {
+    for (unsigned_int32 Index = 0; Index < Count; Index++)
      {
-      SubGroupIndex = 0;
+      delete Tasks[Index];
      }
 
-    SubBranchCount = BranchModel->GetSubBranchCount();
+    delete[] Tasks;
+   }
 
-    for (SubBranchIndex = 0; SubBranchIndex < SubBranchCount; SubBranchIndex++)
+  P3DHLISubtreeTask
+                  *Append             ()
+   {
+    if (Count == Capacity)
      {
-      P3DHLIFillVAttrBuffersIMultiHelper
-                                       Helper(RNG,
-                                              BranchModel->GetSubBranchModel(SubBranchIndex),
-                                              Instance,
-                                              SubGroupIndex,
-                                              VAttrBufferSetArray);
+      P3DHLISubtreeTask              **NewTasks;
+      unsigned_int32                     NewCapacity;
 
-      const_cast<P3DBranchingAlg*>(BranchModel->GetSubBranchModel(SubBranchIndex)->GetBranchingAlg())
-       ->CreateBranches(&Helper,Instance,RNG);
+      NewCapacity = Capacity == 0 ? 16 : Capacity * 2;
+      NewTasks    = new P3DHLISubtreeTask*[NewCapacity];
 
-      SubGroupIndex += CalcInternalGroupCount
-                        (BranchModel->GetSubBranchModel(SubBranchIndex));
-     }
+      for (unsigned_int32 Index = 0; Index < Count; Index++)
+       {
+        NewTasks[Index] = Tasks[Index];
+       }
 
-    if (Instance != 0)
-     {
-      StemModel->ReleaseInstance(Instance);
+      delete[] Tasks;
+
+      Tasks    = NewTasks;
+      Capacity = NewCapacity;
      }
+
+    Tasks[Count] = new P3DHLISubtreeTask();
+
+    return(Tasks[Count++]);
+   }
+
+  unsigned_int32     GetCount           () const
+   {
+    return(Count);
+   }
+
+  P3DHLISubtreeTask
+                  *GetTask            (unsigned_int32        Index) const
+   {
+    return(Tasks[Index]);
    }
 
   private          :
 
-  P3DMathRNG                          *RNG;
-  const P3DBranchModel                *BranchModel;
-  const P3DStemModelInstance          *Parent;
-  unsigned_int32                         GroupIndex;
-  P3DHLIVAttrBufferSet                *VAttrBufferSetArray;
+  P3DHLISubtreeTask                  **Tasks;
+  unsigned_int32                         Count;
+  unsigned_int32                         Capacity;
  };
 
-                   P3DHLIVAttrFormat::P3DHLIVAttrFormat
-                                      (unsigned_int32        Stride)
+/* calculate number of branch levels in model subtree */
+static
+unsigned_int32       CalcBranchDepth    (const P3DBranchModel
+                                                          *BranchModel)
  {
-  for (unsigned_int32 Index = 0; Index < P3D_MAX_ATTRS; Index++)
+  unsigned_int32                         Result;
+  unsigned_int32                         SubBranchCount;
+
+  Result         = 0;
+  SubBranchCount = BranchModel->GetSubBranchCount();
+
+  for (unsigned_int32 SubBranchIndex = 0; SubBranchIndex < SubBranchCount; SubBranchIndex++)
    {
-    Enabled[Index] = false;
-    Offsets[Index] = 0;
+    unsigned_int32                       SubDepth;
+
+    SubDepth = CalcBranchDepth(BranchModel->GetSubBranchModel(SubBranchIndex));
+
+    if (SubDepth > Result)
+     {
+      Result = SubDepth;
+     }
    }
 
-  this->Stride = Stride;
+  return(Result + 1);
  }
 
-bool               P3DHLIVAttrFormat::HasAttr
-                                      (unsigned_int32        Attr) const
+/* save states of all groups of BranchModel sub-branches, GroupIndex is */
+/* BranchModel group (P3DHLI_NO_GROUP for plant base), SubGroupIndex -  */
+/* group of its first sub-branch                                        */
+static void        P3DHLISaveGroupStates
+                                      (P3DHLIGroupState   *States,
+                                       const P3DBranchModel
+                                                          *BranchModel,
+                                       unsigned_int32        GroupIndex,
+                                       unsigned_int32        SubGroupIndex)
  {
-  if (Attr < P3D_MAX_ATTRS)
-   {
-    return(Enabled[Attr]);
-   }
-  else
+  unsigned_int32                         SubBranchCount;
+
+  SubBranchCount = BranchModel->GetSubBranchCount();
+
+  for (unsigned_int32 SubBranchIndex = 0; SubBranchIndex < SubBranchCount; SubBranchIndex++)
    {
-    throw P3DExceptionGeneric("invalid vertex attribute");
+    const P3DBranchModel              *SubBranchModel;
+
+    SubBranchModel = BranchModel->GetSubBranchModel(SubBranchIndex);
+
+    States[SubGroupIndex].Save(SubBranchModel,GroupIndex,SubBranchIndex);
+
+    P3DHLISaveGroupStates(States,SubBranchModel,SubGroupIndex,SubGroupIndex + 1);
+
+    SubGroupIndex += CalcInternalGroupCount(SubBranchModel);
    }
  }
 
-unsigned_int32       P3DHLIVAttrFormat::GetAttrOffset
-                                      (unsigned_int32        Attr) const
+/* walk state of single branch */
+class P3DHLIWalkFrame
  {
-  if (Attr < P3D_MAX_ATTRS)
-   {
-    return(Offsets[Attr]);
-   }
-  else
+  public           :
+
+                   P3DHLIWalkFrame    ()
    {
-    throw P3DExceptionGeneric("invalid vertex attribute");
    }
- }
 
-unsigned_int32       P3DHLIVAttrFormat::GetStride
-                                      () const
- {
-  return(Stride);
- }
+  const P3DBranchModel                *BranchModel;
+  P3DStemModelInstance                *Instance;
+  P3DMemoryArenaMark                   ArenaMark;
+  bool                                 Owned;
+  unsigned_int32                         GroupIndex;
+  unsigned_int32                         Depth;
+  unsigned_int32                         Seed;
 
-void               P3DHLIVAttrFormat::AddAttr
-                                      (unsigned_int32        Attr,
-                                       unsigned_int32        Offset)
+  /* sub-branch model which branches are generated now */
+  unsigned_int32                         SubBranchIndex;
+  unsigned_int32                         SubGroupIndex;
+  unsigned_int32                         SubStreamSeed;
+  unsigned_int32                         BranchOrdinal;
+  unsigned_int32                         Checkpoint;
+  bool                                 CursorActive;
+  P3DBranchingCursor                   Cursor;
+  P3DHLIStreamRNG                      AlgRNG;
+ };
+
+static void        P3DHLIEnterBranch  (const P3DHLIWalkContext
+                                                          *Context,
+                                       P3DHLIWalkFrame    *Frame,
+                                       const P3DBranchModel
+                                                          *BranchModel,
+                                       const P3DStemModelInstance
+                                                          *Parent,
+                                       unsigned_int32        GroupIndex,
+                                       unsigned_int32        Depth,
+                                       float               Offset,
+                                       const P3DQuaternionf
+                                                          *Orientation,
+                                       unsigned_int32        Seed)
  {
-  if (Attr < P3D_MAX_ATTRS)
+  const P3DStemModel                  *StemModel;
+  P3DHLIStreamRNG                      NodeRNG;
+  P3DMathRNG                          *RNG;
+
+  if ((Context->SubtreeRNG) && (Context->RNG != 0))
    {
-    Enabled[Attr] = true;
-    Offsets[Attr] = Offset;
+    RNG = NodeRNG.SetStream(Context->CounterRNG,Seed);
    }
   else
    {
-    throw P3DExceptionGeneric("invalid vertex attribute");
+    RNG = Context->RNG;
    }
- }
 
-static void        CheckVAttrValidity (unsigned_int32        Attr)
- {
-  if (Attr >= P3D_MAX_ATTRS)
+  Frame->BranchModel    = BranchModel;
+  Frame->Instance       = 0;
+  Frame->ArenaMark      = Context->Arena->GetMark();
+  Frame->Owned          = false;
+  Frame->GroupIndex     = GroupIndex;
+  Frame->Depth          = Depth;
+  Frame->Seed           = Seed;
+  Frame->SubBranchIndex = 0;
+  Frame->SubGroupIndex  = 0;
+  Frame->CursorActive   = false;
+
+  StemModel = BranchModel->GetStemModel();
+
+  if ((StemModel != 0) && (Context->StemModels != 0))
    {
-    throw P3DExceptionGeneric("invalid vertex attribute");
+    StemModel = Context->StemModels[GroupIndex].GetStemModel();
    }
- }
 
-                   P3DHLIVAttrBuffers::P3DHLIVAttrBuffers
-                                      ()
- {
-  for (unsigned_int32 Index = 0; Index < P3D_MAX_ATTRS; Index++)
+  if (StemModel != 0)
    {
-    Buffers[Index] = 0;
-    Offsets[Index] = 0;
-    Strides[Index] = 0;
+    Frame->Instance      = StemModel->CreateArenaInstance(Context->Arena,RNG,Parent,Offset,Orientation);
+    Frame->SubGroupIndex = GroupIndex + 1;
    }
  }
 
-void               P3DHLIVAttrBuffers::AddAttr
-                                      (unsigned_int32        Attr,
-                                       void               *Data,
-                                       unsigned_int32        Offset,
-                                       unsigned_int32        Stride)
+static void        P3DHLILeaveBranch  (const P3DHLIWalkContext
+                                                          *Context,
+                                       P3DHLIWalkFrame    *Frame)
  {
-  CheckVAttrValidity(Attr);
+  if ((Frame->Instance != 0) && (!Frame->Owned))
+   {
+    if (Context->StemModels != 0)
+     {
+      Context->StemModels[Frame->GroupIndex].GetStemModel()->ReleaseArenaInstance(Frame->Instance);
+     }
+    else
+     {
+      Frame->BranchModel->GetStemModel()->ReleaseArenaInstance(Frame->Instance);
+     }
 
-  Buffers[Attr] = Data;
-  Offsets[Attr] = Offset;
-  Strides[Attr] = Stride;
+    /* instances are released in reverse order, so their */
+    /* memory can be reused by next sibling branches     */
+    Context->Arena->Rewind(Frame->ArenaMark);
+   }
  }
 
-bool               P3DHLIVAttrBuffers::HasAttr
-                                      (unsigned_int32        Attr) const
+/* Called before branches of sub-branch model SubBranchModel of frame */
+/* branch are generated. Returns true if they are skipped or queued   */
+static bool        P3DHLIBeginSubBranch
+                                      (const P3DHLIWalkContext
+                                                          *Context,
+                                       P3DHLIWalkFrame    *Frame,
+                                       const P3DBranchModel
+                                                          *SubBranchModel)
  {
-  CheckVAttrValidity(Attr);
+  bool                                 Skip;
+  bool                                 Queue;
+  unsigned_int32                         RNGState;
 
-  return(Buffers[Attr] != 0);
- }
+  Skip  = (Context->RequiredGroup != P3DHLI_NO_GROUP) &&
+          ((Context->RequiredGroup < Frame->SubGroupIndex) ||
+           (Context->RequiredGroup >= Frame->SubGroupIndex + CalcInternalGroupCount(SubBranchModel)));
+  Queue = (Context->Tasks != 0) && (Frame->Depth == Context->SplitDepth);
 
-void              *P3DHLIVAttrBuffers::GetAttrBuffer
-                                      (unsigned_int32        Attr) const
- {
-  CheckVAttrValidity(Attr);
+  if (Context->NewCheckpoints != 0)
+   {
+    Frame->Checkpoint = Context->NewCheckpoints->Open(Context->SharedRNG->GetState(),
+                                                      Frame->SubGroupIndex);
 
-  return(Buffers[Attr]);
- }
+    return(false);
+   }
 
-unsigned_int32       P3DHLIVAttrBuffers::GetAttrOffset
-                                      (unsigned_int32        Attr) const
- {
-  CheckVAttrValidity(Attr);
+  RNGState = 0;
 
-  return(Offsets[Attr]);
+  if (Context->Checkpoints != 0)
+   {
+    RNGState = Context->SharedRNG->GetState();
+
+    Context->Checkpoints->Next(RNGState);
+
+    if ((Skip) || (Queue))
+     {
+      Context->SharedRNG->SetState(Context->Checkpoints->Skip());
+     }
+   }
+
+  if (Skip)
+   {
+    return(true);
+   }
+
+  if (Queue)
+   {
+    P3DHLISubtreeTask                 *Task;
+
+    Task = Context->Tasks->Append();
+
+    Task->Context        = Context;
+    Task->SubBranchModel = SubBranchModel;
+    Task->SubBranchIndex = Frame->SubBranchIndex;
+    Task->Parent         = Frame->Instance;
+    Task->SubGroupIndex  = Frame->SubGroupIndex;
+    Task->Depth          = Frame->Depth;
+    Task->Seed           = Frame->Seed;
+    Task->RNGState       = RNGState;
+
+    return(true);
+   }
+
+  return(false);
  }
 
-unsigned_int32       P3DHLIVAttrBuffers::GetAttrStride
-                                      (unsigned_int32        Attr) const
+static void        P3DHLIEndSubBranch (const P3DHLIWalkContext
+                                                          *Context,
+                                       P3DHLIWalkFrame    *Frame)
  {
-  CheckVAttrValidity(Attr);
-
-  return(Strides[Attr]);
+  if (Context->NewCheckpoints != 0)
+   {
+    Context->NewCheckpoints->Close(Frame->Checkpoint,Context->SharedRNG->GetState());
+   }
  }
 
-static
-const P3DBranchModel
-                  *GetBranchModelByIndex
-                                      (const P3DPlantModel*Model,
-                                       unsigned_int32        Index)
+/* stack of this size is enough for most plants, deeper ones use heap */
+#define P3DHLI_WALK_STACK_SIZE (16)
+
+/* Generate branch and all its sub-branches, passing every stem instance */
+/* to visitor. Tree is walked using explicit stack instead of recursion, */
+/* except branching algorithms which do not support step-by-step mode.   */
+static void        P3DHLIWalkBranch   (const P3DHLIWalkContext
+                                                          *Context,
+                                       const P3DBranchModel
+                                                          *BranchModel,
+                                       const P3DStemModelInstance
+                                                          *Parent,
+                                       unsigned_int32        GroupIndex,
+                                       unsigned_int32        Depth,
+                                       float               Offset,
+                                       const P3DQuaternionf
+                                                          *Orientation,
+                                       unsigned_int32        Seed)
  {
-  const P3DBranchModel                *BranchModel;
+  P3DHLIWalkFrame                      LocalFrames[P3DHLI_WALK_STACK_SIZE];
+  P3DHLIWalkFrame                     *Frames;
+  unsigned_int32                         FrameCount;
+  unsigned_int32                         MaxDepth;
+  bool                                 SubtreeRNG;
 
-  BranchModel = P3DPlantModel::GetBranchModelByIndex(Model,Index);
+  MaxDepth   = CalcBranchDepth(BranchModel);
+  SubtreeRNG = (Context->SubtreeRNG) && (Context->RNG != 0);
 
-  if (BranchModel == 0)
+  if (MaxDepth > P3DHLI_WALK_STACK_SIZE)
    {
-    throw P3DExceptionGeneric("group index out of range");
+    Frames = new P3DHLIWalkFrame[MaxDepth];
+   }
+  else
+   {
+    Frames = LocalFrames;
    }
 
-  return(BranchModel);
- }
+  FrameCount = 0;
 
-                   P3DHLIPlantTemplate::P3DHLIPlantTemplate
-                                      (P3DInputStringStream
-                                                          *SourceStream)
- {
-  P3DHLIMatFactory                     MaterialFactory;
+  try
+   {
+    P3DHLIEnterBranch(Context,&Frames[0],BranchModel,Parent,GroupIndex,Depth,Offset,Orientation,Seed);
 
-  OwnedModel.Load(SourceStream,&MaterialFactory);
-  Model = &OwnedModel;
- }
+    FrameCount++;
 
-                   P3DHLIPlantTemplate::P3DHLIPlantTemplate
-                                      (const P3DPlantModel*SourceModel)
- {
-  Model = SourceModel;
- }
+    if (Frames[0].Instance != 0)
+     {
+      Frames[0].Owned = Context->Visitor->Visit(GroupIndex,Frames[0].Instance,Seed);
+     }
 
-unsigned_int32       P3DHLIPlantTemplate::GetGroupCount
-                                      () const
- {
-  return(CalcInternalGroupCount(Model->GetPlantBase()) - 1);
- }
+    while (FrameCount > 0)
+     {
+      P3DHLIWalkFrame                 *Frame;
+      const P3DBranchModel            *SubBranchModel;
+      const P3DBranchingAlg           *BranchingAlg;
+      P3DMathRNG                      *AlgRNG;
+      float                            SubOffset;
+      P3DQuaternionf                   SubOrientation;
 
-const char        *P3DHLIPlantTemplate::GetGroupName
-                                      (unsigned_int32        GroupIndex) const
- {
-  return(GetBranchModelByIndex(Model,GroupIndex)->GetName());
- }
+      Frame = &Frames[FrameCount - 1];
 
-const
-P3DMaterialDef    *P3DHLIPlantTemplate::GetMaterial
-                                      (unsigned_int32        GroupIndex) const
- {
-  return(GetBranchModelByIndex(Model,GroupIndex)->
-          GetMaterialInstance()->GetMaterialDef());
- }
+      if (Frame->SubBranchIndex == Frame->BranchModel->GetSubBranchCount())
+       {
+        P3DHLILeaveBranch(Context,Frame);
 
-void               P3DHLIPlantTemplate::GetBillboardSize
-                                      (float              *Width,
-                                       float              *Height,
-                                       unsigned_int32        GroupIndex) const
- {
-  const P3DBranchModel                *BranchModel;
+        FrameCount--;
 
-  BranchModel = GetBranchModelByIndex(Model,GroupIndex);
+        continue;
+       }
 
-  const P3DStemModelQuad *QuadModel = dynamic_cast<const P3DStemModelQuad*>(BranchModel->GetStemModel());
+      SubBranchModel = Frame->BranchModel->GetSubBranchModel(Frame->SubBranchIndex);
+      BranchingAlg   = SubBranchModel->GetBranchingAlg();
+      AlgRNG         = SubtreeRNG ? Frame->AlgRNG.GetRNG() : Context->RNG;
 
-  if (QuadModel != 0)
+      if (!Frame->CursorActive)
+       {
+        if (P3DHLIBeginSubBranch(Context,Frame,SubBranchModel))
+         {
+          Frame->SubGroupIndex += CalcInternalGroupCount(SubBranchModel);
+          Frame->SubBranchIndex++;
+
+          continue;
+         }
+
+        Frame->SubStreamSeed = P3DHLIDeriveSeed(Frame->Seed,Frame->SubBranchIndex);
+        Frame->BranchOrdinal = 0;
+
+        if (SubtreeRNG)
+         {
+          AlgRNG = Frame->AlgRNG.SetStream(Context->CounterRNG,
+                                           P3DHLIDeriveSeed(Frame->SubStreamSeed,P3DHLI_ALG_STREAM_INDEX));
+         }
+
+        Frame->CursorActive = BranchingAlg->BeginBranches(&Frame->Cursor,Frame->Instance,AlgRNG);
+
+        if (!Frame->CursorActive)
+         {
+          P3DHLIBranchWalker           Walker(Context,
+                                              SubBranchModel,
+                                              Frame->Instance,
+                                              Frame->SubGroupIndex,
+                                              Frame->Depth + 1,
+                                              Frame->SubStreamSeed);
+
+          const_cast<P3DBranchingAlg*>(BranchingAlg)->CreateBranches
+           (&Walker,Frame->Instance,AlgRNG);
+
+          P3DHLIEndSubBranch(Context,Frame);
+
+          Frame->SubGroupIndex += CalcInternalGroupCount(SubBranchModel);
+          Frame->SubBranchIndex++;
+
+          continue;
+         }
+       }
+
+      if (BranchingAlg->NextBranch(&Frame->Cursor,&SubOffset,&SubOrientation,Frame->Instance,AlgRNG))
+       {
+        unsigned_int32                   SubSeed;
+
+        SubSeed = P3DHLIDeriveSeed(Frame->SubStreamSeed,Frame->BranchOrdinal++);
+
+        P3DHLIWalkFrame             *SubFrame;
+
+        SubFrame = &Frames[FrameCount];
+
+        P3DHLIEnterBranch(Context,
+                          SubFrame,
+                          SubBranchModel,
+                          Frame->Instance,
+                          Frame->SubGroupIndex,
+                          Frame->Depth + 1,
+                          SubOffset,
+                          &SubOrientation,
+                          SubSeed);
+
+        FrameCount++;
+
+        if (SubFrame->Instance != 0)
+         {
+          SubFrame->Owned = Context->Visitor->Visit(SubFrame->GroupIndex,SubFrame->Instance,SubSeed);
+         }
+       }
+      else
+       {
+        Frame->CursorActive = false;
+
+        P3DHLIEndSubBranch(Context,Frame);
+
+        Frame->SubGroupIndex += CalcInternalGroupCount(SubBranchModel);
+        Frame->SubBranchIndex++;
+       }
+     }
+   }
+  catch (...)
    {
-    if (QuadModel->IsBillboard())
+    while (FrameCount > 0)
      {
-      *Width  = QuadModel->GetWidth();
-      *Height = QuadModel->GetLength();
+      FrameCount--;
 
-      return;
+      P3DHLILeaveBranch(Context,&Frames[FrameCount]);
+     }
+
+    if (Frames != LocalFrames)
+     {
+      delete[] Frames;
      }
+
+    throw;
    }
 
-  throw P3DExceptionGeneric("trying to get billboard size for non-billboard branches");
+  if (Frames != LocalFrames)
+   {
+    delete[] Frames;
+   }
  }
 
-bool               P3DHLIPlantTemplate::IsCloneable
-                                      (unsigned_int32        GroupIndex,
-                                       bool                AllowScaling) const
+void               P3DHLIBranchWalker::GenerateBranch
+                                      (float               Offset,
+                                       const P3DQuaternionf
+                                                          *Orientation)
  {
-  return GetBranchModelByIndex(Model,GroupIndex)->GetStemModel()->IsCloneable(AllowScaling);
- }
+  unsigned_int32                         Seed;
 
-bool               P3DHLIPlantTemplate::IsLODVisRangeEnabled
-                                      (unsigned_int32        GroupIndex) const
- {
-  return(GetBranchModelByIndex(Model,GroupIndex)->
-          GetVisRangeState()->IsEnabled());
- }
+  Seed = P3DHLIDeriveSeed(StreamSeed,BranchOrdinal++);
 
-void               P3DHLIPlantTemplate::GetLODVisRange
-                                      (float              *MinLOD,
-                                       float              *MaxLOD,
-                                       unsigned_int32        GroupIndex) const
- {
-  GetBranchModelByIndex(Model,GroupIndex)->
-   GetVisRangeState()->GetRange(MinLOD,MaxLOD);
+  P3DHLIWalkBranch(Context,BranchModel,Parent,GroupIndex,Depth,Offset,Orientation,Seed);
  }
 
-unsigned_int32       P3DHLIPlantTemplate::GetVAttrCount
-                                      (unsigned_int32        GroupIndex,
-                                       unsigned_int32        Attr) const
+/* Generate all branches of sub-branch model SubBranchIndex of Parent  */
+/* (0 for plant base) and their sub-branches. Parent branch has given  */
+/* Depth and Seed. Branches are the same as generated by full walk.    */
+static void        P3DHLIWalkSubBranch(const P3DHLIWalkContext
+                                                          *Context,
+                                       const P3DBranchModel
+                                                          *SubBranchModel,
+                                       unsigned_int32        SubBranchIndex,
+                                       const P3DStemModelInstance
+                                                          *Parent,
+                                       unsigned_int32        SubGroupIndex,
+                                       unsigned_int32        Depth,
+                                       unsigned_int32        Seed)
  {
-  return(GetBranchModelByIndex(Model,GroupIndex)->
-          GetStemModel()->GetVAttrCount(Attr));
+  const P3DBranchingAlg               *BranchingAlg;
+  P3DHLIStreamRNG                      StreamRNG;
+  P3DMathRNG                          *AlgRNG;
+  P3DBranchingCursor                   Cursor;
+  unsigned_int32                         SubStreamSeed;
+
+  BranchingAlg  = SubBranchModel->GetBranchingAlg();
+  SubStreamSeed = P3DHLIDeriveSeed(Seed,SubBranchIndex);
+
+  if ((Context->SubtreeRNG) && (Context->RNG != 0))
+   {
+    AlgRNG = StreamRNG.SetStream(Context->CounterRNG,
+                                 P3DHLIDeriveSeed(SubStreamSeed,P3DHLI_ALG_STREAM_INDEX));
+   }
+  else
+   {
+    AlgRNG = Context->RNG;
+   }
+
+  if (BranchingAlg->BeginBranches(&Cursor,Parent,AlgRNG))
+   {
+    unsigned_int32                       BranchOrdinal;
+    float                              SubOffset;
+    P3DQuaternionf                     SubOrientation;
+
+    BranchOrdinal = 0;
+
+    while (BranchingAlg->NextBranch(&Cursor,&SubOffset,&SubOrientation,Parent,AlgRNG))
+     {
+      P3DHLIWalkBranch(Context,
+                       SubBranchModel,
+                       Parent,
+                       SubGroupIndex,
+                       Depth + 1,
+                       SubOffset,
+                       &SubOrientation,
+                       P3DHLIDeriveSeed(SubStreamSeed,BranchOrdinal++));
+     }
+   }
+  else
+   {
+    P3DHLIBranchWalker                 Walker(Context,
+                                              SubBranchModel,
+                                              Parent,
+                                              SubGroupIndex,
+                                              Depth + 1,
+                                              SubStreamSeed);
+
+    const_cast<P3DBranchingAlg*>(BranchingAlg)->CreateBranches
+     (&Walker,Parent,AlgRNG);
+   }
  }
 
-void               P3DHLIPlantTemplate::FillCloneVAttrBuffer
-                                      (void               *VAttrBuffer,
-                                       unsigned_int32        GroupIndex,
-                                       unsigned_int32        Attr) const
+/* generates plant once, storing every stem instance in its group list */
+/* instead of releasing it. Per-group instance order is the same as    */
+/* order in which other visitors see them                              */
+class P3DHLIMaterializeVisitor : public P3DHLIBranchVisitor
  {
-  GetBranchModelByIndex(Model,GroupIndex)->GetStemModel()->
-   FillCloneVAttrBuffer(VAttrBuffer,Attr);
- }
+  public           :
 
-unsigned_int32       P3DHLIPlantTemplate::GetPrimitiveCount
-                                      (unsigned_int32        GroupIndex) const
+                   P3DHLIMaterializeVisitor
+                                      (P3DHLIBranchInstanceList
+                                                          *Branches)
+   {
+    this->Branches = Branches;
+   }
+
+  virtual bool     Visit              (unsigned_int32        GroupIndex,
+                                       P3DStemModelInstance
+                                                          *Instance,
+                                       unsigned_int32        Seed)
+   {
+    Branches[GroupIndex].Append(Instance,Seed);
+
+    return(true);
+   }
+
+  private          :
+
+  P3DHLIBranchInstanceList            *Branches;
+ };
+
+void               P3DHLISubtreeTask::Execute
+                                      ()
  {
-  return(GetBranchModelByIndex(Model,GroupIndex)->
-          GetStemModel()->GetPrimitiveCount());
+  P3DHLIMaterializeVisitor             Visitor(Branches);
+  P3DHLIWalkContext                    TaskContext;
+  P3DMathRNGSimple                     SubtreeRNG(0);
+
+  TaskContext.Visitor        = &Visitor;
+  TaskContext.Arena          = &Arena;
+  TaskContext.RNG            = Context->RNG;
+  TaskContext.SubtreeRNG     = Context->SubtreeRNG;
+  TaskContext.CounterRNG     = Context->CounterRNG;
+  TaskContext.Tasks          = 0;
+  TaskContext.SplitDepth     = 0;
+  TaskContext.SharedRNG      = 0;
+  TaskContext.Checkpoints    = 0;
+  TaskContext.NewCheckpoints = 0;
+  TaskContext.RequiredGroup  = P3DHLI_NO_GROUP;
+  TaskContext.StemModels     = Context->StemModels;
+
+  /* shared sequence is continued from checkpoint */
+  if (Context->SharedRNG != 0)
+   {
+    SubtreeRNG.SetState(RNGState);
+
+    TaskContext.RNG = &SubtreeRNG;
+   }
+
+  P3DHLIWalkSubBranch(&TaskContext,
+                      SubBranchModel,
+                      SubBranchIndex,
+                      Parent,
+                      SubGroupIndex,
+                      Depth,
+                      Seed);
  }
 
-unsigned_int32       P3DHLIPlantTemplate::GetPrimitiveType
-                                      (unsigned_int32        GroupIndex,
-                                       unsigned_int32        PrimitiveIndex) const
+class P3DHLICountVisitor : public P3DHLIBranchVisitor
  {
-  return(GetBranchModelByIndex(Model,GroupIndex)->
-          GetStemModel()->GetPrimitiveType(PrimitiveIndex));
- }
+  public           :
 
-void               P3DHLIPlantTemplate::FillVAttrIndexBuffer
-                                      (void               *IndexBuffer,
-                                       unsigned_int32        GroupIndex,
+                   P3DHLICountVisitor (unsigned_int32       *Counters)
+   {
+    this->Counters = Counters;
+   }
+
+  virtual bool     Visit              (unsigned_int32        GroupIndex,
+                                       P3DStemModelInstance
+                                                          *Instance P3D_UNUSED_ATTR,
+                                       unsigned_int32        Seed P3D_UNUSED_ATTR)
+   {
+    Counters[GroupIndex]++;
+
+    return(false);
+   }
+
+  private          :
+
+  unsigned_int32                        *Counters;
+ };
+
+#define P3DHLI_FUSED_VISITOR_MAX_COUNT (4)
+
+/* passes every instance to several visitors, so they share single walk */
+class P3DHLIFusedVisitor : public P3DHLIBranchVisitor
+ {
+  public           :
+
+                   P3DHLIFusedVisitor ()
+   {
+    VisitorCount = 0;
+   }
+
+  void             AddVisitor         (P3DHLIBranchVisitor*Visitor)
+   {
+    if (VisitorCount == P3DHLI_FUSED_VISITOR_MAX_COUNT)
+     {
+      throw P3DExceptionGeneric("too many fused visitors");
+     }
+
+    Visitors[VisitorCount++] = Visitor;
+   }
+
+  /* returns true if any of visitors took ownership of instance */
+  virtual bool     Visit              (unsigned_int32        GroupIndex,
+                                       P3DStemModelInstance
+                                                          *Instance,
+                                       unsigned_int32        Seed)
+   {
+    bool                               Owned;
+
+    Owned = false;
+
+    for (unsigned_int32 Index = 0; Index < VisitorCount; Index++)
+     {
+      if (Visitors[Index]->Visit(GroupIndex,Instance,Seed))
+       {
+        Owned = true;
+       }
+     }
+
+    return(Owned);
+   }
+
+  private          :
+
+  P3DHLIBranchVisitor                 *Visitors[P3DHLI_FUSED_VISITOR_MAX_COUNT];
+  unsigned_int32                         VisitorCount;
+ };
+
+class P3DHLIBBoxVisitor : public P3DHLIBranchVisitor
+ {
+  public           :
+
+                   P3DHLIBBoxVisitor  (float              *Min,
+                                       float              *Max)
+   {
+    this->Min = Min;
+    this->Max = Max;
+   }
+
+  virtual bool     Visit              (unsigned_int32        GroupIndex P3D_UNUSED_ATTR,
+                                       P3DStemModelInstance
+                                                          *Instance,
+                                       unsigned_int32        Seed P3D_UNUSED_ATTR)
+   {
+    P3DHLIUpdateBBox(Min,Max,Instance);
+
+    return(false);
+   }
+
+  private          :
+
+  float                               *Min;
+  float                               *Max;
+ };
+
+class P3DHLIFillCloneTransformVisitor : public P3DHLIBranchVisitor
+ {
+  public           :
+
+                   P3DHLIFillCloneTransformVisitor
+                                      (unsigned_int32        RequiredGroup,
+                                       float             **OffsetBuffer,
+                                       float             **OrientationBuffer,
+                                       float             **ScaleBuffer)
+   {
+    this->RequiredGroup     = RequiredGroup;
+    this->OffsetBuffer      = OffsetBuffer;
+    this->OrientationBuffer = OrientationBuffer;
+    this->ScaleBuffer       = ScaleBuffer;
+   }
+
+  virtual bool     Visit              (unsigned_int32        GroupIndex,
+                                       P3DStemModelInstance
+                                                          *Instance,
+                                       unsigned_int32        Seed P3D_UNUSED_ATTR)
+   {
+    if (GroupIndex == RequiredGroup)
+     {
+      P3DHLIFillCloneTransform(Instance,OffsetBuffer,OrientationBuffer,ScaleBuffer);
+     }
+
+    return(false);
+   }
+
+  private          :
+
+  unsigned_int32                         RequiredGroup;
+  float                              **OffsetBuffer;
+  float                              **OrientationBuffer;
+  float                              **ScaleBuffer;
+ };
+
+class P3DHLIFillVAttrVisitor : public P3DHLIBranchVisitor
+ {
+  public           :
+
+                   P3DHLIFillVAttrVisitor
+                                      (unsigned_int32        RequiredGroup,
                                        unsigned_int32        Attr,
-                                       unsigned_int32        ElementType,
-                                       unsigned_int32        IndexBase) const
+                                       unsigned char     **Buffer)
+   {
+    this->RequiredGroup = RequiredGroup;
+    this->Attr          = Attr;
+    this->Buffer        = Buffer;
+   }
+
+  virtual bool     Visit              (unsigned_int32        GroupIndex,
+                                       P3DStemModelInstance
+                                                          *Instance,
+                                       unsigned_int32        Seed P3D_UNUSED_ATTR)
+   {
+    if (GroupIndex == RequiredGroup)
+     {
+      P3DHLIFillVAttr(Instance,Attr,Buffer);
+     }
+
+    return(false);
+   }
+
+  private          :
+
+  unsigned_int32                         RequiredGroup;
+  unsigned_int32                         Attr;
+  unsigned char                      **Buffer;
+ };
+
+class P3DHLIFillVAttrIVisitor : public P3DHLIBranchVisitor
  {
-  GetBranchModelByIndex(Model,GroupIndex)->GetStemModel()->
-   FillVAttrIndexBuffer(IndexBuffer,Attr,ElementType,IndexBase);
- }
+  public           :
 
-unsigned_int32       P3DHLIPlantTemplate::GetVAttrCountI
-                                      (unsigned_int32        GroupIndex) const
+                   P3DHLIFillVAttrIVisitor
+                                      (unsigned_int32        RequiredGroup,
+                                       const P3DHLIVAttrFormat
+                                                          *VAttrFormat,
+                                       unsigned char     **Buffer)
+   {
+    this->RequiredGroup = RequiredGroup;
+    this->VAttrFormat   = VAttrFormat;
+    this->Buffer        = Buffer;
+   }
+
+  virtual bool     Visit              (unsigned_int32        GroupIndex,
+                                       P3DStemModelInstance
+                                                          *Instance,
+                                       unsigned_int32        Seed P3D_UNUSED_ATTR)
+   {
+    if (GroupIndex == RequiredGroup)
+     {
+      P3DHLIFillVAttrI(Instance,VAttrFormat,Buffer);
+     }
+
+    return(false);
+   }
+
+  private          :
+
+  unsigned_int32                         RequiredGroup;
+  const P3DHLIVAttrFormat             *VAttrFormat;
+  unsigned char                      **Buffer;
+ };
+
+class P3DHLIFillVAttrsIVisitor : public P3DHLIBranchVisitor
  {
-  return(GetBranchModelByIndex(Model,GroupIndex)->
-          GetStemModel()->GetVAttrCountI());
- }
+  public           :
 
-void               P3DHLIPlantTemplate::FillCloneVAttrBuffersI
-                                      (const P3DHLIVAttrBuffers
+                   P3DHLIFillVAttrsIVisitor
+                                      (unsigned_int32        RequiredGroup,
+                                       const P3DHLIVAttrBuffers
                                                           *VAttrBuffers,
-                                       unsigned_int32        GroupIndex) const
+                                       void              **DataBuffers)
+   {
+    this->RequiredGroup = RequiredGroup;
+    this->VAttrBuffers  = VAttrBuffers;
+    this->DataBuffers   = DataBuffers;
+   }
+
+  virtual bool     Visit              (unsigned_int32        GroupIndex,
+                                       P3DStemModelInstance
+                                                          *Instance,
+                                       unsigned_int32        Seed P3D_UNUSED_ATTR)
+   {
+    if (GroupIndex == RequiredGroup)
+     {
+      P3DHLIFillVAttrsI(Instance,VAttrBuffers,DataBuffers);
+     }
+
+    return(false);
+   }
+
+  private          :
+
+  unsigned_int32                         RequiredGroup;
+  const P3DHLIVAttrBuffers            *VAttrBuffers;
+  void                               **DataBuffers;
+ };
+
+class P3DHLIFillVAttrSetIVisitor : public P3DHLIBranchVisitor
  {
-  const P3DStemModel                  *StemModel;
-  unsigned_int32                         AttrIndex;
+  public           :
 
-  StemModel = GetBranchModelByIndex(Model,GroupIndex)->GetStemModel();
+                   P3DHLIFillVAttrSetIVisitor
+                                      (P3DHLIVAttrBufferSet
+                                                          *VAttrBufferSetArray)
+   {
+    this->VAttrBufferSetArray = VAttrBufferSetArray;
+   }
 
-  for (AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+  virtual bool     Visit              (unsigned_int32        GroupIndex,
+                                       P3DStemModelInstance
+                                                          *Instance,
+                                       unsigned_int32        Seed P3D_UNUSED_ATTR)
    {
-    if (VAttrBuffers->HasAttr(AttrIndex))
+    P3DHLIFillVAttrSetI(Instance,VAttrBufferSetArray[GroupIndex]);
+
+    return(false);
+   }
+
+  private          :
+
+  P3DHLIVAttrBufferSet                *VAttrBufferSetArray;
+ };
+
+/* fill task for range of branches of materialized group */
+class P3DHLIFillVAttrSetITask : public P3DHLITask
+ {
+  public           :
+
+  virtual void     Execute            ()
+   {
+    for (unsigned_int32 Index = FirstBranch; Index < LastBranch; Index++)
      {
-      StemModel->FillCloneVAttrBufferI
-       (&((char*)(VAttrBuffers->GetAttrBuffer(AttrIndex)))[VAttrBuffers->GetAttrOffset(AttrIndex)],
-        AttrIndex,
-        VAttrBuffers->GetAttrStride(AttrIndex));
+      P3DHLIFillVAttrSetI(Branches->GetInstance(Index),VAttrBufferSet);
      }
    }
- }
 
-unsigned_int32       P3DHLIPlantTemplate::GetIndexCount
-                                      (unsigned_int32        GroupIndex,
-                                       unsigned_int32        PrimitiveType) const
+  const P3DHLIBranchInstanceList      *Branches;
+  unsigned_int32                         FirstBranch;
+  unsigned_int32                         LastBranch;
+  P3DHLIVAttrBufferSet                 VAttrBufferSet;
+ };
+
+/* write position in buffers of single group during FillAll */
+class P3DHLIFillAllGroup
  {
-  return(GetBranchModelByIndex(Model,GroupIndex)->
-          GetStemModel()->GetIndexCount(PrimitiveType));
- }
+  public           :
 
-void               P3DHLIPlantTemplate::FillIndexBuffer
-                                      (void               *IndexBuffer,
-                                       unsigned_int32        GroupIndex,
-                                       unsigned_int32        PrimitiveType,
-                                       unsigned_int32        ElementType,
-                                       unsigned_int32        IndexBase) const
+  const P3DHLIGroupBuffers            *Buffers;
+  const P3DStemModel                  *StemModel;
+  void                                *DataBuffers[P3D_MAX_ATTRS];
+  unsigned char                       *IndexBuffer;
+  /* size of branch indices in bytes */
+  unsigned_int32                         IndexBufferStep;
+  /* index of first vertex of next branch */
+  unsigned_int32                         IndexBase;
+  float                               *OffsetBuffer;
+  float                               *OrientationBuffer;
+  float                               *ScaleBuffer;
+ };
+
+static void        P3DHLIFillAll      (P3DHLIFillAllGroup *Group,
+                                       const P3DStemModelInstance
+                                                          *Instance,
+                                       float              *Min,
+                                       float              *Max)
  {
-  GetBranchModelByIndex(Model,GroupIndex)->GetStemModel()->
-   FillIndexBuffer(IndexBuffer,PrimitiveType,ElementType,IndexBase);
+  if (Group->Buffers->GetVAttrBuffers() != 0)
+   {
+    P3DHLIFillVAttrsI(Instance,Group->Buffers->GetVAttrBuffers(),Group->DataBuffers);
+   }
+
+  if (Group->IndexBuffer != 0)
+   {
+    Group->StemModel->FillIndexBuffer(Group->IndexBuffer,
+                                      Group->Buffers->GetPrimitiveType(),
+                                      Group->Buffers->GetElementType(),
+                                      Group->IndexBase);
+
+    Group->IndexBuffer += Group->IndexBufferStep;
+    Group->IndexBase   += Group->StemModel->GetVAttrCountI();
+   }
+
+  if ((Group->OffsetBuffer != 0) ||
+      (Group->OrientationBuffer != 0) ||
+      (Group->ScaleBuffer != 0))
+   {
+    P3DHLIFillCloneTransform(Instance,
+                             Group->OffsetBuffer != 0 ? &Group->OffsetBuffer : 0,
+                             Group->OrientationBuffer != 0 ? &Group->OrientationBuffer : 0,
+                             Group->ScaleBuffer != 0 ? &Group->ScaleBuffer : 0);
+   }
+
+  if (Min != 0)
+   {
+    P3DHLIUpdateBBox(Min,Max,Instance);
+   }
  }
 
-P3DHLIPlantInstance
-                  *P3DHLIPlantTemplate::CreateInstance
-                                      (unsigned_int32        BaseSeed) const
+class P3DHLIFillAllVisitor : public P3DHLIBranchVisitor
  {
-  if (BaseSeed == 0)
+  public           :
+
+                   P3DHLIFillAllVisitor
+                                      (P3DHLIFillAllGroup *Groups,
+                                       float              *Min,
+                                       float              *Max)
    {
-    return(new P3DHLIPlantInstance(Model,Model->GetBaseSeed()));
+    this->Groups = Groups;
+    this->Min    = Min;
+    this->Max    = Max;
    }
-  else
+
+  virtual bool     Visit              (unsigned_int32        GroupIndex,
+                                       P3DStemModelInstance
+                                                          *Instance,
+                                       unsigned_int32        Seed P3D_UNUSED_ATTR)
    {
-    return(new P3DHLIPlantInstance(Model,BaseSeed));
+    P3DHLIFillAll(&Groups[GroupIndex],Instance,Min,Max);
+
+    return(false);
+   }
+
+  private          :
+
+  P3DHLIFillAllGroup                  *Groups;
+  float                               *Min;
+  float                               *Max;
+ };
+
+
+                   P3DHLIVAttrFormat::P3DHLIVAttrFormat
+                                      (unsigned_int32        Stride)
+ {
+  for (unsigned_int32 Index = 0; Index < P3D_MAX_ATTRS; Index++)
+   {
+    Enabled[Index] = false;
+    Offsets[Index] = 0;
+   }
+
+  this->Stride = Stride;
+ }
+
+bool               P3DHLIVAttrFormat::HasAttr
+                                      (unsigned_int32        Attr) const
+ {
+  if (Attr < P3D_MAX_ATTRS)
+   {
+    return(Enabled[Attr]);
+   }
+  else
+   {
+    throw P3DExceptionGeneric("invalid vertex attribute");
+   }
+ }
+
+unsigned_int32       P3DHLIVAttrFormat::GetAttrOffset
+                                      (unsigned_int32        Attr) const
+ {
+  if (Attr < P3D_MAX_ATTRS)
+   {
+    return(Offsets[Attr]);
+   }
+  else
+   {
+    throw P3DExceptionGeneric("invalid vertex attribute");
+   }
+ }
+
+unsigned_int32       P3DHLIVAttrFormat::GetStride
+                                      () const
+ {
+  return(Stride);
+ }
+
+void               P3DHLIVAttrFormat::AddAttr
+                                      (unsigned_int32        Attr,
+                                       unsigned_int32        Offset)
+ {
+  if (Attr < P3D_MAX_ATTRS)
+   {
+    Enabled[Attr] = true;
+    Offsets[Attr] = Offset;
+   }
+  else
+   {
+    throw P3DExceptionGeneric("invalid vertex attribute");
+   }
+ }
+
+static void        CheckVAttrValidity (unsigned_int32        Attr)
+ {
+  if (Attr >= P3D_MAX_ATTRS)
+   {
+    throw P3DExceptionGeneric("invalid vertex attribute");
+   }
+ }
+
+                   P3DHLIVAttrBuffers::P3DHLIVAttrBuffers
+                                      ()
+ {
+  for (unsigned_int32 Index = 0; Index < P3D_MAX_ATTRS; Index++)
+   {
+    Buffers[Index] = 0;
+    Offsets[Index] = 0;
+    Strides[Index] = 0;
+   }
+ }
+
+void               P3DHLIVAttrBuffers::AddAttr
+                                      (unsigned_int32        Attr,
+                                       void               *Data,
+                                       unsigned_int32        Offset,
+                                       unsigned_int32        Stride)
+ {
+  CheckVAttrValidity(Attr);
+
+  Buffers[Attr] = Data;
+  Offsets[Attr] = Offset;
+  Strides[Attr] = Stride;
+ }
+
+bool               P3DHLIVAttrBuffers::HasAttr
+                                      (unsigned_int32        Attr) const
+ {
+  CheckVAttrValidity(Attr);
+
+  return(Buffers[Attr] != 0);
+ }
+
+void              *P3DHLIVAttrBuffers::GetAttrBuffer
+                                      (unsigned_int32        Attr) const
+ {
+  CheckVAttrValidity(Attr);
+
+  return(Buffers[Attr]);
+ }
+
+unsigned_int32       P3DHLIVAttrBuffers::GetAttrOffset
+                                      (unsigned_int32        Attr) const
+ {
+  CheckVAttrValidity(Attr);
+
+  return(Offsets[Attr]);
+ }
+
+unsigned_int32       P3DHLIVAttrBuffers::GetAttrStride
+                                      (unsigned_int32        Attr) const
+ {
+  CheckVAttrValidity(Attr);
+
+  return(Strides[Attr]);
+ }
+
+                   P3DHLIGroupBuffers::P3DHLIGroupBuffers
+                                      ()
+ {
+  VAttrBuffers      = 0;
+  IndexBuffer       = 0;
+  PrimitiveType     = P3D_TRIANGLE_LIST;
+  ElementType       = P3D_UNSIGNED_INT;
+  IndexBase         = 0;
+  OffsetBuffer      = 0;
+  OrientationBuffer = 0;
+  ScaleBuffer       = 0;
+ }
+
+void               P3DHLIGroupBuffers::SetVAttrBuffers
+                                      (const P3DHLIVAttrBuffers
+                                                          *VAttrBuffers)
+ {
+  this->VAttrBuffers = VAttrBuffers;
+ }
+
+void               P3DHLIGroupBuffers::SetIndexBuffer
+                                      (void               *IndexBuffer,
+                                       unsigned_int32        PrimitiveType,
+                                       unsigned_int32        ElementType,
+                                       unsigned_int32        IndexBase)
+ {
+  if ((ElementType != P3D_UNSIGNED_SHORT) && (ElementType != P3D_UNSIGNED_INT))
+   {
+    throw P3DExceptionGeneric("invalid index element type");
+   }
+
+  this->IndexBuffer   = IndexBuffer;
+  this->PrimitiveType = PrimitiveType;
+  this->ElementType   = ElementType;
+  this->IndexBase     = IndexBase;
+ }
+
+void               P3DHLIGroupBuffers::SetCloneTransformBuffers
+                                      (float              *OffsetBuffer,
+                                       float              *OrientationBuffer,
+                                       float              *ScaleBuffer)
+ {
+  this->OffsetBuffer      = OffsetBuffer;
+  this->OrientationBuffer = OrientationBuffer;
+  this->ScaleBuffer       = ScaleBuffer;
+ }
+
+const
+P3DHLIVAttrBuffers*P3DHLIGroupBuffers::GetVAttrBuffers
+                                      () const
+ {
+  return(VAttrBuffers);
+ }
+
+void              *P3DHLIGroupBuffers::GetIndexBuffer
+                                      () const
+ {
+  return(IndexBuffer);
+ }
+
+unsigned_int32       P3DHLIGroupBuffers::GetPrimitiveType
+                                      () const
+ {
+  return(PrimitiveType);
+ }
+
+unsigned_int32       P3DHLIGroupBuffers::GetElementType
+                                      () const
+ {
+  return(ElementType);
+ }
+
+unsigned_int32       P3DHLIGroupBuffers::GetIndexBase
+                                      () const
+ {
+  return(IndexBase);
+ }
+
+float             *P3DHLIGroupBuffers::GetOffsetBuffer
+                                      () const
+ {
+  return(OffsetBuffer);
+ }
+
+float             *P3DHLIGroupBuffers::GetOrientationBuffer
+                                      () const
+ {
+  return(OrientationBuffer);
+ }
+
+float             *P3DHLIGroupBuffers::GetScaleBuffer
+                                      () const
+ {
+  return(ScaleBuffer);
+ }
+
+static
+const P3DBranchModel
+                  *GetBranchModelByIndex
+                                      (const P3DPlantModel*Model,
+                                       unsigned_int32        Index)
+ {
+  const P3DBranchModel                *BranchModel;
+
+  BranchModel = P3DPlantModel::GetBranchModelByIndex(Model,Index);
+
+  if (BranchModel == 0)
+   {
+    throw P3DExceptionGeneric("group index out of range");
+   }
+
+  return(BranchModel);
+ }
+
+                   P3DHLIPlantTemplate::P3DHLIPlantTemplate
+                                      (P3DInputStringStream
+                                                          *SourceStream)
+ {
+  P3DHLIMatFactory                     MaterialFactory;
+
+  OwnedModel.Load(SourceStream,&MaterialFactory);
+  Model = &OwnedModel;
+ }
+
+                   P3DHLIPlantTemplate::P3DHLIPlantTemplate
+                                      (const P3DPlantModel*SourceModel)
+ {
+  Model = SourceModel;
+ }
+
+const
+P3DPlantModel     *P3DHLIPlantTemplate::GetModel
+                                      () const
+ {
+  return(Model);
+ }
+
+unsigned_int32       P3DHLIPlantTemplate::GetGroupCount
+                                      () const
+ {
+  return(CalcInternalGroupCount(Model->GetPlantBase()) - 1);
+ }
+
+const char        *P3DHLIPlantTemplate::GetGroupName
+                                      (unsigned_int32        GroupIndex) const
+ {
+  return(GetBranchModelByIndex(Model,GroupIndex)->GetName());
+ }
+
+const
+P3DMaterialDef    *P3DHLIPlantTemplate::GetMaterial
+                                      (unsigned_int32        GroupIndex) const
+ {
+  const P3DMaterialInstance           *MaterialInstance;
+
+  MaterialInstance = GetBranchModelByIndex(Model,GroupIndex)->GetMaterialInstance();
+
+  return(MaterialInstance != 0 ? MaterialInstance->GetMaterialDef() : 0);
+ }
+
+bool               P3DHLIPlantTemplate::IsBillboard
+                                      (unsigned_int32        GroupIndex) const
+ {
+  const P3DStemModelQuad *QuadModel = dynamic_cast<const P3DStemModelQuad*>
+                                       (GetBranchModelByIndex(Model,GroupIndex)->GetStemModel());
+
+  return((QuadModel != 0) && (QuadModel->IsBillboard()));
+ }
+
+void               P3DHLIPlantTemplate::GetBillboardSize
+                                      (float              *Width,
+                                       float              *Height,
+                                       unsigned_int32        GroupIndex) const
+ {
+  const P3DBranchModel                *BranchModel;
+
+  BranchModel = GetBranchModelByIndex(Model,GroupIndex);
+
+  const P3DStemModelQuad *QuadModel = dynamic_cast<const P3DStemModelQuad*>(BranchModel->GetStemModel());
+
+  if (QuadModel != 0)
+   {
+    if (QuadModel->IsBillboard())
+     {
+      *Width  = QuadModel->GetWidth();
+      *Height = QuadModel->GetLength();
+
+      return;
+     }
+   }
+
+  throw P3DExceptionGeneric("trying to get billboard size for non-billboard branches");
+ }
+
+bool               P3DHLIPlantTemplate::IsCloneable
+                                      (unsigned_int32        GroupIndex,
+                                       bool                AllowScaling) const
+ {
+  return GetBranchModelByIndex(Model,GroupIndex)->GetStemModel()->IsCloneable(AllowScaling);
+ }
+
+bool               P3DHLIPlantTemplate::IsLODVisRangeEnabled
+                                      (unsigned_int32        GroupIndex) const
+ {
+  return(GetBranchModelByIndex(Model,GroupIndex)->
+          GetVisRangeState()->IsEnabled());
+ }
+
+void               P3DHLIPlantTemplate::GetLODVisRange
+                                      (float              *MinLOD,
+                                       float              *MaxLOD,
+                                       unsigned_int32        GroupIndex) const
+ {
+  GetBranchModelByIndex(Model,GroupIndex)->
+   GetVisRangeState()->GetRange(MinLOD,MaxLOD);
+ }
+
+unsigned_int32       P3DHLIPlantTemplate::GetVAttrCount
+                                      (unsigned_int32        GroupIndex,
+                                       unsigned_int32        Attr) const
+ {
+  return(GetBranchModelByIndex(Model,GroupIndex)->
+          GetStemModel()->GetVAttrCount(Attr));
+ }
+
+void               P3DHLIPlantTemplate::FillCloneVAttrBuffer
+                                      (void               *VAttrBuffer,
+                                       unsigned_int32        GroupIndex,
+                                       unsigned_int32        Attr) const
+ {
+  GetBranchModelByIndex(Model,GroupIndex)->GetStemModel()->
+   FillCloneVAttrBuffer(VAttrBuffer,Attr);
+ }
+
+unsigned_int32       P3DHLIPlantTemplate::GetPrimitiveCount
+                                      (unsigned_int32        GroupIndex) const
+ {
+  return(GetBranchModelByIndex(Model,GroupIndex)->
+          GetStemModel()->GetPrimitiveCount());
+ }
+
+unsigned_int32       P3DHLIPlantTemplate::GetPrimitiveType
+                                      (unsigned_int32        GroupIndex,
+                                       unsigned_int32        PrimitiveIndex) const
+ {
+  return(GetBranchModelByIndex(Model,GroupIndex)->
+          GetStemModel()->GetPrimitiveType(PrimitiveIndex));
+ }
+
+void               P3DHLIPlantTemplate::FillVAttrIndexBuffer
+                                      (void               *IndexBuffer,
+                                       unsigned_int32        GroupIndex,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        ElementType,
+                                       unsigned_int32        IndexBase) const
+ {
+  GetBranchModelByIndex(Model,GroupIndex)->GetStemModel()->
+   FillVAttrIndexBuffer(IndexBuffer,Attr,ElementType,IndexBase);
+ }
+
+unsigned_int32       P3DHLIPlantTemplate::GetVAttrCountI
+                                      (unsigned_int32        GroupIndex) const
+ {
+  return(GetBranchModelByIndex(Model,GroupIndex)->
+          GetStemModel()->GetVAttrCountI());
+ }
+
+void               P3DHLIPlantTemplate::FillCloneVAttrBuffersI
+                                      (const P3DHLIVAttrBuffers
+                                                          *VAttrBuffers,
+                                       unsigned_int32        GroupIndex) const
+ {
+  const P3DStemModel                  *StemModel;
+  unsigned_int32                         AttrIndex;
+
+  StemModel = GetBranchModelByIndex(Model,GroupIndex)->GetStemModel();
+
+  for (AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+   {
+    if (VAttrBuffers->HasAttr(AttrIndex))
+     {
+      StemModel->FillCloneVAttrBufferI
+       (&((char*)(VAttrBuffers->GetAttrBuffer(AttrIndex)))[VAttrBuffers->GetAttrOffset(AttrIndex)],
+        AttrIndex,
+        VAttrBuffers->GetAttrStride(AttrIndex));
+     }
+   }
+ }
+
+unsigned_int32       P3DHLIPlantTemplate::GetIndexCount
+                                      (unsigned_int32        GroupIndex,
+                                       unsigned_int32        PrimitiveType) const
+ {
+  return(GetBranchModelByIndex(Model,GroupIndex)->
+          GetStemModel()->GetIndexCount(PrimitiveType));
+ }
+
+void               P3DHLIPlantTemplate::FillIndexBuffer
+                                      (void               *IndexBuffer,
+                                       unsigned_int32        GroupIndex,
+                                       unsigned_int32        PrimitiveType,
+                                       unsigned_int32        ElementType,
+                                       unsigned_int32        IndexBase) const
+ {
+  GetBranchModelByIndex(Model,GroupIndex)->GetStemModel()->
+   FillIndexBuffer(IndexBuffer,PrimitiveType,ElementType,IndexBase);
+ }
+
+P3DHLIPlantInstance
+                  *P3DHLIPlantTemplate::CreateInstance
+                                      (unsigned_int32        BaseSeed) const
+ {
+  if (BaseSeed == 0)
+   {
+    return(new P3DHLIPlantInstance(Model,Model->GetBaseSeed()));
+   }
+  else
+   {
+    return(new P3DHLIPlantInstance(Model,BaseSeed));
+   }
+ }
+
+                   P3DHLIPlantInstance::P3DHLIPlantInstance
+                                      (const P3DPlantModel*Model,
+                                       unsigned_int32        BaseSeed)
+ {
+  this->Model           = Model;
+  this->BaseSeed        = BaseSeed;
+  this->Branches        = 0;
+  this->BranchCounts    = 0;
+  this->GroupStates     = 0;
+  this->GroupStateCount = 0;
+  this->BranchesFlags   = 0;
+  this->GroupArenas     = 0;
+  this->Checkpoints     = 0;
+ }
+
+                   P3DHLIPlantInstance::~P3DHLIPlantInstance
+                                      ()
+ {
+  Dematerialize();
+
+  delete[] BranchCounts;
+  delete Checkpoints;
+ }
+
+/* stem instances of the walked branch and all its ancestors must fit */
+/* into this buffer to avoid heap allocations during walk             */
+#define P3DHLI_WALK_ARENA_BUFFER_SIZE (16 * 1024)
+
+void               P3DHLIPlantInstance::RecordCheckpoints
+                                      ()
+ {
+  P3DHLICheckpointTable               *NewCheckpoints;
+
+  if ((Checkpoints != 0) || (!IsRandomnessEnabled()) || (IsSubtreeRNGEnabled()))
+   {
+    return;
+   }
+
+  NewCheckpoints = new P3DHLICheckpointTable();
+
+  try
+   {
+    Walk(0,P3DHLI_NO_GROUP,NewCheckpoints);
+   }
+  catch (...)
+   {
+    delete NewCheckpoints;
+
+    throw;
+   }
+
+  Checkpoints = NewCheckpoints;
+ }
+
+void               P3DHLIPlantInstance::Walk
+                                      (P3DHLIBranchVisitor*Visitor,
+                                       unsigned_int32        RequiredGroup,
+                                       P3DHLICheckpointTable
+                                                          *NewCheckpoints) const
+ {
+  P3DMathRNGSimple                     RNG(BaseSeed);
+  P3DHLICheckpointReader               CheckpointReader(Checkpoints);
+  unsigned char                        ArenaBuffer[P3DHLI_WALK_ARENA_BUFFER_SIZE];
+  P3DMemoryArena                       Arena(ArenaBuffer,sizeof(ArenaBuffer));
+  P3DHLIWalkContext                    Context;
+  P3DHLIFusedVisitor                   FusedVisitor;
+  unsigned_int32                        *Counts;
+
+  if (Visitor != 0)
+   {
+    FusedVisitor.AddVisitor(Visitor);
+   }
+
+  /* branch counts are calculated during first walk */
+  if (!HasBranchCounts())
+   {
+    unsigned_int32                       GroupCount;
+
+    GroupCount = CalcInternalGroupCount(Model->GetPlantBase()) - 1;
+    Counts     = new unsigned_int32[GroupCount > 0 ? GroupCount : 1];
+
+    for (unsigned_int32 GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      Counts[GroupIndex] = 0;
+     }
+   }
+  else
+   {
+    Counts = 0;
+   }
+
+  P3DHLICountVisitor                   CountVisitor(Counts);
+
+  if (Counts != 0)
+   {
+    FusedVisitor.AddVisitor(&CountVisitor);
+   }
+
+  Context.Visitor        = &FusedVisitor;
+  Context.Arena          = &Arena;
+  Context.RNG            = IsRandomnessEnabled() ? &RNG : 0;
+  Context.SubtreeRNG     = IsSubtreeRNGEnabled();
+  Context.CounterRNG     = IsCounterRNGEnabled();
+  Context.Tasks          = 0;
+  Context.SplitDepth     = 0;
+  Context.SharedRNG      = 0;
+  Context.Checkpoints    = 0;
+  Context.NewCheckpoints = 0;
+  Context.RequiredGroup  = P3DHLI_NO_GROUP;
+  Context.StemModels     = 0;
+
+  if ((Context.RNG != 0) && (!Context.SubtreeRNG))
+   {
+    Context.SharedRNG = &RNG;
+
+    if (NewCheckpoints != 0)
+     {
+      Context.NewCheckpoints = NewCheckpoints;
+     }
+    else if (Checkpoints != 0)
+     {
+      Context.Checkpoints = &CheckpointReader;
+     }
+   }
+
+  /* all branches are needed if they are counted during this walk,  */
+  /* branches sharing RNG stream may be skipped only if its state   */
+  /* at their exit is known                                         */
+  if ((Counts == 0) && (Context.NewCheckpoints == 0) &&
+      ((Context.SharedRNG == 0) || (Context.Checkpoints != 0)))
+   {
+    Context.RequiredGroup = RequiredGroup;
+   }
+
+  try
+   {
+    P3DHLIWalkBranch(&Context,Model->GetPlantBase(),0,0,0,0.0f,0,BaseSeed);
+   }
+  catch (...)
+   {
+    delete[] Counts;
+
+    throw;
+   }
+
+  if (Counts != 0)
+   {
+    PublishBranchCounts(Counts);
+   }
+ }
+
+/* sub-branches of branches at this depth become separate tasks in */
+/* parallel mode (plant base has depth 0, trunk - 1)               */
+#define P3DHLI_PARALLEL_SPLIT_DEPTH (2)
+
+void               P3DHLIPlantInstance::Materialize
+                                      (P3DThreadPool      *Pool)
+ {
+  unsigned_int32                         GroupIndex;
+  unsigned_int32                         GroupCount;
+  P3DHLICheckpointTable               *NewCheckpoints;
+
+  if (Branches != 0)
+   {
+    return;
+   }
+
+  GroupCount = CalcInternalGroupCount(Model->GetPlantBase()) - 1;
+
+  if (GroupCount == 0)
+   {
+    return;
+   }
+
+  Branches = new P3DHLIBranchInstanceList[GroupCount];
+
+  try
+   {
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      Branches[GroupIndex].CopyStemModel
+       (GetBranchModelByIndex(Model,GroupIndex)->GetStemModel());
+     }
+
+    GroupStates     = new P3DHLIGroupState[GroupCount];
+    GroupStateCount = GroupCount;
+    BranchesFlags   = Model->GetFlags();
+    GroupArenas     = new P3DMemoryArena[GroupCount];
+
+    P3DHLISaveGroupStates(GroupStates,Model->GetPlantBase(),P3DHLI_NO_GROUP,0);
+   }
+  catch (...)
+   {
+    Dematerialize();
+
+    throw;
+   }
+
+  NewCheckpoints = 0;
+
+  try
+   {
+    P3DMathRNGSimple                   RNG(BaseSeed);
+    P3DHLIWalkContext                  Context;
+    P3DHLIMaterializeVisitor           Visitor(Branches);
+    P3DHLISubtreeTaskList              Tasks;
+    P3DHLICheckpointReader             CheckpointReader(Checkpoints);
+
+    Context.Visitor        = &Visitor;
+    Context.Arena          = &BranchesArena;
+    Context.RNG            = IsRandomnessEnabled() ? &RNG : 0;
+    Context.SubtreeRNG     = IsSubtreeRNGEnabled();
+    Context.CounterRNG     = IsCounterRNGEnabled();
+    Context.Tasks          = 0;
+    Context.SplitDepth     = 0;
+    Context.SharedRNG      = 0;
+    Context.Checkpoints    = 0;
+    Context.NewCheckpoints = 0;
+    Context.RequiredGroup  = P3DHLI_NO_GROUP;
+    Context.StemModels     = Branches;
+
+    if ((Context.RNG != 0) && (!Context.SubtreeRNG))
+     {
+      Context.SharedRNG = &RNG;
+
+      if (Checkpoints != 0)
+       {
+        Context.Checkpoints = &CheckpointReader;
+       }
+      else
+       {
+        NewCheckpoints         = new P3DHLICheckpointTable();
+        Context.NewCheckpoints = NewCheckpoints;
+       }
+     }
+
+    /* subtrees may be generated independently only if they do not */
+    /* share RNG stream, or if its state at their entry is known   */
+    if ((Pool != 0) && ((Context.SharedRNG == 0) || (Context.Checkpoints != 0)))
+     {
+      Context.Tasks      = &Tasks;
+      Context.SplitDepth = P3DHLI_PARALLEL_SPLIT_DEPTH;
+     }
+
+    P3DHLIWalkBranch(&Context,Model->GetPlantBase(),0,0,0,0.0f,0,BaseSeed);
+
+    if (NewCheckpoints != 0)
+     {
+      Checkpoints    = NewCheckpoints;
+      NewCheckpoints = 0;
+     }
+
+    if (Tasks.GetCount() > 0)
+     {
+      unsigned_int32                     TaskIndex;
+      P3DTaskGroup                       TaskGroup;
+
+      for (TaskIndex = 0; TaskIndex < Tasks.GetCount(); TaskIndex++)
+       {
+        P3DHLISubtreeTask             *Task;
+
+        Task = Tasks.GetTask(TaskIndex);
+
+        Task->Branches = new P3DHLIBranchInstanceList[GroupCount];
+
+        for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+         {
+          Task->Branches[GroupIndex].SetStemModel
+           (Branches[GroupIndex].GetStemModel());
+         }
+       }
+
+      try
+       {
+        for (TaskIndex = 0; TaskIndex < Tasks.GetCount(); TaskIndex++)
+         {
+          Pool->Submit(Tasks.GetTask(TaskIndex),&TaskGroup);
+         }
+       }
+      catch (...)
+       {
+        Pool->Wait(&TaskGroup);
+
+        throw;
+       }
+
+      Pool->Wait(&TaskGroup);
+
+      for (TaskIndex = 0; TaskIndex < Tasks.GetCount(); TaskIndex++)
+       {
+        if (Tasks.GetTask(TaskIndex)->IsFailed())
+         {
+          throw P3DExceptionGeneric(Tasks.GetTask(TaskIndex)->GetErrorMessage());
+         }
+       }
+
+      /* instances created by tasks must live as long as plant instance */
+      for (TaskIndex = 0; TaskIndex < Tasks.GetCount(); TaskIndex++)
+       {
+        BranchesArena.Adopt(&Tasks.GetTask(TaskIndex)->Arena);
+       }
+
+      /* tasks were created in depth-first order, so concatenation */
+      /* of their results keeps per-group order of serial walk     */
+      for (TaskIndex = 0; TaskIndex < Tasks.GetCount(); TaskIndex++)
+       {
+        for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+         {
+          Branches[GroupIndex].AppendList(&Tasks.GetTask(TaskIndex)->Branches[GroupIndex]);
+         }
+       }
+     }
+   }
+  catch (...)
+   {
+    delete NewCheckpoints;
+
+    Dematerialize();
+
+    throw;
+   }
+ }
+
+void               P3DHLIPlantInstance::Dematerialize
+                                      ()
+ {
+  delete[] Branches;
+  delete[] GroupStates;
+  delete[] GroupArenas;
+
+  Branches        = 0;
+  GroupStates     = 0;
+  GroupStateCount = 0;
+  GroupArenas     = 0;
+
+  BranchesArena.FreeBlocks();
+ }
+
+void               P3DHLIPlantInstance::Update
+                                      (P3DThreadPool      *Pool)
+ {
+  P3DHLIGroupState                    *States;
+  unsigned_int32                         GroupIndex;
+  unsigned_int32                         GroupCount;
+  bool                                 Incremental;
+  bool                                 Recorded;
+
+  /* branch counts may be changed too */
+  delete[] BranchCounts;
+
+  BranchCounts = 0;
+
+  if (Branches == 0)
+   {
+    /* RNG checkpoints are recorded again if they were recorded before */
+    Recorded = Checkpoints != 0;
+
+    delete Checkpoints;
+
+    Checkpoints = 0;
+
+    if (Recorded)
+     {
+      RecordCheckpoints();
+     }
+
+    return;
+   }
+
+  GroupCount = CalcInternalGroupCount(Model->GetPlantBase()) - 1;
+
+  /* branches of changed groups may be generated again only if they */
+  /* do not share random stream with other groups, or if states of  */
+  /* shared stream at their lists were recorded                     */
+  Incremental = (GroupCount == GroupStateCount) &&
+                (Model->GetFlags() == BranchesFlags) &&
+                ((!IsRandomnessEnabled()) || (IsSubtreeRNGEnabled()) || (Checkpoints != 0));
+
+  States = 0;
+
+  if (Incremental)
+   {
+    States = new P3DHLIGroupState[GroupCount];
+
+    P3DHLISaveGroupStates(States,Model->GetPlantBase(),P3DHLI_NO_GROUP,0);
+
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      if (!States[GroupIndex].IsSamePlace(&GroupStates[GroupIndex]))
+       {
+        Incremental = false;
+       }
+     }
+   }
+
+  /* groups are stored in depth-first order, so every group is  */
+  /* followed by its sub-groups                                 */
+  try
+   {
+    GroupIndex = 0;
+
+    while ((Incremental) && (GroupIndex < GroupCount))
+     {
+      if (States[GroupIndex].IsChanged(&GroupStates[GroupIndex]))
+       {
+        unsigned_int32                   SubtreeGroupCount;
+
+        SubtreeGroupCount = CalcInternalGroupCount(States[GroupIndex].BranchModel);
+
+        Incremental = RegenerateGroups(GroupIndex,SubtreeGroupCount);
+
+        GroupIndex += SubtreeGroupCount;
+       }
+      else
+       {
+        GroupIndex++;
+       }
+     }
+   }
+  catch (...)
+   {
+    delete[] States;
+    delete Checkpoints;
+
+    Checkpoints = 0;
+
+    Dematerialize();
+
+    throw;
+   }
+
+  if (!Incremental)
+   {
+    delete[] States;
+    delete Checkpoints;
+
+    /* checkpoints are recorded again by Materialize */
+    Checkpoints = 0;
+
+    Dematerialize();
+    Materialize(Pool);
+
+    return;
+   }
+
+  delete[] GroupStates;
+
+  GroupStates = States;
+ }
+
+bool               P3DHLIPlantInstance::RegenerateGroups
+                                      (unsigned_int32        FirstGroup,
+                                       unsigned_int32        GroupCount)
+ {
+  const P3DHLIGroupState              *State;
+  const P3DHLIBranchInstanceList      *Parents;
+  unsigned_int32                         ParentCount;
+  unsigned_int32                         ParentDepth;
+  P3DMathRNGSimple                     RNG(BaseSeed);
+  P3DHLIWalkContext                    Context;
+  P3DHLIMaterializeVisitor             Visitor(Branches);
+  P3DHLICheckpointTable               *NewCheckpoints;
+  bool                                 Same;
+
+  for (unsigned_int32 GroupIndex = FirstGroup; GroupIndex < FirstGroup + GroupCount; GroupIndex++)
+   {
+    Branches[GroupIndex].CopyStemModel
+     (GetBranchModelByIndex(Model,GroupIndex)->GetStemModel());
+   }
+
+  /* arenas of groups in range contain only instances of these groups */
+  for (unsigned_int32 GroupIndex = FirstGroup; GroupIndex < FirstGroup + GroupCount; GroupIndex++)
+   {
+    GroupArenas[GroupIndex].Reset();
+   }
+
+  State = &GroupStates[FirstGroup];
+
+  Context.Visitor        = &Visitor;
+  Context.Arena          = &GroupArenas[FirstGroup];
+  Context.RNG            = IsRandomnessEnabled() ? &RNG : 0;
+  Context.SubtreeRNG     = IsSubtreeRNGEnabled();
+  Context.CounterRNG     = IsCounterRNGEnabled();
+  Context.Tasks          = 0;
+  Context.SplitDepth     = 0;
+  Context.SharedRNG      = 0;
+  Context.Checkpoints    = 0;
+  Context.NewCheckpoints = 0;
+  Context.RequiredGroup  = P3DHLI_NO_GROUP;
+  Context.StemModels     = Branches;
+
+  /* plant base has depth 0, trunk - 1 */
+  if (State->ParentGroup == P3DHLI_NO_GROUP)
+   {
+    Parents     = 0;
+    ParentCount = 1;
+    ParentDepth = 0;
+   }
+  else
+   {
+    ParentDepth = 1;
+
+    for (unsigned_int32 GroupIndex = State->ParentGroup;
+         GroupStates[GroupIndex].ParentGroup != P3DHLI_NO_GROUP;
+         GroupIndex = GroupStates[GroupIndex].ParentGroup)
+     {
+      ParentDepth++;
+     }
+
+    Parents     = &Branches[State->ParentGroup];
+    ParentCount = Parents->GetCount();
+   }
+
+  /* Lists sharing random stream are generated from recorded states at */
+  /* their entry. Branches of other groups are still valid if stream   */
+  /* state at exit of every list is the same as recorded one, lists of */
+  /* regenerated groups are recorded again in this case                */
+  NewCheckpoints = 0;
+
+  if ((Context.RNG != 0) && (!Context.SubtreeRNG))
+   {
+    NewCheckpoints         = new P3DHLICheckpointTable();
+    Context.SharedRNG      = &RNG;
+    Context.NewCheckpoints = NewCheckpoints;
+   }
+
+  Same = true;
+
+  try
+   {
+    P3DHLICheckpointSplicer            Splicer(Checkpoints,
+                                               NewCheckpoints,
+                                               CalcBranchDepth(Model->GetPlantBase()));
+
+    for (unsigned_int32 Index = 0; (Same) && (Index < ParentCount); Index++)
+     {
+      unsigned_int32                     Checkpoint;
+      unsigned_int32                     NewCheckpoint;
+
+      Checkpoint    = 0;
+      NewCheckpoint = 0;
+
+      /* every parent branch has recorded list of group */
+      if (NewCheckpoints != 0)
+       {
+        Same = Splicer.CopyToList(FirstGroup,&Checkpoint);
+
+        if (Same)
+         {
+          RNG.SetState(Checkpoints->GetEntryState(Checkpoint));
+
+          NewCheckpoint = NewCheckpoints->Open(RNG.GetState(),FirstGroup);
+         }
+       }
+
+      if (Same)
+       {
+        P3DHLIWalkSubBranch(&Context,
+                            State->BranchModel,
+                            State->SubBranchIndex,
+                            Parents != 0 ? Parents->GetInstance(Index) : 0,
+                            FirstGroup,
+                            ParentDepth,
+                            Parents != 0 ? Parents->GetSeed(Index) : BaseSeed);
+
+        if (NewCheckpoints != 0)
+         {
+          NewCheckpoints->Close(NewCheckpoint,RNG.GetState());
+
+          Same = RNG.GetState() == Checkpoints->GetExitState(Checkpoint);
+
+          Splicer.SkipList(Checkpoint);
+         }
+       }
+     }
+
+    /* rest of checkpoints is copied, there must be no more lists of group */
+    if ((Same) && (NewCheckpoints != 0))
+     {
+      unsigned_int32                     Checkpoint;
+
+      Same = !Splicer.CopyToList(FirstGroup,&Checkpoint);
+     }
+   }
+  catch (...)
+   {
+    delete NewCheckpoints;
+
+    throw;
+   }
+
+  if (NewCheckpoints != 0)
+   {
+    if (Same)
+     {
+      delete Checkpoints;
+
+      Checkpoints = NewCheckpoints;
+     }
+    else
+     {
+      delete NewCheckpoints;
+     }
    }
+
+  return(Same);
  }
 
-                   P3DHLIPlantInstance::P3DHLIPlantInstance
-                                      (const P3DPlantModel*Model,
-                                       unsigned_int32        BaseSeed)
+bool               P3DHLIPlantInstance::IsMaterialized
+                                      () const
  {
-  this->Model    = Model;
-  this->BaseSeed = BaseSeed;
+  return(Branches != 0);
  }
 
-unsigned_int32       P3DHLIPlantInstance::GetBranchCount
-                                      (unsigned_int32        GroupIndex) const
+bool               P3DHLIPlantInstance::HasBranchCounts
+                                      () const
  {
-  const P3DBranchModel                *BranchModel;
-  unsigned_int32                         Counter;
-
-  BranchModel = GetBranchModelByIndex(Model,GroupIndex);
+  bool                                 Result;
 
-  Counter = 0;
+  BranchCountsMutex.Lock();
 
-  P3DMathRNGSimple                     RNG(BaseSeed);
-
-  P3DHLIBranchCalculator               Calculator( IsRandomnessEnabled() ? &RNG : 0,
-                                                   Model->GetPlantBase(),
-                                                   0,
-                                                   BranchModel,
-                                                  &Counter);
+  Result = BranchCounts != 0;
 
-  Calculator.GenerateBranch(0.0f,0);
+  BranchCountsMutex.Unlock();
 
-  return(Counter);
+  return(Result);
  }
 
-void               P3DHLIPlantInstance::GetBranchCountMulti
-                                      (unsigned_int32       *BranchCounts) const
+const
+unsigned_int32      *P3DHLIPlantInstance::PublishBranchCounts
+                                      (unsigned_int32       *Counts) const
  {
-  unsigned_int32                         GroupIndex;
-  unsigned_int32                         GroupCount;
+  const unsigned_int32                  *Result;
 
-  GroupCount = CalcInternalGroupCount(Model->GetPlantBase()) - 1;
+  BranchCountsMutex.Lock();
 
-  for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+  /* counts may be already published by concurrent query */
+  if (BranchCounts == 0)
+   {
+    BranchCounts = Counts;
+   }
+  else
    {
-    BranchCounts[GroupIndex] = 0;
+    delete[] Counts;
    }
 
-  P3DMathRNGSimple                     RNG(Model->GetBaseSeed());
+  Result = BranchCounts;
 
-  P3DHLIBranchCalculatorMulti Calculator(IsRandomnessEnabled() ? &RNG : 0,
-                                          Model->GetPlantBase(),
-                                          0,
-                                          0,
-                                          BranchCounts);
+  BranchCountsMutex.Unlock();
 
-  Calculator.GenerateBranch(0.0f,0);
+  return(Result);
  }
 
-class P3DBranchingFactoryBoundCalc : public P3DBranchingFactory
+const
+unsigned_int32      *P3DHLIPlantInstance::GetBranchCounts
+                                      () const
  {
-  public           :
-
-                   P3DBranchingFactoryBoundCalc    (P3DBranchModel  *BranchModel,
-                                                    P3DStemModelInstance
-                                                                    *ParentStem,
-                                                    P3DMathRNG      *RNG,
-                                                    float           *Min,
-                                                    float           *Max);
-
-  virtual void     GenerateBranch     (float               offset,
-                                       const P3DQuaternionf
-                                                          *orientation);
-
-  private          :
+  const unsigned_int32                  *Result;
 
-  P3DBranchModel                      *BranchModel;
-  P3DStemModelInstance                *ParentStem;
-  P3DMathRNG                          *RNG;
-  float                               *Min;
-  float                               *Max;
- };
+  BranchCountsMutex.Lock();
 
-                   P3DBranchingFactoryBoundCalc::P3DBranchingFactoryBoundCalc
-                                                   (P3DBranchModel  *BranchModel,
-                                                    P3DStemModelInstance
-                                                                    *ParentStem,
-                                                    P3DMathRNG      *RNG,
-                                                    float           *Min,
-                                                    float           *Max)
- {
-  this->BranchModel = BranchModel;
-  this->ParentStem  = ParentStem;
-  this->RNG         = RNG;
-  this->Min         = Min;
-  this->Max         = Max;
- }
-
-void               P3DBranchingFactoryBoundCalc::GenerateBranch
-                                      (float               offset,
-                                       const P3DQuaternionf
-                                                          *orientation)
- {
-  unsigned_int32                         SubBranchIndex;
-  unsigned_int32                         SubBranchCount;
-  P3DBranchModel                      *SubBranchModel;
-  P3DBranchingAlg                     *BranchingAlg;
-  P3DStemModel                        *StemModel;
-  P3DStemModelInstance                *StemInstance;
+  Result = BranchCounts;
 
-  StemModel = BranchModel->GetStemModel();
+  BranchCountsMutex.Unlock();
 
-  if (StemModel != 0)
+  if (Result == 0)
    {
-    float          InstMin[3];
-    float          InstMax[3];
-
-    StemInstance = StemModel->CreateInstance
-                    (RNG,ParentStem,offset,orientation);
+    if (Branches != 0)
+     {
+      unsigned_int32                     GroupIndex;
+      unsigned_int32                     GroupCount;
+      unsigned_int32                    *Counts;
 
-    StemInstance->GetBoundBox(InstMin,InstMax);
+      GroupCount = CalcInternalGroupCount(Model->GetPlantBase()) - 1;
+      Counts     = new unsigned_int32[GroupCount > 0 ? GroupCount : 1];
 
-    for (unsigned_int32 Axis = 0; Axis < 3; Axis++)
-     {
-      if      (InstMin[Axis] < Min[Axis])
+      for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
        {
-        Min[Axis] = InstMin[Axis];
+        Counts[GroupIndex] = Branches[GroupIndex].GetCount();
        }
 
-      if (InstMax[Axis] > Max[Axis])
-       {
-        Max[Axis] = InstMax[Axis];
-       }
+      Result = PublishBranchCounts(Counts);
      }
-   }
-  else
-   {
-    StemInstance = 0;
-   }
-
-  SubBranchCount = BranchModel->GetSubBranchCount();
+    else
+     {
+      /* counts are collected and published by walk itself */
+      Walk(0,P3DHLI_NO_GROUP);
 
-  for (SubBranchIndex = 0; SubBranchIndex < SubBranchCount; SubBranchIndex++)
-   {
-    SubBranchModel = BranchModel->GetSubBranchModel(SubBranchIndex);
-    BranchingAlg   = SubBranchModel->GetBranchingAlg();
+      BranchCountsMutex.Lock();
 
-    P3DBranchingFactoryBoundCalc         BranchingFactory(SubBranchModel,StemInstance,RNG,Min,Max);
+      Result = BranchCounts;
 
-    BranchingAlg->CreateBranches(&BranchingFactory,StemInstance,RNG);
+      BranchCountsMutex.Unlock();
+     }
    }
 
-  if (StemModel != 0)
-   {
-    StemModel->ReleaseInstance(StemInstance);
-   }
+  return(Result);
  }
 
-static void        P3DHLICalcBBox     (float              *Min,
-                                       float              *Max,
-                                       const P3DPlantModel*Model,
-                                       unsigned_int32        BaseSeed)
+unsigned_int32       P3DHLIPlantInstance::GetBranchCount
+                                      (unsigned_int32        GroupIndex) const
  {
-  P3DMathRNGSimple                     RNG(BaseSeed);
+  /* validate group index */
+  GetBranchModelByIndex(Model,GroupIndex);
 
-  Min[0] = Min[1] = Min[2] = 0.0f;
-  Max[0] = Max[1] = Max[2] = 0.0f;
+  return(GetBranchCounts()[GroupIndex]);
+ }
+
+void               P3DHLIPlantInstance::GetBranchCountMulti
+                                      (unsigned_int32       *BranchCounts) const
+ {
+  unsigned_int32                         GroupIndex;
+  unsigned_int32                         GroupCount;
+  const unsigned_int32                  *Counts;
 
-  P3DBranchingFactoryBoundCalc
-   BranchingFactory ((const_cast<P3DPlantModel*>(Model))->GetPlantBase(),
-                     0,
-                     (Model->GetFlags() & P3D_MODEL_FLAG_NO_RANDOMNESS) ? 0 : &RNG,
-                     Min,
-                     Max);
+  GroupCount = CalcInternalGroupCount(Model->GetPlantBase()) - 1;
+  Counts     = GetBranchCounts();
 
-  BranchingFactory.GenerateBranch(0.0f,0);
+  for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+   {
+    BranchCounts[GroupIndex] = Counts[GroupIndex];
+   }
  }
 
 void               P3DHLIPlantInstance::GetBoundingBox
                                       (float              *Min,
                                        float              *Max) const
  {
-  P3DHLICalcBBox(Min,Max,Model,BaseSeed);
+  Min[0] = Min[1] = Min[2] = 0.0f;
+  Max[0] = Max[1] = Max[2] = 0.0f;
+
+  if (Branches != 0)
+   {
+    unsigned_int32                       GroupIndex;
+    unsigned_int32                       GroupCount;
+
+    GroupCount = CalcInternalGroupCount(Model->GetPlantBase()) - 1;
+
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      for (unsigned_int32 Index = 0; Index < Branches[GroupIndex].GetCount(); Index++)
+       {
+        P3DHLIUpdateBBox(Min,Max,Branches[GroupIndex].GetInstance(Index));
+       }
+     }
+   }
+  else
+   {
+    P3DHLIBBoxVisitor                  Visitor(Min,Max);
+
+    Walk(&Visitor,P3DHLI_NO_GROUP);
+   }
  }
 
 void               P3DHLIPlantInstance::FillCloneTransformBuffer
@@ -1434,21 +3173,28 @@ void               P3DHLIPlantInstance::FillCloneTransformBuffer
                                        float              *ScaleBuffer,
                                        unsigned_int32        GroupIndex) const
  {
-  const P3DBranchModel                *BranchModel;
+  /* validate group index */
+  GetBranchModelByIndex(Model,GroupIndex);
 
-  BranchModel = GetBranchModelByIndex(Model,GroupIndex);
-
-  P3DMathRNGSimple RNG(BaseSeed);
-
-  P3DHLIFillCloneTransformBufferHelper Helper(IsRandomnessEnabled() ? &RNG : 0,
-                                              Model->GetPlantBase(),
-                                              0,
-                                              BranchModel,
-                                              OffsetBuffer != 0 ? &OffsetBuffer : 0,
-                                              OrientationBuffer != 0 ? &OrientationBuffer : 0,
-                                              ScaleBuffer != 0 ? &ScaleBuffer : 0);
+  if (Branches != 0)
+   {
+    for (unsigned_int32 Index = 0; Index < Branches[GroupIndex].GetCount(); Index++)
+     {
+      P3DHLIFillCloneTransform(Branches[GroupIndex].GetInstance(Index),
+                               OffsetBuffer != 0 ? &OffsetBuffer : 0,
+                               OrientationBuffer != 0 ? &OrientationBuffer : 0,
+                               ScaleBuffer != 0 ? &ScaleBuffer : 0);
+     }
+   }
+  else
+   {
+    P3DHLIFillCloneTransformVisitor    Visitor(GroupIndex,
+                                               OffsetBuffer != 0 ? &OffsetBuffer : 0,
+                                               OrientationBuffer != 0 ? &OrientationBuffer : 0,
+                                               ScaleBuffer != 0 ? &ScaleBuffer : 0);
 
-  Helper.GenerateBranch(0.0f,0);
+    Walk(&Visitor,GroupIndex);
+   }
  }
 
 unsigned_int32       P3DHLIPlantInstance::GetVAttrCount
@@ -1469,23 +3215,26 @@ void               P3DHLIPlantInstance::FillVAttrBuffer
                                        unsigned_int32        GroupIndex,
                                        unsigned_int32        Attr) const
  {
-  const P3DBranchModel                *BranchModel;
-
-  BranchModel = GetBranchModelByIndex(Model,GroupIndex);
-
-  P3DMathRNGSimple                     RNG(BaseSeed);
   unsigned char                       *Buffer;
 
+  /* validate group index */
+  GetBranchModelByIndex(Model,GroupIndex);
+
   Buffer = (unsigned char*)VAttrBuffer;
 
-  P3DHLIFillVAttrBufferHelper Helper( IsRandomnessEnabled() ? &RNG : 0,
-                                      Model->GetPlantBase(),
-                                      0,
-                                      BranchModel,
-                                      Attr,
-                                     &Buffer);
+  if (Branches != 0)
+   {
+    for (unsigned_int32 Index = 0; Index < Branches[GroupIndex].GetCount(); Index++)
+     {
+      P3DHLIFillVAttr(Branches[GroupIndex].GetInstance(Index),Attr,&Buffer);
+     }
+   }
+  else
+   {
+    P3DHLIFillVAttrVisitor             Visitor(GroupIndex,Attr,&Buffer);
 
-  Helper.GenerateBranch(0.0f,0);
+    Walk(&Visitor,GroupIndex);
+   }
  }
 
 unsigned_int32       P3DHLIPlantInstance::GetVAttrCountI
@@ -1506,23 +3255,26 @@ void               P3DHLIPlantInstance::FillVAttrBufferI
                                        const P3DHLIVAttrFormat
                                                           *VAttrFormat) const
  {
-  const P3DBranchModel                *BranchModel;
-
-  BranchModel = GetBranchModelByIndex(Model,GroupIndex);
-
-  P3DMathRNGSimple                     RNG(BaseSeed);
   unsigned char                       *Buffer;
 
+  /* validate group index */
+  GetBranchModelByIndex(Model,GroupIndex);
+
   Buffer = (unsigned char*)VAttrBuffer;
 
-  P3DHLIFillVAttrBufferIHelper Helper( IsRandomnessEnabled() ? &RNG : 0,
-                                       Model->GetPlantBase(),
-                                       0,
-                                       BranchModel,
-                                       VAttrFormat,
-                                      &Buffer);
+  if (Branches != 0)
+   {
+    for (unsigned_int32 Index = 0; Index < Branches[GroupIndex].GetCount(); Index++)
+     {
+      P3DHLIFillVAttrI(Branches[GroupIndex].GetInstance(Index),VAttrFormat,&Buffer);
+     }
+   }
+  else
+   {
+    P3DHLIFillVAttrIVisitor            Visitor(GroupIndex,VAttrFormat,&Buffer);
 
-  Helper.GenerateBranch(0.0f,0);
+    Walk(&Visitor,GroupIndex);
+   }
  }
 
 void               P3DHLIPlantInstance::FillVAttrBuffersI
@@ -1530,38 +3282,142 @@ void               P3DHLIPlantInstance::FillVAttrBuffersI
                                                           *VAttrBuffers,
                                        unsigned_int32        GroupIndex) const
  {
-  const P3DBranchModel                *BranchModel;
-
-  BranchModel = GetBranchModelByIndex(Model,GroupIndex);
-
-  P3DMathRNGSimple                     RNG(BaseSeed);
   void                                *DataBuffers[P3D_MAX_ATTRS];
 
+  /* validate group index */
+  GetBranchModelByIndex(Model,GroupIndex);
+
   for (unsigned_int32 AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
    {
     DataBuffers[AttrIndex] = VAttrBuffers->GetAttrBuffer(AttrIndex);
    }
 
-  P3DHLIFillVAttrBuffersIHelper Helper(IsRandomnessEnabled() ? &RNG : 0,
-                                       Model->GetPlantBase(),
-                                       0,
-                                       BranchModel,
-                                       VAttrBuffers,
-                                       DataBuffers);
+  if (Branches != 0)
+   {
+    for (unsigned_int32 Index = 0; Index < Branches[GroupIndex].GetCount(); Index++)
+     {
+      P3DHLIFillVAttrsI(Branches[GroupIndex].GetInstance(Index),VAttrBuffers,DataBuffers);
+     }
+   }
+  else
+   {
+    P3DHLIFillVAttrsIVisitor           Visitor(GroupIndex,VAttrBuffers,DataBuffers);
 
-  Helper.GenerateBranch(0.0f,0);
+    Walk(&Visitor,GroupIndex);
+   }
  }
 
+/* number of branches filled by single task in parallel mode */
+#define P3DHLI_PARALLEL_FILL_BRANCHES (256)
+
 void               P3DHLIPlantInstance::FillVAttrBuffersIMulti
                                       (P3DHLIVAttrBufferSet
-                                                          *VAttrBufferSet) const
+                                                          *VAttrBufferSet,
+                                       P3DThreadPool      *Pool) const
  {
   unsigned_int32                         GroupIndex;
   unsigned_int32                         GroupCount;
 
   GroupCount = CalcInternalGroupCount(Model->GetPlantBase()) - 1;
 
-  if (GroupCount > 0)
+  if (GroupCount == 0)
+   {
+    return;
+   }
+
+  if ((Branches != 0) && (Pool != 0))
+   {
+    P3DHLIFillVAttrSetITask           *Tasks;
+    unsigned_int32                       TaskCount;
+    unsigned_int32                       TaskIndex;
+    P3DTaskGroup                         TaskGroup;
+
+    TaskCount = 0;
+
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      TaskCount += (Branches[GroupIndex].GetCount() + P3DHLI_PARALLEL_FILL_BRANCHES - 1) /
+                    P3DHLI_PARALLEL_FILL_BRANCHES;
+     }
+
+    if (TaskCount == 0)
+     {
+      return;
+     }
+
+    Tasks     = new P3DHLIFillVAttrSetITask[TaskCount];
+    TaskIndex = 0;
+
+    /* every branch of group has the same vertex count, so output */
+    /* offset of each branch range is known before filling        */
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      unsigned_int32                     BranchVAttrCount;
+      unsigned_int32                     BranchCount;
+
+      BranchVAttrCount = GetBranchModelByIndex(Model,GroupIndex)->GetStemModel()->GetVAttrCountI();
+      BranchCount      = Branches[GroupIndex].GetCount();
+
+      for (unsigned_int32 FirstBranch = 0; FirstBranch < BranchCount; FirstBranch += P3DHLI_PARALLEL_FILL_BRANCHES)
+       {
+        P3DHLIFillVAttrSetITask       *Task;
+
+        Task = &Tasks[TaskIndex++];
+
+        Task->Branches    = &Branches[GroupIndex];
+        Task->FirstBranch = FirstBranch;
+        Task->LastBranch  = FirstBranch + P3DHLI_PARALLEL_FILL_BRANCHES < BranchCount ?
+                             FirstBranch + P3DHLI_PARALLEL_FILL_BRANCHES : BranchCount;
+
+        for (unsigned_int32 AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+         {
+          if (VAttrBufferSet[GroupIndex][AttrIndex] != 0)
+           {
+            Task->VAttrBufferSet[AttrIndex] =
+             VAttrBufferSet[GroupIndex][AttrIndex] +
+             FirstBranch * BranchVAttrCount * (AttrIndex == P3D_ATTR_TEXCOORD0 ? 2 : 3);
+           }
+          else
+           {
+            Task->VAttrBufferSet[AttrIndex] = 0;
+           }
+         }
+       }
+     }
+
+    try
+     {
+      for (TaskIndex = 0; TaskIndex < TaskCount; TaskIndex++)
+       {
+        Pool->Submit(&Tasks[TaskIndex],&TaskGroup);
+       }
+     }
+    catch (...)
+     {
+      Pool->Wait(&TaskGroup);
+
+      delete[] Tasks;
+
+      throw;
+     }
+
+    Pool->Wait(&TaskGroup);
+
+    for (TaskIndex = 0; TaskIndex < TaskCount; TaskIndex++)
+     {
+      if (Tasks[TaskIndex].IsFailed())
+       {
+        P3DExceptionGeneric            Exception(Tasks[TaskIndex].GetErrorMessage());
+
+        delete[] Tasks;
+
+        throw Exception;
+       }
+     }
+
+    delete[] Tasks;
+   }
+  else
    {
     P3DHLIVAttrBufferSet              *TempVAttrBufferSet;
 
@@ -1576,17 +3432,117 @@ void               P3DHLIPlantInstance::FillVAttrBuffersIMulti
        }
      }
 
-    P3DMathRNGSimple                     RNG(Model->GetBaseSeed());
-    P3DHLIFillVAttrBuffersIMultiHelper   Helper(IsRandomnessEnabled() ? &RNG : 0,
-                                                 Model->GetPlantBase(),
-                                                 0,
-                                                 0,
-                                                 TempVAttrBufferSet);
+    try
+     {
+      if (Branches != 0)
+       {
+        for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+         {
+          for (unsigned_int32 Index = 0; Index < Branches[GroupIndex].GetCount(); Index++)
+           {
+            P3DHLIFillVAttrSetI(Branches[GroupIndex].GetInstance(Index),
+                                TempVAttrBufferSet[GroupIndex]);
+           }
+         }
+       }
+      else
+       {
+        P3DHLIFillVAttrSetIVisitor       Visitor(TempVAttrBufferSet);
+
+        Walk(&Visitor,P3DHLI_NO_GROUP);
+       }
+     }
+    catch (...)
+     {
+      delete[] TempVAttrBufferSet;
+
+      throw;
+     }
+
+    delete[] TempVAttrBufferSet;
+   }
+ }
+
+void               P3DHLIPlantInstance::FillAll
+                                      (const P3DHLIGroupBuffers
+                                                          *GroupBuffers,
+                                       float              *Min,
+                                       float              *Max) const
+ {
+  P3DHLIFillAllGroup                  *Groups;
+  unsigned_int32                         GroupIndex;
+  unsigned_int32                         GroupCount;
+
+  if (Min != 0)
+   {
+    Min[0] = Min[1] = Min[2] = 0.0f;
+    Max[0] = Max[1] = Max[2] = 0.0f;
+   }
+
+  GroupCount = CalcInternalGroupCount(Model->GetPlantBase()) - 1;
+
+  if (GroupCount == 0)
+   {
+    return;
+   }
+
+  Groups = new P3DHLIFillAllGroup[GroupCount];
+
+  for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+   {
+    P3DHLIFillAllGroup                *Group;
+    const P3DHLIGroupBuffers          *Buffers;
+
+    Group   = &Groups[GroupIndex];
+    Buffers = &GroupBuffers[GroupIndex];
+
+    Group->Buffers   = Buffers;
+    Group->StemModel = GetBranchModelByIndex(Model,GroupIndex)->GetStemModel();
+
+    for (unsigned_int32 AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+     {
+      Group->DataBuffers[AttrIndex] = Buffers->GetVAttrBuffers() != 0 ?
+                                       Buffers->GetVAttrBuffers()->GetAttrBuffer(AttrIndex) : 0;
+     }
+
+    Group->IndexBuffer     = (unsigned char*)Buffers->GetIndexBuffer();
+    Group->IndexBufferStep = Group->StemModel->GetIndexCount(Buffers->GetPrimitiveType()) *
+                             (Buffers->GetElementType() == P3D_UNSIGNED_SHORT ?
+                               sizeof(unsigned short) : sizeof(unsigned_int32));
+    Group->IndexBase       = Buffers->GetIndexBase();
+
+    Group->OffsetBuffer      = Buffers->GetOffsetBuffer();
+    Group->OrientationBuffer = Buffers->GetOrientationBuffer();
+    Group->ScaleBuffer       = Buffers->GetScaleBuffer();
+   }
+
+  try
+   {
+    if (Branches != 0)
+     {
+      for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+       {
+        for (unsigned_int32 Index = 0; Index < Branches[GroupIndex].GetCount(); Index++)
+         {
+          P3DHLIFillAll(&Groups[GroupIndex],Branches[GroupIndex].GetInstance(Index),Min,Max);
+         }
+       }
+     }
+    else
+     {
+      P3DHLIFillAllVisitor             Visitor(Groups,Min,Max);
 
-    Helper.GenerateBranch(0.0f,0);
+      Walk(&Visitor,P3DHLI_NO_GROUP);
+     }
+   }
+  catch (...)
+   {
+    delete[] Groups;
 
-    delete TempVAttrBufferSet;
+    throw;
    }
+
+  delete[] Groups;
  }
 
 bool               P3DHLIPlantInstance::IsRandomnessEnabled() const
@@ -1594,3 +3550,12 @@ bool               P3DHLIPlantInstance::IsRandomnessEnabled() const
   return (Model->GetFlags() & P3D_MODEL_FLAG_NO_RANDOMNESS) == 0;
  }
 
+bool               P3DHLIPlantInstance::IsSubtreeRNGEnabled() const
+ {
+  return (Model->GetFlags() & (P3D_MODEL_FLAG_SUBTREE_RNG | P3D_MODEL_FLAG_COUNTER_RNG)) != 0;
+ }
+
+bool               P3DHLIPlantInstance::IsCounterRNGEnabled() const
+ {
+  return (Model->GetFlags() & P3D_MODEL_FLAG_COUNTER_RNG) != 0;
+ }
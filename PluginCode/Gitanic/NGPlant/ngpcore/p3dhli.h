@@ -34,6 +34,7 @@
 
 #include <ngpcore/p3dmathrng.h>
 #include <ngpcore/p3dmodel.h>
+#include <ngpcore/p3dthread.h>
 
 #define P3DHLI_VER_MAJOR    (0)
 #define P3DHLI_VER_MINOR    (9)
@@ -64,6 +65,56 @@ class P3D_DLL_ENTRY P3DHLIVAttrBuffers
   unsigned_int32     Strides[P3D_MAX_ATTRS];
  };
 
+/* Destination buffers of single group for P3DHLIPlantInstance::FillAll. */
+/* Buffers which were not set are not filled.                            */
+class P3D_DLL_ENTRY P3DHLIGroupBuffers
+ {
+  public           :
+
+                   P3DHLIGroupBuffers ();
+
+  void             SetVAttrBuffers    (const P3DHLIVAttrBuffers
+                                                          *VAttrBuffers);
+
+  /* indices of N-th branch of group are offset by */
+  /* IndexBase + N * (vertex count of one branch)  */
+  void             SetIndexBuffer     (void               *IndexBuffer,
+                                       unsigned_int32        PrimitiveType,
+                                       unsigned_int32        ElementType,
+                                       unsigned_int32        IndexBase = 0);
+
+  /* buffer layout is the same as in FillCloneTransformBuffer */
+  void             SetCloneTransformBuffers
+                                      (float              *OffsetBuffer,
+                                       float              *OrientationBuffer,
+                                       float              *ScaleBuffer);
+
+  const
+  P3DHLIVAttrBuffers
+                  *GetVAttrBuffers    () const;
+
+  void            *GetIndexBuffer     () const;
+  unsigned_int32     GetPrimitiveType   () const;
+  unsigned_int32     GetElementType     () const;
+  unsigned_int32     GetIndexBase       () const;
+
+  float           *GetOffsetBuffer    () const;
+  float           *GetOrientationBuffer
+                                      () const;
+  float           *GetScaleBuffer     () const;
+
+  private          :
+
+  const P3DHLIVAttrBuffers            *VAttrBuffers;
+  void                                *IndexBuffer;
+  unsigned_int32                         PrimitiveType;
+  unsigned_int32                         ElementType;
+  unsigned_int32                         IndexBase;
+  float                               *OffsetBuffer;
+  float                               *OrientationBuffer;
+  float                               *ScaleBuffer;
+ };
+
 /******************************************************************************/
 /* NOTE: Class P3DHLIVAttrFormat and P3DHLIPlantInstance::FillVAttrBufferI    */
 /* are obsolete. Both of them will be removed in one of the next version.     */
@@ -91,6 +142,10 @@ class P3D_DLL_ENTRY P3DHLIVAttrFormat
  };
 
 class P3DHLIPlantInstance;
+class P3DHLIBranchInstanceList;
+class P3DHLIGroupState;
+class P3DHLICheckpointTable;
+class P3DHLIBranchVisitor;
 
 class P3D_DLL_ENTRY P3DHLIPlantTemplate
  {
@@ -100,13 +155,19 @@ class P3D_DLL_ENTRY P3DHLIPlantTemplate
                                                           *SourceStream);
                    P3DHLIPlantTemplate(const P3DPlantModel*SourceModel);
 
+  const
+  P3DPlantModel   *GetModel           () const;
+
   unsigned_int32     GetGroupCount      () const;
 
   const char      *GetGroupName       (unsigned_int32        GroupIndex) const;
 
+  /* returns 0 if group has no material ("__None__" in model file) */
   const
   P3DMaterialDef  *GetMaterial        (unsigned_int32        GroupIndex) const;
 
+  bool             IsBillboard        (unsigned_int32        GroupIndex) const;
+
   void             GetBillboardSize   (float              *Width,
                                        float              *Height,
                                        unsigned_int32        GroupIndex) const;
@@ -177,6 +238,42 @@ class P3D_DLL_ENTRY P3DHLIPlantInstance
 
                    P3DHLIPlantInstance(const P3DPlantModel*Model,
                                        unsigned_int32        BaseSeed);
+                  ~P3DHLIPlantInstance();
+
+  /* Materialized mode: plant is generated once and all branch instances */
+  /* are kept in memory, so subsequent queries do not regenerate it.     */
+  /* Results are exactly the same as in non-materialized mode. Model     */
+  /* may be changed only if Update is called after the change.           */
+  /* If Pool is specified and model uses per-subtree random streams (or  */
+  /* randomness is disabled), subtrees are generated by pool threads.    */
+  /* Plants with single shared random stream are generated in parallel   */
+  /* too, if states of this stream were recorded (see RecordCheckpoints) */
+  /* before, otherwise they are recorded during this generation.         */
+  /* It may be called from tasks running in the same Pool.               */
+  void             Materialize        (P3DThreadPool      *Pool = 0);
+  /* releases branches and frees all memory used by them */
+  void             Dematerialize      ();
+  bool             IsMaterialized     () const;
+
+  /* Must be called after model change. In materialized mode only groups */
+  /* which stem models or branching algorithms were changed and their    */
+  /* sub-groups are regenerated, branches of other groups are kept.      */
+  /* If all branches share single random stream, changed groups are      */
+  /* generated from recorded states of this stream. Whole plant is       */
+  /* regenerated (using Pool) if group hierarchy or model flags were     */
+  /* changed, or if changed groups use different amount of random        */
+  /* numbers than before.                                                */
+  /* Materialized branches are released by copies of stem models, so    */
+  /* replaced or removed stem models may be deleted before Update.       */
+  void             Update             (P3DThreadPool      *Pool = 0);
+
+  /* Record states of random stream shared by all branches at every    */
+  /* sub-branch list, so queries of single group skip branches of      */
+  /* other groups and Materialize may use Pool. States are recorded by */
+  /* Materialize too, Update records them again. Must be called before */
+  /* instance is used by several threads, has no effect for plants     */
+  /* with per-subtree random streams or without randomness.            */
+  void             RecordCheckpoints  ();
 
   unsigned_int32     GetBranchCount     (unsigned_int32        GroupIndex) const;
   void             GetBranchCountMulti(unsigned_int32       *BranchCounts) const;
@@ -216,16 +313,77 @@ class P3D_DLL_ENTRY P3DHLIPlantInstance
                                                           *VAttrBuffers,
                                        unsigned_int32        GroupIndex) const;
 
+  /* If Pool is specified and instance is materialized,  */
+  /* branches are filled by pool threads                 */
   void             FillVAttrBuffersIMulti
                                       (P3DHLIVAttrBufferSet
-                                                          *VAttrBufferSet) const;
+                                                          *VAttrBufferSet,
+                                       P3DThreadPool      *Pool = 0) const;
+
+  /* Fused mode: vertex attributes, indices and clone transforms of all */
+  /* groups and bounding box are filled during single plant generation. */
+  /* GroupBuffers must contain GetGroupCount() items, Min and Max may   */
+  /* be 0 if bounding box is not needed.                                */
+  void             FillAll            (const P3DHLIGroupBuffers
+                                                          *GroupBuffers,
+                                       float              *Min,
+                                       float              *Max) const;
 
   private          :
 
+                   P3DHLIPlantInstance(const P3DHLIPlantInstance
+                                                          &Source);
+  P3DHLIPlantInstance
+                  &operator =         (const P3DHLIPlantInstance
+                                                          &Source);
+
   bool             IsRandomnessEnabled() const;
+  bool             IsSubtreeRNGEnabled() const;
+  bool             IsCounterRNGEnabled() const;
+
+  /* generate plant passing every stem instance to Visitor (may be 0); */
+  /* per-group branch counts are collected during first walk. If       */
+  /* RequiredGroup is not P3DHLI_NO_GROUP, visitor needs branches of   */
+  /* this group only, so subtrees without them may be skipped. If      */
+  /* NewCheckpoints is not 0, RNG checkpoints are recorded there       */
+  void             Walk               (P3DHLIBranchVisitor*Visitor,
+                                       unsigned_int32        RequiredGroup,
+                                       P3DHLICheckpointTable
+                                                          *NewCheckpoints = 0) const;
+
+  /* per-group branch counts, calculated during first call */
+  const
+  unsigned_int32    *GetBranchCounts    () const;
+  bool             HasBranchCounts    () const;
+  /* store Counts unless counts were stored by concurrent query, */
+  /* in which case Counts are deleted; returns stored counts     */
+  const
+  unsigned_int32    *PublishBranchCounts(unsigned_int32       *Counts) const;
+
+  /* release materialized branches of groups in range and generate them  */
+  /* again, parent groups must be materialized. Returns false if random  */
+  /* stream is shared and its state after regenerated lists differs from */
+  /* recorded one, branches of following groups are not valid then       */
+  bool             RegenerateGroups   (unsigned_int32        FirstGroup,
+                                       unsigned_int32        GroupCount);
 
   const P3DPlantModel                 *Model;
   unsigned_int32                         BaseSeed;
+  P3DHLIBranchInstanceList            *Branches;
+  /* memory of materialized stem instances */
+  P3DMemoryArena                       BranchesArena;
+  /* group states and model flags at the moment of materialization */
+  P3DHLIGroupState                    *GroupStates;
+  unsigned_int32                         GroupStateCount;
+  unsigned_int32                         BranchesFlags;
+  /* memory of stem instances regenerated by Update, item for every  */
+  /* group is used when group and its sub-groups are regenerated     */
+  P3DMemoryArena                      *GroupArenas;
+  /* 0 if RNG checkpoints are not recorded */
+  P3DHLICheckpointTable               *Checkpoints;
+  /* calculated by const queries, so guarded by BranchCountsMutex */
+  mutable unsigned_int32                *BranchCounts;
+  mutable P3DMutex                     BranchCountsMutex;
  };
 
 #endif
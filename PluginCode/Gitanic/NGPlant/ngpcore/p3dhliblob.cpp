@@ -0,0 +1,883 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include <ngpcore/p3dexcept.h>
+#include <ngpcore/p3dhliblob.h>
+
+/* Blob layout: header, group table, strings, vertex block and index  */
+/* blocks. Header and group table consist of unsigned_int32 items,    */
+/* floats are stored as float bits, strings are stored as offsets of  */
+/* zero-terminated strings (0 means "no string"). All offsets are     */
+/* relative to the blob start.                                        */
+
+#define P3D_PLANT_BLOB_VERSION               (1)
+#define P3D_PLANT_BLOB_BYTE_ORDER            (0x01020304U)
+#define P3D_PLANT_BLOB_ALIGNMENT             (16)
+#define P3D_PLANT_BLOB_NO_ATTR               (0xFFFFFFFFU)
+/* largest vertex count of group which may be addressed by 16-bit indices */
+#define P3D_PLANT_BLOB_SHORT_INDEX_LIMIT     (65536)
+
+#define P3D_PLANT_BLOB_HEADER_MAGIC          (0)
+#define P3D_PLANT_BLOB_HEADER_VERSION        (1)
+#define P3D_PLANT_BLOB_HEADER_BYTE_ORDER     (2)
+#define P3D_PLANT_BLOB_HEADER_DATA_SIZE      (3)
+#define P3D_PLANT_BLOB_HEADER_GROUPS         (4)
+#define P3D_PLANT_BLOB_HEADER_VERTEX_STRIDE  (5)
+#define P3D_PLANT_BLOB_HEADER_VERTEX_COUNT   (6)
+#define P3D_PLANT_BLOB_HEADER_VERTEX_DATA    (7)
+#define P3D_PLANT_BLOB_HEADER_ATTR_OFFSETS   (8)
+#define P3D_PLANT_BLOB_HEADER_BBOX           (P3D_PLANT_BLOB_HEADER_ATTR_OFFSETS + P3D_MAX_ATTRS)
+#define P3D_PLANT_BLOB_HEADER_SIZE           (P3D_PLANT_BLOB_HEADER_BBOX + 6)
+
+#define P3D_PLANT_BLOB_GROUP_NAME            (0)
+#define P3D_PLANT_BLOB_GROUP_BRANCHES        (1)
+#define P3D_PLANT_BLOB_GROUP_FIRST_VERTEX    (2)
+#define P3D_PLANT_BLOB_GROUP_VERTEX_COUNT    (3)
+#define P3D_PLANT_BLOB_GROUP_INDEX_TYPE      (4)
+#define P3D_PLANT_BLOB_GROUP_INDEX_COUNT     (5)
+#define P3D_PLANT_BLOB_GROUP_INDEX_DATA      (6)
+#define P3D_PLANT_BLOB_GROUP_BBOX            (7)
+#define P3D_PLANT_BLOB_GROUP_COLOR           (13)
+#define P3D_PLANT_BLOB_GROUP_FLAGS           (16)
+#define P3D_PLANT_BLOB_GROUP_BILLBOARD_MODE  (17)
+#define P3D_PLANT_BLOB_GROUP_ALPHA_FADE_IN   (18)
+#define P3D_PLANT_BLOB_GROUP_ALPHA_FADE_OUT  (19)
+#define P3D_PLANT_BLOB_GROUP_TEX_NAMES       (20)
+#define P3D_PLANT_BLOB_GROUP_SIZE            (P3D_PLANT_BLOB_GROUP_TEX_NAMES + P3D_MAX_TEX_LAYERS)
+
+#define P3D_PLANT_BLOB_FLAG_DOUBLE_SIDED     (0x01)
+#define P3D_PLANT_BLOB_FLAG_TRANSPARENT      (0x02)
+#define P3D_PLANT_BLOB_FLAG_ALPHA_CTRL       (0x04)
+
+static const char  P3DPlantBlobMagic[4] = { 'N', 'G', 'P', 'B' };
+
+/* number of floats per vertex attribute value */
+static unsigned_int32 P3DPlantBlobGetAttrElementSize
+                                      (unsigned_int32        Attr)
+ {
+  return(Attr == P3D_ATTR_TEXCOORD0 ? 2 : 3);
+ }
+
+static unsigned_int32 P3DPlantBlobGetIndexSize
+                                      (unsigned_int32        IndexType)
+ {
+  return(IndexType == P3D_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned_int32));
+ }
+
+/* returns offset of data block placed after Offset (aligned if Aligned */
+/* is true), updates Offset to point after the end of this block        */
+static unsigned_int32 P3DPlantBlobAllocBlock
+                                      (unsigned_int32       *Offset,
+                                       unsigned_int32        ItemCount,
+                                       unsigned_int32        ItemSize,
+                                       bool                Aligned)
+ {
+  unsigned_int32                         BlockOffset;
+
+  BlockOffset = *Offset;
+
+  if (Aligned)
+   {
+    BlockOffset = (BlockOffset + P3D_PLANT_BLOB_ALIGNMENT - 1) & ~(P3D_PLANT_BLOB_ALIGNMENT - 1);
+   }
+
+  if ((BlockOffset < *Offset) ||
+      (ItemCount > (0xFFFFFFFFU - BlockOffset) / ItemSize))
+   {
+    throw P3DExceptionGeneric("plant geometry is too large");
+   }
+
+  *Offset = BlockOffset + ItemCount * ItemSize;
+
+  return(BlockOffset);
+ }
+
+/* returns 0 for NULL string */
+static unsigned_int32 P3DPlantBlobAllocString
+                                      (unsigned_int32       *Offset,
+                                       const char         *String)
+ {
+  if (String == NULL)
+   {
+    return(0);
+   }
+
+  return(P3DPlantBlobAllocBlock(Offset,strlen(String) + 1,1,false));
+ }
+
+static bool        P3DPlantBlobBlockValid
+                                      (unsigned_int32        DataSize,
+                                       unsigned_int32        BlockOffset,
+                                       unsigned_int32        ItemCount,
+                                       unsigned_int32        ItemSize)
+ {
+  return((BlockOffset % P3D_PLANT_BLOB_ALIGNMENT == 0) &&
+         (BlockOffset >= P3D_PLANT_BLOB_HEADER_SIZE * sizeof(unsigned_int32)) &&
+         (BlockOffset <= DataSize) &&
+         (ItemCount <= (DataSize - BlockOffset) / ItemSize));
+ }
+
+static bool        P3DPlantBlobStringValid
+                                      (const unsigned char*Data,
+                                       unsigned_int32        DataSize,
+                                       unsigned_int32        Offset)
+ {
+  if (Offset == 0)
+   {
+    return(true);
+   }
+
+  return((Offset >= P3D_PLANT_BLOB_HEADER_SIZE * sizeof(unsigned_int32)) &&
+         (Offset < DataSize) &&
+         (memchr(Data + Offset,0,DataSize - Offset) != NULL));
+ }
+
+static void        P3DPlantBlobPutFloat
+                                      (unsigned_int32       *Item,
+                                       float               Value)
+ {
+  memcpy(Item,&Value,sizeof(Value));
+ }
+
+static float       P3DPlantBlobGetFloat
+                                      (const unsigned_int32 *Item)
+ {
+  float                                Value;
+
+  memcpy(&Value,Item,sizeof(Value));
+
+  return(Value);
+ }
+
+/* groups without material are stored with default material */
+static const P3DMaterialDef
+                  *P3DPlantBlobGetMaterial
+                                      (const P3DHLIPlantTemplate
+                                                          *Template,
+                                       unsigned_int32        GroupIndex,
+                                       const P3DMaterialDef
+                                                          *DefaultMaterial)
+ {
+  const P3DMaterialDef                *Material;
+
+  Material = Template->GetMaterial(GroupIndex);
+
+  return(Material != 0 ? Material : DefaultMaterial);
+ }
+
+static void        P3DPlantBlobCalcBBox
+                                      (float              *Min,
+                                       float              *Max,
+                                       const unsigned char*Positions,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        VertexCount)
+ {
+  Min[0] = Min[1] = Min[2] = 0.0f;
+  Max[0] = Max[1] = Max[2] = 0.0f;
+
+  for (unsigned_int32 VertexIndex = 0; VertexIndex < VertexCount; VertexIndex++)
+   {
+    const float                       *Position;
+
+    Position = (const float*)(Positions + VertexIndex * Stride);
+
+    for (unsigned_int32 Axis = 0; Axis < 3; Axis++)
+     {
+      if      ((VertexIndex == 0) || (Position[Axis] < Min[Axis]))
+       {
+        Min[Axis] = Position[Axis];
+       }
+
+      if ((VertexIndex == 0) || (Position[Axis] > Max[Axis]))
+       {
+        Max[Axis] = Position[Axis];
+       }
+     }
+   }
+ }
+
+                   P3DHLIPlantBlob::P3DHLIPlantBlob
+                                      ()
+ {
+  OwnedData = 0;
+  Header    = 0;
+  DataSize  = 0;
+ }
+
+                   P3DHLIPlantBlob::~P3DHLIPlantBlob
+                                      ()
+ {
+  Clear();
+ }
+
+void               P3DHLIPlantBlob::Clear
+                                      ()
+ {
+  delete[] OwnedData;
+
+  Mapping.Close();
+
+  OwnedData = 0;
+  Header    = 0;
+  DataSize  = 0;
+ }
+
+void               P3DHLIPlantBlob::Create
+                                      (const P3DHLIPlantTemplate
+                                                          *Template,
+                                       const P3DHLIPlantInstance
+                                                          *Instance,
+                                       const P3DHLIVAttrFormat
+                                                          *VAttrFormat)
+ {
+  unsigned_int32                        *Table;
+  unsigned_int32                         TableSize;
+  unsigned_int32                         GroupCount;
+  unsigned_int32                         GroupIndex;
+  unsigned_int32                         AttrIndex;
+  unsigned_int32                         Stride;
+  unsigned_int32                         VertexCount;
+  unsigned_int32                         Offset;
+  unsigned char                       *Data;
+  float                                Min[3];
+  float                                Max[3];
+  float                               *Positions;
+  P3DMaterialDef                       DefaultMaterial;
+  P3DHLIVAttrBuffers                  *VAttrBuffers;
+  P3DHLIGroupBuffers                  *GroupBuffers;
+
+  Clear();
+
+  Stride = VAttrFormat->GetStride();
+
+  if ((Stride == 0) || (Stride % sizeof(float) != 0))
+   {
+    throw P3DExceptionGeneric("invalid vertex format");
+   }
+
+  for (AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+   {
+    if (VAttrFormat->HasAttr(AttrIndex))
+     {
+      unsigned_int32                     AttrOffset;
+
+      AttrOffset = VAttrFormat->GetAttrOffset(AttrIndex);
+
+      if ((AttrOffset % sizeof(float) != 0) ||
+          (AttrOffset > Stride) ||
+          (P3DPlantBlobGetAttrElementSize(AttrIndex) * sizeof(float) > Stride - AttrOffset))
+       {
+        throw P3DExceptionGeneric("invalid vertex format");
+       }
+     }
+   }
+
+  GroupCount = Template->GetGroupCount();
+  TableSize  = P3D_PLANT_BLOB_HEADER_SIZE + GroupCount * P3D_PLANT_BLOB_GROUP_SIZE;
+  Table      = new unsigned_int32[TableSize];
+
+  memset(Table,0,TableSize * sizeof(unsigned_int32));
+
+  Positions    = 0;
+  VAttrBuffers = 0;
+  GroupBuffers = 0;
+
+  try
+   {
+    /* first pass - layout */
+    memcpy(&Table[P3D_PLANT_BLOB_HEADER_MAGIC],P3DPlantBlobMagic,sizeof(P3DPlantBlobMagic));
+
+    Table[P3D_PLANT_BLOB_HEADER_VERSION]       = P3D_PLANT_BLOB_VERSION;
+    Table[P3D_PLANT_BLOB_HEADER_BYTE_ORDER]    = P3D_PLANT_BLOB_BYTE_ORDER;
+    Table[P3D_PLANT_BLOB_HEADER_GROUPS]        = GroupCount;
+    Table[P3D_PLANT_BLOB_HEADER_VERTEX_STRIDE] = Stride;
+
+    for (AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+     {
+      Table[P3D_PLANT_BLOB_HEADER_ATTR_OFFSETS + AttrIndex] =
+       VAttrFormat->HasAttr(AttrIndex) ? VAttrFormat->GetAttrOffset(AttrIndex) : P3D_PLANT_BLOB_NO_ATTR;
+     }
+
+    Offset      = TableSize * sizeof(unsigned_int32);
+    VertexCount = 0;
+
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      unsigned_int32                    *Record;
+      const P3DMaterialDef            *Material;
+      unsigned_int32                     BranchCount;
+      unsigned_int32                     GroupVertexCount;
+      unsigned_int32                     Flags;
+      float                            R,G,B;
+
+      Record   = &Table[P3D_PLANT_BLOB_HEADER_SIZE + GroupIndex * P3D_PLANT_BLOB_GROUP_SIZE];
+      Material = P3DPlantBlobGetMaterial(Template,GroupIndex,&DefaultMaterial);
+
+      BranchCount      = Instance->GetBranchCount(GroupIndex);
+      GroupVertexCount = BranchCount * Template->GetVAttrCountI(GroupIndex);
+
+      if (GroupVertexCount > 0xFFFFFFFFU - VertexCount)
+       {
+        throw P3DExceptionGeneric("plant geometry is too large");
+       }
+
+      Record[P3D_PLANT_BLOB_GROUP_NAME]         = P3DPlantBlobAllocString(&Offset,Template->GetGroupName(GroupIndex));
+      Record[P3D_PLANT_BLOB_GROUP_BRANCHES]     = BranchCount;
+      Record[P3D_PLANT_BLOB_GROUP_FIRST_VERTEX] = VertexCount;
+      Record[P3D_PLANT_BLOB_GROUP_VERTEX_COUNT] = GroupVertexCount;
+      Record[P3D_PLANT_BLOB_GROUP_INDEX_TYPE]   = GroupVertexCount <= P3D_PLANT_BLOB_SHORT_INDEX_LIMIT ?
+                                                   P3D_UNSIGNED_SHORT : P3D_UNSIGNED_INT;
+      Record[P3D_PLANT_BLOB_GROUP_INDEX_COUNT]  = BranchCount * Template->GetIndexCount(GroupIndex,P3D_TRIANGLE_LIST);
+
+      Material->GetColor(&R,&G,&B);
+
+      P3DPlantBlobPutFloat(&Record[P3D_PLANT_BLOB_GROUP_COLOR    ],R);
+      P3DPlantBlobPutFloat(&Record[P3D_PLANT_BLOB_GROUP_COLOR + 1],G);
+      P3DPlantBlobPutFloat(&Record[P3D_PLANT_BLOB_GROUP_COLOR + 2],B);
+
+      Flags = 0;
+
+      if (Material->IsDoubleSided())
+       {
+        Flags |= P3D_PLANT_BLOB_FLAG_DOUBLE_SIDED;
+       }
+
+      if (Material->IsTransparent())
+       {
+        Flags |= P3D_PLANT_BLOB_FLAG_TRANSPARENT;
+       }
+
+      if (Material->IsAlphaCtrlEnabled())
+       {
+        Flags |= P3D_PLANT_BLOB_FLAG_ALPHA_CTRL;
+       }
+
+      Record[P3D_PLANT_BLOB_GROUP_FLAGS]          = Flags;
+      Record[P3D_PLANT_BLOB_GROUP_BILLBOARD_MODE] = Material->GetBillboardMode();
+
+      P3DPlantBlobPutFloat(&Record[P3D_PLANT_BLOB_GROUP_ALPHA_FADE_IN],Material->GetAlphaFadeIn());
+      P3DPlantBlobPutFloat(&Record[P3D_PLANT_BLOB_GROUP_ALPHA_FADE_OUT],Material->GetAlphaFadeOut());
+
+      for (unsigned_int32 Layer = 0; Layer < P3D_MAX_TEX_LAYERS; Layer++)
+       {
+        Record[P3D_PLANT_BLOB_GROUP_TEX_NAMES + Layer] =
+         P3DPlantBlobAllocString(&Offset,Material->GetTexName(Layer));
+       }
+
+      VertexCount += GroupVertexCount;
+     }
+
+    Table[P3D_PLANT_BLOB_HEADER_VERTEX_COUNT] = VertexCount;
+    Table[P3D_PLANT_BLOB_HEADER_VERTEX_DATA]  = P3DPlantBlobAllocBlock(&Offset,VertexCount,Stride,true);
+
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      unsigned_int32                    *Record;
+
+      Record = &Table[P3D_PLANT_BLOB_HEADER_SIZE + GroupIndex * P3D_PLANT_BLOB_GROUP_SIZE];
+
+      Record[P3D_PLANT_BLOB_GROUP_INDEX_DATA] =
+       P3DPlantBlobAllocBlock(&Offset,
+                              Record[P3D_PLANT_BLOB_GROUP_INDEX_COUNT],
+                              P3DPlantBlobGetIndexSize(Record[P3D_PLANT_BLOB_GROUP_INDEX_TYPE]),
+                              true);
+     }
+
+    Table[P3D_PLANT_BLOB_HEADER_DATA_SIZE] = Offset;
+
+    /* second pass - data */
+    OwnedData = new unsigned char[Offset + P3D_PLANT_BLOB_ALIGNMENT - 1];
+    Data      = OwnedData + (P3D_PLANT_BLOB_ALIGNMENT - ((size_t)OwnedData % P3D_PLANT_BLOB_ALIGNMENT)) % P3D_PLANT_BLOB_ALIGNMENT;
+
+    memset(Data,0,Offset);
+    memcpy(Data,Table,TableSize * sizeof(unsigned_int32));
+
+    delete[] Table;
+
+    Table = (unsigned_int32*)Data;
+
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      const unsigned_int32              *Record;
+      const P3DMaterialDef            *Material;
+
+      Record   = &Table[P3D_PLANT_BLOB_HEADER_SIZE + GroupIndex * P3D_PLANT_BLOB_GROUP_SIZE];
+      Material = P3DPlantBlobGetMaterial(Template,GroupIndex,&DefaultMaterial);
+
+      if (Record[P3D_PLANT_BLOB_GROUP_NAME] != 0)
+       {
+        strcpy((char*)(Data + Record[P3D_PLANT_BLOB_GROUP_NAME]),Template->GetGroupName(GroupIndex));
+       }
+
+      for (unsigned_int32 Layer = 0; Layer < P3D_MAX_TEX_LAYERS; Layer++)
+       {
+        if (Record[P3D_PLANT_BLOB_GROUP_TEX_NAMES + Layer] != 0)
+         {
+          strcpy((char*)(Data + Record[P3D_PLANT_BLOB_GROUP_TEX_NAMES + Layer]),Material->GetTexName(Layer));
+         }
+       }
+     }
+
+    /* positions are needed for group bounding boxes */
+    if (!VAttrFormat->HasAttr(P3D_ATTR_VERTEX))
+     {
+      Positions = new float[VertexCount * 3];
+     }
+
+    VAttrBuffers = new P3DHLIVAttrBuffers[GroupCount];
+    GroupBuffers = new P3DHLIGroupBuffers[GroupCount];
+
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      const unsigned_int32              *Record;
+
+      Record = &Table[P3D_PLANT_BLOB_HEADER_SIZE + GroupIndex * P3D_PLANT_BLOB_GROUP_SIZE];
+
+      for (AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+       {
+        if ((VAttrFormat->HasAttr(AttrIndex)) &&
+            ((AttrIndex != P3D_ATTR_BILLBOARD_POS) || (Template->IsBillboard(GroupIndex))))
+         {
+          VAttrBuffers[GroupIndex].AddAttr(AttrIndex,
+                                           Data + Table[P3D_PLANT_BLOB_HEADER_VERTEX_DATA] +
+                                            Record[P3D_PLANT_BLOB_GROUP_FIRST_VERTEX] * Stride,
+                                           VAttrFormat->GetAttrOffset(AttrIndex),
+                                           Stride);
+         }
+       }
+
+      if (Positions != 0)
+       {
+        VAttrBuffers[GroupIndex].AddAttr(P3D_ATTR_VERTEX,
+                                         &Positions[Record[P3D_PLANT_BLOB_GROUP_FIRST_VERTEX] * 3],
+                                         0,
+                                         3 * sizeof(float));
+       }
+
+      GroupBuffers[GroupIndex].SetVAttrBuffers(&VAttrBuffers[GroupIndex]);
+      GroupBuffers[GroupIndex].SetIndexBuffer(Data + Record[P3D_PLANT_BLOB_GROUP_INDEX_DATA],
+                                              P3D_TRIANGLE_LIST,
+                                              Record[P3D_PLANT_BLOB_GROUP_INDEX_TYPE]);
+     }
+
+    /* vertices, indices and bounding box are filled in single pass */
+    Instance->FillAll(GroupBuffers,Min,Max);
+
+    for (unsigned_int32 Axis = 0; Axis < 3; Axis++)
+     {
+      P3DPlantBlobPutFloat(&Table[P3D_PLANT_BLOB_HEADER_BBOX + Axis],Min[Axis]);
+      P3DPlantBlobPutFloat(&Table[P3D_PLANT_BLOB_HEADER_BBOX + 3 + Axis],Max[Axis]);
+     }
+
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      unsigned_int32                    *Record;
+
+      Record = &Table[P3D_PLANT_BLOB_HEADER_SIZE + GroupIndex * P3D_PLANT_BLOB_GROUP_SIZE];
+
+      if (Positions != 0)
+       {
+        P3DPlantBlobCalcBBox(Min,Max,
+                             (const unsigned char*)&Positions[Record[P3D_PLANT_BLOB_GROUP_FIRST_VERTEX] * 3],
+                             3 * sizeof(float),
+                             Record[P3D_PLANT_BLOB_GROUP_VERTEX_COUNT]);
+       }
+      else
+       {
+        P3DPlantBlobCalcBBox(Min,Max,
+                             Data + Table[P3D_PLANT_BLOB_HEADER_VERTEX_DATA] +
+                              Record[P3D_PLANT_BLOB_GROUP_FIRST_VERTEX] * Stride +
+                              VAttrFormat->GetAttrOffset(P3D_ATTR_VERTEX),
+                             Stride,
+                             Record[P3D_PLANT_BLOB_GROUP_VERTEX_COUNT]);
+       }
+
+      for (unsigned_int32 Axis = 0; Axis < 3; Axis++)
+       {
+        P3DPlantBlobPutFloat(&Record[P3D_PLANT_BLOB_GROUP_BBOX + Axis],Min[Axis]);
+        P3DPlantBlobPutFloat(&Record[P3D_PLANT_BLOB_GROUP_BBOX + 3 + Axis],Max[Axis]);
+       }
+     }
+   }
+  catch (...)
+   {
+    if (OwnedData == 0)
+     {
+      delete[] Table;
+     }
+
+    delete[] GroupBuffers;
+    delete[] VAttrBuffers;
+    delete[] Positions;
+
+    Clear();
+
+    throw;
+   }
+
+  delete[] GroupBuffers;
+  delete[] VAttrBuffers;
+  delete[] Positions;
+
+  Header   = Table;
+  DataSize = Offset;
+ }
+
+void               P3DHLIPlantBlob::SaveFile
+                                      (const char         *FileName) const
+ {
+  FILE                                *Target;
+
+  if (Header == 0)
+   {
+    throw P3DExceptionGeneric("plant blob is empty");
+   }
+
+  Target = fopen(FileName,"wb");
+
+  if (Target == NULL)
+   {
+    throw P3DExceptionIO();
+   }
+
+  if (fwrite(Header,1,DataSize,Target) != DataSize)
+   {
+    fclose(Target);
+
+    throw P3DExceptionIO();
+   }
+
+  if (fclose(Target) != 0)
+   {
+    throw P3DExceptionIO();
+   }
+ }
+
+void               P3DHLIPlantBlob::MapFile
+                                      (const char         *FileName)
+ {
+  Clear();
+
+  Mapping.Open(FileName);
+
+  try
+   {
+    Attach(Mapping.GetData(),Mapping.GetDataSize());
+   }
+  catch (...)
+   {
+    Clear();
+
+    throw;
+   }
+ }
+
+void               P3DHLIPlantBlob::SetData
+                                      (const void         *Data,
+                                       unsigned_int32        DataSize)
+ {
+  Clear();
+
+  Attach(Data,DataSize);
+ }
+
+/* validates blob, so accessors may use it without further checks */
+void               P3DHLIPlantBlob::Attach
+                                      (const void         *Data,
+                                       unsigned_int32        DataSize)
+ {
+  const unsigned_int32                  *Items;
+  unsigned_int32                         GroupCount;
+  unsigned_int32                         Stride;
+  unsigned_int32                         VertexCount;
+
+  Items = (const unsigned_int32*)Data;
+
+  if (((size_t)Data % sizeof(unsigned_int32) != 0) ||
+      (DataSize < P3D_PLANT_BLOB_HEADER_SIZE * sizeof(unsigned_int32)) ||
+      (memcmp(&Items[P3D_PLANT_BLOB_HEADER_MAGIC],P3DPlantBlobMagic,sizeof(P3DPlantBlobMagic)) != 0) ||
+      (Items[P3D_PLANT_BLOB_HEADER_VERSION]    != P3D_PLANT_BLOB_VERSION) ||
+      (Items[P3D_PLANT_BLOB_HEADER_BYTE_ORDER] != P3D_PLANT_BLOB_BYTE_ORDER))
+   {
+    throw P3DExceptionGeneric("invalid plant blob header");
+   }
+
+  GroupCount  = Items[P3D_PLANT_BLOB_HEADER_GROUPS];
+  Stride      = Items[P3D_PLANT_BLOB_HEADER_VERTEX_STRIDE];
+  VertexCount = Items[P3D_PLANT_BLOB_HEADER_VERTEX_COUNT];
+
+  if ((Items[P3D_PLANT_BLOB_HEADER_DATA_SIZE] != DataSize) ||
+      (GroupCount > (DataSize / sizeof(unsigned_int32) - P3D_PLANT_BLOB_HEADER_SIZE) / P3D_PLANT_BLOB_GROUP_SIZE) ||
+      (Stride == 0) || (Stride % sizeof(float) != 0) ||
+      (!P3DPlantBlobBlockValid(DataSize,Items[P3D_PLANT_BLOB_HEADER_VERTEX_DATA],VertexCount,Stride)))
+   {
+    throw P3DExceptionGeneric("damaged plant blob");
+   }
+
+  for (unsigned_int32 AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+   {
+    unsigned_int32                       AttrOffset;
+
+    AttrOffset = Items[P3D_PLANT_BLOB_HEADER_ATTR_OFFSETS + AttrIndex];
+
+    if ((AttrOffset != P3D_PLANT_BLOB_NO_ATTR) &&
+        ((AttrOffset % sizeof(float) != 0) ||
+         (AttrOffset > Stride) ||
+         (P3DPlantBlobGetAttrElementSize(AttrIndex) * sizeof(float) > Stride - AttrOffset)))
+     {
+      throw P3DExceptionGeneric("damaged plant blob");
+     }
+   }
+
+  for (unsigned_int32 GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+   {
+    const unsigned_int32                *Record;
+    bool                               Valid;
+
+    Record = &Items[P3D_PLANT_BLOB_HEADER_SIZE + GroupIndex * P3D_PLANT_BLOB_GROUP_SIZE];
+
+    Valid = (Record[P3D_PLANT_BLOB_GROUP_FIRST_VERTEX] <= VertexCount) &&
+            (Record[P3D_PLANT_BLOB_GROUP_VERTEX_COUNT] <= VertexCount - Record[P3D_PLANT_BLOB_GROUP_FIRST_VERTEX]) &&
+            ((Record[P3D_PLANT_BLOB_GROUP_INDEX_TYPE] == P3D_UNSIGNED_SHORT) ||
+             (Record[P3D_PLANT_BLOB_GROUP_INDEX_TYPE] == P3D_UNSIGNED_INT)) &&
+            (P3DPlantBlobBlockValid(DataSize,
+                                    Record[P3D_PLANT_BLOB_GROUP_INDEX_DATA],
+                                    Record[P3D_PLANT_BLOB_GROUP_INDEX_COUNT],
+                                    P3DPlantBlobGetIndexSize(Record[P3D_PLANT_BLOB_GROUP_INDEX_TYPE]))) &&
+            (P3DPlantBlobStringValid((const unsigned char*)Data,DataSize,Record[P3D_PLANT_BLOB_GROUP_NAME]));
+
+    for (unsigned_int32 Layer = 0; (Valid) && (Layer < P3D_MAX_TEX_LAYERS); Layer++)
+     {
+      Valid = P3DPlantBlobStringValid((const unsigned char*)Data,DataSize,
+                                      Record[P3D_PLANT_BLOB_GROUP_TEX_NAMES + Layer]);
+     }
+
+    if (!Valid)
+     {
+      throw P3DExceptionGeneric("damaged plant blob");
+     }
+   }
+
+  Header         = Items;
+  this->DataSize = DataSize;
+ }
+
+bool               P3DHLIPlantBlob::IsMapped
+                                      () const
+ {
+  return(Mapping.IsOpen());
+ }
+
+const void        *P3DHLIPlantBlob::GetData
+                                      () const
+ {
+  return(Header);
+ }
+
+unsigned_int32       P3DHLIPlantBlob::GetDataSize
+                                      () const
+ {
+  return(DataSize);
+ }
+
+unsigned_int32       P3DHLIPlantBlob::GetGroupCount
+                                      () const
+ {
+  return(Header != 0 ? Header[P3D_PLANT_BLOB_HEADER_GROUPS] : 0);
+ }
+
+unsigned_int32       P3DHLIPlantBlob::GetVertexStride
+                                      () const
+ {
+  return(Header != 0 ? Header[P3D_PLANT_BLOB_HEADER_VERTEX_STRIDE] : 0);
+ }
+
+unsigned_int32       P3DHLIPlantBlob::GetVertexCount
+                                      () const
+ {
+  return(Header != 0 ? Header[P3D_PLANT_BLOB_HEADER_VERTEX_COUNT] : 0);
+ }
+
+bool               P3DHLIPlantBlob::HasAttr
+                                      (unsigned_int32        Attr) const
+ {
+  return((Header != 0) &&
+         (Attr < P3D_MAX_ATTRS) &&
+         (Header[P3D_PLANT_BLOB_HEADER_ATTR_OFFSETS + Attr] != P3D_PLANT_BLOB_NO_ATTR));
+ }
+
+unsigned_int32       P3DHLIPlantBlob::GetAttrOffset
+                                      (unsigned_int32        Attr) const
+ {
+  if (!HasAttr(Attr))
+   {
+    throw P3DExceptionGeneric("invalid vertex attribute");
+   }
+
+  return(Header[P3D_PLANT_BLOB_HEADER_ATTR_OFFSETS + Attr]);
+ }
+
+const void        *P3DHLIPlantBlob::GetVertexData
+                                      () const
+ {
+  if (Header == 0)
+   {
+    return(0);
+   }
+
+  return((const unsigned char*)Header + Header[P3D_PLANT_BLOB_HEADER_VERTEX_DATA]);
+ }
+
+void               P3DHLIPlantBlob::GetBoundingBox
+                                      (float              *Min,
+                                       float              *Max) const
+ {
+  for (unsigned_int32 Axis = 0; Axis < 3; Axis++)
+   {
+    if (Header != 0)
+     {
+      Min[Axis] = P3DPlantBlobGetFloat(&Header[P3D_PLANT_BLOB_HEADER_BBOX + Axis]);
+      Max[Axis] = P3DPlantBlobGetFloat(&Header[P3D_PLANT_BLOB_HEADER_BBOX + 3 + Axis]);
+     }
+    else
+     {
+      Min[Axis] = Max[Axis] = 0.0f;
+     }
+   }
+ }
+
+const
+unsigned_int32      *P3DHLIPlantBlob::GetGroupRecord
+                                      (unsigned_int32        GroupIndex) const
+ {
+  if (GroupIndex >= GetGroupCount())
+   {
+    throw P3DExceptionGeneric("group index out of range");
+   }
+
+  return(&Header[P3D_PLANT_BLOB_HEADER_SIZE + GroupIndex * P3D_PLANT_BLOB_GROUP_SIZE]);
+ }
+
+const char        *P3DHLIPlantBlob::GetString
+                                      (unsigned_int32        Offset) const
+ {
+  return(Offset != 0 ? (const char*)Header + Offset : NULL);
+ }
+
+const char        *P3DHLIPlantBlob::GetGroupName
+                                      (unsigned_int32        GroupIndex) const
+ {
+  return(GetString(GetGroupRecord(GroupIndex)[P3D_PLANT_BLOB_GROUP_NAME]));
+ }
+
+unsigned_int32       P3DHLIPlantBlob::GetBranchCount
+                                      (unsigned_int32        GroupIndex) const
+ {
+  return(GetGroupRecord(GroupIndex)[P3D_PLANT_BLOB_GROUP_BRANCHES]);
+ }
+
+unsigned_int32       P3DHLIPlantBlob::GetGroupFirstVertex
+                                      (unsigned_int32        GroupIndex) const
+ {
+  return(GetGroupRecord(GroupIndex)[P3D_PLANT_BLOB_GROUP_FIRST_VERTEX]);
+ }
+
+unsigned_int32       P3DHLIPlantBlob::GetGroupVertexCount
+                                      (unsigned_int32        GroupIndex) const
+ {
+  return(GetGroupRecord(GroupIndex)[P3D_PLANT_BLOB_GROUP_VERTEX_COUNT]);
+ }
+
+unsigned_int32       P3DHLIPlantBlob::GetIndexType
+                                      (unsigned_int32        GroupIndex) const
+ {
+  return(GetGroupRecord(GroupIndex)[P3D_PLANT_BLOB_GROUP_INDEX_TYPE]);
+ }
+
+unsigned_int32       P3DHLIPlantBlob::GetIndexCount
+                                      (unsigned_int32        GroupIndex) const
+ {
+  return(GetGroupRecord(GroupIndex)[P3D_PLANT_BLOB_GROUP_INDEX_COUNT]);
+ }
+
+const void        *P3DHLIPlantBlob::GetIndexData
+                                      (unsigned_int32        GroupIndex) const
+ {
+  return((const unsigned char*)Header + GetGroupRecord(GroupIndex)[P3D_PLANT_BLOB_GROUP_INDEX_DATA]);
+ }
+
+void               P3DHLIPlantBlob::GetGroupBoundingBox
+                                      (float              *Min,
+                                       float              *Max,
+                                       unsigned_int32        GroupIndex) const
+ {
+  const unsigned_int32                  *Record;
+
+  Record = GetGroupRecord(GroupIndex);
+
+  for (unsigned_int32 Axis = 0; Axis < 3; Axis++)
+   {
+    Min[Axis] = P3DPlantBlobGetFloat(&Record[P3D_PLANT_BLOB_GROUP_BBOX + Axis]);
+    Max[Axis] = P3DPlantBlobGetFloat(&Record[P3D_PLANT_BLOB_GROUP_BBOX + 3 + Axis]);
+   }
+ }
+
+void               P3DHLIPlantBlob::GetMaterial
+                                      (P3DMaterialDef     *Material,
+                                       unsigned_int32        GroupIndex) const
+ {
+  const unsigned_int32                  *Record;
+  unsigned_int32                         Flags;
+
+  Record = GetGroupRecord(GroupIndex);
+  Flags  = Record[P3D_PLANT_BLOB_GROUP_FLAGS];
+
+  Material->SetColor(P3DPlantBlobGetFloat(&Record[P3D_PLANT_BLOB_GROUP_COLOR]),
+                     P3DPlantBlobGetFloat(&Record[P3D_PLANT_BLOB_GROUP_COLOR + 1]),
+                     P3DPlantBlobGetFloat(&Record[P3D_PLANT_BLOB_GROUP_COLOR + 2]));
+
+  for (unsigned_int32 Layer = 0; Layer < P3D_MAX_TEX_LAYERS; Layer++)
+   {
+    Material->SetTexName(Layer,GetString(Record[P3D_PLANT_BLOB_GROUP_TEX_NAMES + Layer]));
+   }
+
+  Material->SetDoubleSided((Flags & P3D_PLANT_BLOB_FLAG_DOUBLE_SIDED) != 0);
+  Material->SetTransparent((Flags & P3D_PLANT_BLOB_FLAG_TRANSPARENT) != 0);
+  Material->SetBillboardMode(Record[P3D_PLANT_BLOB_GROUP_BILLBOARD_MODE]);
+  Material->SetAlphaCtrlState((Flags & P3D_PLANT_BLOB_FLAG_ALPHA_CTRL) != 0);
+  Material->SetAlphaFadeIn(P3DPlantBlobGetFloat(&Record[P3D_PLANT_BLOB_GROUP_ALPHA_FADE_IN]));
+  Material->SetAlphaFadeOut(P3DPlantBlobGetFloat(&Record[P3D_PLANT_BLOB_GROUP_ALPHA_FADE_OUT]));
+ }
+
@@ -0,0 +1,131 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#ifndef __P3DHLIBLOB_H__
+#define __P3DHLIBLOB_H__
+
+#include <ngpcore/p3dhli.h>
+#include <ngpcore/p3dfilemap.h>
+
+/* Self-contained geometry of single plant instance, ready for upload to */
+/* GPU. Vertices of all groups are interleaved (layout is described by  */
+/* P3DHLIVAttrFormat) and stored in single vertex block, groups occupy   */
+/* consecutive vertex ranges. Each group has its own triangle list index */
+/* block with 16-bit indices if group has no more than 65536 vertices,   */
+/* 32-bit otherwise. Indices are relative to the first vertex of group,  */
+/* so group should be drawn with base vertex equal to GetGroupFirstVertex*/
+/* (or with offset vertex buffer binding). Blob also contains bounding   */
+/* boxes, group names and materials. All data is kept in one memory block*/
+/* in native byte order, vertex and index blocks are aligned to 16 bytes */
+/* relative to the blob start, so saved blob may be mapped (or loaded    */
+/* into memory by application) and used as is.                          */
+class P3D_DLL_ENTRY P3DHLIPlantBlob
+ {
+  public           :
+
+                   P3DHLIPlantBlob    ();
+                  ~P3DHLIPlantBlob    ();
+
+  /* Instance must be created by Template. VAttrFormat stride and offsets */
+  /* must be multiple of 4. Billboard positions are generated for         */
+  /* billboard groups only, in other groups they are set to zero.         */
+  void             Create             (const P3DHLIPlantTemplate
+                                                          *Template,
+                                       const P3DHLIPlantInstance
+                                                          *Instance,
+                                       const P3DHLIVAttrFormat
+                                                          *VAttrFormat);
+
+  void             SaveFile           (const char         *FileName) const;
+
+  /* Both methods throw exception if data is not a valid blob. Data passed */
+  /* to SetData is not copied and must remain unchanged while blob is used,*/
+  /* it must be aligned at least to 4 bytes (16 bytes for aligned blocks). */
+  void             MapFile            (const char         *FileName);
+  void             SetData            (const void         *Data,
+                                       unsigned_int32        DataSize);
+
+  bool             IsMapped           () const;
+
+  const void      *GetData            () const;
+  unsigned_int32     GetDataSize        () const;
+
+  unsigned_int32     GetGroupCount      () const;
+
+  unsigned_int32     GetVertexStride    () const;
+  unsigned_int32     GetVertexCount     () const;
+  bool             HasAttr            (unsigned_int32        Attr) const;
+  unsigned_int32     GetAttrOffset      (unsigned_int32        Attr) const;
+  const void      *GetVertexData      () const;
+
+  void             GetBoundingBox     (float              *Min,
+                                       float              *Max) const;
+
+  const char      *GetGroupName       (unsigned_int32        GroupIndex) const;
+  unsigned_int32     GetBranchCount     (unsigned_int32        GroupIndex) const;
+  unsigned_int32     GetGroupFirstVertex(unsigned_int32        GroupIndex) const;
+  unsigned_int32     GetGroupVertexCount(unsigned_int32        GroupIndex) const;
+
+  /* returns P3D_UNSIGNED_SHORT or P3D_UNSIGNED_INT */
+  unsigned_int32     GetIndexType       (unsigned_int32        GroupIndex) const;
+  unsigned_int32     GetIndexCount      (unsigned_int32        GroupIndex) const;
+  const void      *GetIndexData       (unsigned_int32        GroupIndex) const;
+
+  void             GetGroupBoundingBox(float              *Min,
+                                       float              *Max,
+                                       unsigned_int32        GroupIndex) const;
+
+  void             GetMaterial        (P3DMaterialDef     *Material,
+                                       unsigned_int32        GroupIndex) const;
+
+  private          :
+
+                   P3DHLIPlantBlob    (const P3DHLIPlantBlob
+                                                          &Source);
+  P3DHLIPlantBlob &operator =         (const P3DHLIPlantBlob
+                                                          &Source);
+
+  void             Clear              ();
+  void             Attach             (const void         *Data,
+                                       unsigned_int32        DataSize);
+  const char      *GetString          (unsigned_int32        Offset) const;
+  const
+  unsigned_int32    *GetGroupRecord     (unsigned_int32        GroupIndex) const;
+
+  /* memory allocated by Create, 0 if blob is mapped or attached */
+  unsigned char                       *OwnedData;
+  const unsigned_int32                  *Header;
+  unsigned_int32                         DataSize;
+  P3DFileMapping                       Mapping;
+ };
+
+#endif
+
@@ -0,0 +1,263 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+ #include <process.h>
+#else
+ #include <unistd.h>
+#endif
+
+#include <ngpcore/p3dexcept.h>
+#include <ngpcore/p3dhlicache.h>
+
+#define P3D_GEOMETRY_CACHE_FILE_EXT ".ngpg"
+/* "/" + 4 hash items + 3 key items + extension + zero */
+#define P3D_GEOMETRY_CACHE_NAME_LEN  (1 + 4 * 8 + 3 * 9 + 5 + 1)
+
+/* Key items */
+#define P3D_GEOMETRY_KEY_MODEL_HASH (0)
+#define P3D_GEOMETRY_KEY_SEED       (P3D_GEOMETRY_KEY_MODEL_HASH + P3D_FINGERPRINT_SIZE)
+#define P3D_GEOMETRY_KEY_ATTR_MASK  (P3D_GEOMETRY_KEY_SEED + 1)
+#define P3D_GEOMETRY_KEY_FLAGS      (P3D_GEOMETRY_KEY_ATTR_MASK + 1)
+#define P3D_GEOMETRY_KEY_VERSION    (P3D_GEOMETRY_KEY_FLAGS + 1)
+
+static unsigned_int32 P3DHLICacheGetProcessId
+                                      ()
+ {
+  #if defined(_WIN32)
+  return((unsigned_int32)_getpid());
+  #else
+  return((unsigned_int32)getpid());
+  #endif
+ }
+
+                   P3DHLIGeometryCache::P3DHLIGeometryCache
+                                      (const char         *DirName)
+ {
+  this->DirName = new char[strlen(DirName) + 1];
+
+  strcpy(this->DirName,DirName);
+
+  HitCount        = 0;
+  MissCount       = 0;
+  TempFileCounter = 0;
+ }
+
+                   P3DHLIGeometryCache::~P3DHLIGeometryCache
+                                      ()
+ {
+  delete[] DirName;
+ }
+
+void               P3DHLIGeometryCache::GetEntryKey
+                                      (unsigned_int32       *Key,
+                                       const P3DPlantModel*Model,
+                                       unsigned_int32        BaseSeed,
+                                       unsigned_int32        AttrMask)
+ {
+  Model->GetFingerprint(&Key[P3D_GEOMETRY_KEY_MODEL_HASH]);
+
+  Key[P3D_GEOMETRY_KEY_SEED]      = BaseSeed == 0 ? Model->GetBaseSeed() : BaseSeed;
+  Key[P3D_GEOMETRY_KEY_ATTR_MASK] = AttrMask;
+  Key[P3D_GEOMETRY_KEY_FLAGS]     = Model->GetFlags();
+  /* generated geometry may change between library versions */
+  Key[P3D_GEOMETRY_KEY_VERSION]   = (P3DHLI_VER_MAJOR << 16) |
+                                    (P3DHLI_VER_MINOR << 8)  |
+                                    (P3DHLI_VER_RELEASE);
+ }
+
+P3DHLIPlantGeometry
+                  *P3DHLIGeometryCache::GetGeometry
+                                      (const P3DHLIPlantTemplate
+                                                          *Template,
+                                       unsigned_int32        BaseSeed,
+                                       unsigned_int32        AttrMask)
+ {
+  unsigned_int32                         Key[P3D_GEOMETRY_FILE_KEY_SIZE];
+  char                                *FileName;
+  P3DHLIPlantGeometry                 *Geometry;
+  bool                                 Found;
+
+  /* model fingerprint calculation updates cached fingerprints */
+  /* of model parts                                            */
+  Mutex.Lock();
+
+  try
+   {
+    GetEntryKey(Key,Template->GetModel(),BaseSeed,AttrMask);
+   }
+  catch (...)
+   {
+    Mutex.Unlock();
+
+    throw;
+   }
+
+  Mutex.Unlock();
+
+  /* library version is not a part of file name, so entries made */
+  /* by previous versions are replaced instead of accumulating   */
+  FileName = new char[strlen(DirName) + P3D_GEOMETRY_CACHE_NAME_LEN];
+
+  sprintf(FileName,"%s/%08x%08x%08x%08x-%08x-%08x-%08x" P3D_GEOMETRY_CACHE_FILE_EXT,
+          DirName,
+          Key[P3D_GEOMETRY_KEY_MODEL_HASH],
+          Key[P3D_GEOMETRY_KEY_MODEL_HASH + 1],
+          Key[P3D_GEOMETRY_KEY_MODEL_HASH + 2],
+          Key[P3D_GEOMETRY_KEY_MODEL_HASH + 3],
+          Key[P3D_GEOMETRY_KEY_SEED],
+          Key[P3D_GEOMETRY_KEY_ATTR_MASK],
+          Key[P3D_GEOMETRY_KEY_FLAGS]);
+
+  Geometry = 0;
+
+  try
+   {
+    Geometry = new P3DHLIPlantGeometry();
+
+    /* missing and damaged files are just cache misses */
+    try
+     {
+      Found = Geometry->MapFile(FileName,Key);
+     }
+    catch (...)
+     {
+      Found = false;
+     }
+
+    if (!Found)
+     {
+      Geometry->Generate(Template,BaseSeed,AttrMask);
+
+      StoreEntry(Geometry,FileName,Key);
+     }
+   }
+  catch (...)
+   {
+    delete Geometry;
+    delete[] FileName;
+
+    throw;
+   }
+
+  delete[] FileName;
+
+  Mutex.Lock();
+
+  if (Found)
+   {
+    HitCount++;
+   }
+  else
+   {
+    MissCount++;
+   }
+
+  Mutex.Unlock();
+
+  return(Geometry);
+ }
+
+void               P3DHLIGeometryCache::StoreEntry
+                                      (const P3DHLIPlantGeometry
+                                                          *Geometry,
+                                       const char         *FileName,
+                                       const unsigned_int32 *Key)
+ {
+  char                                *TempFileName;
+  unsigned_int32                         TempIndex;
+
+  Mutex.Lock();
+
+  TempIndex = TempFileCounter++;
+
+  Mutex.Unlock();
+
+  TempFileName = new char[strlen(FileName) + 32];
+
+  sprintf(TempFileName,"%s.%u.%u.tmp",FileName,
+          (unsigned int)P3DHLICacheGetProcessId(),
+          (unsigned int)TempIndex);
+
+  /* entry is written to temporary file and then renamed, so other */
+  /* threads and processes never see partially written entries     */
+  try
+   {
+    Geometry->SaveFile(TempFileName,Key);
+
+    #if defined(_WIN32)
+    remove(FileName);
+    #endif
+
+    if (rename(TempFileName,FileName) != 0)
+     {
+      remove(TempFileName);
+     }
+   }
+  catch (...)
+   {
+    remove(TempFileName);
+   }
+
+  delete[] TempFileName;
+ }
+
+unsigned_int32       P3DHLIGeometryCache::GetHitCount
+                                      () const
+ {
+  unsigned_int32                         Result;
+
+  Mutex.Lock();
+
+  Result = HitCount;
+
+  Mutex.Unlock();
+
+  return(Result);
+ }
+
+unsigned_int32       P3DHLIGeometryCache::GetMissCount
+                                      () const
+ {
+  unsigned_int32                         Result;
+
+  Mutex.Lock();
+
+  Result = MissCount;
+
+  Mutex.Unlock();
+
+  return(Result);
+ }
+
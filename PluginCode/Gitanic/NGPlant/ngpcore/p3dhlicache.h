@@ -0,0 +1,94 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#ifndef __P3DHLICACHE_H__
+#define __P3DHLICACHE_H__
+
+#include <ngpcore/p3dhli.h>
+#include <ngpcore/p3dhliforest.h>
+#include <ngpcore/p3dthread.h>
+
+/* Persistent on-disk cache of generated plant geometry. Each entry is */
+/* stored in separate geometry file in cache directory. Entry key is   */
+/* made of model fingerprint, base seed, model flags and generated     */
+/* attributes, and is also stored in the file itself, so files made    */
+/* for another model or by another library version are detected as     */
+/* stale and regenerated.                                              */
+class P3D_DLL_ENTRY P3DHLIGeometryCache
+ {
+  public           :
+
+                   P3DHLIGeometryCache(const char         *DirName);
+                  ~P3DHLIGeometryCache();
+
+  /* Returns geometry mapped from cache file (without generation) if   */
+  /* cache contains up-to-date entry, otherwise generates geometry and */
+  /* stores it to cache. Failures to store entry are ignored. Caller   */
+  /* owns returned geometry. BaseSeed == 0 means "use model seed".     */
+  /* May be called from several threads simultaneously.                */
+  P3DHLIPlantGeometry
+                  *GetGeometry        (const P3DHLIPlantTemplate
+                                                          *Template,
+                                       unsigned_int32        BaseSeed,
+                                       unsigned_int32        AttrMask);
+
+  unsigned_int32     GetHitCount        () const;
+  unsigned_int32     GetMissCount       () const;
+
+  /* Key must have room for P3D_GEOMETRY_FILE_KEY_SIZE items. Must not */
+  /* be called for the same model from several threads simultaneously. */
+  static void      GetEntryKey        (unsigned_int32       *Key,
+                                       const P3DPlantModel*Model,
+                                       unsigned_int32        BaseSeed,
+                                       unsigned_int32        AttrMask);
+
+  private          :
+
+                   P3DHLIGeometryCache(const P3DHLIGeometryCache
+                                                          &Source);
+  P3DHLIGeometryCache
+                  &operator =         (const P3DHLIGeometryCache
+                                                          &Source);
+
+  void             StoreEntry         (const P3DHLIPlantGeometry
+                                                          *Geometry,
+                                       const char         *FileName,
+                                       const unsigned_int32 *Key);
+
+  char                                *DirName;
+  mutable P3DMutex                     Mutex;
+  unsigned_int32                         HitCount;
+  unsigned_int32                         MissCount;
+  unsigned_int32                         TempFileCounter;
+ };
+
+#endif
+
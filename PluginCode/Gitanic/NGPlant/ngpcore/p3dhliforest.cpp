@@ -0,0 +1,700 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <ngpcore/p3dexcept.h>
+#include <ngpcore/p3diostream.h>
+#include <ngpcore/p3dhliforest.h>
+
+/* number of floats per vertex attribute value */
+static unsigned_int32 P3DHLIGetAttrElementSize
+                                      (unsigned_int32        Attr)
+ {
+  return(Attr == P3D_ATTR_TEXCOORD0 ? 2 : 3);
+ }
+
+                   P3DHLIPlantGeometry::P3DHLIPlantGeometry
+                                      ()
+ {
+  GroupCount = 0;
+  Groups     = 0;
+
+  Min[0] = Min[1] = Min[2] = 0.0f;
+  Max[0] = Max[1] = Max[2] = 0.0f;
+ }
+
+                   P3DHLIPlantGeometry::~P3DHLIPlantGeometry
+                                      ()
+ {
+  Clear();
+ }
+
+void               P3DHLIPlantGeometry::Clear
+                                      ()
+ {
+  if (!Mapping.IsOpen())
+   {
+    for (unsigned_int32 GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      for (unsigned_int32 AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+       {
+        delete[] Groups[GroupIndex].VAttrBuffers[AttrIndex];
+       }
+
+      delete[] Groups[GroupIndex].IndexBuffer;
+     }
+   }
+
+  delete[] Groups;
+
+  Mapping.Close();
+
+  GroupCount = 0;
+  Groups     = 0;
+ }
+
+void               P3DHLIPlantGeometry::Generate
+                                      (const P3DHLIPlantTemplate
+                                                          *Template,
+                                       unsigned_int32        BaseSeed,
+                                       unsigned_int32        AttrMask)
+ {
+  P3DHLIPlantInstance                 *Instance;
+  P3DHLIVAttrBuffers                  *VAttrBuffers;
+  P3DHLIGroupBuffers                  *GroupBuffers;
+
+  Clear();
+
+  Instance     = 0;
+  VAttrBuffers = 0;
+  GroupBuffers = 0;
+
+  try
+   {
+    unsigned_int32                       GroupIndex;
+    unsigned_int32                       AttrIndex;
+
+    Instance = Template->CreateInstance(BaseSeed);
+    Instance->Materialize();
+
+    GroupCount = Template->GetGroupCount();
+    Groups     = new GroupGeometry[GroupCount];
+
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      for (AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+       {
+        Groups[GroupIndex].VAttrBuffers[AttrIndex] = 0;
+       }
+
+      Groups[GroupIndex].IndexBuffer = 0;
+     }
+
+    VAttrBuffers = new P3DHLIVAttrBuffers[GroupCount];
+    GroupBuffers = new P3DHLIGroupBuffers[GroupCount];
+
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      GroupGeometry                   *Group;
+
+      Group = &Groups[GroupIndex];
+
+      Group->BranchCount = Instance->GetBranchCount(GroupIndex);
+      Group->VAttrCount  = Group->BranchCount * Template->GetVAttrCountI(GroupIndex);
+      Group->IndexCount  = Group->BranchCount * Template->GetIndexCount(GroupIndex,P3D_TRIANGLE_LIST);
+
+      for (AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+       {
+        if (((AttrMask & P3D_ATTR_MASK(AttrIndex)) != 0) &&
+            ((AttrIndex != P3D_ATTR_BILLBOARD_POS) || (Template->IsBillboard(GroupIndex))))
+         {
+          unsigned_int32                 ElementSize;
+
+          ElementSize = P3DHLIGetAttrElementSize(AttrIndex);
+
+          Group->VAttrBuffers[AttrIndex] = new float[Group->VAttrCount * ElementSize];
+
+          VAttrBuffers[GroupIndex].AddAttr(AttrIndex,
+                                           Group->VAttrBuffers[AttrIndex],
+                                           0,
+                                           ElementSize * sizeof(float));
+         }
+       }
+
+      Group->IndexBuffer = new unsigned_int32[Group->IndexCount];
+
+      GroupBuffers[GroupIndex].SetVAttrBuffers(&VAttrBuffers[GroupIndex]);
+      GroupBuffers[GroupIndex].SetIndexBuffer(Group->IndexBuffer,
+                                              P3D_TRIANGLE_LIST,
+                                              P3D_UNSIGNED_INT);
+     }
+
+    /* vertices, indices and bounding box are filled in single pass */
+    Instance->FillAll(GroupBuffers,Min,Max);
+   }
+  catch (...)
+   {
+    delete[] GroupBuffers;
+    delete[] VAttrBuffers;
+    delete Instance;
+
+    Clear();
+
+    throw;
+   }
+
+  delete[] GroupBuffers;
+  delete[] VAttrBuffers;
+  delete Instance;
+ }
+
+void               P3DHLIPlantGeometry::CheckGroupIndex
+                                      (unsigned_int32        GroupIndex) const
+ {
+  if (GroupIndex >= GroupCount)
+   {
+    throw P3DExceptionGeneric("group index out of range");
+   }
+ }
+
+unsigned_int32       P3DHLIPlantGeometry::GetGroupCount
+                                      () const
+ {
+  return(GroupCount);
+ }
+
+unsigned_int32       P3DHLIPlantGeometry::GetBranchCount
+                                      (unsigned_int32        GroupIndex) const
+ {
+  CheckGroupIndex(GroupIndex);
+
+  return(Groups[GroupIndex].BranchCount);
+ }
+
+unsigned_int32       P3DHLIPlantGeometry::GetVAttrCountI
+                                      (unsigned_int32        GroupIndex) const
+ {
+  CheckGroupIndex(GroupIndex);
+
+  return(Groups[GroupIndex].VAttrCount);
+ }
+
+const float       *P3DHLIPlantGeometry::GetVAttrBufferI
+                                      (unsigned_int32        GroupIndex,
+                                       unsigned_int32        Attr) const
+ {
+  CheckGroupIndex(GroupIndex);
+
+  if (Attr >= P3D_MAX_ATTRS)
+   {
+    throw P3DExceptionGeneric("invalid vertex attribute");
+   }
+
+  return(Groups[GroupIndex].VAttrBuffers[Attr]);
+ }
+
+unsigned_int32       P3DHLIPlantGeometry::GetIndexCount
+                                      (unsigned_int32        GroupIndex) const
+ {
+  CheckGroupIndex(GroupIndex);
+
+  return(Groups[GroupIndex].IndexCount);
+ }
+
+const
+unsigned_int32      *P3DHLIPlantGeometry::GetIndexBuffer
+                                      (unsigned_int32        GroupIndex) const
+ {
+  CheckGroupIndex(GroupIndex);
+
+  return(Groups[GroupIndex].IndexBuffer);
+ }
+
+void               P3DHLIPlantGeometry::GetBoundingBox
+                                      (float              *Min,
+                                       float              *Max) const
+ {
+  for (unsigned_int32 Axis = 0; Axis < 3; Axis++)
+   {
+    Min[Axis] = this->Min[Axis];
+    Max[Axis] = this->Max[Axis];
+   }
+ }
+
+/* Geometry file layout: header, group table and data blocks. Header */
+/* and group table consist of unsigned_int32 items, bounding box is  */
+/* stored as float bits. Data blocks are aligned to allow direct use */
+/* of mapped buffers.                                                */
+
+#define P3D_GEOMETRY_FILE_VERSION      (1)
+#define P3D_GEOMETRY_FILE_BYTE_ORDER   (0x01020304U)
+#define P3D_GEOMETRY_FILE_ALIGNMENT    (16)
+
+#define P3D_GEOMETRY_HEADER_MAGIC      (0)
+#define P3D_GEOMETRY_HEADER_VERSION    (1)
+#define P3D_GEOMETRY_HEADER_BYTE_ORDER (2)
+#define P3D_GEOMETRY_HEADER_FILE_SIZE  (3)
+#define P3D_GEOMETRY_HEADER_GROUPS     (4)
+#define P3D_GEOMETRY_HEADER_BBOX       (5)
+#define P3D_GEOMETRY_HEADER_KEY        (11)
+#define P3D_GEOMETRY_HEADER_SIZE       (P3D_GEOMETRY_HEADER_KEY + P3D_GEOMETRY_FILE_KEY_SIZE)
+
+#define P3D_GEOMETRY_GROUP_BRANCHES    (0)
+#define P3D_GEOMETRY_GROUP_VATTR_COUNT (1)
+#define P3D_GEOMETRY_GROUP_INDEX_COUNT (2)
+#define P3D_GEOMETRY_GROUP_INDEX_DATA  (3)
+#define P3D_GEOMETRY_GROUP_VATTR_DATA  (4)
+#define P3D_GEOMETRY_GROUP_SIZE        (P3D_GEOMETRY_GROUP_VATTR_DATA + P3D_MAX_ATTRS)
+
+static const char  P3DGeometryFileMagic[4] = { 'N', 'G', 'P', 'G' };
+
+/* returns offset of data block placed after Offset, updates Offset */
+/* to point after the end of this block                             */
+static unsigned_int32 P3DGeometryFileAllocBlock
+                                      (unsigned_int32       *Offset,
+                                       unsigned_int32        ItemCount,
+                                       unsigned_int32        ItemSize)
+ {
+  unsigned_int32                         BlockOffset;
+
+  BlockOffset = (*Offset + P3D_GEOMETRY_FILE_ALIGNMENT - 1) & ~(P3D_GEOMETRY_FILE_ALIGNMENT - 1);
+
+  if ((BlockOffset < *Offset) ||
+      (ItemCount > (0xFFFFFFFFU - BlockOffset) / ItemSize))
+   {
+    throw P3DExceptionGeneric("geometry is too large to be saved");
+   }
+
+  *Offset = BlockOffset + ItemCount * ItemSize;
+
+  return(BlockOffset);
+ }
+
+static bool        P3DGeometryFileBlockValid
+                                      (unsigned_int32        FileSize,
+                                       unsigned_int32        BlockOffset,
+                                       unsigned_int32        ItemCount,
+                                       unsigned_int32        ItemSize)
+ {
+  return((BlockOffset % sizeof(unsigned_int32) == 0) &&
+         (BlockOffset >= P3D_GEOMETRY_HEADER_SIZE * sizeof(unsigned_int32)) &&
+         (BlockOffset <= FileSize) &&
+         (ItemCount <= (FileSize - BlockOffset) / ItemSize));
+ }
+
+static void        P3DGeometryFileWrite
+                                      (FILE               *Target,
+                                       unsigned_int32       *Offset,
+                                       unsigned_int32        BlockOffset,
+                                       const void         *Data,
+                                       unsigned_int32        Size)
+ {
+  static const char                    Padding[P3D_GEOMETRY_FILE_ALIGNMENT] = { 0 };
+
+  if (BlockOffset > *Offset)
+   {
+    if (fwrite(Padding,1,BlockOffset - *Offset,Target) != BlockOffset - *Offset)
+     {
+      throw P3DExceptionIO();
+     }
+   }
+
+  if (Size > 0)
+   {
+    if (fwrite(Data,1,Size,Target) != Size)
+     {
+      throw P3DExceptionIO();
+     }
+   }
+
+  *Offset = BlockOffset + Size;
+ }
+
+void               P3DHLIPlantGeometry::SaveFile
+                                      (const char         *FileName,
+                                       const unsigned_int32 *Key) const
+ {
+  unsigned_int32                        *Table;
+  unsigned_int32                         TableSize;
+  unsigned_int32                         Offset;
+  unsigned_int32                         GroupIndex;
+  unsigned_int32                         AttrIndex;
+  FILE                                *Target;
+
+  TableSize = P3D_GEOMETRY_HEADER_SIZE + GroupCount * P3D_GEOMETRY_GROUP_SIZE;
+  Table     = new unsigned_int32[TableSize];
+
+  memset(Table,0,TableSize * sizeof(unsigned_int32));
+
+  memcpy(&Table[P3D_GEOMETRY_HEADER_MAGIC],P3DGeometryFileMagic,sizeof(P3DGeometryFileMagic));
+
+  Table[P3D_GEOMETRY_HEADER_VERSION]    = P3D_GEOMETRY_FILE_VERSION;
+  Table[P3D_GEOMETRY_HEADER_BYTE_ORDER] = P3D_GEOMETRY_FILE_BYTE_ORDER;
+  Table[P3D_GEOMETRY_HEADER_GROUPS]     = GroupCount;
+
+  memcpy(&Table[P3D_GEOMETRY_HEADER_BBOX],Min,sizeof(Min));
+  memcpy(&Table[P3D_GEOMETRY_HEADER_BBOX + 3],Max,sizeof(Max));
+  memcpy(&Table[P3D_GEOMETRY_HEADER_KEY],Key,P3D_GEOMETRY_FILE_KEY_SIZE * sizeof(unsigned_int32));
+
+  Target = 0;
+
+  try
+   {
+    Offset = TableSize * sizeof(unsigned_int32);
+
+    /* first pass - layout */
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      const GroupGeometry             *Group;
+      unsigned_int32                    *Record;
+
+      Group  = &Groups[GroupIndex];
+      Record = &Table[P3D_GEOMETRY_HEADER_SIZE + GroupIndex * P3D_GEOMETRY_GROUP_SIZE];
+
+      Record[P3D_GEOMETRY_GROUP_BRANCHES]    = Group->BranchCount;
+      Record[P3D_GEOMETRY_GROUP_VATTR_COUNT] = Group->VAttrCount;
+      Record[P3D_GEOMETRY_GROUP_INDEX_COUNT] = Group->IndexCount;
+
+      for (AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+       {
+        if (Group->VAttrBuffers[AttrIndex] != 0)
+         {
+          Record[P3D_GEOMETRY_GROUP_VATTR_DATA + AttrIndex] =
+           P3DGeometryFileAllocBlock(&Offset,Group->VAttrCount,
+                                     P3DHLIGetAttrElementSize(AttrIndex) * sizeof(float));
+         }
+       }
+
+      Record[P3D_GEOMETRY_GROUP_INDEX_DATA] =
+       P3DGeometryFileAllocBlock(&Offset,Group->IndexCount,sizeof(unsigned_int32));
+     }
+
+    Table[P3D_GEOMETRY_HEADER_FILE_SIZE] = Offset;
+
+    Target = fopen(FileName,"wb");
+
+    if (Target == NULL)
+     {
+      throw P3DExceptionIO();
+     }
+
+    Offset = 0;
+
+    P3DGeometryFileWrite(Target,&Offset,0,Table,TableSize * sizeof(unsigned_int32));
+
+    /* second pass - data, in the same order */
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      const GroupGeometry             *Group;
+      const unsigned_int32              *Record;
+
+      Group  = &Groups[GroupIndex];
+      Record = &Table[P3D_GEOMETRY_HEADER_SIZE + GroupIndex * P3D_GEOMETRY_GROUP_SIZE];
+
+      for (AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+       {
+        if (Group->VAttrBuffers[AttrIndex] != 0)
+         {
+          P3DGeometryFileWrite(Target,&Offset,
+                               Record[P3D_GEOMETRY_GROUP_VATTR_DATA + AttrIndex],
+                               Group->VAttrBuffers[AttrIndex],
+                               Group->VAttrCount * P3DHLIGetAttrElementSize(AttrIndex) * sizeof(float));
+         }
+       }
+
+      P3DGeometryFileWrite(Target,&Offset,
+                           Record[P3D_GEOMETRY_GROUP_INDEX_DATA],
+                           Group->IndexBuffer,
+                           Group->IndexCount * sizeof(unsigned_int32));
+     }
+
+    if (fclose(Target) != 0)
+     {
+      Target = 0;
+
+      throw P3DExceptionIO();
+     }
+   }
+  catch (...)
+   {
+    if (Target != 0)
+     {
+      fclose(Target);
+     }
+
+    delete[] Table;
+
+    throw;
+   }
+
+  delete[] Table;
+ }
+
+bool               P3DHLIPlantGeometry::MapFile
+                                      (const char         *FileName,
+                                       const unsigned_int32 *Key)
+ {
+  const unsigned char                 *Data;
+  const unsigned_int32                  *Header;
+  unsigned_int32                         FileSize;
+
+  Clear();
+
+  Mapping.Open(FileName);
+
+  Data     = (const unsigned char*)Mapping.GetData();
+  Header   = (const unsigned_int32*)Data;
+  FileSize = Mapping.GetDataSize();
+
+  try
+   {
+    unsigned_int32                       GroupIndex;
+    unsigned_int32                       AttrIndex;
+    unsigned_int32                       TableGroupCount;
+
+    if ((FileSize < P3D_GEOMETRY_HEADER_SIZE * sizeof(unsigned_int32)) ||
+        (memcmp(&Header[P3D_GEOMETRY_HEADER_MAGIC],P3DGeometryFileMagic,sizeof(P3DGeometryFileMagic)) != 0))
+     {
+      throw P3DExceptionGeneric("invalid geometry file header");
+     }
+
+    if ((Header[P3D_GEOMETRY_HEADER_VERSION]    != P3D_GEOMETRY_FILE_VERSION)    ||
+        (Header[P3D_GEOMETRY_HEADER_BYTE_ORDER] != P3D_GEOMETRY_FILE_BYTE_ORDER) ||
+        (memcmp(&Header[P3D_GEOMETRY_HEADER_KEY],Key,P3D_GEOMETRY_FILE_KEY_SIZE * sizeof(unsigned_int32)) != 0))
+     {
+      Mapping.Close();
+
+      return(false);
+     }
+
+    TableGroupCount = Header[P3D_GEOMETRY_HEADER_GROUPS];
+
+    if ((Header[P3D_GEOMETRY_HEADER_FILE_SIZE] != FileSize) ||
+        (TableGroupCount > (FileSize / sizeof(unsigned_int32) - P3D_GEOMETRY_HEADER_SIZE) / P3D_GEOMETRY_GROUP_SIZE))
+     {
+      throw P3DExceptionGeneric("damaged geometry file");
+     }
+
+    Groups     = new GroupGeometry[TableGroupCount];
+    GroupCount = TableGroupCount;
+
+    for (GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+     {
+      GroupGeometry                   *Group;
+      const unsigned_int32              *Record;
+
+      Group  = &Groups[GroupIndex];
+      Record = &Header[P3D_GEOMETRY_HEADER_SIZE + GroupIndex * P3D_GEOMETRY_GROUP_SIZE];
+
+      Group->BranchCount = Record[P3D_GEOMETRY_GROUP_BRANCHES];
+      Group->VAttrCount  = Record[P3D_GEOMETRY_GROUP_VATTR_COUNT];
+      Group->IndexCount  = Record[P3D_GEOMETRY_GROUP_INDEX_COUNT];
+
+      for (AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+       {
+        unsigned_int32                   BlockOffset;
+
+        BlockOffset = Record[P3D_GEOMETRY_GROUP_VATTR_DATA + AttrIndex];
+
+        if (BlockOffset == 0)
+         {
+          Group->VAttrBuffers[AttrIndex] = 0;
+         }
+        else if (P3DGeometryFileBlockValid(FileSize,BlockOffset,Group->VAttrCount,
+                                           P3DHLIGetAttrElementSize(AttrIndex) * sizeof(float)))
+         {
+          Group->VAttrBuffers[AttrIndex] = (float*)(Data + BlockOffset);
+         }
+        else
+         {
+          throw P3DExceptionGeneric("damaged geometry file");
+         }
+       }
+
+      if (!P3DGeometryFileBlockValid(FileSize,Record[P3D_GEOMETRY_GROUP_INDEX_DATA],
+                                     Group->IndexCount,sizeof(unsigned_int32)))
+       {
+        throw P3DExceptionGeneric("damaged geometry file");
+       }
+
+      Group->IndexBuffer = (unsigned_int32*)(Data + Record[P3D_GEOMETRY_GROUP_INDEX_DATA]);
+     }
+
+    memcpy(Min,&Header[P3D_GEOMETRY_HEADER_BBOX],sizeof(Min));
+    memcpy(Max,&Header[P3D_GEOMETRY_HEADER_BBOX + 3],sizeof(Max));
+   }
+  catch (...)
+   {
+    Clear();
+
+    throw;
+   }
+
+  return(true);
+ }
+
+bool               P3DHLIPlantGeometry::IsMapped
+                                      () const
+ {
+  return(Mapping.IsOpen());
+ }
+
+class P3DHLIForestTask : public P3DTask
+ {
+  public           :
+
+                   P3DHLIForestTask   ()
+   {
+    Template      = 0;
+    BaseSeed      = 0;
+    AttrMask      = 0;
+    InstanceIndex = 0;
+    Callback      = 0;
+   }
+
+  void             Init               (const P3DHLIPlantTemplate
+                                                          *Template,
+                                       unsigned_int32        BaseSeed,
+                                       unsigned_int32        AttrMask,
+                                       unsigned_int32        InstanceIndex,
+                                       P3DHLIForestCallback
+                                                          *Callback)
+   {
+    this->Template      = Template;
+    this->BaseSeed      = BaseSeed;
+    this->AttrMask      = AttrMask;
+    this->InstanceIndex = InstanceIndex;
+    this->Callback      = Callback;
+   }
+
+  virtual void     Run                ()
+   {
+    P3DHLIPlantGeometry               *Geometry;
+
+    Geometry = 0;
+
+    try
+     {
+      Geometry = new P3DHLIPlantGeometry();
+
+      Geometry->Generate(Template,BaseSeed,AttrMask);
+     }
+    catch (P3DException &Exception)
+     {
+      delete Geometry;
+
+      Callback->OnInstanceError(InstanceIndex,Exception.GetMessage());
+
+      return;
+     }
+    catch (...)
+     {
+      delete Geometry;
+
+      Callback->OnInstanceError(InstanceIndex,"instance generation failed");
+
+      return;
+     }
+
+    Callback->OnInstanceReady(InstanceIndex,Geometry);
+   }
+
+  private          :
+
+  const P3DHLIPlantTemplate           *Template;
+  unsigned_int32                         BaseSeed;
+  unsigned_int32                         AttrMask;
+  unsigned_int32                         InstanceIndex;
+  P3DHLIForestCallback                *Callback;
+ };
+
+                   P3DHLIForestGenerator::P3DHLIForestGenerator
+                                      (unsigned_int32        ThreadCount)
+                   : Pool(ThreadCount)
+ {
+ }
+
+                   P3DHLIForestGenerator::~P3DHLIForestGenerator
+                                      ()
+ {
+ }
+
+unsigned_int32       P3DHLIForestGenerator::GetThreadCount
+                                      () const
+ {
+  return(Pool.GetThreadCount());
+ }
+
+void               P3DHLIForestGenerator::Generate
+                                      (const P3DHLIPlantTemplate
+                                                          *Template,
+                                       const unsigned_int32 *Seeds,
+                                       unsigned_int32        SeedCount,
+                                       unsigned_int32        AttrMask,
+                                       P3DHLIForestCallback
+                                                          *Callback)
+ {
+  P3DHLIForestTask                    *Tasks;
+  unsigned_int32                         SeedIndex;
+  P3DTaskGroup                         TaskGroup;
+
+  if (SeedCount == 0)
+   {
+    return;
+   }
+
+  Tasks = new P3DHLIForestTask[SeedCount];
+
+  try
+   {
+    for (SeedIndex = 0; SeedIndex < SeedCount; SeedIndex++)
+     {
+      Tasks[SeedIndex].Init(Template,Seeds[SeedIndex],AttrMask,SeedIndex,Callback);
+
+      Pool.Submit(&Tasks[SeedIndex],&TaskGroup);
+     }
+   }
+  catch (...)
+   {
+    Pool.Wait(&TaskGroup);
+
+    delete[] Tasks;
+
+    throw;
+   }
+
+  Pool.Wait(&TaskGroup);
+
+  delete[] Tasks;
+ }
+
@@ -0,0 +1,169 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#ifndef __P3DHLIFOREST_H__
+#define __P3DHLIFOREST_H__
+
+#include <ngpcore/p3dhli.h>
+#include <ngpcore/p3dthread.h>
+#include <ngpcore/p3dfilemap.h>
+
+#define P3D_ATTR_MASK(Attr)      (1U << (Attr))
+#define P3D_ATTR_MASK_ALL        ((1U << P3D_MAX_ATTRS) - 1)
+
+#define P3D_GEOMETRY_FILE_KEY_SIZE (8)
+
+/* Indexed geometry of single plant instance. For each group it contains  */
+/* vertex attribute buffers (as in P3DHLIPlantInstance::FillVAttrBuffersI) */
+/* and triangle list index buffer for all branches of this group.          */
+class P3D_DLL_ENTRY P3DHLIPlantGeometry
+ {
+  public           :
+
+                   P3DHLIPlantGeometry();
+                  ~P3DHLIPlantGeometry();
+
+  /* AttrMask is combination of P3D_ATTR_MASK(Attr) values. Billboard    */
+  /* positions are generated for billboard groups only.                  */
+  /* BaseSeed == 0 means "use model seed" (see P3DHLIPlantTemplate)      */
+  void             Generate           (const P3DHLIPlantTemplate
+                                                          *Template,
+                                       unsigned_int32        BaseSeed,
+                                       unsigned_int32        AttrMask);
+
+  unsigned_int32     GetGroupCount      () const;
+  unsigned_int32     GetBranchCount     (unsigned_int32        GroupIndex) const;
+
+  unsigned_int32     GetVAttrCountI     (unsigned_int32        GroupIndex) const;
+  /* returns 0 if attribute was not generated */
+  const float     *GetVAttrBufferI    (unsigned_int32        GroupIndex,
+                                       unsigned_int32        Attr) const;
+
+  unsigned_int32     GetIndexCount      (unsigned_int32        GroupIndex) const;
+  const
+  unsigned_int32    *GetIndexBuffer     (unsigned_int32        GroupIndex) const;
+
+  void             GetBoundingBox     (float              *Min,
+                                       float              *Max) const;
+
+  /* Geometry file contains all buffers in native byte order, so mapped */
+  /* geometry is used directly, without copying. Key is arbitrary data  */
+  /* (P3D_GEOMETRY_FILE_KEY_SIZE items) identifying geometry contents.  */
+  void             SaveFile           (const char         *FileName,
+                                       const unsigned_int32 *Key) const;
+
+  /* Returns false (and leaves geometry empty) if file exists but was */
+  /* saved with another key, byte order or format version. Throws     */
+  /* exception if file can not be mapped or is damaged.               */
+  bool             MapFile            (const char         *FileName,
+                                       const unsigned_int32 *Key);
+
+  bool             IsMapped           () const;
+
+  private          :
+
+                   P3DHLIPlantGeometry(const P3DHLIPlantGeometry
+                                                          &Source);
+  P3DHLIPlantGeometry
+                  &operator =         (const P3DHLIPlantGeometry
+                                                          &Source);
+
+  void             Clear              ();
+  void             CheckGroupIndex    (unsigned_int32        GroupIndex) const;
+
+  struct GroupGeometry
+   {
+    unsigned_int32                       BranchCount;
+    unsigned_int32                       VAttrCount;
+    float                             *VAttrBuffers[P3D_MAX_ATTRS];
+    unsigned_int32                       IndexCount;
+    unsigned_int32                      *IndexBuffer;
+   };
+
+  unsigned_int32                         GroupCount;
+  GroupGeometry                       *Groups;
+  float                                Min[3];
+  float                                Max[3];
+  /* buffers point into mapped file if it is open */
+  P3DFileMapping                       Mapping;
+ };
+
+class P3D_DLL_ENTRY P3DHLIForestCallback
+ {
+  public           :
+
+  virtual         ~P3DHLIForestCallback
+                                      () {};
+
+  /* Both methods are called from worker threads, possibly concurrently. */
+  /* Geometry ownership is passed to callback.                            */
+  virtual void     OnInstanceReady    (unsigned_int32        InstanceIndex,
+                                       P3DHLIPlantGeometry*Geometry) = 0;
+  virtual void     OnInstanceError    (unsigned_int32        InstanceIndex,
+                                       const char         *Message) = 0;
+ };
+
+/* Generates geometry of many instances of one template in parallel. */
+/* Template (and its model) must not be changed during generation.   */
+class P3D_DLL_ENTRY P3DHLIForestGenerator
+ {
+  public           :
+
+                   P3DHLIForestGenerator
+                                      (unsigned_int32        ThreadCount = 0);
+                  ~P3DHLIForestGenerator
+                                      ();
+
+  unsigned_int32     GetThreadCount     () const;
+
+  /* returns after all instances are processed */
+  void             Generate           (const P3DHLIPlantTemplate
+                                                          *Template,
+                                       const unsigned_int32 *Seeds,
+                                       unsigned_int32        SeedCount,
+                                       unsigned_int32        AttrMask,
+                                       P3DHLIForestCallback
+                                                          *Callback);
+
+  private          :
+
+                   P3DHLIForestGenerator
+                                      (const P3DHLIForestGenerator
+                                                          &Source);
+  P3DHLIForestGenerator
+                  &operator =         (const P3DHLIForestGenerator
+                                                          &Source);
+
+  P3DThreadPool                        Pool;
+ };
+
+#endif
+
@@ -0,0 +1,342 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#include <string.h>
+
+#include <ngpcore/p3dexcept.h>
+#include <ngpcore/p3diostreamadd.h>
+#include <ngpcore/p3dhliloader.h>
+
+                   P3DHLILoadedTemplate::P3DHLILoadedTemplate
+                                      (void               *UserData)
+ {
+  this->UserData = UserData;
+
+  Template     = 0;
+  ErrorMessage = 0;
+  Next         = 0;
+ }
+
+                   P3DHLILoadedTemplate::~P3DHLILoadedTemplate
+                                      ()
+ {
+  delete Template;
+  delete[] ErrorMessage;
+ }
+
+void              *P3DHLILoadedTemplate::GetUserData
+                                      () const
+ {
+  return(UserData);
+ }
+
+P3DHLIPlantTemplate
+                  *P3DHLILoadedTemplate::GetTemplate
+                                      () const
+ {
+  return(Template);
+ }
+
+P3DHLIPlantTemplate
+                  *P3DHLILoadedTemplate::DetachTemplate
+                                      ()
+ {
+  P3DHLIPlantTemplate                 *Result;
+
+  Result   = Template;
+  Template = 0;
+
+  return(Result);
+ }
+
+const char        *P3DHLILoadedTemplate::GetErrorMessage
+                                      () const
+ {
+  return(ErrorMessage);
+ }
+
+/* Task owns its source description and result, result is passed to  */
+/* loader when task is finished, task deletes itself then            */
+class P3DHLITemplateLoadTask : public P3DTask
+ {
+  public           :
+
+                   P3DHLITemplateLoadTask
+                                      (P3DHLITemplateLoader
+                                                          *Loader,
+                                       const char         *FileName,
+                                       const void         *Data,
+                                       unsigned_int32        DataSize,
+                                       void               *UserData)
+   {
+    this->Loader   = Loader;
+    this->FileName = 0;
+    this->Data     = Data;
+    this->DataSize = DataSize;
+
+    Result = new P3DHLILoadedTemplate(UserData);
+
+    if (FileName != 0)
+     {
+      try
+       {
+        this->FileName = new char[strlen(FileName) + 1];
+       }
+      catch (...)
+       {
+        delete Result;
+
+        throw;
+       }
+
+      strcpy(this->FileName,FileName);
+     }
+   }
+
+                  ~P3DHLITemplateLoadTask
+                                      ()
+   {
+    delete[] FileName;
+    delete Result;
+   }
+
+  virtual void     Run                ()
+   {
+    try
+     {
+      Result->Template = Load();
+     }
+    catch (P3DException &Exception)
+     {
+      SetErrorMessage(Exception.GetMessage());
+     }
+    catch (...)
+     {
+      SetErrorMessage("unknown error");
+     }
+
+    Loader->Complete(Result);
+
+    Result = 0;
+
+    delete this;
+   }
+
+  private          :
+
+  P3DHLIPlantTemplate
+                  *Load               ()
+   {
+    if (FileName != 0)
+     {
+      P3DInputBinaryStreamFile         BinaryStream;
+
+      if (BinaryStream.OpenIfBinary(FileName))
+       {
+        return(new P3DHLIPlantTemplate(&BinaryStream));
+       }
+      else
+       {
+        P3DInputStringStreamFile       SourceStream;
+
+        SourceStream.Open(FileName);
+
+        return(new P3DHLIPlantTemplate(&SourceStream));
+       }
+     }
+    else
+     {
+      if (P3DInputBinaryStreamFile::IsBinaryData(Data,DataSize))
+       {
+        P3DInputBinaryStreamView       SourceStream(Data,DataSize);
+
+        return(new P3DHLIPlantTemplate(&SourceStream));
+       }
+      else
+       {
+        P3DInputStringStreamView       SourceStream((const char*)Data,DataSize);
+
+        return(new P3DHLIPlantTemplate(&SourceStream));
+       }
+     }
+   }
+
+  /* failure to store message is not reported - GetTemplate() returns */
+  /* 0 anyway                                                         */
+  void             SetErrorMessage    (const char         *Message)
+   {
+    try
+     {
+      Result->ErrorMessage = new char[strlen(Message) + 1];
+
+      strcpy(Result->ErrorMessage,Message);
+     }
+    catch (...)
+     {
+     }
+   }
+
+  P3DHLITemplateLoader                *Loader;
+  char                                *FileName;
+  const void                          *Data;
+  unsigned_int32                         DataSize;
+  P3DHLILoadedTemplate                *Result;
+ };
+
+                   P3DHLITemplateLoader::P3DHLITemplateLoader
+                                      (unsigned_int32        ThreadCount)
+                   : Pool(ThreadCount)
+ {
+  CompletedHead = 0;
+  ReadyHead     = 0;
+ }
+
+                   P3DHLITemplateLoader::~P3DHLITemplateLoader
+                                      ()
+ {
+  P3DHLILoadedTemplate                *Result;
+
+  Pool.Wait(&Tasks);
+
+  while ((Result = GetLoaded()) != 0)
+   {
+    delete Result;
+   }
+ }
+
+void               P3DHLITemplateLoader::LoadFile
+                                      (const char         *FileName,
+                                       void               *UserData)
+ {
+  P3DHLITemplateLoadTask              *Task;
+
+  Task = new P3DHLITemplateLoadTask(this,FileName,0,0,UserData);
+
+  try
+   {
+    Pool.Submit(Task,&Tasks);
+   }
+  catch (...)
+   {
+    delete Task;
+
+    throw;
+   }
+ }
+
+void               P3DHLITemplateLoader::LoadMemory
+                                      (const void         *Data,
+                                       unsigned_int32        DataSize,
+                                       void               *UserData)
+ {
+  P3DHLITemplateLoadTask              *Task;
+
+  Task = new P3DHLITemplateLoadTask(this,0,Data,DataSize,UserData);
+
+  try
+   {
+    Pool.Submit(Task,&Tasks);
+   }
+  catch (...)
+   {
+    delete Task;
+
+    throw;
+   }
+ }
+
+void               P3DHLITemplateLoader::Complete
+                                      (P3DHLILoadedTemplate
+                                                          *Result)
+ {
+  void                                *Head;
+  void                                *PrevHead;
+
+  /* value returned by failed exchange is used as new expected head, */
+  /* so CompletedHead is never read without atomic operation         */
+  Head = 0;
+
+  while (true)
+   {
+    Result->Next = (P3DHLILoadedTemplate*)Head;
+
+    PrevHead = P3DAtomic::CompareExchangePointer(&CompletedHead,Result,Head);
+
+    if (PrevHead == Head)
+     {
+      return;
+     }
+
+    Head = PrevHead;
+   }
+ }
+
+P3DHLILoadedTemplate
+                  *P3DHLITemplateLoader::GetLoaded
+                                      ()
+ {
+  P3DHLILoadedTemplate                *Result;
+  P3DHLILoadedTemplate                *Completed;
+  P3DHLILoadedTemplate                *Next;
+
+  if (ReadyHead == 0)
+   {
+    /* whole list is taken at once, so there is no ABA problem */
+    Completed = (P3DHLILoadedTemplate*)P3DAtomic::ExchangePointer(&CompletedHead,0);
+
+    /* reverse list to return results in completion order */
+    while (Completed != 0)
+     {
+      Next = Completed->Next;
+
+      Completed->Next = ReadyHead;
+      ReadyHead       = Completed;
+      Completed       = Next;
+     }
+   }
+
+  Result = ReadyHead;
+
+  if (Result != 0)
+   {
+    ReadyHead    = Result->Next;
+    Result->Next = 0;
+   }
+
+  return(Result);
+ }
+
+void               P3DHLITemplateLoader::Wait
+                                      ()
+ {
+  Pool.Wait(&Tasks);
+ }
+
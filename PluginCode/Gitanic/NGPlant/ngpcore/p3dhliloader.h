@@ -0,0 +1,138 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#ifndef __P3DHLILOADER_H__
+#define __P3DHLILOADER_H__
+
+#include <ngpcore/p3dhli.h>
+#include <ngpcore/p3dthread.h>
+
+/* Result of template loading. Owns loaded template until it is */
+/* detached.                                                    */
+class P3D_DLL_ENTRY P3DHLILoadedTemplate
+ {
+  public           :
+
+                  ~P3DHLILoadedTemplate
+                                      ();
+
+  void            *GetUserData        () const;
+
+  /* returns 0 if loading failed */
+  P3DHLIPlantTemplate
+                  *GetTemplate        () const;
+  /* caller becomes owner of returned template */
+  P3DHLIPlantTemplate
+                  *DetachTemplate     ();
+
+  /* returns 0 if template was loaded successfully */
+  const char      *GetErrorMessage    () const;
+
+  private          :
+
+                   P3DHLILoadedTemplate
+                                      (void               *UserData);
+
+                   P3DHLILoadedTemplate
+                                      (const P3DHLILoadedTemplate
+                                                          &Source);
+  P3DHLILoadedTemplate
+                  &operator =         (const P3DHLILoadedTemplate
+                                                          &Source);
+
+  void            *UserData;
+  P3DHLIPlantTemplate                 *Template;
+  char                                *ErrorMessage;
+  /* link in completion queue */
+  P3DHLILoadedTemplate                *Next;
+
+  friend class P3DHLITemplateLoader;
+  friend class P3DHLITemplateLoadTask;
+ };
+
+/* Loads plant templates on worker threads. Finished loads are pushed */
+/* to lock-free completion queue, which is drained by GetLoaded, for  */
+/* example once per frame. Templates are loaded in parallel, but      */
+/* results may arrive in any order - UserData identifies them.        */
+class P3D_DLL_ENTRY P3DHLITemplateLoader
+ {
+  public           :
+
+  /* ThreadCount == 0 means "one thread per processor" */
+                   P3DHLITemplateLoader
+                                      (unsigned_int32        ThreadCount = 0);
+  /* waits for queued loads, unclaimed results are deleted */
+                  ~P3DHLITemplateLoader
+                                      ();
+
+  /* Queue loading of template from file in text or binary format */
+  void             LoadFile           (const char         *FileName,
+                                       void               *UserData);
+  /* Data is not copied, so it must stay valid until load is finished */
+  void             LoadMemory         (const void         *Data,
+                                       unsigned_int32        DataSize,
+                                       void               *UserData);
+
+  /* Returns next finished load or 0 if there are no finished loads.  */
+  /* Never blocks. Must not be called from several threads at a time. */
+  /* Caller owns returned object.                                     */
+  P3DHLILoadedTemplate
+                  *GetLoaded          ();
+
+  /* wait until all queued loads are finished */
+  void             Wait               ();
+
+  private          :
+
+                   P3DHLITemplateLoader
+                                      (const P3DHLITemplateLoader
+                                                          &Source);
+  P3DHLITemplateLoader
+                  &operator =         (const P3DHLITemplateLoader
+                                                          &Source);
+
+  /* called by worker threads */
+  void             Complete           (P3DHLILoadedTemplate
+                                                          *Result);
+
+  P3DThreadPool                        Pool;
+  /* all queued loads */
+  P3DTaskGroup                         Tasks;
+  /* loads completed by workers, most recent first */
+  void *volatile                       CompletedHead;
+  /* loads taken from CompletedHead, oldest first */
+  P3DHLILoadedTemplate                *ReadyHead;
+
+  friend class P3DHLITemplateLoadTask;
+ };
+
+#endif
+
@@ -29,15 +29,17 @@
 
 ***************************************************************************/
 
-#include <ngpcore/p3dcompat.h> /* for snprintf definition in MSVC environment */
+#include <math.h>
+#include <float.h>
+
 #include <ngpcore/p3dexcept.h>
 #include <ngpcore/p3diostream.h>
 
+#define P3D_INPUT_FILE_BLOCK_SIZE (64 * 1024)
+#define P3D_BINARY_RECORD_BUFFER_SIZE (256)
+#define P3D_OUTPUT_FILE_BUFFER_SIZE (64 * 1024)
+#define P3D_OUTPUT_LINE_BUFFER_SIZE (512)
 
-typedef struct
- {
-  char            *Old;
- } P3DLocaleInfo;
 
 static char        GetHexDigitChar    (char                Value)
  {
@@ -87,270 +89,1593 @@ static bool        GetCharByHexCode   (char               *Ch,
   return Ok;
  }
 
-static void        SetLocaleNumericStd(P3DLocaleInfo      *OldLocale)
+/* Locale-independent conversion between numbers and their text */
+/* representation. Floats are parsed with correct rounding and   */
+/* written exactly like printf("%f"), so files produced by older */
+/* versions are read back bit-identically.                       */
+
+#define P3D_BIGUINT_MAX_LIMBS        (80)
+/* digits beyond this count cannot change rounding of float value */
+#define P3D_FLOAT_MAX_SIGNIFICANT_DIGITS (120)
+/* integer values below 10^15 are exactly representable in double */
+#define P3D_DOUBLE_EXACT_DIGITS      (15)
+#define P3D_FLOAT_FRACTION_DIGITS    (6)
+
+static const double P3DPow10[] =
+ {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+  1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+  1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+ };
+
+static const float  P3DPow10f[] =
+ {
+  1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f,
+  1e8f, 1e9f, 1e10f
+ };
+
+/* Unsigned big integer, used only in rare cases when exact float <-> */
+/* decimal conversion cannot be done with double arithmetic. Limbs    */
+/* are 16-bit wide, so all intermediate values fit into unsigned_int32. */
+class P3DBigUInt
  {
-  char *Old = setlocale(LC_NUMERIC,NULL);
+  public           :
 
-  OldLocale->Old = Old != NULL ? strdup(Old) : NULL;
+                   P3DBigUInt         ();
 
-  setlocale(LC_NUMERIC,"C");
+  /* IntValue must be integer in [0,2^53) range */
+  void             SetDouble          (double              IntValue);
+
+  /* Multiplier and Value must be less than 65536 */
+  void             MulSmall           (unsigned_int32        Multiplier);
+  void             AddSmall           (unsigned_int32        Value);
+  void             MulPow10           (unsigned_int32        Power);
+  void             ShiftLeft          (unsigned_int32        BitCount);
+  /* result is rounded to nearest, ties to even */
+  void             ShiftRightRound    (unsigned_int32        BitCount);
+  /* Divisor must be less than 65536, returns remainder */
+  unsigned_int32     DivSmall           (unsigned_int32        Divisor);
+
+  bool             IsZero             () const;
+  int              Compare            (const P3DBigUInt   &Other) const;
+
+  private          :
+
+  unsigned_int32     GetLimb            (unsigned_int32        Index) const;
+  void             Push               (unsigned_int32        Limb);
+  void             Trim               ();
+
+  unsigned_int32     Limbs[P3D_BIGUINT_MAX_LIMBS];
+  unsigned_int32     Count;
+ };
+
+                   P3DBigUInt::P3DBigUInt
+                                      ()
+ {
+  Count = 0;
  }
 
-static void        RestoreLocaleNumeric
-                                      (P3DLocaleInfo      *OldLocale)
+void               P3DBigUInt::SetDouble
+                                      (double              IntValue)
  {
-  if (OldLocale->Old != NULL)
+  Count = 0;
+
+  while (IntValue > 0.0)
    {
-    setlocale(LC_NUMERIC,OldLocale->Old);
+    double                             Limb;
+
+    Limb = fmod(IntValue,65536.0);
 
-    free(OldLocale->Old);
+    Push((unsigned_int32)Limb);
+
+    IntValue = (IntValue - Limb) / 65536.0;
    }
  }
 
-const char        *P3DExceptionIO::GetMessage
-                                      () const
+unsigned_int32       P3DBigUInt::GetLimb
+                                      (unsigned_int32        Index) const
  {
-  return("Input/output error");
+  return(Index < Count ? Limbs[Index] : 0);
  }
 
-                   P3DInputStringFmtStream::P3DInputStringFmtStream
-                                      (P3DInputStringStream
-                                                          *SourceStream)
+void               P3DBigUInt::Push   (unsigned_int32        Limb)
  {
-  this->SourceStream         = SourceStream;
-  this->HandleEscapedStrings = true;
+  if (Count >= P3D_BIGUINT_MAX_LIMBS)
+   {
+    throw P3DExceptionAssert();
+   }
+
+  Limbs[Count++] = Limb;
  }
 
-void               P3DInputStringFmtStream::EnableEscapeChars
-                                      (bool                Enable)
+void               P3DBigUInt::Trim   ()
  {
-  this->HandleEscapedStrings = Enable;
+  while ((Count > 0) && (Limbs[Count - 1] == 0))
+   {
+    Count--;
+   }
  }
 
-typedef struct
+void               P3DBigUInt::MulSmall
+                                      (unsigned_int32        Multiplier)
  {
-  unsigned_int32     Start;
-  unsigned_int32     Length;
- } P3DWordInfo;
+  unsigned_int32                         Carry;
 
-static bool        GetWordInfoNext    (P3DWordInfo        *WordInfo,
-                                       const char         *Str)
- {
-  WordInfo->Start += WordInfo->Length;
-  WordInfo->Length = 0;
+  Carry = 0;
 
-  while ((Str[WordInfo->Start] == ' ') ||
-         (Str[WordInfo->Start] == '\t'))
+  for (unsigned_int32 Index = 0; Index < Count; Index++)
    {
-    WordInfo->Start++;
+    unsigned_int32                       Value;
+
+    Value         = Limbs[Index] * Multiplier + Carry;
+    Limbs[Index]  = Value & 0xFFFF;
+    Carry         = Value >> 16;
    }
 
-  if (Str[WordInfo->Start] == '\0')
+  if (Carry != 0)
    {
-    return(false);
+    Push(Carry);
    }
+ }
 
-  do
+void               P3DBigUInt::AddSmall
+                                      (unsigned_int32        Value)
+ {
+  unsigned_int32                         Index;
+
+  Index = 0;
+
+  while ((Value != 0) && (Index < Count))
    {
-    WordInfo->Length++;
-   } while ((Str[WordInfo->Start + WordInfo->Length] != ' ')  &&
-            (Str[WordInfo->Start + WordInfo->Length] != '\t') &&
-            (Str[WordInfo->Start + WordInfo->Length] != '\0'));
+    Value        += Limbs[Index];
+    Limbs[Index]  = Value & 0xFFFF;
+    Value       >>= 16;
 
-  return(true);
- }
+    Index++;
+   }
 
+  if (Value != 0)
+   {
+    Push(Value);
+   }
+ }
 
-static bool        GetWordInfoFirst   (P3DWordInfo        *WordInfo,
-                                       const char         *Str)
+void               P3DBigUInt::MulPow10
+                                      (unsigned_int32        Power)
  {
-  WordInfo->Start  = 0;
-  WordInfo->Length = 0;
+  while (Power >= 4)
+   {
+    MulSmall(10000);
 
-  return(GetWordInfoNext(WordInfo,Str));
+    Power -= 4;
+   }
+
+  if (Power > 0)
+   {
+    MulSmall((unsigned_int32)P3DPow10[Power]);
+   }
  }
 
-void               P3DInputStringFmtStream::ScanStringSafe
-                                      (char               *DestBuffer,
-                                       unsigned_int32        DestSize,
-                                       const char         *SrcBuffer,
-                                       unsigned_int32        SrcOffset,
-                                       unsigned_int32        SrcLength)
+void               P3DBigUInt::ShiftLeft
+                                      (unsigned_int32        BitCount)
  {
-  if (!HandleEscapedStrings  ||
-      SrcOffset >= SrcLength ||
-      SrcBuffer[SrcOffset] != '\"')
+  unsigned_int32                         LimbShift;
+  unsigned_int32                         Shift;
+  unsigned_int32                         NewCount;
+
+  if (Count == 0)
    {
-    if (SrcLength >= DestSize)
+    return;
+   }
+
+  LimbShift = BitCount / 16;
+  Shift     = BitCount % 16;
+  NewCount  = Count + LimbShift + 1;
+
+  if (NewCount > P3D_BIGUINT_MAX_LIMBS)
+   {
+    throw P3DExceptionAssert();
+   }
+
+  for (unsigned_int32 Index = NewCount; Index > 0; Index--)
+   {
+    unsigned_int32                       Src;
+
+    /* Index - 1 is a destination limb, limbs below LimbShift become 0 */
+    Src = Index - 1;
+
+    if (Src < LimbShift)
      {
-      throw P3DExceptionGeneric("string value is too large");
+      Limbs[Src] = 0;
      }
+    else
+     {
+      Src -= LimbShift;
 
-    memcpy(DestBuffer,&SrcBuffer[SrcOffset],SrcLength);
-    DestBuffer[SrcLength] = '\0';
+      Limbs[Index - 1] = ((GetLimb(Src) << Shift) |
+                          (Src > 0 ? (GetLimb(Src - 1) >> (16 - Shift)) : 0)) & 0xFFFF;
+     }
+   }
+
+  Count = NewCount;
+
+  Trim();
+ }
+
+void               P3DBigUInt::ShiftRightRound
+                                      (unsigned_int32        BitCount)
+ {
+  unsigned_int32                         LimbShift;
+  unsigned_int32                         Shift;
+  bool                                 Half;
+  bool                                 Sticky;
 
+  if (BitCount == 0)
+   {
     return;
    }
 
-  unsigned_int32 SrcEnd    = SrcOffset + SrcLength;
-  unsigned_int32 DestOffset = 0;
+  /* bit BitCount - 1 decides rounding, bits below it break ties */
+  Half   = ((GetLimb((BitCount - 1) / 16) >> ((BitCount - 1) % 16)) & 1) != 0;
+  Sticky = (GetLimb((BitCount - 1) / 16) & ((1U << ((BitCount - 1) % 16)) - 1)) != 0;
 
-  for (SrcOffset = SrcOffset + 1; // skip leading quote
-       SrcOffset < SrcEnd && SrcBuffer[SrcOffset] != '\"';
-       SrcOffset++)
+  for (unsigned_int32 Index = 0; (!Sticky) && (Index < (BitCount - 1) / 16) && (Index < Count); Index++)
    {
-    if (DestOffset >= DestSize)
+    Sticky = Limbs[Index] != 0;
+   }
+
+  LimbShift = BitCount / 16;
+  Shift     = BitCount % 16;
+
+  if (LimbShift >= Count)
+   {
+    Count = 0;
+   }
+  else
+   {
+    for (unsigned_int32 Index = 0; Index < Count - LimbShift; Index++)
      {
-      throw P3DExceptionGeneric("string too long in data file");
+      Limbs[Index] = ((GetLimb(Index + LimbShift) >> Shift) |
+                      (GetLimb(Index + LimbShift + 1) << (16 - Shift))) & 0xFFFF;
      }
 
-    char Ch = SrcBuffer[SrcOffset];
+    Count -= LimbShift;
 
-    if (Ch == '\\')
-     {
-      if (SrcOffset + 2 >= SrcEnd)
-       {
-        throw P3DExceptionGeneric("unterminated escape sequence in data file");
-       }
+    Trim();
+   }
 
-      if (!GetCharByHexCode(&Ch,SrcBuffer[SrcOffset + 1],SrcBuffer[SrcOffset + 2]))
-       {
-        throw P3DExceptionGeneric("invalid escape sequence in data file");
-       }
+  if ((Half) && ((Sticky) || ((GetLimb(0) & 1) != 0)))
+   {
+    AddSmall(1);
+   }
+ }
 
-      SrcOffset += 2;
-     }
+unsigned_int32       P3DBigUInt::DivSmall
+                                      (unsigned_int32        Divisor)
+ {
+  unsigned_int32                         Remainder;
 
-    DestBuffer[DestOffset++] = Ch;
+  Remainder = 0;
+
+  for (unsigned_int32 Index = Count; Index > 0; Index--)
+   {
+    unsigned_int32                       Value;
+
+    Value            = (Remainder << 16) | Limbs[Index - 1];
+    Limbs[Index - 1] = Value / Divisor;
+    Remainder        = Value % Divisor;
    }
 
-  if (DestOffset < DestSize)
+  Trim();
+
+  return(Remainder);
+ }
+
+bool               P3DBigUInt::IsZero () const
+ {
+  return(Count == 0);
+ }
+
+int                P3DBigUInt::Compare(const P3DBigUInt   &Other) const
+ {
+  if (Count != Other.Count)
    {
-    DestBuffer[DestOffset] = '\0';
+    return(Count < Other.Count ? -1 : 1);
    }
-  else
+
+  for (unsigned_int32 Index = Count; Index > 0; Index--)
    {
-    throw P3DExceptionGeneric("string too long in data file");
+    if (Limbs[Index - 1] != Other.Limbs[Index - 1])
+     {
+      return(Limbs[Index - 1] < Other.Limbs[Index - 1] ? -1 : 1);
+     }
    }
+
+  return(0);
  }
 
-void               P3DInputStringFmtStream::ReadFmtStringTagged
-                                      (const char         *Tag,
-                                       const char         *Format,
-                                       ...)
+static unsigned_int32 P3DFloatToBits    (float               Value)
  {
-  char                                 Buffer[1024];
-  char                                 ValueBuffer[256];
-  P3DWordInfo                          WordInfo;
-  unsigned_int32                         FieldIndex;
-  unsigned_int32                         FieldCount;
-  va_list                              FieldValues;
-  P3DLocaleInfo                        LocaleInfo;
+  unsigned_int32                         Bits;
 
-  SetLocaleNumericStd(&LocaleInfo);
+  memcpy(&Bits,&Value,sizeof(Bits));
 
-  va_start(FieldValues,Format);
+  return(Bits);
+ }
 
-  try
+static float       P3DFloatFromBits   (unsigned_int32        Bits)
+ {
+  float                                Value;
+
+  memcpy(&Value,&Bits,sizeof(Value));
+
+  return(Value);
+ }
+
+/* Bits - non-negative finite float, result is exactly representable */
+static double      P3DFloatMidpointAbove
+                                      (unsigned_int32        Bits)
+ {
+  if (Bits == 0x7F7FFFFF)
    {
-    ReadDataString(Buffer,sizeof(Buffer));
+    /* halfway between FLT_MAX and next (non-existent) float */
+    return((double)P3DFloatFromBits(Bits) + ldexp(1.0,103));
+   }
+  else
+   {
+    return(((double)P3DFloatFromBits(Bits) + (double)P3DFloatFromBits(Bits + 1)) * 0.5);
+   }
+ }
 
-    if (!GetWordInfoFirst(&WordInfo,Buffer))
-     {
-      throw P3DExceptionGeneric("invalid data file string format");
-     }
+static double      P3DScalePow10      (double              Value,
+                                       int                 Power)
+ {
+  while (Power > 22)
+   {
+    Value *= P3DPow10[22];
+    Power -= 22;
+   }
 
-    if (strlen(Tag) != WordInfo.Length)
-     {
-      throw P3DExceptionGeneric("invalid string tag");
-     }
+  while (Power < -22)
+   {
+    Value /= P3DPow10[22];
+    Power += 22;
+   }
 
-    if (memcmp(Tag,&Buffer[WordInfo.Start],WordInfo.Length) != 0)
-     {
-      throw P3DExceptionGeneric("invalid string tag");
-     }
+  return(Power < 0 ? Value / P3DPow10[-Power] : Value * P3DPow10[Power]);
+ }
 
-    FieldCount = strlen(Format);
+/* compares Digits * 10^Exp (+ tiny value if Sticky) with Value > 0 */
+static int         P3DCompareDecimal  (const P3DBigUInt   *Digits,
+                                       int                 Exp,
+                                       bool                Sticky,
+                                       double              Value)
+ {
+  P3DBigUInt                           Left;
+  P3DBigUInt                           Right;
+  int                                  BinExp;
+  int                                  Result;
 
-    for (FieldIndex = 0; FieldIndex < FieldCount; FieldIndex++)
-     {
-      if (!GetWordInfoNext(&WordInfo,Buffer))
-       {
-        throw P3DExceptionGeneric("unsufficient value count in data file string");
-       }
+  Left = *Digits;
 
-      switch (Format[FieldIndex])
-       {
-        case ('s') :
-         {
-          char         *Value;
-          unsigned_int32  Size;
+  Right.SetDouble(ldexp(frexp(Value,&BinExp),53));
 
-          Value = va_arg(FieldValues,char*);
-          Size  = va_arg(FieldValues,unsigned_int32);
+  BinExp -= 53;
 
-          ScanStringSafe(Value,Size,Buffer,WordInfo.Start,WordInfo.Length);
-         } break;
+  if (Exp > 0)
+   {
+    Left.MulPow10(Exp);
+   }
+  else
+   {
+    Right.MulPow10(-Exp);
+   }
 
-        case ('u') :
-         {
-          if (WordInfo.Length >= sizeof(ValueBuffer))
-           {
-            throw P3DExceptionGeneric("unsigned_int32 value is too large");
-           }
+  if (BinExp > 0)
+   {
+    Right.ShiftLeft(BinExp);
+   }
+  else
+   {
+    Left.ShiftLeft(-BinExp);
+   }
 
-          memcpy(ValueBuffer,&Buffer[WordInfo.Start],WordInfo.Length);
-          ValueBuffer[WordInfo.Length] = '\0';
+  Result = Left.Compare(Right);
 
-          if (sscanf(ValueBuffer,"%u",va_arg(FieldValues,unsigned_int32*)) < 1)
-           {
-            throw P3DExceptionGeneric("invalid unsigned_int32 value");
-           }
-         } break;
+  if ((Result == 0) && (Sticky))
+   {
+    Result = 1;
+   }
 
-        case ('f') :
-         {
-          if (WordInfo.Length >= sizeof(ValueBuffer))
-           {
-            throw P3DExceptionGeneric("float value is too large");
-           }
+  return(Result);
+ }
 
-          memcpy(ValueBuffer,&Buffer[WordInfo.Start],WordInfo.Length);
-          ValueBuffer[WordInfo.Length] = '\0';
+/* parses unsigned decimal number, trailing non-digit characters are */
+/* ignored, like sscanf("%u") does                                   */
+static bool        P3DParseUInt32     (unsigned_int32       *Value,
+                                       const char         *Str,
+                                       unsigned_int32        Length)
+ {
+  unsigned_int32                         Pos;
+  unsigned_int32                         Result;
 
-          if (sscanf(ValueBuffer,"%f",va_arg(FieldValues,float*)) < 1)
-           {
-            throw P3DExceptionGeneric("invalid float value");
-           }
-         } break;
+  Pos    = 0;
+  Result = 0;
 
-        case ('b') :
-         {
-          if      (WordInfo.Length == 4)
+  if ((Pos < Length) && (Str[Pos] == '+'))
+   {
+    Pos++;
+   }
+
+  if ((Pos >= Length) || (Str[Pos] < '0') || (Str[Pos] > '9'))
+   {
+    return(false);
+   }
+
+  while ((Pos < Length) && (Str[Pos] >= '0') && (Str[Pos] <= '9'))
+   {
+    unsigned_int32                       Digit;
+
+    Digit = Str[Pos] - '0';
+
+    if (Result > (0xFFFFFFFFU - Digit) / 10)
+     {
+      return(false);
+     }
+
+    Result = Result * 10 + Digit;
+
+    Pos++;
+   }
+
+  *Value = Result;
+
+  return(true);
+ }
+
+static bool        P3DMatchNoCase     (const char         *Str,
+                                       unsigned_int32        Length,
+                                       const char         *Word)
+ {
+  unsigned_int32                         Pos;
+
+  for (Pos = 0; Word[Pos] != '\0'; Pos++)
+   {
+    if ((Pos >= Length) || ((Str[Pos] | 0x20) != Word[Pos]))
+     {
+      return(false);
+     }
+   }
+
+  return(true);
+ }
+
+/* parses decimal floating point number the same way as sscanf("%f") */
+/* in "C" locale does, with correct rounding                         */
+static bool        P3DParseFloat      (float              *Value,
+                                       const char         *Str,
+                                       unsigned_int32        Length)
+ {
+  unsigned_int32                         Pos;
+  unsigned_int32                         IntStart;
+  unsigned_int32                         IntCount;
+  unsigned_int32                         FracStart;
+  unsigned_int32                         FracCount;
+  int                                  Exp;
+  int                                  LeadExp;
+  bool                                 Negative;
+  bool                                 Sticky;
+  char                                 Digits[P3D_FLOAT_MAX_SIGNIFICANT_DIGITS];
+  unsigned_int32                         DigitCount;
+  float                                Result;
+
+  Pos      = 0;
+  Negative = false;
+
+  if ((Pos < Length) && ((Str[Pos] == '+') || (Str[Pos] == '-')))
+   {
+    Negative = Str[Pos] == '-';
+
+    Pos++;
+   }
+
+  if      (P3DMatchNoCase(&Str[Pos],Length - Pos,"inf"))
+   {
+    *Value = P3DFloatFromBits(Negative ? 0xFF800000 : 0x7F800000);
+
+    return(true);
+   }
+  else if (P3DMatchNoCase(&Str[Pos],Length - Pos,"nan"))
+   {
+    *Value = P3DFloatFromBits(Negative ? 0xFFC00000 : 0x7FC00000);
+
+    return(true);
+   }
+
+  IntStart = Pos;
+
+  while ((Pos < Length) && (Str[Pos] >= '0') && (Str[Pos] <= '9'))
+   {
+    Pos++;
+   }
+
+  IntCount  = Pos - IntStart;
+  FracStart = Pos;
+  FracCount = 0;
+
+  if ((Pos < Length) && (Str[Pos] == '.'))
+   {
+    Pos++;
+
+    FracStart = Pos;
+
+    while ((Pos < Length) && (Str[Pos] >= '0') && (Str[Pos] <= '9'))
+     {
+      Pos++;
+     }
+
+    FracCount = Pos - FracStart;
+   }
+
+  if ((IntCount + FracCount) == 0)
+   {
+    return(false);
+   }
+
+  Exp = 0;
+
+  if ((Pos < Length) && ((Str[Pos] | 0x20) == 'e'))
+   {
+    unsigned_int32                       ExpPos;
+    bool                               ExpNegative;
+
+    ExpPos      = Pos + 1;
+    ExpNegative = false;
+
+    if ((ExpPos < Length) && ((Str[ExpPos] == '+') || (Str[ExpPos] == '-')))
+     {
+      ExpNegative = Str[ExpPos] == '-';
+
+      ExpPos++;
+     }
+
+    /* exponent without digits is not a part of number */
+    while ((ExpPos < Length) && (Str[ExpPos] >= '0') && (Str[ExpPos] <= '9'))
+     {
+      if (Exp < 100000)
+       {
+        Exp = Exp * 10 + (Str[ExpPos] - '0');
+       }
+
+      ExpPos++;
+     }
+
+    if (ExpNegative)
+     {
+      Exp = -Exp;
+     }
+   }
+
+  /* collect significant digits, LeadExp - decimal exponent of first one */
+
+  DigitCount = 0;
+  LeadExp    = 0;
+  Sticky     = false;
+
+  for (unsigned_int32 Index = 0; Index < IntCount + FracCount; Index++)
+   {
+    char                               Digit;
+
+    Digit = Index < IntCount ? Str[IntStart + Index] : Str[FracStart + Index - IntCount];
+
+    if      (DigitCount < P3D_FLOAT_MAX_SIGNIFICANT_DIGITS)
+     {
+      if ((DigitCount > 0) || (Digit != '0'))
+       {
+        if (DigitCount == 0)
+         {
+          LeadExp = Exp + (int)IntCount - 1 - (int)Index;
+         }
+
+        Digits[DigitCount++] = Digit - '0';
+       }
+     }
+    else if (Digit != '0')
+     {
+      Sticky = true;
+     }
+   }
+
+  while ((DigitCount > 0) && (Digits[DigitCount - 1] == 0))
+   {
+    DigitCount--;
+   }
+
+  if      (DigitCount == 0)
+   {
+    Result = 0.0f;
+   }
+  else if (LeadExp > 38)
+   {
+    /* value is at least 1e39 which is greater than FLT_MAX */
+    Result = P3DFloatFromBits(0x7F800000);
+   }
+  else if (LeadExp < -46)
+   {
+    /* value is less than half of smallest denormal */
+    Result = 0.0f;
+   }
+  else
+   {
+    double                             Mantissa;
+    double                             Approx;
+    int                                DigitExp;
+    unsigned_int32                       ApproxDigitCount;
+    bool                               Done;
+
+    ApproxDigitCount = DigitCount < P3D_DOUBLE_EXACT_DIGITS ? DigitCount : P3D_DOUBLE_EXACT_DIGITS;
+    Mantissa         = 0.0;
+
+    for (unsigned_int32 Index = 0; Index < ApproxDigitCount; Index++)
+     {
+      Mantissa = Mantissa * 10.0 + Digits[Index];
+     }
+
+    DigitExp = LeadExp - (int)ApproxDigitCount + 1;
+    Done     = false;
+    Result   = 0.0f;
+
+    if ((DigitCount <= P3D_DOUBLE_EXACT_DIGITS) && (!Sticky))
+     {
+      if      ((Mantissa < 16777216.0) && (DigitExp >= -10) && (DigitExp <= 10))
+       {
+        /* both operands are exact floats, so single operation is correctly rounded */
+        Result = DigitExp < 0 ? (float)Mantissa / P3DPow10f[-DigitExp] : (float)Mantissa * P3DPow10f[DigitExp];
+        Done   = true;
+       }
+      else if ((DigitExp >= -22) && (DigitExp <= 22))
+       {
+        double                         Exact;
+        double                         Midpoint;
+        unsigned_int32                   Bits;
+
+        /* Exact is correctly rounded double, converting it to float */
+        /* gives correct result unless Exact is halfway between two  */
+        /* floats                                                    */
+        Exact  = DigitExp < 0 ? Mantissa / P3DPow10[-DigitExp] : Mantissa * P3DPow10[DigitExp];
+        Result = (float)Exact;
+        Bits   = P3DFloatToBits(Result);
+
+        if ((double)Result == Exact)
+         {
+          Done = true;
+         }
+        else
+         {
+          Midpoint = (double)Result < Exact ? P3DFloatMidpointAbove(Bits) : P3DFloatMidpointAbove(Bits - 1);
+          Done     = Midpoint != Exact;
+         }
+       }
+     }
+
+    if (!Done)
+     {
+      P3DBigUInt                       BigDigits;
+      unsigned_int32                     Bits;
+      int                              Exp10;
+
+      Approx = P3DScalePow10(Mantissa,DigitExp);
+      Bits   = P3DFloatToBits((float)Approx);
+      Exp10  = LeadExp - (int)DigitCount + 1;
+
+      for (unsigned_int32 Index = 0; Index < DigitCount; Index++)
+       {
+        BigDigits.MulSmall(10);
+        BigDigits.AddSmall(Digits[Index]);
+       }
+
+      /* approximation is off by at most one float ulp, */
+      /* move it towards exact value                    */
+      while (true)
+       {
+        int                            Cmp;
+
+        if (Bits < 0x7F800000)
+         {
+          Cmp = P3DCompareDecimal(&BigDigits,Exp10,Sticky,P3DFloatMidpointAbove(Bits));
+
+          if ((Cmp > 0) || ((Cmp == 0) && ((Bits & 1) != 0)))
+           {
+            Bits++;
+
+            continue;
+           }
+         }
+
+        if (Bits > 0)
+         {
+          Cmp = P3DCompareDecimal(&BigDigits,Exp10,Sticky,P3DFloatMidpointAbove(Bits - 1));
+
+          if ((Cmp < 0) || ((Cmp == 0) && ((Bits & 1) != 0)))
+           {
+            Bits--;
+
+            continue;
+           }
+         }
+
+        break;
+       }
+
+      Result = P3DFloatFromBits(Bits);
+     }
+   }
+
+  *Value = Negative ? -Result : Result;
+
+  return(true);
+ }
+
+/* writes Value to Buffer, returns false if Buffer is too small */
+static bool        P3DFormatUInt32    (char               *Buffer,
+                                       unsigned_int32        BufferSize,
+                                       unsigned_int32        Value)
+ {
+  char                                 Digits[10];
+  unsigned_int32                         DigitCount;
+
+  DigitCount = 0;
+
+  do
+   {
+    Digits[DigitCount++] = '0' + (char)(Value % 10);
+
+    Value /= 10;
+   } while (Value != 0);
+
+  if (DigitCount >= BufferSize)
+   {
+    return(false);
+   }
+
+  for (unsigned_int32 Index = 0; Index < DigitCount; Index++)
+   {
+    Buffer[Index] = Digits[DigitCount - 1 - Index];
+   }
+
+  Buffer[DigitCount] = '\0';
+
+  return(true);
+ }
+
+/* writes Value to Buffer exactly like printf("%f") does, returns */
+/* false if Buffer is too small                                   */
+static bool        P3DFormatFloat     (char               *Buffer,
+                                       unsigned_int32        BufferSize,
+                                       double              Value)
+ {
+  /* digits in reversed order, enough for any double */
+  char                                 Digits[320];
+  unsigned_int32                         DigitCount;
+  unsigned_int32                         Pos;
+  bool                                 Negative;
+  double                               Abs;
+
+  /* sign bit survives conversion to float, including NaNs and zeros */
+  Negative   = (P3DFloatToBits((float)Value) & 0x80000000) != 0;
+  Abs        = fabs(Value);
+  DigitCount = 0;
+
+  if ((Value != Value) || (Abs > DBL_MAX))
+   {
+    const char                        *Str;
+
+    Str = Value != Value ? (Negative ? "-nan" : "nan") : (Negative ? "-inf" : "inf");
+
+    if (strlen(Str) >= BufferSize)
+     {
+      return(false);
+     }
+
+    strcpy(Buffer,Str);
+
+    return(true);
+   }
+
+  if (((double)(float)Abs == Abs) && (Abs < 4.0e9))
+   {
+    double                             Scaled;
+    double                             Integer;
+    double                             Fraction;
+    double                             Low;
+    double                             HighPart;
+    unsigned_int32                       High;
+    unsigned_int32                       Fixed;
+
+    /* float mantissa has 24 bits and 10^6 = 15625 * 2^6, */
+    /* so Scaled is exact and less than 2^53              */
+    Scaled   = Abs * P3DPow10[P3D_FLOAT_FRACTION_DIGITS];
+    Integer  = floor(Scaled);
+    Fraction = Scaled - Integer;
+
+    if ((Fraction > 0.5) || ((Fraction == 0.5) && (fmod(Integer,2.0) != 0.0)))
+     {
+      Integer += 1.0;
+     }
+
+    /* Integer is less than 2^53, so product and difference are exact, */
+    /* only rounded quotient may need correction (fmod is much slower) */
+    HighPart = floor(Integer / P3DPow10[P3D_FLOAT_FRACTION_DIGITS]);
+    Low      = Integer - HighPart * P3DPow10[P3D_FLOAT_FRACTION_DIGITS];
+
+    if      (Low < 0.0)
+     {
+      HighPart -= 1.0;
+      Low      += P3DPow10[P3D_FLOAT_FRACTION_DIGITS];
+     }
+    else if (Low >= P3DPow10[P3D_FLOAT_FRACTION_DIGITS])
+     {
+      HighPart += 1.0;
+      Low      -= P3DPow10[P3D_FLOAT_FRACTION_DIGITS];
+     }
+
+    High  = (unsigned_int32)HighPart;
+    Fixed = (unsigned_int32)Low;
+
+    for (unsigned_int32 Index = 0; Index < P3D_FLOAT_FRACTION_DIGITS; Index++)
+     {
+      Digits[DigitCount++] = '0' + (char)(Fixed % 10);
+
+      Fixed /= 10;
+     }
+
+    while (High != 0)
+     {
+      Digits[DigitCount++] = '0' + (char)(High % 10);
+
+      High /= 10;
+     }
+   }
+  else
+   {
+    P3DBigUInt                         Scaled;
+    int                                BinExp;
+
+    Scaled.SetDouble(ldexp(frexp(Abs,&BinExp),53));
+    Scaled.MulPow10(P3D_FLOAT_FRACTION_DIGITS);
+
+    BinExp -= 53;
+
+    if (BinExp > 0)
+     {
+      Scaled.ShiftLeft(BinExp);
+     }
+    else
+     {
+      Scaled.ShiftRightRound(-BinExp);
+     }
+
+    while (!Scaled.IsZero())
+     {
+      unsigned_int32                     Group;
+
+      Group = Scaled.DivSmall(10000);
+
+      for (unsigned_int32 Index = 0; Index < 4; Index++)
+       {
+        Digits[DigitCount++] = '0' + (char)(Group % 10);
+
+        Group /= 10;
+       }
+     }
+
+    while ((DigitCount > P3D_FLOAT_FRACTION_DIGITS + 1) && (Digits[DigitCount - 1] == '0'))
+     {
+      DigitCount--;
+     }
+   }
+
+  while (DigitCount < P3D_FLOAT_FRACTION_DIGITS + 1)
+   {
+    Digits[DigitCount++] = '0';
+   }
+
+  /* sign, digits and decimal point */
+  if ((Negative ? 1 : 0) + DigitCount + 1 >= BufferSize)
+   {
+    return(false);
+   }
+
+  Pos = 0;
+
+  if (Negative)
+   {
+    Buffer[Pos++] = '-';
+   }
+
+  for (unsigned_int32 Index = DigitCount; Index > 0; Index--)
+   {
+    if (Index == P3D_FLOAT_FRACTION_DIGITS)
+     {
+      Buffer[Pos++] = '.';
+     }
+
+    Buffer[Pos++] = Digits[Index - 1];
+   }
+
+  Buffer[Pos] = '\0';
+
+  return(true);
+ }
+
+static const unsigned char P3DBinaryMagic[4] = { 'N', 'G', 'P', 'B' };
+
+static void        P3DPutUInt32LE     (unsigned char      *Dest,
+                                       unsigned_int32        Value)
+ {
+  Dest[0] = (unsigned char)(Value & 0xFF);
+  Dest[1] = (unsigned char)((Value >> 8) & 0xFF);
+  Dest[2] = (unsigned char)((Value >> 16) & 0xFF);
+  Dest[3] = (unsigned char)((Value >> 24) & 0xFF);
+ }
+
+static unsigned_int32 P3DGetUInt32LE    (const unsigned char*Src)
+ {
+  return(((unsigned_int32)Src[0])         |
+         (((unsigned_int32)Src[1]) << 8)  |
+         (((unsigned_int32)Src[2]) << 16) |
+         (((unsigned_int32)Src[3]) << 24));
+ }
+
+/* binary records store 32-bit FNV-1a hash of tag instead of tag itself */
+static unsigned_int32 P3DBinaryTagHash  (const char         *Tag)
+ {
+  unsigned_int32                         Hash;
+
+  Hash = 2166136261U;
+
+  while (*Tag != '\0')
+   {
+    Hash ^= (unsigned char)(*Tag++);
+    Hash *= 16777619U;
+   }
+
+  return(Hash);
+ }
+
+const char        *P3DExceptionIO::GetMessage
+                                      () const
+ {
+  return("Input/output error");
+ }
+
+                   P3DInputStringFmtStream::P3DInputStringFmtStream
+                                      (P3DInputStringStream
+                                                          *SourceStream)
+ {
+  this->SourceStream         = SourceStream;
+  this->BinarySource         = dynamic_cast<P3DInputBinaryStream*>(SourceStream);
+  this->HandleEscapedStrings = true;
+  this->MaxBlockSize         = 0;
+  this->Progress             = 0;
+ }
+
+void               P3DInputStringFmtStream::EnableEscapeChars
+                                      (bool                Enable)
+ {
+  this->HandleEscapedStrings = Enable;
+ }
+
+void               P3DInputStringFmtStream::SetMaxBlockSize
+                                      (unsigned_int32        Size)
+ {
+  MaxBlockSize = Size;
+ }
+
+unsigned_int32       P3DInputStringFmtStream::GetMaxBlockSize
+                                      () const
+ {
+  return(MaxBlockSize);
+ }
+
+void               P3DInputStringFmtStream::SetProgress
+                                      (P3DLoadProgress    *Progress)
+ {
+  this->Progress = Progress;
+ }
+
+P3DLoadProgress   *P3DInputStringFmtStream::GetProgress
+                                      () const
+ {
+  return(Progress);
+ }
+
+typedef struct
+ {
+  unsigned_int32     Start;
+  unsigned_int32     Length;
+ } P3DWordInfo;
+
+static bool        GetWordInfoNext    (P3DWordInfo        *WordInfo,
+                                       const char         *Str)
+ {
+  WordInfo->Start += WordInfo->Length;
+  WordInfo->Length = 0;
+
+  while ((Str[WordInfo->Start] == ' ') ||
+         (Str[WordInfo->Start] == '\t'))
+   {
+    WordInfo->Start++;
+   }
+
+  if (Str[WordInfo->Start] == '\0')
+   {
+    return(false);
+   }
+
+  do
+   {
+    WordInfo->Length++;
+   } while ((Str[WordInfo->Start + WordInfo->Length] != ' ')  &&
+            (Str[WordInfo->Start + WordInfo->Length] != '\t') &&
+            (Str[WordInfo->Start + WordInfo->Length] != '\0'));
+
+  return(true);
+ }
+
+
+static bool        GetWordInfoFirst   (P3DWordInfo        *WordInfo,
+                                       const char         *Str)
+ {
+  WordInfo->Start  = 0;
+  WordInfo->Length = 0;
+
+  return(GetWordInfoNext(WordInfo,Str));
+ }
+
+void               P3DInputStringFmtStream::ScanStringSafe
+                                      (char               *DestBuffer,
+                                       unsigned_int32        DestSize,
+                                       const char         *SrcBuffer,
+                                       unsigned_int32        SrcOffset,
+                                       unsigned_int32        SrcLength)
+ {
+  if (!HandleEscapedStrings  ||
+      SrcOffset >= SrcLength ||
+      SrcBuffer[SrcOffset] != '\"')
+   {
+    if (SrcLength >= DestSize)
+     {
+      throw P3DExceptionGeneric("string value is too large");
+     }
+
+    memcpy(DestBuffer,&SrcBuffer[SrcOffset],SrcLength);
+    DestBuffer[SrcLength] = '\0';
+
+    return;
+   }
+
+  unsigned_int32 SrcEnd    = SrcOffset + SrcLength;
+  unsigned_int32 DestOffset = 0;
+
+  for (SrcOffset = SrcOffset + 1; // skip leading quote
+       SrcOffset < SrcEnd && SrcBuffer[SrcOffset] != '\"';
+       SrcOffset++)
+   {
+    if (DestOffset >= DestSize)
+     {
+      throw P3DExceptionGeneric("string too long in data file");
+     }
+
+    char Ch = SrcBuffer[SrcOffset];
+
+    if (Ch == '\\')
+     {
+      if (SrcOffset + 2 >= SrcEnd)
+       {
+        throw P3DExceptionGeneric("unterminated escape sequence in data file");
+       }
+
+      if (!GetCharByHexCode(&Ch,SrcBuffer[SrcOffset + 1],SrcBuffer[SrcOffset + 2]))
+       {
+        throw P3DExceptionGeneric("invalid escape sequence in data file");
+       }
+
+      SrcOffset += 2;
+     }
+
+    DestBuffer[DestOffset++] = Ch;
+   }
+
+  if (DestOffset < DestSize)
+   {
+    DestBuffer[DestOffset] = '\0';
+   }
+  else
+   {
+    throw P3DExceptionGeneric("string too long in data file");
+   }
+ }
+
+void               P3DInputStringFmtStream::ReadFmtStringTagged
+                                      (const char         *Tag,
+                                       const char         *Format,
+                                       ...)
+ {
+  char                                 Buffer[1024];
+  P3DWordInfo                          WordInfo;
+  unsigned_int32                         FieldIndex;
+  unsigned_int32                         FieldCount;
+  va_list                              FieldValues;
+
+  va_start(FieldValues,Format);
+
+  if (BinarySource != 0)
+   {
+    try
+     {
+      ReadFieldsBinary(Tag,Format,FieldValues);
+     }
+    catch (...)
+     {
+      va_end(FieldValues);
+
+      throw;
+     }
+
+    va_end(FieldValues);
+
+    return;
+   }
+
+  try
+   {
+    ReadDataString(Buffer,sizeof(Buffer));
+
+    if (!GetWordInfoFirst(&WordInfo,Buffer))
+     {
+      throw P3DExceptionGeneric("invalid data file string format");
+     }
+
+    if (strlen(Tag) != WordInfo.Length)
+     {
+      throw P3DExceptionGeneric("invalid string tag");
+     }
+
+    if (memcmp(Tag,&Buffer[WordInfo.Start],WordInfo.Length) != 0)
+     {
+      throw P3DExceptionGeneric("invalid string tag");
+     }
+
+    FieldCount = strlen(Format);
+
+    for (FieldIndex = 0; FieldIndex < FieldCount; FieldIndex++)
+     {
+      if (!GetWordInfoNext(&WordInfo,Buffer))
+       {
+        throw P3DExceptionGeneric("unsufficient value count in data file string");
+       }
+
+      switch (Format[FieldIndex])
+       {
+        case ('s') :
+         {
+          char         *Value;
+          unsigned_int32  Size;
+
+          Value = va_arg(FieldValues,char*);
+          Size  = va_arg(FieldValues,unsigned_int32);
+
+          ScanStringSafe(Value,Size,Buffer,WordInfo.Start,WordInfo.Length);
+         } break;
+
+        case ('u') :
+         {
+          if (!P3DParseUInt32(va_arg(FieldValues,unsigned_int32*),&Buffer[WordInfo.Start],WordInfo.Length))
+           {
+            throw P3DExceptionGeneric("invalid unsigned_int32 value");
+           }
+         } break;
+
+        case ('f') :
+         {
+          if (!P3DParseFloat(va_arg(FieldValues,float*),&Buffer[WordInfo.Start],WordInfo.Length))
+           {
+            throw P3DExceptionGeneric("invalid float value");
+           }
+         } break;
+
+        case ('b') :
+         {
+          if      (WordInfo.Length == 4)
+           {
+            if (memcmp(&Buffer[WordInfo.Start],"true",4) == 0)
+             {
+              *(va_arg(FieldValues,bool*)) = 1;
+             }
+            else
+             {
+              throw P3DExceptionGeneric("invalid boolean value");
+             }
+           }
+          else if (WordInfo.Length == 5)
+           {
+            if (memcmp(&Buffer[WordInfo.Start],"false",5) == 0)
+             {
+              *(va_arg(FieldValues,bool*)) = 0;
+             }
+            else
+             {
+              throw P3DExceptionGeneric("invalid boolean value");
+             }
+           }
+          else
+           {
+            throw P3DExceptionGeneric("invalid boolean value");
+           }
+         } break;
+
+        default    :
+         {
+          throw P3DExceptionGeneric("invalid format string field type");
+         }
+       }
+     }
+   }
+  catch (...)
+   {
+    va_end(FieldValues);
+
+    throw;
+   }
+
+  va_end(FieldValues);
+ }
+
+void               P3DInputStringFmtStream::ReadFieldsBinary
+                                      (const char         *Tag,
+                                       const char         *Format,
+                                       va_list             FieldValues)
+ {
+  unsigned char                        Buffer[P3D_BINARY_RECORD_BUFFER_SIZE];
+  const unsigned char                 *Data;
+  const char                          *Field;
+  const char                          *FixedEnd;
+  unsigned_int32                         FixedSize;
+
+  /* tag and leading numeric fields have fixed size, so they are read */
+  /* at once and decoded without reading stream field by field        */
+  FixedEnd  = Format;
+  FixedSize = 4;
+
+  while (((*FixedEnd == 'u') || (*FixedEnd == 'f')) &&
+         (FixedSize < sizeof(Buffer)))
+   {
+    FixedSize += 4;
+    FixedEnd++;
+   }
+
+  Data = BinarySource->MapData(Buffer,FixedSize);
+
+  if (P3DGetUInt32LE(Data) != P3DBinaryTagHash(Tag))
+   {
+    throw P3DExceptionGeneric("invalid string tag");
+   }
+
+  for (Field = Format; Field < FixedEnd; Field++)
+   {
+    unsigned_int32                       Bits;
+
+    Data += 4;
+    Bits  = P3DGetUInt32LE(Data);
+
+    if (*Field == 'u')
+     {
+      *(va_arg(FieldValues,unsigned_int32*)) = Bits;
+     }
+    else
+     {
+      memcpy(va_arg(FieldValues,float*),&Bits,sizeof(Bits));
+     }
+   }
+
+  for (Field = FixedEnd; *Field != '\0'; Field++)
+   {
+    switch (*Field)
+     {
+      case ('s') :
+       {
+        char                          *Value;
+        unsigned_int32                   Size;
+        unsigned_int32                   Length;
+
+        Value = va_arg(FieldValues,char*);
+        Size  = va_arg(FieldValues,unsigned_int32);
+
+        Length = P3DGetUInt32LE(BinarySource->MapData(Buffer,4));
+
+        if (Length >= Size)
+         {
+          throw P3DExceptionGeneric("string value is too large");
+         }
+
+        BinarySource->ReadData(Value,Length);
+
+        Value[Length] = '\0';
+       } break;
+
+      case ('u') :
+       {
+        *(va_arg(FieldValues,unsigned_int32*)) =
+         P3DGetUInt32LE(BinarySource->MapData(Buffer,4));
+       } break;
+
+      case ('f') :
+       {
+        unsigned_int32                   Bits;
+
+        Bits = P3DGetUInt32LE(BinarySource->MapData(Buffer,4));
+
+        memcpy(va_arg(FieldValues,float*),&Bits,sizeof(Bits));
+       } break;
+
+      case ('b') :
+       {
+        unsigned char                    Value;
+
+        Value = *(BinarySource->MapData(Buffer,1));
+
+        if (Value > 1)
+         {
+          throw P3DExceptionGeneric("invalid boolean value");
+         }
+
+        *(va_arg(FieldValues,bool*)) = Value != 0;
+       } break;
+
+      default    :
+       {
+        throw P3DExceptionGeneric("invalid format string field type");
+       }
+     }
+   }
+ }
+
+void               P3DInputStringFmtStream::ReadDataString
+                                      (char               *Buffer,
+                                       unsigned_int32        BufferSize)
+ {
+  /*FIXME: skip empty lines here */
+  SourceStream->ReadString(Buffer,BufferSize);
+ }
+
+                   P3DInputStringStreamFile::P3DInputStringStreamFile
+                                      ()
+ {
+  Source    = NULL;
+  Block     = NULL;
+  BlockSize = 0;
+  BlockPos  = 0;
+ }
+
+                   P3DOutputStringFmtStream::P3DOutputStringFmtStream
+                                      (P3DOutputStringStream
+                                                          *Target)
+ {
+  this->Target       = Target;
+  this->BinaryTarget = dynamic_cast<P3DOutputBinaryStream*>(Target);
+ }
+
+void               P3DOutputStringFmtStream::WriteString
+                                      (const char         *Buffer)
+ {
+  Target->WriteString(Buffer);
+ }
+
+/* Collects text line in fixed-size buffer, so every line is passed */
+/* to target stream by single call. Parts of long lines, which do    */
+/* not fit into buffer, are written without line end.                */
+class P3DOutputLineBuffer
+ {
+  public           :
+
+                   P3DOutputLineBuffer(P3DOutputStringStream
+                                                          *Target)
+   {
+    this->Target = Target;
+
+    Size = 0;
+   }
+
+  void             Append             (const char         *Str,
+                                       unsigned_int32        Length)
+   {
+    unsigned_int32                       ChunkSize;
+
+    while (Length > 0)
+     {
+      if (Size == P3D_OUTPUT_LINE_BUFFER_SIZE)
+       {
+        WritePart();
+       }
+
+      ChunkSize = P3D_OUTPUT_LINE_BUFFER_SIZE - Size;
+
+      if (ChunkSize > Length)
+       {
+        ChunkSize = Length;
+       }
+
+      memcpy(&Buffer[Size],Str,ChunkSize);
+
+      Size   += ChunkSize;
+      Str    += ChunkSize;
+      Length -= ChunkSize;
+     }
+   }
+
+  void             Append             (char                Ch)
+   {
+    if (Size == P3D_OUTPUT_LINE_BUFFER_SIZE)
+     {
+      WritePart();
+     }
+
+    Buffer[Size++] = Ch;
+   }
+
+  /* writes rest of line with line end */
+  void             WriteLine          ()
+   {
+    Buffer[Size] = '\0';
+
+    Target->WriteString(Buffer);
+
+    Size = 0;
+   }
+
+  private          :
+
+  void             WritePart          ()
+   {
+    Buffer[Size] = '\0';
+
+    Target->AutoLnDisable();
+
+    try
+     {
+      Target->WriteString(Buffer);
+     }
+    catch (...)
+     {
+      Target->AutoLnEnable();
+
+      throw;
+     }
+
+    Target->AutoLnEnable();
+
+    Size = 0;
+   }
+
+  P3DOutputStringStream               *Target;
+  char                                 Buffer[P3D_OUTPUT_LINE_BUFFER_SIZE + 1];
+  unsigned_int32                         Size;
+ };
+
+/* strings with spaces or special chars are quoted and special chars */
+/* are written as \XX                                                */
+static void        P3DAppendStringSafe(P3DOutputLineBuffer
+                                                          *Line,
+                                       const char         *Str)
+ {
+  const char                          *SrcPtr;
+  char                                 Ch;
+
+  for (SrcPtr = Str; *SrcPtr > 0x20; SrcPtr++) ;
+
+  if (*SrcPtr == '\0')
+   {
+    Line->Append(Str,(unsigned_int32)(SrcPtr - Str)); // no need to escape since no special chars found
+
+    return;
+   }
+
+  Line->Append('\"');
+
+  for (SrcPtr = Str; *SrcPtr != '\0'; SrcPtr++)
+   {
+    Ch = *SrcPtr;
+
+    if (Ch <= 0x20 || Ch == '\"' || Ch == '\\')
+     {
+      Line->Append('\\');
+      Line->Append(GetHexDigitChar(Ch >> 4));
+      Line->Append(GetHexDigitChar(Ch & 0x0F));
+     }
+    else
+     {
+      Line->Append(Ch);
+     }
+   }
+
+  Line->Append('\"');
+ }
+
+void               P3DOutputStringFmtStream::WriteString
+                                      (const char         *Format,
+                                       ...)
+ {
+  unsigned_int32                         FieldIndex;
+  va_list                              FieldValues;
+  char                                 Buffer[255 + 1];
+  P3DOutputLineBuffer                  Line(Target);
+
+  va_start(FieldValues,Format);
+
+  if (BinaryTarget != 0)
+   {
+    try
+     {
+      WriteFieldsBinary(Format,FieldValues);
+     }
+    catch (...)
+     {
+      va_end(FieldValues);
+
+      throw;
+     }
+
+    va_end(FieldValues);
+
+    return;
+   }
+
+  try
+   {
+    for (FieldIndex = 0; Format[FieldIndex] != '\0'; FieldIndex++)
+     {
+      if (FieldIndex > 0)
+       {
+        Line.Append(' ');
+       }
+
+      switch (Format[FieldIndex])
+       {
+        case ('s') :
+         {
+          P3DAppendStringSafe(&Line,va_arg(FieldValues,char*));
+         } break;
+
+        case ('u') :
+         {
+          if (!P3DFormatUInt32(Buffer,sizeof(Buffer),va_arg(FieldValues,unsigned_int32)))
+           {
+            throw P3DExceptionGeneric("unsigned_int32 value string representation is too large");
+           }
+
+          Line.Append(Buffer,(unsigned_int32)strlen(Buffer));
+         } break;
+
+        case ('f') :
+         {
+          if (!P3DFormatFloat(Buffer,sizeof(Buffer),va_arg(FieldValues,double)))
            {
-            if (memcmp(&Buffer[WordInfo.Start],"true",4) == 0)
-             {
-              *(va_arg(FieldValues,bool*)) = 1;
-             }
-            else
-             {
-              throw P3DExceptionGeneric("invalid boolean value");
-             }
+            throw P3DExceptionGeneric("float value string representation is too large");
            }
-          else if (WordInfo.Length == 5)
+
+          Line.Append(Buffer,(unsigned_int32)strlen(Buffer));
+         } break;
+
+        case ('b') :
+         {
+          if ((bool)va_arg(FieldValues,int))
            {
-            if (memcmp(&Buffer[WordInfo.Start],"false",5) == 0)
-             {
-              *(va_arg(FieldValues,bool*)) = 0;
-             }
-            else
-             {
-              throw P3DExceptionGeneric("invalid boolean value");
-             }
+            Line.Append("true",4);
            }
           else
            {
-            throw P3DExceptionGeneric("invalid boolean value");
+            Line.Append("false",5);
            }
          } break;
 
@@ -360,226 +1685,509 @@ void               P3DInputStringFmtStream::ReadFmtStringTagged
          }
        }
      }
+
+    Line.WriteLine();
    }
   catch (...)
    {
     va_end(FieldValues);
 
-    RestoreLocaleNumeric(&LocaleInfo);
-
     throw;
    }
 
   va_end(FieldValues);
+ }
+
+void               P3DOutputStringFmtStream::WriteFieldsBinary
+                                      (const char         *Format,
+                                       va_list             FieldValues)
+ {
+  unsigned char                        Record[64];
+  unsigned_int32                         RecordSize;
+  unsigned_int32                         FieldIndex;
+  unsigned_int32                         FieldCount;
+
+  /* first field is a tag */
+  if (Format[0] != 's')
+   {
+    throw P3DExceptionGeneric("invalid format string field type");
+   }
+
+  P3DPutUInt32LE(Record,P3DBinaryTagHash(va_arg(FieldValues,char*)));
+
+  RecordSize = 4;
+  FieldCount = strlen(Format);
+
+  for (FieldIndex = 1; FieldIndex < FieldCount; FieldIndex++)
+   {
+    if (RecordSize + 4 > sizeof(Record))
+     {
+      BinaryTarget->WriteData(Record,RecordSize);
+
+      RecordSize = 0;
+     }
+
+    switch (Format[FieldIndex])
+     {
+      case ('s') :
+       {
+        const char                    *Str;
+        unsigned_int32                   Length;
+
+        Str    = va_arg(FieldValues,char*);
+        Length = strlen(Str);
+
+        P3DPutUInt32LE(&Record[RecordSize],Length);
+
+        BinaryTarget->WriteData(Record,RecordSize + 4);
+        BinaryTarget->WriteData(Str,Length);
+
+        RecordSize = 0;
+       } break;
+
+      case ('u') :
+       {
+        P3DPutUInt32LE(&Record[RecordSize],va_arg(FieldValues,unsigned_int32));
+
+        RecordSize += 4;
+       } break;
+
+      case ('f') :
+       {
+        float                          Value;
+        unsigned_int32                   Bits;
+
+        Value = (float)va_arg(FieldValues,double);
+
+        memcpy(&Bits,&Value,sizeof(Bits));
 
-  RestoreLocaleNumeric(&LocaleInfo);
+        P3DPutUInt32LE(&Record[RecordSize],Bits);
+
+        RecordSize += 4;
+       } break;
+
+      case ('b') :
+       {
+        Record[RecordSize++] = (bool)va_arg(FieldValues,int) ? 1 : 0;
+       } break;
+
+      default    :
+       {
+        throw P3DExceptionGeneric("invalid format string field type");
+       }
+     }
+   }
+
+  if (RecordSize > 0)
+   {
+    BinaryTarget->WriteData(Record,RecordSize);
+   }
  }
 
-void               P3DInputStringFmtStream::ReadDataString
+                   P3DInputStringStreamFile::~P3DInputStringStreamFile
+                                      ()
+ {
+  Close();
+ }
+
+void               P3DInputStringStreamFile::Open
+                                      (const char         *FileName)
+ {
+  if (Source != NULL)
+   {
+    Close();
+   }
+
+  if (Block == NULL)
+   {
+    Block = new char[P3D_INPUT_FILE_BLOCK_SIZE];
+   }
+
+  BlockSize = 0;
+  BlockPos  = 0;
+
+  Source = fopen(FileName,"rb");
+
+  if (Source == NULL)
+   {
+    throw P3DExceptionIO();
+   }
+ }
+
+void               P3DInputStringStreamFile::Close
+                                      ()
+ {
+  if (Source != NULL)
+   {
+    fclose(Source);
+
+    Source = NULL;
+   }
+
+  delete[] Block;
+
+  Block     = NULL;
+  BlockSize = 0;
+  BlockPos  = 0;
+ }
+
+bool               P3DInputStringStreamFile::FillBuffer
+                                      () const
+ {
+  size_t                               ReadSize;
+
+  ReadSize = fread(Block,1,P3D_INPUT_FILE_BLOCK_SIZE,Source);
+
+  if (ReadSize == 0)
+   {
+    if (ferror(Source))
+     {
+      throw P3DExceptionIO();
+     }
+   }
+
+  BlockSize = (unsigned_int32)ReadSize;
+  BlockPos  = 0;
+
+  return(ReadSize > 0);
+ }
+
+void               P3DInputStringStreamFile::ReadString
                                       (char               *Buffer,
                                        unsigned_int32        BufferSize)
  {
-  /*FIXME: skip empty lines here */
-  SourceStream->ReadString(Buffer,BufferSize);
+  unsigned_int32                         Index;
+  unsigned_int32                         Limit;
+  const char                          *Curr;
+  const char                          *End;
+  const char                          *LineEnd;
+  char                                 CurrChar;
+
+  if ((Source == NULL) || (BufferSize < 2))
+   {
+    throw P3DExceptionAssert();
+   }
+
+  Index = 0;
+  Limit = BufferSize - 1;
+
+  while (true)
+   {
+    if (BlockPos >= BlockSize)
+     {
+      if (!FillBuffer())
+       {
+        Buffer[Index] = 0;
+
+        return;
+       }
+     }
+
+    Curr    = &Block[BlockPos];
+    End     = &Block[BlockSize];
+    LineEnd = (const char*)memchr(Curr,'\n',End - Curr);
+
+    if (LineEnd == NULL)
+     {
+      LineEnd = End;
+     }
+
+    while (Curr < LineEnd)
+     {
+      CurrChar = *Curr++;
+
+      if (CurrChar != '\r')
+       {
+        Buffer[Index] = CurrChar;
+
+        Index++;
+
+        if (Index >= Limit)
+         {
+          BlockPos      = (unsigned_int32)(Curr - Block);
+          Buffer[Index] = 0;
+
+          return;
+         }
+       }
+     }
+
+    if (LineEnd < End)
+     {
+      /* skip '\n' */
+      BlockPos      = (unsigned_int32)(LineEnd + 1 - Block);
+      Buffer[Index] = 0;
+
+      return;
+     }
+
+    BlockPos = BlockSize;
+   }
  }
 
-                   P3DInputStringStreamFile::P3DInputStringStreamFile
+bool               P3DInputStringStreamFile::Eof
+                                      () const
+ {
+  if (Source == NULL)
+   {
+    throw P3DExceptionAssert();
+   }
+
+  if (BlockPos < BlockSize)
+   {
+    return(false);
+   }
+
+  return(!FillBuffer());
+ }
+
+                   P3DOutputStringStreamFile::P3DOutputStringStreamFile
                                       ()
  {
-  Source = NULL;
+  Target = NULL;
+  AutoLn = true;
  }
 
-                   P3DOutputStringFmtStream::P3DOutputStringFmtStream
-                                      (P3DOutputStringStream
-                                                          *Target)
+                   P3DOutputStringStreamFile::~P3DOutputStringStreamFile
+                                      ()
+ {
+  if (Target != NULL)
+   {
+    Close();
+   }
+ }
+
+void               P3DOutputStringStreamFile::Open
+                                      (const char         *FileName)
+ {
+  if (Target != NULL)
+   {
+    Close();
+   }
+
+  Target = fopen(FileName,"wt");
+
+  if (Target == NULL)
+   {
+    throw P3DExceptionIO();
+   }
+
+  /* failure is not critical - default buffer is used then */
+  setvbuf(Target,NULL,_IOFBF,P3D_OUTPUT_FILE_BUFFER_SIZE);
+ }
+
+void               P3DOutputStringStreamFile::Close
+                                      ()
+ {
+  if (Target != NULL)
+   {
+    if (fclose(Target) != 0)
+     {
+      throw P3DExceptionIO();
+     }
+
+    Target = NULL;
+   }
+ }
+
+void               P3DOutputStringStreamFile::WriteString
+                                      (const char         *Buffer)
+ {
+  if (Target == NULL)
+   {
+    throw P3DExceptionAssert();
+   }
+
+  if (fputs(Buffer,Target) == EOF)
+   {
+    throw P3DExceptionIO();
+   }
+
+  if (AutoLn)
+   {
+    if (putc('\n',Target) == EOF)
+     {
+      throw P3DExceptionIO();
+     }
+   }
+ }
+
+void               P3DOutputStringStreamFile::AutoLnEnable
+                                      ()
+ {
+  AutoLn = true;
+ }
+
+void               P3DOutputStringStreamFile::AutoLnDisable
+                                      ()
  {
-  this->Target = Target;
+  AutoLn = false;
  }
 
-void               P3DOutputStringFmtStream::WriteString
-                                      (const char         *Buffer)
+                   P3DInputBinaryStream::P3DInputBinaryStream
+                                      ()
  {
-  Target->WriteString(Buffer);
+  BufferPos = 0;
+  BufferEnd = 0;
  }
 
-void               P3DOutputStringFmtStream::WriteStringSafe
-                                      (const char         *Str)
+void               P3DInputBinaryStream::ReadData
+                                      (void               *Buffer,
+                                       unsigned_int32        Size)
  {
-  const char *SrcPtr;
-  char       *DstPtr;
-  char       *Buffer;
-  char        Ch;
-
-  for (SrcPtr = Str; *SrcPtr > 0x20; SrcPtr++) ;
+  unsigned char                       *Target;
+  unsigned_int32                         ChunkSize;
 
-  if (*SrcPtr == '\0')
-   {
-    Target->WriteString(Str); // no need to escape since no special chars found
-
-    return;
-   }
-
-  // each char can be represented with 3 chars in escaped form,
-  // also 2 chars needed for quotes and 1 for zero
-  Buffer = (char*)malloc(strlen(Str) * 3 + 2 + 1);
+  Target = (unsigned char*)Buffer;
 
-  DstPtr    = Buffer;
-  *DstPtr++ = '\"';
-
-  for (SrcPtr = Str; *SrcPtr != '\0'; SrcPtr++, DstPtr++)
+  while (Size > 0)
    {
-    Ch = *SrcPtr;
-
-    if (Ch <= 0x20 || Ch == '\"' || Ch == '\\')
+    if (BufferPos >= BufferEnd)
      {
-      *DstPtr++ = '\\';
-      *DstPtr++ = GetHexDigitChar(Ch >> 4);
-      *DstPtr   = GetHexDigitChar(Ch & 0x0F);
+      if (!FillBuffer())
+       {
+        throw P3DExceptionGeneric("unexpected end of binary stream");
+       }
      }
-    else
+
+    ChunkSize = (unsigned_int32)(BufferEnd - BufferPos);
+
+    if (ChunkSize > Size)
      {
-      *DstPtr = *SrcPtr;
+      ChunkSize = Size;
      }
-   }
 
-  *DstPtr++ = '\"';
-  *DstPtr   = '\0';
+    memcpy(Target,BufferPos,ChunkSize);
 
-  try
-   {
-    Target->WriteString(Buffer);
-   }
-  catch (...)
-   {
-    free(Buffer);
-
-    throw;
+    BufferPos += ChunkSize;
+    Target    += ChunkSize;
+    Size      -= ChunkSize;
    }
-
-  free(Buffer);
  }
 
-void               P3DOutputStringFmtStream::WriteString
-                                      (const char         *Format,
-                                       ...)
+const unsigned char
+                  *P3DInputBinaryStream::MapData
+                                      (void               *Buffer,
+                                       unsigned_int32        Size)
  {
-  unsigned_int32                         FieldCount;
-  unsigned_int32                         FieldIndex;
-  char                                 FieldType;
-  va_list                              FieldValues;
-  char                                 Buffer[255 + 1];
-  P3DLocaleInfo                        LocaleInfo;
+  const unsigned char                 *Data;
 
-  SetLocaleNumericStd(&LocaleInfo);
-
-  va_start(FieldValues,Format);
-
-  try
+  if (Size <= (unsigned_int32)(BufferEnd - BufferPos))
    {
-    Target->AutoLnDisable();
-
-    FieldCount = strlen(Format);
+    Data       = BufferPos;
+    BufferPos += Size;
 
-    for (FieldIndex = 0; FieldIndex < FieldCount; FieldIndex++)
-     {
-      if (FieldIndex > 0)
-       {
-        Target->WriteString(" ");
-       }
+    return(Data);
+   }
 
-      FieldType = Format[FieldIndex];
+  ReadData(Buffer,Size);
 
-      switch (FieldType)
-       {
-        case ('s') :
-         {
-          WriteStringSafe(va_arg(FieldValues,char*));
-         } break;
+  return((const unsigned char*)Buffer);
+ }
 
-        case ('u') :
-         {
-          if (snprintf(Buffer,sizeof(Buffer),"%u",va_arg(FieldValues,unsigned_int32)) >= (int)(sizeof(Buffer)))
-           {
-            throw P3DExceptionGeneric("unsigned_int32 value string representation is too large");
-           }
+bool               P3DInputBinaryStream::Eof
+                                      () const
+ {
+  if (BufferPos < BufferEnd)
+   {
+    return(false);
+   }
 
-          Target->WriteString(Buffer);
-         } break;
+  return(!FillBuffer());
+ }
 
-        case ('f') :
-         {
-          if (snprintf(Buffer,sizeof(Buffer),"%f",(double)va_arg(FieldValues,double)) >= (int)(sizeof(Buffer)))
-           {
-            throw P3DExceptionGeneric("float value string representation is too large");
-           }
+void               P3DInputBinaryStream::ReadString
+                                      (char               *Buffer P3D_UNUSED_ATTR,
+                                       unsigned_int32        BufferSize P3D_UNUSED_ATTR)
+ {
+  throw P3DExceptionGeneric("text data requested from binary stream");
+ }
 
-          Target->WriteString(Buffer);
-         } break;
+void               P3DInputBinaryStream::ReadHeader
+                                      ()
+ {
+  unsigned char                        Header[P3D_BINARY_HEADER_SIZE];
+  unsigned_int32                         Version;
 
-        case ('b') :
-         {
-          if ((bool)va_arg(FieldValues,int))
-           {
-            Target->WriteString("true");
-           }
-          else
-           {
-            Target->WriteString("false");
-           }
-         } break;
+  ReadData(Header,sizeof(Header));
 
-        default    :
-         {
-          throw P3DExceptionGeneric("invalid format string field type");
-         }
-       }
-     }
-   }
-  catch (...)
+  if (memcmp(Header,P3DBinaryMagic,sizeof(P3DBinaryMagic)) != 0)
    {
-    va_end(FieldValues);
-
-    RestoreLocaleNumeric(&LocaleInfo);
-
-    Target->AutoLnEnable();
-
-    throw;
+    throw P3DExceptionGeneric("invalid binary stream header");
    }
 
-  va_end(FieldValues);
+  Version = P3DGetUInt32LE(&Header[4]);
 
-  RestoreLocaleNumeric(&LocaleInfo);
+  if ((Version == 0) || (Version > P3D_BINARY_FORMAT_VERSION))
+   {
+    throw P3DExceptionGeneric("unsupported binary format version");
+   }
+ }
 
-  Target->AutoLnEnable();
-  Target->WriteString("");
+                   P3DInputBinaryStreamFile::P3DInputBinaryStreamFile
+                                      ()
+ {
+  Source = NULL;
+  Block  = NULL;
  }
 
-                   P3DInputStringStreamFile::~P3DInputStringStreamFile
+                   P3DInputBinaryStreamFile::~P3DInputBinaryStreamFile
                                       ()
  {
-  if (Source != NULL)
-   {
-    Close();
-   }
+  Close();
  }
 
-void               P3DInputStringStreamFile::Open
+void               P3DInputBinaryStreamFile::Open
                                       (const char         *FileName)
  {
-  if (Source != NULL)
+  if (!OpenIfBinary(FileName))
    {
-    Close();
+    throw P3DExceptionGeneric("invalid binary stream header");
    }
+ }
+
+bool               P3DInputBinaryStreamFile::OpenIfBinary
+                                      (const char         *FileName)
+ {
+  Close();
+
+  Block = new unsigned char[P3D_INPUT_FILE_BLOCK_SIZE];
 
   Source = fopen(FileName,"rb");
 
   if (Source == NULL)
    {
+    Close();
+
     throw P3DExceptionIO();
    }
+
+  /* file is read in blocks already, so stdio buffer is not needed */
+  setvbuf(Source,NULL,_IONBF,0);
+
+  try
+   {
+    if ((!FillBuffer()) ||
+        (!IsBinaryData(BufferPos,(unsigned_int32)(BufferEnd - BufferPos))))
+     {
+      Close();
+
+      return(false);
+     }
+
+    ReadHeader();
+   }
+  catch (...)
+   {
+    Close();
+
+    throw;
+   }
+
+  return(true);
  }
 
-void               P3DInputStringStreamFile::Close
+void               P3DInputBinaryStreamFile::Close
                                       ()
  {
   if (Source != NULL)
@@ -588,111 +2196,121 @@ void               P3DInputStringStreamFile::Close
 
     Source = NULL;
    }
+
+  delete[] Block;
+
+  Block     = NULL;
+  BufferPos = NULL;
+  BufferEnd = NULL;
  }
 
-void               P3DInputStringStreamFile::ReadString
-                                      (char               *Buffer,
-                                       unsigned_int32        BufferSize)
+bool               P3DInputBinaryStreamFile::FillBuffer
+                                      () const
  {
-  bool                                 Ready;
-  int                                  CurrChar;
-  unsigned_int32                         Index;
+  size_t                               ReadSize;
 
-  /*FIXME: slow and bruteforced, must be rewritten ;) */
-
-  if ((Source == NULL) || (BufferSize < 2))
+  if (Source == NULL)
    {
     throw P3DExceptionAssert();
    }
 
-  Ready  = false;
-  Index  = 0;
-
-  while (!Ready)
+  /* short read of previous block has reached end of file already, */
+  /* so one more read call is not needed to detect it              */
+  if (feof(Source))
    {
-    CurrChar = fgetc(Source);
+    return(false);
+   }
 
-    if      (CurrChar == EOF)
-     {
-      if (feof(Source))
-       {
-        Buffer[Index] = 0;
-        Ready = true;
-       }
-      else
-       {
-        throw P3DExceptionIO();
-       }
-     }
-    else if (CurrChar == '\r')
-     {
-      /* ignore it */
-     }
-    else if (CurrChar == '\n')
-     {
-      Buffer[Index] = 0;
+  ReadSize = fread(Block,1,P3D_INPUT_FILE_BLOCK_SIZE,Source);
 
-      Ready = true;
-     }
-    else
+  if (ReadSize == 0)
+   {
+    if (ferror(Source))
      {
-      Buffer[Index] = (unsigned char)CurrChar;
-
-      Index++;
-
-      if (Index < (BufferSize - 1))
-       {
-       }
-      else
-       {
-        Buffer[Index] = 0;
-
-        Ready = true;
-       }
+      throw P3DExceptionIO();
      }
    }
+
+  BufferPos = Block;
+  BufferEnd = Block + ReadSize;
+
+  return(ReadSize > 0);
  }
 
-bool               P3DInputStringStreamFile::Eof
-                                      () const
+bool               P3DInputBinaryStreamFile::IsBinaryFile
+                                      (const char         *FileName)
  {
-  int                                  TempChar;
+  FILE                                *Source;
+  unsigned char                        Magic[sizeof(P3DBinaryMagic)];
+  bool                                 Result;
+
+  Source = fopen(FileName,"rb");
 
   if (Source == NULL)
    {
-    throw P3DExceptionAssert();
+    throw P3DExceptionIO();
    }
 
-  TempChar = fgetc(Source);
-  ungetc(TempChar,Source);
+  Result = (fread(Magic,1,sizeof(Magic),Source) == sizeof(Magic)) &&
+           (memcmp(Magic,P3DBinaryMagic,sizeof(Magic)) == 0);
 
-  if (TempChar == EOF)
-   {
-    return(true);
-   }
-  else
-   {
-    return(false);
-   }
+  fclose(Source);
+
+  return(Result);
  }
 
-                   P3DOutputStringStreamFile::P3DOutputStringStreamFile
+bool               P3DInputBinaryStreamFile::IsBinaryData
+                                      (const void         *Data,
+                                       unsigned_int32        DataSize)
+ {
+  return((DataSize >= sizeof(P3DBinaryMagic)) &&
+         (memcmp(Data,P3DBinaryMagic,sizeof(P3DBinaryMagic)) == 0));
+ }
+
+void               P3DOutputBinaryStream::WriteString
+                                      (const char         *Buffer P3D_UNUSED_ATTR)
+ {
+  throw P3DExceptionGeneric("text data written to binary stream");
+ }
+
+void               P3DOutputBinaryStream::AutoLnEnable
+                                      ()
+ {
+ }
+
+void               P3DOutputBinaryStream::AutoLnDisable
+                                      ()
+ {
+ }
+
+void               P3DOutputBinaryStream::WriteHeader
+                                      ()
+ {
+  unsigned char                        Header[P3D_BINARY_HEADER_SIZE];
+
+  memcpy(Header,P3DBinaryMagic,sizeof(P3DBinaryMagic));
+
+  P3DPutUInt32LE(&Header[4],P3D_BINARY_FORMAT_VERSION);
+
+  WriteData(Header,sizeof(Header));
+ }
+
+                   P3DOutputBinaryStreamFile::P3DOutputBinaryStreamFile
                                       ()
  {
   Target = NULL;
-  AutoLn = true;
  }
 
-                   P3DOutputStringStreamFile::~P3DOutputStringStreamFile
+                   P3DOutputBinaryStreamFile::~P3DOutputBinaryStreamFile
                                       ()
  {
   if (Target != NULL)
    {
-    Close();
+    fclose(Target);
    }
  }
 
-void               P3DOutputStringStreamFile::Open
+void               P3DOutputBinaryStreamFile::Open
                                       (const char         *FileName)
  {
   if (Target != NULL)
@@ -700,61 +2318,45 @@ void               P3DOutputStringStreamFile::Open
     Close();
    }
 
-  Target = fopen(FileName,"wt");
+  Target = fopen(FileName,"wb");
 
   if (Target == NULL)
    {
     throw P3DExceptionIO();
    }
+
+  WriteHeader();
  }
 
-void               P3DOutputStringStreamFile::Close
+void               P3DOutputBinaryStreamFile::Close
                                       ()
  {
   if (Target != NULL)
    {
-    if (fclose(Target) != 0)
+    FILE                              *File;
+
+    File   = Target;
+    Target = NULL;
+
+    if (fclose(File) != 0)
      {
       throw P3DExceptionIO();
      }
-
-    Target = NULL;
    }
  }
 
-void               P3DOutputStringStreamFile::WriteString
-                                      (const char         *Buffer)
+void               P3DOutputBinaryStreamFile::WriteData
+                                      (const void         *Data,
+                                       unsigned_int32        Size)
  {
   if (Target == NULL)
    {
     throw P3DExceptionAssert();
    }
 
-  if (AutoLn)
-   {
-    if (fprintf(Target,"%s\n",Buffer) < 0)
-     {
-      throw P3DExceptionIO();
-     }
-   }
-  else
+  if (fwrite(Data,1,Size,Target) != Size)
    {
-    if (fprintf(Target,"%s",Buffer) < 0)
-     {
-      throw P3DExceptionIO();
-     }
+    throw P3DExceptionIO();
    }
  }
 
-void               P3DOutputStringStreamFile::AutoLnEnable
-                                      ()
- {
-  AutoLn = true;
- }
-
-void               P3DOutputStringStreamFile::AutoLnDisable
-                                      ()
- {
-  AutoLn = false;
- }
-
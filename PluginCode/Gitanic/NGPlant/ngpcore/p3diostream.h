@@ -32,6 +32,8 @@
 #ifndef __P3DIOSTREAM_H__
 #define __P3DIOSTREAM_H__
 
+#include <stdarg.h>
+
 #include <C4Defines.h>
 
 #include <ngpcore/p3ddefs.h>
@@ -80,7 +82,115 @@ class P3D_DLL_ENTRY P3DInputStringStreamFile : public P3DInputStringStream
 
   private          :
 
+  /* returns false if there is no more data in file */
+  bool             FillBuffer         () const;
+
+  FILE            *Source;
+  /* file is read in blocks of P3D_INPUT_FILE_BLOCK_SIZE bytes, Eof() */
+  /* may need to read next block, so buffer state is mutable          */
+  char            *Block;
+  mutable unsigned_int32                 BlockSize;
+  mutable unsigned_int32                 BlockPos;
+ };
+
+/* Binary streams carry the same data as text ones, but FmtStreams */
+/* encode every tagged string as compact little-endian record      */
+/* instead of text line. Stream data starts with header containing */
+/* magic and binary format version.                                */
+
+#define P3D_BINARY_FORMAT_VERSION    (1)
+#define P3D_BINARY_HEADER_SIZE       (8)
+
+class P3DInputBinaryStream : public P3DInputStringStream
+ {
+  public           :
+
+                   P3DInputBinaryStream
+                                      ();
+
+  void             ReadData           (void               *Buffer,
+                                       unsigned_int32        Size);
+
+  /* Returns pointer to next Size bytes of stream and skips them. Data */
+  /* is copied to Buffer only if it is split between buffered blocks,  */
+  /* returned pointer is valid until next read.                        */
+  const unsigned char
+                  *MapData            (void               *Buffer,
+                                       unsigned_int32        Size);
+
+  /* binary streams contain no text lines, throws exception */
+  virtual
+  void             ReadString         (char               *Buffer,
+                                       unsigned_int32        BufferSize);
+
+  virtual bool     Eof                () const;
+
+  protected        :
+
+  /* reads and validates stream header */
+  void             ReadHeader         ();
+
+  /* Sets BufferPos and BufferEnd to next data block, returns false */
+  /* if there is no more data. Eof() may need to read next block,   */
+  /* so buffer state is mutable.                                    */
+  virtual bool     FillBuffer         () const = 0;
+
+  mutable const unsigned char         *BufferPos;
+  mutable const unsigned char         *BufferEnd;
+ };
+
+class P3D_DLL_ENTRY P3DInputBinaryStreamFile : public P3DInputBinaryStream
+ {
+  public           :
+
+                   P3DInputBinaryStreamFile
+                                      ();
+
+  virtual         ~P3DInputBinaryStreamFile
+                                      ();
+
+  void             Open               (const char         *FileName);
+  /* opens file only if it starts with binary stream header, so */
+  /* caller can fall back to text stream without reopening it   */
+  bool             OpenIfBinary       (const char         *FileName);
+  void             Close              ();
+
+  /* returns true if file starts with binary stream header */
+  static bool      IsBinaryFile       (const char         *FileName);
+
+  /* returns true if memory block starts with binary stream header */
+  static bool      IsBinaryData       (const void         *Data,
+                                       unsigned_int32        DataSize);
+
+  private          :
+
+                   P3DInputBinaryStreamFile
+                                      (const P3DInputBinaryStreamFile
+                                                          &Source);
+  P3DInputBinaryStreamFile
+                  &operator =         (const P3DInputBinaryStreamFile
+                                                          &Source);
+
+  virtual bool     FillBuffer         () const;
+
   FILE            *Source;
+  /* file is read in blocks of P3D_INPUT_FILE_BLOCK_SIZE bytes, as */
+  /* in P3DInputStringStreamFile                                    */
+  unsigned char   *Block;
+ };
+
+/* Receives notifications while large data blocks (like custom mesh */
+/* data) are loaded. Loading may be cancelled by throwing exception */
+/* from OnProgress.                                                 */
+class P3DLoadProgress
+ {
+  public           :
+
+  virtual         ~P3DLoadProgress    () {};
+
+  /* Counts are in records of data block currently being loaded */
+  virtual void     OnProgress         (unsigned_int32        LoadedCount,
+                                       unsigned_int32        TotalCount) = 0;
  };
 
 class P3DInputStringFmtStream
@@ -97,6 +207,14 @@ class P3DInputStringFmtStream
 
   void             EnableEscapeChars  (bool                Enable);
 
+  /* Size limit (in bytes) for single data block allocated while */
+  /* loading, 0 means no limit                                   */
+  void             SetMaxBlockSize    (unsigned_int32        Size);
+  unsigned_int32     GetMaxBlockSize    () const;
+
+  void             SetProgress        (P3DLoadProgress    *Progress);
+  P3DLoadProgress *GetProgress        () const;
+
   private          :
 
   void             ReadDataString     (char               *Buffer,
@@ -108,8 +226,16 @@ class P3DInputStringFmtStream
                                        unsigned_int32        SrcOffset,
                                        unsigned_int32        SrcLength);
 
+  void             ReadFieldsBinary   (const char         *Tag,
+                                       const char         *Format,
+                                       va_list             FieldValues);
+
   P3DInputStringStream                *SourceStream;
+  /* same as SourceStream if it is binary, 0 otherwise */
+  P3DInputBinaryStream                *BinarySource;
   bool                                 HandleEscapedStrings;
+  unsigned_int32                         MaxBlockSize;
+  P3DLoadProgress                     *Progress;
  };
 
 class P3DOutputStringStream
@@ -124,6 +250,23 @@ class P3DOutputStringStream
   virtual void     AutoLnDisable      () = 0;
  };
 
+class P3DOutputBinaryStream : public P3DOutputStringStream
+ {
+  public           :
+
+  virtual void     WriteData          (const void         *Data,
+                                       unsigned_int32        Size) = 0;
+
+  /* binary streams contain no text lines, throws exception */
+  virtual void     WriteString        (const char         *Buffer);
+  virtual void     AutoLnEnable       ();
+  virtual void     AutoLnDisable      ();
+
+  protected        :
+
+  void             WriteHeader        ();
+ };
+
 class P3DOutputStringFmtStream
  {
   public           :
@@ -149,9 +292,12 @@ class P3DOutputStringFmtStream
 
   private          :
 
-  void             WriteStringSafe    (const char         *Str);
+  void             WriteFieldsBinary  (const char         *Format,
+                                       va_list             FieldValues);
 
   P3DOutputStringStream               *Target;
+  /* same as Target if it is binary, 0 otherwise */
+  P3DOutputBinaryStream               *BinaryTarget;
  };
 
 class P3DOutputStringStreamFile : public P3DOutputStringStream
@@ -176,5 +322,33 @@ class P3DOutputStringStreamFile : public P3DOutputStringStream
   bool             AutoLn;
  };
 
+class P3D_DLL_ENTRY P3DOutputBinaryStreamFile : public P3DOutputBinaryStream
+ {
+  public           :
+
+                   P3DOutputBinaryStreamFile
+                                      ();
+  virtual         ~P3DOutputBinaryStreamFile
+                                      ();
+
+  /* stream header is written on open */
+  void             Open               (const char         *FileName);
+  void             Close              ();
+
+  virtual void     WriteData          (const void         *Data,
+                                       unsigned_int32        Size);
+
+  private          :
+
+                   P3DOutputBinaryStreamFile
+                                      (const P3DOutputBinaryStreamFile
+                                                          &Source);
+  P3DOutputBinaryStreamFile
+                  &operator =         (const P3DOutputBinaryStreamFile
+                                                          &Source);
+
+  FILE            *Target;
+ };
+
 #endif
 
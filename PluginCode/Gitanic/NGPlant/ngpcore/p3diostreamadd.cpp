@@ -51,12 +51,18 @@
   delete [] Data;
  }
 
-void               P3DInputStringStreamString::ReadString
+/* reads next line from memory block, '\r' characters are skipped, */
+/* too long lines are split to fit into Buffer                     */
+static void        P3DReadStringFromMemory
                                       (char               *Buffer,
-                                       unsigned_int32        BufferSize)
+                                       unsigned_int32        BufferSize,
+                                       const char         *Data,
+                                       unsigned_int32        DataSize,
+                                       unsigned_int32       *Pos)
  {
-  bool                                 Done;
   unsigned_int32                         Index;
+  const char                          *Curr;
+  const char                          *LineEnd;
   char                                 CurrChar;
 
   if (BufferSize < 2)
@@ -64,54 +70,51 @@ void               P3DInputStringStreamString::ReadString
     throw P3DExceptionAssert();
    }
 
-  Done  = false;
-  Index = 0;
+  Index   = 0;
+  Curr    = &Data[*Pos];
+  LineEnd = (const char*)memchr(Curr,'\n',DataSize - *Pos);
 
-  while (!Done)
+  if (LineEnd == NULL)
    {
-    if (Pos >= DataSize)
-     {
-      Buffer[Index] = 0;
-      Done          = true;
-     }
-    else
+    LineEnd = &Data[DataSize];
+   }
+
+  while (Curr < LineEnd)
+   {
+    CurrChar = *Curr++;
+
+    if (CurrChar != '\r')
      {
-      CurrChar = Data[Pos];
-      Pos++;
+      Buffer[Index] = CurrChar;
+
+      Index++;
 
-      switch (CurrChar)
+      if (Index >= BufferSize - 1)
        {
-        case ('\r')  :
-         {
-          /* skip it */
-         } break;
-
-        case ('\n')  :
-         {
-          Buffer[Index] = 0;
-          Done          = true;
-
-          Index++;
-         } break;
-
-        default      :
-         {
-          Buffer[Index] = CurrChar;
-          Index++;
-
-          if (Index < (BufferSize - 1))
-           {
-           }
-          else
-           {
-            Buffer[Index] = 0;
-
-            Done = true;
-           }
-         }
+        /* line will be continued by next call */
+        Buffer[Index] = 0;
+        *Pos          = (unsigned_int32)(Curr - Data);
+
+        return;
        }
      }
    }
+
+  if (LineEnd < &Data[DataSize])
+   {
+    /* skip '\n' */
+    Curr++;
+   }
+
+  Buffer[Index] = 0;
+  *Pos          = (unsigned_int32)(Curr - Data);
+ }
+
+void               P3DInputStringStreamString::ReadString
+                                      (char               *Buffer,
+                                       unsigned_int32        BufferSize)
+ {
+  P3DReadStringFromMemory(Buffer,BufferSize,Data,DataSize,&Pos);
  }
 
 bool               P3DInputStringStreamString::Eof
@@ -120,4 +123,341 @@ bool               P3DInputStringStreamString::Eof
   return(Pos >= DataSize);
  }
 
+                   P3DInputStringStreamView::P3DInputStringStreamView
+                                      (const char         *Data,
+                                       unsigned_int32        DataSize)
+ {
+  this->Data     = Data;
+  this->DataSize = DataSize;
+
+  Pos = 0;
+ }
+
+void               P3DInputStringStreamView::ReadString
+                                      (char               *Buffer,
+                                       unsigned_int32        BufferSize)
+ {
+  P3DReadStringFromMemory(Buffer,BufferSize,Data,DataSize,&Pos);
+ }
+
+bool               P3DInputStringStreamView::Eof
+                                      () const
+ {
+  return(Pos >= DataSize);
+ }
+
+                   P3DInputBinaryStreamView::P3DInputBinaryStreamView
+                                      (const void         *Data,
+                                       unsigned_int32        DataSize)
+ {
+  BufferPos = (const unsigned char*)Data;
+  BufferEnd = BufferPos + DataSize;
+
+  ReadHeader();
+ }
+
+bool               P3DInputBinaryStreamView::FillBuffer
+                                      () const
+ {
+  return(false);
+ }
+
+#define P3D_OUTPUT_MEMORY_MIN_CAPACITY (4096)
+
+                   P3DOutputStringStreamMemory::P3DOutputStringStreamMemory
+                                      ()
+ {
+  Data     = 0;
+  DataSize = 0;
+  Capacity = 0;
+  AutoLn   = true;
+ }
+
+                   P3DOutputStringStreamMemory::~P3DOutputStringStreamMemory
+                                      ()
+ {
+  delete[] Data;
+ }
+
+void               P3DOutputStringStreamMemory::Reserve
+                                      (unsigned_int32        Size)
+ {
+  unsigned_int32                         NewCapacity;
+  char                                *NewData;
+
+  if (Size < Capacity)
+   {
+    return;
+   }
+
+  NewCapacity = Capacity < P3D_OUTPUT_MEMORY_MIN_CAPACITY ? P3D_OUTPUT_MEMORY_MIN_CAPACITY : Capacity;
+
+  while (NewCapacity <= Size)
+   {
+    if (NewCapacity > 0x7FFFFFFFU)
+     {
+      throw P3DExceptionIO();
+     }
+
+    NewCapacity *= 2;
+   }
+
+  NewData = new char[NewCapacity];
+
+  if (DataSize > 0)
+   {
+    memcpy(NewData,Data,DataSize);
+   }
+
+  delete[] Data;
+
+  Data     = NewData;
+  Capacity = NewCapacity;
+ }
+
+void               P3DOutputStringStreamMemory::WriteString
+                                      (const char         *Buffer)
+ {
+  size_t                               Length;
+
+  Length = strlen(Buffer);
+
+  if (Length + 1 >= 0xFFFFFFFFU - DataSize)
+   {
+    throw P3DExceptionIO();
+   }
+
+  /* reserve space for optional '\n' and terminating zero */
+  Reserve(DataSize + (unsigned_int32)Length + 1);
+
+  memcpy(&Data[DataSize],Buffer,Length);
+
+  DataSize += (unsigned_int32)Length;
+
+  if (AutoLn)
+   {
+    Data[DataSize++] = '\n';
+   }
+
+  Data[DataSize] = 0;
+ }
+
+void               P3DOutputStringStreamMemory::AutoLnEnable
+                                      ()
+ {
+  AutoLn = true;
+ }
+
+void               P3DOutputStringStreamMemory::AutoLnDisable
+                                      ()
+ {
+  AutoLn = false;
+ }
+
+const char        *P3DOutputStringStreamMemory::GetData
+                                      () const
+ {
+  return(Data != 0 ? Data : "");
+ }
+
+unsigned_int32       P3DOutputStringStreamMemory::GetDataSize
+                                      () const
+ {
+  return(DataSize);
+ }
+
+void               P3DOutputStringStreamMemory::Clear
+                                      ()
+ {
+  DataSize = 0;
+
+  if (Data != 0)
+   {
+    Data[0] = 0;
+   }
+ }
+
+
+#define P3D_HASH_C1 (0x239B961BU)
+#define P3D_HASH_C2 (0xAB0E9789U)
+#define P3D_HASH_C3 (0x38B34AE5U)
+#define P3D_HASH_C4 (0xA1E38B93U)
+
+static inline unsigned_int32 P3DHashRotL
+                                      (unsigned_int32        Value,
+                                       unsigned_int32        Shift)
+ {
+  return((Value << Shift) | (Value >> (32 - Shift)));
+ }
+
+static inline unsigned_int32 P3DHashFMix
+                                      (unsigned_int32        Value)
+ {
+  Value ^= Value >> 16;
+  Value *= 0x85EBCA6BU;
+  Value ^= Value >> 13;
+  Value *= 0xC2B2AE35U;
+  Value ^= Value >> 16;
+
+  return(Value);
+ }
+
+static inline unsigned_int32 P3DHashGetUInt32
+                                      (const unsigned char*Data)
+ {
+  return(((unsigned_int32)Data[0])        |
+         ((unsigned_int32)Data[1] << 8)   |
+         ((unsigned_int32)Data[2] << 16)  |
+         ((unsigned_int32)Data[3] << 24));
+ }
+
+                   P3DOutputBinaryStreamHash::P3DOutputBinaryStreamHash
+                                      ()
+ {
+  Reset();
+ }
+
+void               P3DOutputBinaryStreamHash::Reset
+                                      ()
+ {
+  State[0] = State[1] = State[2] = State[3] = 0;
+
+  TailSize  = 0;
+  TotalSize = 0;
+ }
+
+void               P3DOutputBinaryStreamHash::MixBlock
+                                      (const unsigned char*Block)
+ {
+  unsigned_int32                         K1,K2,K3,K4;
+  unsigned_int32                         H1,H2,H3,H4;
+
+  K1 = P3DHashGetUInt32(&Block[0]);
+  K2 = P3DHashGetUInt32(&Block[4]);
+  K3 = P3DHashGetUInt32(&Block[8]);
+  K4 = P3DHashGetUInt32(&Block[12]);
+
+  H1 = State[0]; H2 = State[1]; H3 = State[2]; H4 = State[3];
+
+  K1 *= P3D_HASH_C1; K1 = P3DHashRotL(K1,15); K1 *= P3D_HASH_C2; H1 ^= K1;
+
+  H1 = P3DHashRotL(H1,19); H1 += H2; H1 = H1 * 5 + 0x561CCD1BU;
+
+  K2 *= P3D_HASH_C2; K2 = P3DHashRotL(K2,16); K2 *= P3D_HASH_C3; H2 ^= K2;
+
+  H2 = P3DHashRotL(H2,17); H2 += H3; H2 = H2 * 5 + 0x0BCAA747U;
+
+  K3 *= P3D_HASH_C3; K3 = P3DHashRotL(K3,17); K3 *= P3D_HASH_C4; H3 ^= K3;
+
+  H3 = P3DHashRotL(H3,15); H3 += H4; H3 = H3 * 5 + 0x96CD1C35U;
+
+  K4 *= P3D_HASH_C4; K4 = P3DHashRotL(K4,18); K4 *= P3D_HASH_C1; H4 ^= K4;
+
+  H4 = P3DHashRotL(H4,13); H4 += H1; H4 = H4 * 5 + 0x32AC3B17U;
+
+  State[0] = H1; State[1] = H2; State[2] = H3; State[3] = H4;
+ }
+
+void               P3DOutputBinaryStreamHash::WriteData
+                                      (const void         *Data,
+                                       unsigned_int32        Size)
+ {
+  const unsigned char                 *Curr;
+  unsigned_int32                         Count;
+
+  Curr       = (const unsigned char*)Data;
+  TotalSize += Size;
+
+  if (TailSize > 0)
+   {
+    Count = 16 - TailSize;
+
+    if (Count > Size)
+     {
+      Count = Size;
+     }
+
+    memcpy(&Tail[TailSize],Curr,Count);
+
+    TailSize += Count;
+    Curr     += Count;
+    Size     -= Count;
+
+    if (TailSize < 16)
+     {
+      return;
+     }
+
+    MixBlock(Tail);
+
+    TailSize = 0;
+   }
+
+  while (Size >= 16)
+   {
+    MixBlock(Curr);
+
+    Curr += 16;
+    Size -= 16;
+   }
+
+  if (Size > 0)
+   {
+    memcpy(Tail,Curr,Size);
+
+    TailSize = Size;
+   }
+ }
+
+void               P3DOutputBinaryStreamHash::GetHash
+                                      (unsigned_int32       *Hash) const
+ {
+  unsigned_int32                         H1,H2,H3,H4;
+  unsigned_int32                         K[4];
+  unsigned_int32                         Index;
+
+  H1 = State[0]; H2 = State[1]; H3 = State[2]; H4 = State[3];
+
+  /* tail bytes are mixed in as zero-padded little-endian words */
+  K[0] = K[1] = K[2] = K[3] = 0;
+
+  for (Index = 0; Index < TailSize; Index++)
+   {
+    K[Index >> 2] |= ((unsigned_int32)Tail[Index]) << ((Index & 3) * 8);
+   }
+
+  if (TailSize > 12)
+   {
+    K[3] *= P3D_HASH_C4; K[3] = P3DHashRotL(K[3],18); K[3] *= P3D_HASH_C1; H4 ^= K[3];
+   }
+
+  if (TailSize > 8)
+   {
+    K[2] *= P3D_HASH_C3; K[2] = P3DHashRotL(K[2],17); K[2] *= P3D_HASH_C4; H3 ^= K[2];
+   }
+
+  if (TailSize > 4)
+   {
+    K[1] *= P3D_HASH_C2; K[1] = P3DHashRotL(K[1],16); K[1] *= P3D_HASH_C3; H2 ^= K[1];
+   }
+
+  if (TailSize > 0)
+   {
+    K[0] *= P3D_HASH_C1; K[0] = P3DHashRotL(K[0],15); K[0] *= P3D_HASH_C2; H1 ^= K[0];
+   }
+
+  H1 ^= TotalSize; H2 ^= TotalSize; H3 ^= TotalSize; H4 ^= TotalSize;
+
+  H1 += H2; H1 += H3; H1 += H4;
+  H2 += H1; H3 += H1; H4 += H1;
 
+  H1 = P3DHashFMix(H1);
+  H2 = P3DHashFMix(H2);
+  H3 = P3DHashFMix(H3);
+  H4 = P3DHashFMix(H4);
+
+  H1 += H2; H1 += H3; H1 += H4;
+  H2 += H1; H3 += H1; H4 += H1;
+
+  Hash[0] = H1; Hash[1] = H2; Hash[2] = H3; Hash[3] = H4;
+ }
@@ -56,5 +56,114 @@ class P3DInputStringStreamString : public P3DInputStringStream
   unsigned_int32     Pos;
  };
 
+/* Reads strings from memory block owned by caller (for example, part */
+/* of memory-mapped file). Data is not copied, so it must stay valid  */
+/* while stream is used.                                              */
+class P3DInputStringStreamView : public P3DInputStringStream
+ {
+  public           :
+
+                   P3DInputStringStreamView
+                                      (const char         *Data,
+                                       unsigned_int32        DataSize);
+
+  virtual
+  void             ReadString         (char               *Buffer,
+                                       unsigned_int32        BufferSize);
+
+  virtual bool     Eof                () const;
+
+  private          :
+
+  const char      *Data;
+  unsigned_int32     DataSize;
+  unsigned_int32     Pos;
+ };
+
+/* Binary counterpart of P3DInputStringStreamView, Data must start */
+/* with binary stream header                                       */
+class P3DInputBinaryStreamView : public P3DInputBinaryStream
+ {
+  public           :
+
+                   P3DInputBinaryStreamView
+                                      (const void         *Data,
+                                       unsigned_int32        DataSize);
+
+  protected        :
+
+  /* whole data is buffered already */
+  virtual bool     FillBuffer         () const;
+ };
+
+/* Writes strings to growable memory buffer. Buffer contents are always */
+/* zero-terminated.                                                     */
+class P3DOutputStringStreamMemory : public P3DOutputStringStream
+ {
+  public           :
+
+                   P3DOutputStringStreamMemory
+                                      ();
+  virtual         ~P3DOutputStringStreamMemory
+                                      ();
+
+  virtual void     WriteString        (const char         *Buffer);
+  virtual void     AutoLnEnable       ();
+  virtual void     AutoLnDisable      ();
+
+  const char      *GetData            () const;
+  /* size of written data, without terminating zero */
+  unsigned_int32     GetDataSize        () const;
+
+  void             Clear              ();
+
+  private          :
+
+                   P3DOutputStringStreamMemory
+                                      (const P3DOutputStringStreamMemory
+                                                          &Source);
+  P3DOutputStringStreamMemory
+                  &operator =         (const P3DOutputStringStreamMemory
+                                                          &Source);
+
+  void             Reserve            (unsigned_int32        Size);
+
+  char            *Data;
+  unsigned_int32     DataSize;
+  unsigned_int32     Capacity;
+  bool             AutoLn;
+ };
+
+#define P3D_STREAM_HASH_SIZE (4)
+
+/* Calculates 128-bit hash (MurmurHash3, x86 variant) of binary data */
+/* written to it instead of storing it. Since binary records do not  */
+/* depend on text formatting, hash of saved model identifies model   */
+/* contents.                                                         */
+class P3DOutputBinaryStreamHash : public P3DOutputBinaryStream
+ {
+  public           :
+
+                   P3DOutputBinaryStreamHash
+                                      ();
+
+  virtual void     WriteData          (const void         *Data,
+                                       unsigned_int32        Size);
+
+  /* Hash must have room for P3D_STREAM_HASH_SIZE items */
+  void             GetHash            (unsigned_int32       *Hash) const;
+
+  void             Reset              ();
+
+  private          :
+
+  void             MixBlock           (const unsigned char*Block);
+
+  unsigned_int32                         State[P3D_STREAM_HASH_SIZE];
+  unsigned char                        Tail[16];
+  unsigned_int32                         TailSize;
+  unsigned_int32                         TotalSize;
+ };
+
 #endif
 
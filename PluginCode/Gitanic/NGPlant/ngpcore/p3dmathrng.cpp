@@ -35,6 +35,14 @@
 
 #define P3DMathRNGSimpleMax (0xFFFFFFFFU)
 
+/* UniformUnits generates LCG sequence in several independent lanes,  */
+/* every lane advances by lane count steps at once:                   */
+/* X(n + 4) = A4 * X(n) + C4 (mod 2^32), where A4 = A^4 and           */
+/* C4 = C * (A^3 + A^2 + A + 1)                                       */
+#define P3DMathRNGSimpleLanes (4)
+#define P3DMathRNGSimpleA4    (0x0979E791U)
+#define P3DMathRNGSimpleC4    (0xAAF95334U)
+
                    P3DMathRNGSimple::P3DMathRNGSimple
                                       (unsigned_int32        Seed)
  {
@@ -62,7 +70,66 @@ float              P3DMathRNGSimple::UniformFloat
                                       (float               Min,
                                        float               Max)
  {
-  return(Min + Rand() / (P3DMathRNGSimpleMax + 1.0) * (Max - Min));
+  return(UnitToFloat(Rand() / (P3DMathRNGSimpleMax + 1.0),Min,Max));
+ }
+
+void               P3DMathRNGSimple::UniformUnits
+                                      (double             *Values,
+                                       unsigned_int32        Count)
+ {
+  unsigned_int32                         Index;
+
+  Index = 0;
+
+  if (Count >= P3DMathRNGSimpleLanes)
+   {
+    unsigned_int32                       Lanes[P3DMathRNGSimpleLanes];
+    unsigned_int32                       Lane;
+
+    for (Lane = 0; Lane < P3DMathRNGSimpleLanes; Lane++)
+     {
+      Lanes[Lane] = Rand();
+     }
+
+    while (true)
+     {
+      for (Lane = 0; Lane < P3DMathRNGSimpleLanes; Lane++)
+       {
+        Values[Index + Lane] = Lanes[Lane] / (P3DMathRNGSimpleMax + 1.0);
+       }
+
+      Index += P3DMathRNGSimpleLanes;
+
+      if (Count - Index < P3DMathRNGSimpleLanes)
+       {
+        break;
+       }
+
+      for (Lane = 0; Lane < P3DMathRNGSimpleLanes; Lane++)
+       {
+        Lanes[Lane] = P3DMathRNGSimpleA4 * Lanes[Lane] + P3DMathRNGSimpleC4;
+       }
+     }
+
+    Seed = Lanes[P3DMathRNGSimpleLanes - 1];
+   }
+
+  for (; Index < Count; Index++)
+   {
+    Values[Index] = Rand() / (P3DMathRNGSimpleMax + 1.0);
+   }
+ }
+
+unsigned_int32       P3DMathRNGSimple::GetState
+                                      () const
+ {
+  return(Seed);
+ }
+
+void               P3DMathRNGSimple::SetState
+                                      (unsigned_int32        State)
+ {
+  Seed = State;
  }
 
 unsigned_int32       P3DMathRNGSimple::Rand
@@ -73,3 +140,87 @@ unsigned_int32       P3DMathRNGSimple::Rand
   return(Seed);
  }
 
+
+/* 32-bit finalizer of MurmurHash3 (also used by SplitMix generators) */
+static unsigned_int32 P3DMathRNGCounterMix
+                                      (unsigned_int32        Value)
+ {
+  Value ^= Value >> 16;
+  Value *= 0x85EBCA6BU;
+  Value ^= Value >> 13;
+  Value *= 0xC2B2AE35U;
+  Value ^= Value >> 16;
+
+  return(Value);
+ }
+
+                   P3DMathRNGCounter::P3DMathRNGCounter
+                                      (unsigned_int32        Seed)
+ {
+  SetSeed(Seed);
+ }
+
+void               P3DMathRNGCounter::SetSeed
+                                      (unsigned_int32        Seed)
+ {
+  Key0    = P3DMathRNGCounterMix(Seed ^ 0x243F6A88U);
+  Key1    = P3DMathRNGCounterMix(Seed + 0x9E3779B9U);
+  Counter = 0;
+ }
+
+int                P3DMathRNGCounter::RandomInt
+                                      (int                 Min,
+                                       int                 Max)
+ {
+  return(Min + int((Max - Min + 1.0) * Rand() / (P3DMathRNGSimpleMax + 1.0)));
+ }
+
+float              P3DMathRNGCounter::UniformFloat
+                                      (float               Min,
+                                       float               Max)
+ {
+  return(UnitToFloat(Rand() / (P3DMathRNGSimpleMax + 1.0),Min,Max));
+ }
+
+/* values do not depend on each other, so loop is easily vectorized */
+void               P3DMathRNGCounter::UniformUnits
+                                      (double             *Values,
+                                       unsigned_int32        Count)
+ {
+  for (unsigned_int32 Index = 0; Index < Count; Index++)
+   {
+    unsigned_int32                       Value;
+
+    Value = P3DMathRNGCounterMix((Counter + Index) ^ Key0);
+    Value = P3DMathRNGCounterMix(Value + Key1);
+
+    Values[Index] = Value / (P3DMathRNGSimpleMax + 1.0);
+   }
+
+  Counter += Count;
+ }
+
+unsigned_int32       P3DMathRNGCounter::GetCounter
+                                      () const
+ {
+  return(Counter);
+ }
+
+void               P3DMathRNGCounter::SetCounter
+                                      (unsigned_int32        Counter)
+ {
+  this->Counter = Counter;
+ }
+
+/* two keyed mixing rounds - each of them is a bijection of 32-bit */
+/* values, so stream does not repeat within 2^32 numbers           */
+unsigned_int32       P3DMathRNGCounter::Rand
+                                      ()
+ {
+  unsigned_int32                         Value;
+
+  Value = P3DMathRNGCounterMix(Counter++ ^ Key0);
+
+  return(P3DMathRNGCounterMix(Value + Key1));
+ }
+
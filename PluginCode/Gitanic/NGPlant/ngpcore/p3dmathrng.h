@@ -46,6 +46,20 @@ class P3DMathRNG
 
   virtual float    UniformFloat       (float               Min,
                                        float               Max) = 0;
+
+  /* Fills Values with next Count numbers of stream, uniformly distributed */
+  /* in [0,1). UnitToFloat(Values[i],Min,Max) is exactly the same value    */
+  /* which UniformFloat(Min,Max) would return at the same stream position, */
+  /* so draws with different ranges may be fetched in single call.         */
+  virtual void     UniformUnits       (double             *Values,
+                                       unsigned_int32        Count) = 0;
+
+  static float     UnitToFloat        (double              Unit,
+                                       float               Min,
+                                       float               Max)
+   {
+    return(Min + Unit * (Max - Min));
+   }
  };
 
 /*FIXME: find more definite name for it*/
@@ -63,6 +77,14 @@ class P3DMathRNGSimple : public P3DMathRNG
   virtual float    UniformFloat       (float               Min,
                                        float               Max);
 
+  virtual void     UniformUnits       (double             *Values,
+                                       unsigned_int32        Count);
+
+  /* current position in sequence, so it may be restored later */
+  /* (unlike SetSeed, SetState does not advance the sequence)  */
+  unsigned_int32     GetState           () const;
+  void             SetState           (unsigned_int32        State);
+
   private          :
 
   unsigned_int32     Rand               ();
@@ -70,5 +92,40 @@ class P3DMathRNGSimple : public P3DMathRNG
   unsigned_int32     Seed;
  };
 
+/* Counter-based generator: N-th number of stream is computed directly */
+/* from stream key and N, so any stream position may be restored and   */
+/* streams with different seeds do not overlap (unlike LCG streams,    */
+/* which are parts of one common sequence).                            */
+class P3DMathRNGCounter : public P3DMathRNG
+ {
+  public           :
+
+                   P3DMathRNGCounter  (unsigned_int32        Seed);
+
+  /* resets counter to 0 */
+  virtual void     SetSeed            (unsigned_int32        Seed);
+
+  virtual int      RandomInt          (int                 Min,
+                                       int                 Max);
+
+  virtual float    UniformFloat       (float               Min,
+                                       float               Max);
+
+  virtual void     UniformUnits       (double             *Values,
+                                       unsigned_int32        Count);
+
+  /* number of values generated since SetSeed */
+  unsigned_int32     GetCounter         () const;
+  void             SetCounter         (unsigned_int32        Counter);
+
+  private          :
+
+  unsigned_int32     Rand               ();
+
+  unsigned_int32     Key0;
+  unsigned_int32     Key1;
+  unsigned_int32     Counter;
+ };
+
 #endif
 
@@ -79,6 +79,9 @@ void               P3DMathNaturalCubicSpline::CopyFrom
     cp_x[i]  = src.cp_x[i];
     cp_y[i]  = src.cp_y[i];
     cp_y2[i] = src.cp_y2[i];
+
+    seg_c1[i] = src.seg_c1[i];
+    seg_c3[i] = src.seg_c3[i];
    }
  }
 
@@ -134,15 +137,20 @@ float              P3DMathNaturalCubicSpline::GetValue
      {
       return(cp_y[cp_count - 1]);
      }
+    else if (cp_x[base] == x)
+     {
+      /* polynomial is expanded around left point of segment, so */
+      /* right point is returned as is to keep it exact          */
+      return(cp_y[base]);
+     }
 
-    float h,a,b;
+    float t;
 
-    h = cp_x[base] - cp_x[base - 1];
-    a = (cp_x[base] - x) / h;
-    b = (x - cp_x[base - 1]) / h;
+    base--;
 
-    return(a * cp_y[base - 1] + b * cp_y[base] +
-           ((a * a * a - a) * cp_y2[base - 1] + (b * b * b - b) * cp_y2[base]) * h * h / 6.0f);
+    t = x - cp_x[base];
+
+    return(cp_y[base] + t * (seg_c1[base] + t * (0.5f * cp_y2[base] + t * seg_c3[base])));
    }
  }
 
@@ -177,15 +185,13 @@ float              P3DMathNaturalCubicSpline::GetTangent
       base = cp_count - 1;
      }
 
-    float h,a,b;
+    float t;
+
+    base--;
 
-    h = cp_x[base] - cp_x[base - 1];
-    a = (cp_x[base] - x) / h;
-    b = (x - cp_x[base - 1]) / h;
+    t = x - cp_x[base];
 
-    return((cp_y[base] - cp_y[base - 1]) / h -
-           ((((3.0f * a * a) - 1.0f) * h * cp_y2[base - 1]) / 6.0f) +
-           ((((3.0f * b * b) - 1.0f) * h * cp_y2[base]) / 6.0f));
+    return(seg_c1[base] + t * (cp_y2[base] + t * 3.0f * seg_c3[base]));
    }
  }
 
@@ -234,35 +240,63 @@ void               P3DMathNaturalCubicSpline::RecalcY2
    {
     cp_y2[k] = cp_y2[k] * cp_y2[k + 1] + u[k];
    }
+
+  RecalcCoeffs();
  }
 
-void               P3DMathNaturalCubicSpline::AddCP
+void               P3DMathNaturalCubicSpline::RecalcCoeffs
+                                                ()
+ {
+  float                                          h;
+
+  for (unsigned_int32 i = 0; (i + 1) < cp_count; i++)
+   {
+    h = cp_x[i + 1] - cp_x[i];
+
+    seg_c1[i] = (cp_y[i + 1] - cp_y[i]) / h - h * (2.0f * cp_y2[i] + cp_y2[i + 1]) / 6.0f;
+    seg_c3[i] = (cp_y2[i + 1] - cp_y2[i]) / (6.0f * h);
+   }
+ }
+
+bool               P3DMathNaturalCubicSpline::InsertCP
                                                 (float               x,
                                                  float               y)
  {
   unsigned_int32                                   cp;
 
-  if (cp_count < P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT)
+  if (cp_count >= P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT)
    {
-    cp = 0;
+    return(false);
+   }
 
-    while ((cp < cp_count) && (cp_x[cp] < x))
-     {
-      cp++;
-     }
+  cp = 0;
 
-    if (cp < cp_count)
+  while ((cp < cp_count) && (cp_x[cp] < x))
+   {
+    cp++;
+   }
+
+  if (cp < cp_count)
+   {
+    for (int i = cp_count; i > ((int)cp); i--)
      {
-      for (int i = cp_count; i > ((int)cp); i--)
-       {
-        cp_x[i] = cp_x[i - 1]; cp_y[i] = cp_y[i - 1];
-       }
+      cp_x[i] = cp_x[i - 1]; cp_y[i] = cp_y[i - 1];
      }
+   }
 
-    cp_x[cp] = x; cp_y[cp] = y;
+  cp_x[cp] = x; cp_y[cp] = y;
+
+  cp_count++;
 
-    cp_count++;
+  return(true);
+ }
 
+void               P3DMathNaturalCubicSpline::AddCP
+                                                (float               x,
+                                                 float               y)
+ {
+  if (InsertCP(x,y))
+   {
     if (cp_count > 1)
      {
       RecalcY2();
@@ -275,6 +309,29 @@ void               P3DMathNaturalCubicSpline::AddCP
    }
  }
 
+void               P3DMathNaturalCubicSpline::SetCPs
+                                                (unsigned_int32        count,
+                                                 const float        *x,
+                                                 const float        *y)
+ {
+  cp_count = 0;
+
+  for (unsigned_int32 i = 0; i < count; i++)
+   {
+    InsertCP(x[i],y[i]);
+   }
+
+  if      (cp_count > 1)
+   {
+    RecalcY2();
+   }
+  else if (cp_count == 1)
+   {
+    cp_y2[0] = 0.0f;
+    cp_y2[1] = 0.0f;
+   }
+ }
+
 void               P3DMathNaturalCubicSpline::DelCP
                                                 (unsigned_int32        cp)
  {
@@ -331,5 +388,7 @@ void               P3DMathNaturalCubicSpline::SetLinear
 
   cp_y2[0] = 0.0f;
   cp_y2[1] = 0.0f;
+
+  RecalcCoeffs();
  }
 
@@ -63,6 +63,11 @@ class P3DMathNaturalCubicSpline
 
   void             DelCP                        (unsigned_int32        cp);
 
+  /* replaces all control points, coefficients are recalculated once */
+  void             SetCPs                       (unsigned_int32        count,
+                                                 const float        *x,
+                                                 const float        *y);
+
   void             SetConstant                  (float               value);
   void             SetLinear                    (float               ax,
                                                  float               ay,
@@ -74,13 +79,23 @@ class P3DMathNaturalCubicSpline
 
   private          :
 
+  /* returns false if there is no room for new control point */
+  bool             InsertCP                     (float               x,
+                                                 float               y);
   void             RecalcY2                     ();
+  void             RecalcCoeffs                 ();
 
 
   unsigned_int32     cp_count;
   float            cp_x[P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT];
   float            cp_y[P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT];
   float            cp_y2[P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT];
+
+  /* Segment between control points i and i + 1 is cached as polynomial */
+  /* y = cp_y[i] + c1 * t + (cp_y2[i] / 2) * t^2 + c3 * t^3, where      */
+  /* t = x - cp_x[i], so evaluation needs no divisions                  */
+  float            seg_c1[P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT];
+  float            seg_c3[P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT];
  };
 
 #endif
@@ -0,0 +1,329 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#include <stddef.h>
+
+#include <ngpcore/p3dexcept.h>
+#include <ngpcore/p3dmemarena.h>
+
+class P3DMemoryArenaBlock
+ {
+  public           :
+
+  P3DMemoryArenaBlock                 *Next;
+  /* heap memory of block, 0 for external buffer */
+  unsigned char                       *Memory;
+  unsigned char                       *Data;
+  unsigned_int32                         Size;
+  unsigned_int32                         Used;
+ };
+
+static unsigned_int32 AlignSize        (unsigned_int32        Size)
+ {
+  return((Size + P3DMemoryArenaAlignment - 1) & ~(P3DMemoryArenaAlignment - 1));
+ }
+
+static unsigned char *AlignPointer     (unsigned char      *Pointer)
+ {
+  return(Pointer + ((P3DMemoryArenaAlignment - ((size_t)Pointer % P3DMemoryArenaAlignment)) % P3DMemoryArenaAlignment));
+ }
+
+/* block header is placed at the start of block memory */
+static P3DMemoryArenaBlock
+                  *InitBlock          (unsigned char      *Memory,
+                                       unsigned_int32        MemorySize,
+                                       bool                Owned)
+ {
+  P3DMemoryArenaBlock                 *Block;
+  unsigned char                       *Start;
+
+  Start = AlignPointer(Memory);
+
+  if ((unsigned_int32)(Start - Memory) + AlignSize(sizeof(P3DMemoryArenaBlock)) >= MemorySize)
+   {
+    return(0);
+   }
+
+  Block = (P3DMemoryArenaBlock*)Start;
+
+  Block->Next   = 0;
+  Block->Memory = Owned ? Memory : 0;
+  Block->Data   = Start + AlignSize(sizeof(P3DMemoryArenaBlock));
+  Block->Size   = MemorySize - (unsigned_int32)(Block->Data - Memory);
+  Block->Used   = 0;
+
+  return(Block);
+ }
+
+                   P3DMemoryArena::P3DMemoryArena
+                                      (unsigned_int32        BlockSize)
+ {
+  this->BlockSize = BlockSize;
+
+  First   = 0;
+  Current = 0;
+ }
+
+                   P3DMemoryArena::P3DMemoryArena
+                                      (void               *Buffer,
+                                       unsigned_int32        BufferSize,
+                                       unsigned_int32        BlockSize)
+ {
+  this->BlockSize = BlockSize;
+
+  First   = InitBlock((unsigned char*)Buffer,BufferSize,false);
+  Current = First;
+ }
+
+                   P3DMemoryArena::~P3DMemoryArena
+                                      ()
+ {
+  FreeBlocks();
+ }
+
+P3DMemoryArenaBlock
+                  *P3DMemoryArena::CreateBlock
+                                      (unsigned_int32        Size)
+ {
+  unsigned_int32                         MemorySize;
+
+  MemorySize = Size + AlignSize(sizeof(P3DMemoryArenaBlock)) + P3DMemoryArenaAlignment;
+
+  return(InitBlock(new unsigned char[MemorySize],MemorySize,true));
+ }
+
+void               P3DMemoryArena::FreeBlocks
+                                      ()
+ {
+  P3DMemoryArenaBlock                 *Block;
+  P3DMemoryArenaBlock                 *Next;
+  P3DMemoryArenaBlock                 *External;
+
+  External = 0;
+
+  for (Block = First; Block != 0; Block = Next)
+   {
+    Next = Block->Next;
+
+    if (Block->Memory != 0)
+     {
+      delete[] Block->Memory;
+     }
+    else
+     {
+      External = Block;
+     }
+   }
+
+  if (External != 0)
+   {
+    External->Next = 0;
+    External->Used = 0;
+   }
+
+  First   = External;
+  Current = External;
+ }
+
+void              *P3DMemoryArena::Allocate
+                                      (unsigned_int32        Size)
+ {
+  void                                *Result;
+  P3DMemoryArenaBlock                 *Block;
+
+  Size = AlignSize(Size);
+
+  while (Current != 0)
+   {
+    if (Current->Size - Current->Used >= Size)
+     {
+      Result         = Current->Data + Current->Used;
+      Current->Used += Size;
+
+      return(Result);
+     }
+
+    if (Current->Next == 0)
+     {
+      break;
+     }
+
+    Current       = Current->Next;
+    Current->Used = 0;
+   }
+
+  Block = CreateBlock(Size > BlockSize ? Size : BlockSize);
+
+  if (Current != 0)
+   {
+    Current->Next = Block;
+   }
+  else
+   {
+    First = Block;
+   }
+
+  Current = Block;
+
+  Result        = Current->Data;
+  Current->Used = Size;
+
+  return(Result);
+ }
+
+P3DMemoryArenaMark P3DMemoryArena::GetMark
+                                      () const
+ {
+  P3DMemoryArenaMark                   Mark;
+
+  Mark.Block = Current;
+  Mark.Used  = Current != 0 ? Current->Used : 0;
+
+  return(Mark);
+ }
+
+void               P3DMemoryArena::Rewind
+                                      (const P3DMemoryArenaMark
+                                                          &Mark)
+ {
+  if (Mark.Block != 0)
+   {
+    Current       = Mark.Block;
+    Current->Used = Mark.Used;
+   }
+  else
+   {
+    Current = First;
+
+    if (Current != 0)
+     {
+      Current->Used = 0;
+     }
+   }
+ }
+
+void               P3DMemoryArena::Reset
+                                      ()
+ {
+  P3DMemoryArenaBlock                 *Block;
+  unsigned_int32                         HeapBlockCount;
+  unsigned_int32                         HeapSize;
+
+  HeapBlockCount = 0;
+  HeapSize       = 0;
+
+  for (Block = First; Block != 0; Block = Block->Next)
+   {
+    if (Block->Memory != 0)
+     {
+      HeapBlockCount++;
+      HeapSize += Block->Size;
+     }
+   }
+
+  if (HeapBlockCount > 1)
+   {
+    /* new block is created first, so arena is left unchanged */
+    /* if it can not be allocated                             */
+    Block = CreateBlock(HeapSize);
+
+    FreeBlocks();
+
+    if (First != 0)
+     {
+      First->Next = Block;
+     }
+    else
+     {
+      First = Block;
+     }
+   }
+
+  Current = First;
+
+  if (Current != 0)
+   {
+    Current->Used = 0;
+   }
+ }
+
+void               P3DMemoryArena::Adopt
+                                      (P3DMemoryArena     *Source)
+ {
+  P3DMemoryArenaBlock                 *Last;
+
+  if (Source->First == 0)
+   {
+    return;
+   }
+
+  for (Last = Source->First; Last->Next != 0; Last = Last->Next)
+   {
+    if (Last->Memory == 0)
+     {
+      throw P3DExceptionGeneric("unable to adopt arena with external buffer");
+     }
+   }
+
+  if (Last->Memory == 0)
+   {
+    throw P3DExceptionGeneric("unable to adopt arena with external buffer");
+   }
+
+  /* adopted blocks are placed before current one, so they */
+  /* will not be reused until arena is reset               */
+  Last->Next = First;
+  First      = Source->First;
+
+  if (Current == 0)
+   {
+    Current = Last;
+   }
+
+  Source->First   = 0;
+  Source->Current = 0;
+ }
+
+
+bool               P3DMemoryArena::Contains
+                                      (const void         *Pointer) const
+ {
+  for (P3DMemoryArenaBlock *Block = First; Block != 0; Block = Block->Next)
+   {
+    if (((const unsigned char*)Pointer >= Block->Data) &&
+        ((const unsigned char*)Pointer <  Block->Data + Block->Size))
+     {
+      return(true);
+     }
+   }
+
+  return(false);
+ }
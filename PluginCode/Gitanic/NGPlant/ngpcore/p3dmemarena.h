@@ -0,0 +1,106 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#ifndef __P3DMEMARENA_H__
+#define __P3DMEMARENA_H__
+
+#include <ngpcore/p3ddefs.h>
+
+#define P3DMemoryArenaAlignment        (16)
+#define P3DMemoryArenaDefaultBlockSize (64 * 1024)
+
+class P3DMemoryArenaBlock;
+
+/* position in arena, returned by GetMark */
+class P3DMemoryArenaMark
+ {
+  public           :
+
+  P3DMemoryArenaBlock                 *Block;
+  unsigned_int32                         Used;
+ };
+
+/* Bump allocator. Memory is never freed separately, instead arena may be */
+/* rewound to previously taken mark or reset completely. Blocks are kept  */
+/* between resets, so arena which is reused for similar work does not     */
+/* allocate heap memory after first use. Objects placed into arena must   */
+/* be destroyed explicitly before arena is rewound or reset.              */
+class P3D_DLL_ENTRY P3DMemoryArena
+ {
+  public           :
+
+                   P3DMemoryArena     (unsigned_int32        BlockSize = P3DMemoryArenaDefaultBlockSize);
+  /* Buffer is used before any heap memory is allocated. Arena does not */
+  /* own it, so buffer must be alive until arena is destroyed           */
+                   P3DMemoryArena     (void               *Buffer,
+                                       unsigned_int32        BufferSize,
+                                       unsigned_int32        BlockSize = P3DMemoryArenaDefaultBlockSize);
+                  ~P3DMemoryArena     ();
+
+  /* returned memory is aligned to P3DMemoryArenaAlignment */
+  void            *Allocate           (unsigned_int32        Size);
+
+  P3DMemoryArenaMark
+                   GetMark            () const;
+  /* release all memory allocated after Mark was taken */
+  void             Rewind             (const P3DMemoryArenaMark
+                                                          &Mark);
+  /* release all memory. If more than one heap block was used, */
+  /* they are replaced by single block of the same total size  */
+  void             Reset              ();
+  /* release all memory and free heap blocks, external buffer is kept */
+  void             FreeBlocks         ();
+
+  /* move all blocks from Source to this arena. Memory allocated from */
+  /* Source stays valid until this arena is reset or destroyed.       */
+  /* Source must not use external buffer.                             */
+  void             Adopt              (P3DMemoryArena     *Source);
+
+  /* true if Pointer points into any block of arena */
+  bool             Contains           (const void         *Pointer) const;
+
+  private          :
+
+                   P3DMemoryArena     (const P3DMemoryArena
+                                                          &Source);
+  P3DMemoryArena  &operator =         (const P3DMemoryArena
+                                                          &Source);
+
+  P3DMemoryArenaBlock
+                  *CreateBlock        (unsigned_int32        Size);
+
+  P3DMemoryArenaBlock                 *First;
+  P3DMemoryArenaBlock                 *Current;
+  unsigned_int32                         BlockSize;
+ };
+
+#endif
+
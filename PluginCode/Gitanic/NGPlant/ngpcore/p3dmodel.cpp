@@ -36,6 +36,7 @@
 #include <ngpcore/p3dcompat.h> /* for snprintf definition in MSVC environment */
 #include <ngpcore/p3dexcept.h>
 #include <ngpcore/p3diostream.h>
+#include <ngpcore/p3diostreamadd.h>
 #include <ngpcore/p3dplant.h>
 
 /* I need these includes for load functionality, if I'll use factories for */
@@ -511,6 +512,44 @@ void               P3DMaterialDef::SetAlphaFadeOut
   AlphaFadeOut = P3DMath::Clampf(0.0f,1.0f,FadeOut);
  }
 
+void               P3DStemModelInstance::GetVAttrValues
+                                      (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const
+ {
+  unsigned char                       *Dest;
+
+  Dest = (unsigned char*)Buffer;
+
+  for (unsigned_int32 Index = FirstIndex; Index < FirstIndex + Count; Index++)
+   {
+    GetVAttrValue((float*)Dest,Attr,Index);
+
+    Dest += Stride;
+   }
+ }
+
+void               P3DStemModelInstance::GetVAttrValuesI
+                                      (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const
+ {
+  unsigned char                       *Dest;
+
+  Dest = (unsigned char*)Buffer;
+
+  for (unsigned_int32 Index = FirstIndex; Index < FirstIndex + Count; Index++)
+   {
+    GetVAttrValueI((float*)Dest,Attr,Index);
+
+    Dest += Stride;
+   }
+ }
+
 void               P3DStemModelInstance::GetBoundBox
                                       (float              *Min,
                                        float              *Max) const
@@ -551,6 +590,120 @@ void               P3DStemModelInstance::GetBoundBox
    }
  }
 
+                   P3DStemModel::P3DStemModel
+                                      ()
+ {
+  Revision         = 0;
+  FingerprintValid = false;
+ }
+
+unsigned_int32       P3DStemModel::GetRevision
+                                      () const
+ {
+  return(Revision);
+ }
+
+void               P3DStemModel::Touch
+                                      ()
+ {
+  Revision++;
+
+  FingerprintValid = false;
+ }
+
+void               P3DStemModel::GetFingerprint
+                                      (unsigned_int32       *Fingerprint) const
+ {
+  if (!FingerprintValid)
+   {
+    P3DOutputBinaryStreamHash          HashStream;
+
+    Save(&HashStream);
+
+    HashStream.GetHash(FingerprintCache);
+
+    FingerprintValid = true;
+   }
+
+  memcpy(Fingerprint,FingerprintCache,sizeof(FingerprintCache));
+ }
+
+P3DStemModelInstance
+                  *P3DStemModel::CreateArenaInstance
+                                      (P3DMemoryArena     *Arena P3D_UNUSED_ATTR,
+                                       P3DMathRNG         *rng,
+                                       const P3DStemModelInstance
+                                                          *parent,
+                                       float               offset,
+                                       const P3DQuaternionf
+                                                          *orientation) const
+ {
+  return(CreateInstance(rng,parent,offset,orientation));
+ }
+
+void               P3DStemModel::ReleaseArenaInstance
+                                      (P3DStemModelInstance
+                                                          *instance) const
+ {
+  ReleaseInstance(instance);
+ }
+
+                   P3DBranchingAlg::P3DBranchingAlg
+                                      ()
+ {
+  Revision         = 0;
+  FingerprintValid = false;
+ }
+
+unsigned_int32       P3DBranchingAlg::GetRevision
+                                      () const
+ {
+  return(Revision);
+ }
+
+void               P3DBranchingAlg::Touch
+                                      ()
+ {
+  Revision++;
+
+  FingerprintValid = false;
+ }
+
+void               P3DBranchingAlg::GetFingerprint
+                                      (unsigned_int32       *Fingerprint) const
+ {
+  if (!FingerprintValid)
+   {
+    P3DOutputBinaryStreamHash          HashStream;
+
+    Save(&HashStream);
+
+    HashStream.GetHash(FingerprintCache);
+
+    FingerprintValid = true;
+   }
+
+  memcpy(Fingerprint,FingerprintCache,sizeof(FingerprintCache));
+ }
+
+bool               P3DBranchingAlg::BeginBranches
+                                      (P3DBranchingCursor           *Cursor P3D_UNUSED_ATTR,
+                                       const P3DStemModelInstance   *Parent P3D_UNUSED_ATTR,
+                                       P3DMathRNG                   *RNG P3D_UNUSED_ATTR) const
+ {
+  return(false);
+ }
+
+bool               P3DBranchingAlg::NextBranch
+                                      (P3DBranchingCursor           *Cursor P3D_UNUSED_ATTR,
+                                       float                        *Offset P3D_UNUSED_ATTR,
+                                       P3DQuaternionf               *Orientation P3D_UNUSED_ATTR,
+                                       const P3DStemModelInstance   *Parent P3D_UNUSED_ATTR,
+                                       P3DMathRNG                   *RNG P3D_UNUSED_ATTR) const
+ {
+  return(false);
+ }
+
                    P3DBranchModel::P3DBranchModel
                                       ()
  {
@@ -559,6 +712,7 @@ void               P3DStemModelInstance::GetBoundBox
   MaterialInstance = 0;
   SubBranchCount   = 0;
   Name             = 0;
+  Revision         = 0;
  }
 
                    P3DBranchModel::~P3DBranchModel
@@ -632,6 +786,8 @@ void               P3DBranchModel::SetStemModel
    }
 
   this->StemModel = StemModel;
+
+  Revision++;
  }
 
 P3DBranchingAlg   *P3DBranchModel::GetBranchingAlg
@@ -656,6 +812,8 @@ void               P3DBranchModel::SetBranchingAlg
    }
 
   this->BranchingAlg = BranchingAlg;
+
+  Revision++;
  }
 
 P3DMaterialInstance
@@ -735,6 +893,7 @@ void               P3DBranchModel::AppendSubBranch
     SubBranches[SubBranchCount] = SubBranchModel;
 
     SubBranchCount++;
+    Revision++;
    }
   else
    {
@@ -762,6 +921,7 @@ void               P3DBranchModel::InsertSubBranch
       SubBranches[SubBranchIndex] = SubBranchModel;
 
       SubBranchCount++;
+      Revision++;
      }
     else
      {
@@ -783,6 +943,7 @@ void               P3DBranchModel::RemoveSubBranch
      }
 
     SubBranchCount--;
+    Revision++;
    }
   else
    {
@@ -805,6 +966,7 @@ P3DBranchModel    *P3DBranchModel::DetachSubBranch
      }
 
     SubBranchCount--;
+    Revision++;
 
     return(Result);
    }
@@ -860,6 +1022,77 @@ void               P3DBranchModel::Save
    }
  }
 
+static void        P3DWriteFingerprint(P3DOutputStringFmtStream
+                                                          *FmtStream,
+                                       const char         *Tag,
+                                       const unsigned_int32 *Fingerprint)
+ {
+  FmtStream->WriteString("suuuu",Tag,Fingerprint[0],Fingerprint[1],
+                                     Fingerprint[2],Fingerprint[3]);
+ }
+
+void               P3DBranchModel::GetFingerprint
+                                      (unsigned_int32       *Fingerprint) const
+ {
+  P3DOutputBinaryStreamHash            HashStream;
+  P3DOutputStringFmtStream             FmtStream(&HashStream);
+  unsigned_int32                         PartFingerprint[P3D_FINGERPRINT_SIZE];
+
+  /* same items as in Save, but stem model, branching algorithm and */
+  /* sub-branches are represented by their own fingerprints         */
+  FmtStream.WriteString("ss","BranchGroupName",GetName());
+
+  if (BranchingAlg != 0)
+   {
+    BranchingAlg->GetFingerprint(PartFingerprint);
+
+    P3DWriteFingerprint(&FmtStream,"BranchingAlg",PartFingerprint);
+   }
+  else
+   {
+    FmtStream.WriteString("ss","BranchingAlg","__None__");
+   }
+
+  if (StemModel != 0)
+   {
+    StemModel->GetFingerprint(PartFingerprint);
+
+    P3DWriteFingerprint(&FmtStream,"StemModel",PartFingerprint);
+   }
+  else
+   {
+    FmtStream.WriteString("ss","StemModel","__None__");
+   }
+
+  if (MaterialInstance != 0)
+   {
+    MaterialInstance->GetMaterialDef()->Save(&HashStream);
+   }
+  else
+   {
+    FmtStream.WriteString("ss","Material","__None__");
+   }
+
+  VisRangeState.Save(&HashStream);
+
+  FmtStream.WriteString("su","BranchModelCount",SubBranchCount);
+
+  for (unsigned_int32 SubBranchIndex = 0; SubBranchIndex < SubBranchCount; SubBranchIndex++)
+   {
+    SubBranches[SubBranchIndex]->GetFingerprint(PartFingerprint);
+
+    P3DWriteFingerprint(&FmtStream,"BranchModel",PartFingerprint);
+   }
+
+  HashStream.GetHash(Fingerprint);
+ }
+
+unsigned_int32       P3DBranchModel::GetRevision
+                                      () const
+ {
+  return(Revision);
+ }
+
 void               P3DBranchModel::Load
                                       (P3DInputStringFmtStream
                                                           *SourceStream,
@@ -1101,6 +1334,24 @@ void               P3DPlantModel::Save(P3DOutputStringStream
   PlantBase->Save(TargetStream,MaterialSaver);
  }
 
+void               P3DPlantModel::GetFingerprint
+                                      (unsigned_int32       *Fingerprint) const
+ {
+  P3DOutputBinaryStreamHash            HashStream;
+  P3DOutputStringFmtStream             FmtStream(&HashStream);
+  unsigned_int32                         BaseFingerprint[P3D_FINGERPRINT_SIZE];
+
+  PlantBase->GetFingerprint(BaseFingerprint);
+
+  FmtStream.WriteString("su","BaseSeed",BaseSeed);
+  /* flags are not saved, but change generated plant */
+  FmtStream.WriteString("su","Flags",Flags);
+
+  P3DWriteFingerprint(&FmtStream,"PlantBase",BaseFingerprint);
+
+  HashStream.GetHash(Fingerprint);
+ }
+
 static void        AutoGenerateBGroupNames
                                       (P3DPlantModel      *PlantModel)
  {
@@ -1129,11 +1380,16 @@ static void        AutoGenerateBGroupNames
 
 void               P3DPlantModel::Load(P3DInputStringStream
                                                           *SourceStream,
-                                       P3DMaterialFactory *MaterialFactory)
+                                       P3DMaterialFactory *MaterialFactory,
+                                       P3DLoadProgress    *Progress,
+                                       unsigned_int32        MaxBlockSize)
  {
   P3DInputStringFmtStream                                  FmtStream(SourceStream);
   P3DFileVersion                                           Version;
 
+  FmtStream.SetProgress(Progress);
+  FmtStream.SetMaxBlockSize(MaxBlockSize);
+
   while (PlantBase->GetSubBranchCount() > 0)
    {
     PlantBase->RemoveSubBranch(PlantBase->GetSubBranchCount() - 1);
@@ -1305,3 +1561,101 @@ P3DBranchModel    *P3DPlantModel::GetBranchModelByName
  }
 
 
+
+/* Material classes used to copy material definitions from one file to  */
+/* another without creating real materials                              */
+class P3DMaterialInstanceCopy : public P3DMaterialInstance
+ {
+  public           :
+
+                   P3DMaterialInstanceCopy
+                                      (const P3DMaterialDef
+                                                          &MaterialDef)
+                   : MaterialDef(MaterialDef)
+   {
+   }
+
+  virtual
+  const
+  P3DMaterialDef  *GetMaterialDef     () const
+   {
+    return(&MaterialDef);
+   }
+
+  virtual
+  P3DMaterialInstance
+                  *CreateCopy         () const
+   {
+    return(new P3DMaterialInstanceCopy(MaterialDef));
+   }
+
+  private          :
+
+  P3DMaterialDef                       MaterialDef;
+ };
+
+class P3DMaterialFactoryCopy : public P3DMaterialFactory
+ {
+  public           :
+
+  virtual P3DMaterialInstance
+                  *CreateMaterial     (const P3DMaterialDef
+                                                          &MaterialDef) const
+   {
+    return(new P3DMaterialInstanceCopy(MaterialDef));
+   }
+ };
+
+class P3DMaterialSaverCopy : public P3DMaterialSaver
+ {
+  public           :
+
+  virtual void     Save               (P3DOutputStringStream
+                                                          *TargetStream,
+                                       const P3DMaterialInstance
+                                                          *Material) const
+   {
+    Material->GetMaterialDef()->Save(TargetStream);
+   }
+ };
+
+void               P3DPlantModel::ConvertFile
+                                      (const char         *SourceFileName,
+                                       const char         *TargetFileName)
+ {
+  P3DPlantModel                        Model;
+  P3DMaterialFactoryCopy               MaterialFactory;
+  P3DMaterialSaverCopy                 MaterialSaver;
+
+  if (P3DInputBinaryStreamFile::IsBinaryFile(SourceFileName))
+   {
+    P3DInputBinaryStreamFile           SourceStream;
+    P3DOutputStringStreamFile          TargetStream;
+
+    SourceStream.Open(SourceFileName);
+
+    Model.Load(&SourceStream,&MaterialFactory);
+
+    TargetStream.Open(TargetFileName);
+
+    Model.Save(&TargetStream,&MaterialSaver);
+
+    TargetStream.Close();
+   }
+  else
+   {
+    P3DInputStringStreamFile           SourceStream;
+    P3DOutputBinaryStreamFile          TargetStream;
+
+    SourceStream.Open(SourceFileName);
+
+    Model.Load(&SourceStream,&MaterialFactory);
+
+    TargetStream.Open(TargetFileName);
+
+    Model.Save(&TargetStream,&MaterialSaver);
+
+    TargetStream.Close();
+   }
+ }
+
@@ -37,6 +37,7 @@
 #include <ngpcore/p3dmath.h>
 #include <ngpcore/p3dmathspline.h>
 #include <ngpcore/p3dmathrng.h>
+#include <ngpcore/p3dmemarena.h>
 
 #include <ngpcore/p3dplant.h>
 
@@ -48,6 +49,10 @@ typedef struct
   unsigned_int32     Minor;
  } P3DFileVersion;
 
+/* Fingerprints are 128-bit hashes of binary model data, so they do */
+/* not depend on text formatting of model file                      */
+#define P3D_FINGERPRINT_SIZE (4)
+
 typedef struct
  {
   float            Min;
@@ -221,6 +226,22 @@ class P3DStemModelInstance
                                        unsigned_int32        Attr,
                                        unsigned_int32        Index) const = 0;
 
+  /* Bulk mode: values of Count vertices starting from FirstIndex are */
+  /* written to Buffer, Stride - distance (in bytes) between values.  */
+  /* Generic implementation calls GetVAttrValue(I) for every vertex.  */
+
+  virtual void     GetVAttrValues     (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const;
+
+  virtual void     GetVAttrValuesI    (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const;
+
   /* Bound-box information */
 
   /* generic implementation - do not take into account billboard mode, */
@@ -249,6 +270,7 @@ class P3DStemModel
  {
   public           :
 
+                   P3DStemModel       ();
   virtual         ~P3DStemModel       () {};
 
   virtual P3DStemModelInstance
@@ -262,6 +284,24 @@ class P3DStemModel
   virtual void     ReleaseInstance    (P3DStemModelInstance
                                                           *instance) const = 0;
 
+  /* Same as CreateInstance, but instance memory is taken from Arena.   */
+  /* Such instance must be released by ReleaseArenaInstance before      */
+  /* arena is rewound or reset. Default implementation ignores Arena.   */
+  /* Materialized plant instances call both methods of stem model copy  */
+  /* (see CreateCopy), so copy must create the same instances.          */
+  virtual P3DStemModelInstance
+                  *CreateArenaInstance(P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *rng,
+                                       const P3DStemModelInstance
+                                                          *parent,
+                                       float               offset,
+                                       const P3DQuaternionf
+                                                          *orientation) const;
+
+  virtual void     ReleaseArenaInstance
+                                      (P3DStemModelInstance
+                                                          *instance) const;
+
   virtual P3DStemModel
                   *CreateCopy         () const = 0;
 
@@ -312,6 +352,23 @@ class P3DStemModel
                                                           *SourceStream,
                                        const P3DFileVersion
                                                           *Version) = 0;
+
+  /* Revision is changed by every modification of model parameters,   */
+  /* so it may be used to find out if model was changed since some    */
+  /* moment. Fingerprint is recalculated only after such changes.     */
+  unsigned_int32     GetRevision        () const;
+  void             GetFingerprint     (unsigned_int32       *Fingerprint) const;
+
+  protected        :
+
+  /* must be called by every method which changes saved parameters */
+  void             Touch              ();
+
+  private          :
+
+  unsigned_int32                         Revision;
+  mutable bool                         FingerprintValid;
+  mutable unsigned_int32                 FingerprintCache[P3D_FINGERPRINT_SIZE];
  };
 
 class P3DBranchingFactory
@@ -325,16 +382,44 @@ class P3DBranchingFactory
                                                           *orientation) = 0;
  };
 
+#define P3DBranchingCursorMaxValues (4)
+
+/* State of step-by-step branch generation. Meaning of */
+/* values is defined by branching algorithm            */
+class P3DBranchingCursor
+ {
+  public           :
+
+  unsigned_int32                         Counters[P3DBranchingCursorMaxValues];
+  float                                Values[P3DBranchingCursorMaxValues];
+ };
+
 class P3DBranchingAlg
  {
   public           :
 
+                   P3DBranchingAlg    ();
   virtual         ~P3DBranchingAlg    () {};
 
   virtual void     CreateBranches     (P3DBranchingFactory          *factory,
                                        const P3DStemModelInstance   *parent,
                                        P3DMathRNG                   *rng) = 0;
 
+  /* Step-by-step alternative to CreateBranches. BeginBranches returns */
+  /* false if algorithm does not support it. Otherwise NextBranch must */
+  /* be called until it returns false. Branches, parameters and random */
+  /* numbers consumed are exactly the same as in CreateBranches, if    */
+  /* factory does not use rng between NextBranch calls.                */
+  virtual bool     BeginBranches      (P3DBranchingCursor           *Cursor,
+                                       const P3DStemModelInstance   *Parent,
+                                       P3DMathRNG                   *RNG) const;
+
+  virtual bool     NextBranch         (P3DBranchingCursor           *Cursor,
+                                       float                        *Offset,
+                                       P3DQuaternionf               *Orientation,
+                                       const P3DStemModelInstance   *Parent,
+                                       P3DMathRNG                   *RNG) const;
+
   virtual P3DBranchingAlg
                   *CreateCopy         () const = 0;
 
@@ -345,6 +430,20 @@ class P3DBranchingAlg
                                                           *SourceStream,
                                        const P3DFileVersion
                                                           *Version) = 0;
+
+  /* same as in P3DStemModel */
+  unsigned_int32     GetRevision        () const;
+  void             GetFingerprint     (unsigned_int32       *Fingerprint) const;
+
+  protected        :
+
+  void             Touch              ();
+
+  private          :
+
+  unsigned_int32                         Revision;
+  mutable bool                         FingerprintValid;
+  mutable unsigned_int32                 FingerprintCache[P3D_FINGERPRINT_SIZE];
  };
 
 #define P3DBranchModelSubBranchMaxCount (8)
@@ -394,6 +493,17 @@ class P3DBranchModel
                                                           *TargetStream,
                                        P3DMaterialSaver   *MaterialSaver) const;
 
+  /* Fingerprint of branch and all its sub-branches. Stem models and  */
+  /* branching algorithms are hashed again only if they were changed, */
+  /* so recalculation after edit costs little more than tree walk.    */
+  /* Materials are identified by their definitions.                   */
+  void             GetFingerprint     (unsigned_int32       *Fingerprint) const;
+
+  /* Revision is changed when stem model or branching algorithm is     */
+  /* replaced or sub-branch list is changed. Changes of stem model and */
+  /* branching algorithm parameters are tracked by their own revisions */
+  unsigned_int32     GetRevision        () const;
+
   void             Load               (P3DInputStringFmtStream
                                                           *SourceStream,
                                        P3DMaterialFactory *MaterialFactory,
@@ -411,9 +521,16 @@ class P3DBranchModel
   P3DVisRangeState                     VisRangeState;
   P3DBranchModel                      *SubBranches[P3DBranchModelSubBranchMaxCount];
   unsigned_int32                         SubBranchCount;
+  unsigned_int32                         Revision;
  };
 
 #define P3D_MODEL_FLAG_NO_RANDOMNESS (0x1)
+/* every branch uses own random stream derived from its position in */
+/* plant hierarchy, so subtrees may be generated independently      */
+#define P3D_MODEL_FLAG_SUBTREE_RNG   (0x2)
+/* branch random streams are produced by counter-based generator */
+/* (P3DMathRNGCounter) instead of LCG, implies subtree RNG mode  */
+#define P3D_MODEL_FLAG_COUNTER_RNG   (0x4)
 
 class P3D_DLL_ENTRY P3DPlantModel
  {
@@ -436,9 +553,19 @@ class P3D_DLL_ENTRY P3DPlantModel
                                                           *TargetStream,
                                        P3DMaterialSaver   *MaterialSaver) const;
 
+  /* Fingerprint of model contents, base seed and flags. Two models  */
+  /* with equal fingerprints generate the same plants. Not thread    */
+  /* safe - cached fingerprints of model parts may be updated.       */
+  void             GetFingerprint     (unsigned_int32       *Fingerprint) const;
+
+  /* Progress (if not 0) is notified while large data blocks (custom  */
+  /* meshes) are loaded, MaxBlockSize (if not 0) limits size of each  */
+  /* such block                                                       */
   void             Load               (P3DInputStringStream
                                                           *SourceStream,
-                                       P3DMaterialFactory *MaterialFactory);
+                                       P3DMaterialFactory *MaterialFactory,
+                                       P3DLoadProgress    *Progress = 0,
+                                       unsigned_int32        MaxBlockSize = 0);
 
   static const P3DBranchModel
                   *GetBranchModelByIndex
@@ -459,6 +586,11 @@ class P3D_DLL_ENTRY P3DPlantModel
                                       (P3DPlantModel      *PlantModel,
                                        P3DBranchModel     *BranchModel);
 
+  /* Converts text model file to binary one or binary to text, depending */
+  /* on source file format. Materials are copied as is.                  */
+  static void      ConvertFile        (const char         *SourceFileName,
+                                       const char         *TargetFileName);
+
   private          :
 
   P3DBranchModel                      *PlantBase;
@@ -29,6 +29,7 @@
 
 ***************************************************************************/
 #include <stdafx.h>
+#include <new>
 #include <ngpcore/p3dmodel.h>
 
 #include <ngpcore/p3dmodelstemgmesh.h>
@@ -59,6 +60,18 @@ class P3DStemModelGMeshInstance : public P3DStemModelInstance
                                        unsigned_int32        Attr,
                                        unsigned_int32        Index) const;
 
+  virtual void     GetVAttrValues     (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const;
+
+  virtual void     GetVAttrValuesI    (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const;
+
   virtual void     GetBoundBox        (float              *Min,
                                        float              *Max) const;
 
@@ -84,6 +97,74 @@ class P3DStemModelGMeshInstance : public P3DStemModelInstance
   P3DMatrix4x4f                        WorldTransform;
  };
 
+/* transform Count source values of attribute into strided destination */
+static void        P3DGMeshTransformVAttrs
+                                      (unsigned char      *Dest,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       const float        *SrcValue,
+                                       unsigned_int32        Count,
+                                       const P3DMatrix4x4f*WorldTransform)
+ {
+  unsigned_int32                         Index;
+
+  if      (Attr == P3D_ATTR_TEXCOORD0)
+   {
+    for (Index = 0; Index < Count; Index++)
+     {
+      ((float*)Dest)[0] = SrcValue[0];
+      ((float*)Dest)[1] = SrcValue[1];
+
+      SrcValue += 2;
+      Dest     += Stride;
+     }
+   }
+  else if (Attr == P3D_ATTR_VERTEX)
+   {
+    for (Index = 0; Index < Count; Index++)
+     {
+      P3DVector3f::MultMatrix((float*)Dest,WorldTransform,SrcValue);
+
+      SrcValue += 3;
+      Dest     += Stride;
+     }
+   }
+  else if ((Attr == P3D_ATTR_NORMAL)   ||
+           (Attr == P3D_ATTR_BINORMAL) ||
+           (Attr == P3D_ATTR_TANGENT))
+   {
+    P3DMatrix4x4f                      Rotation;
+    P3DVector3f                        V;
+
+    P3DMatrix4x4f::GetRotationOnly(Rotation.m,WorldTransform->m);
+
+    for (Index = 0; Index < Count; Index++)
+     {
+      P3DVector3f::MultMatrix(V.v,&Rotation,SrcValue);
+      V.Normalize();
+
+      ((float*)Dest)[0] = V.X();
+      ((float*)Dest)[1] = V.Y();
+      ((float*)Dest)[2] = V.Z();
+
+      SrcValue += 3;
+      Dest     += Stride;
+     }
+   }
+  else
+   {
+    for (Index = 0; Index < Count; Index++)
+     {
+      ((float*)Dest)[0] = SrcValue[0];
+      ((float*)Dest)[1] = SrcValue[1];
+      ((float*)Dest)[2] = SrcValue[2];
+
+      SrcValue += 3;
+      Dest     += Stride;
+     }
+   }
+ }
+
                    P3DStemModelGMeshInstance::P3DStemModelGMeshInstance
                                       (const P3DGMeshData *MeshData,
                                        const P3DMatrix4x4f*Transform)
@@ -132,47 +213,12 @@ void               P3DStemModelGMeshInstance::GetVAttrValue
     throw P3DExceptionGeneric("invalid vertex attribute");
    }
 
-  const float     *SrcValue;
-
-  SrcValue = MeshData->GetVAttrBuffer(Attr);
-
-  if (Attr == P3D_ATTR_TEXCOORD0)
-   {
-    SrcValue += 2 * Index;
-    *Value++ = *SrcValue++;
-    *Value   = *SrcValue;
-   }
-  else
-   {
-    SrcValue += 3 * Index;
-
-    if (Attr == P3D_ATTR_VERTEX)
-     {
-      P3DVector3f::MultMatrix(Value,&WorldTransform,SrcValue);
-     }
-    else if ((Attr == P3D_ATTR_NORMAL)   ||
-             (Attr == P3D_ATTR_BINORMAL) ||
-             (Attr == P3D_ATTR_TANGENT))
-     {
-      P3DMatrix4x4f                    Rotation;
-      P3DVector3f                      V;
-
-      P3DMatrix4x4f::GetRotationOnly(Rotation.m,WorldTransform.m);
-
-      P3DVector3f::MultMatrix(V.v,&Rotation,SrcValue);
-      V.Normalize();
-
-      Value[0] = V.X();
-      Value[1] = V.Y();
-      Value[2] = V.Z();
-     }
-    else
-     {
-      Value[0] = SrcValue[0];
-      Value[1] = SrcValue[1];
-      Value[2] = SrcValue[2];
-     }
-   }
+  P3DGMeshTransformVAttrs((unsigned char*)Value,
+                          0,
+                          Attr,
+                          MeshData->GetVAttrBuffer(Attr) + (Attr == P3D_ATTR_TEXCOORD0 ? 2 : 3) * Index,
+                          1,
+                          &WorldTransform);
  }
 
 unsigned_int32       P3DStemModelGMeshInstance::GetPrimitiveCount
@@ -227,46 +273,62 @@ void               P3DStemModelGMeshInstance::GetVAttrValueI
     throw P3DExceptionGeneric("invalid vertex attribute");
    }
 
-  const float     *SrcValue;
-
-  SrcValue = MeshData->GetVAttrBufferI(Attr);
+  P3DGMeshTransformVAttrs((unsigned char*)Value,
+                          0,
+                          Attr,
+                          MeshData->GetVAttrBufferI(Attr) + (Attr == P3D_ATTR_TEXCOORD0 ? 2 : 3) * Index,
+                          1,
+                          &WorldTransform);
+ }
 
-  if (Attr == P3D_ATTR_TEXCOORD0)
+void               P3DStemModelGMeshInstance::GetVAttrValues
+                                      (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const
+ {
+  if ((FirstIndex + Count < FirstIndex) || (FirstIndex + Count > GetVAttrCount(Attr)))
    {
-    SrcValue += 2 * Index;
-    *Value++ = *SrcValue++;
-    *Value   = *SrcValue;
+    throw P3DExceptionGeneric("invalid attribyte index");
    }
-  else
-   {
-    SrcValue += 3 * Index;
 
-    if (Attr == P3D_ATTR_VERTEX)
-     {
-      P3DVector3f::MultMatrix(Value,&WorldTransform,SrcValue);
-     }
-    else if ((Attr == P3D_ATTR_NORMAL)   ||
-             (Attr == P3D_ATTR_BINORMAL) ||
-             (Attr == P3D_ATTR_TANGENT))
-     {
-      P3DMatrix4x4f                    Rotation;
-      P3DVector3f                      V;
+  if (Count > 0)
+   {
+    P3DGMeshTransformVAttrs((unsigned char*)Buffer,
+                            Stride,
+                            Attr,
+                            MeshData->GetVAttrBuffer(Attr) + (Attr == P3D_ATTR_TEXCOORD0 ? 2 : 3) * FirstIndex,
+                            Count,
+                            &WorldTransform);
+   }
+ }
 
-      P3DMatrix4x4f::GetRotationOnly(Rotation.m,WorldTransform.m);
+void               P3DStemModelGMeshInstance::GetVAttrValuesI
+                                      (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const
+ {
+  if ((FirstIndex + Count < FirstIndex) || (FirstIndex + Count > GetVAttrCountI()))
+   {
+    throw P3DExceptionGeneric("invalid vertex index");
+   }
 
-      P3DVector3f::MultMatrix(V.v,&Rotation,SrcValue);
-      V.Normalize();
+  if (Attr >= P3D_GMESH_MAX_ATTRS)
+   {
+    throw P3DExceptionGeneric("invalid vertex attribute");
+   }
 
-      Value[0] = V.X();
-      Value[1] = V.Y();
-      Value[2] = V.Z();
-     }
-    else
-     {
-      Value[0] = SrcValue[0];
-      Value[1] = SrcValue[1];
-      Value[2] = SrcValue[2];
-     }
+  if (Count > 0)
+   {
+    P3DGMeshTransformVAttrs((unsigned char*)Buffer,
+                            Stride,
+                            Attr,
+                            MeshData->GetVAttrBufferI(Attr) + (Attr == P3D_ATTR_TEXCOORD0 ? 2 : 3) * FirstIndex,
+                            Count,
+                            &WorldTransform);
    }
  }
 
@@ -326,9 +388,16 @@ void               P3DStemModelGMeshInstance::GetAxisOrientationAt
   MeshData = 0;
  }
 
+                   P3DStemModelGMesh::~P3DStemModelGMesh
+                                      ()
+ {
+  delete MeshData;
+ }
+
 P3DStemModelInstance
-                  *P3DStemModelGMesh::CreateInstance
-                                      (P3DMathRNG         *RNG P3D_UNUSED_ATTR,
+                  *P3DStemModelGMesh::CreateInstanceIn
+                                      (P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *RNG P3D_UNUSED_ATTR,
                                        const P3DStemModelInstance
                                                           *Parent,
                                        float               Offset,
@@ -336,26 +405,25 @@ P3DStemModelInstance
                                                           *Orientation) const
  {
   P3DStemModelGMeshInstance           *Instance;
+  P3DMatrix4x4f                        WorldTransform;
+  const P3DMatrix4x4f                 *InstanceTransform;
 
   if (Parent == 0)
    {
     if (Orientation != 0)
      {
-      P3DMatrix4x4f                    WorldTransform;
-
       Orientation->ToMatrix(WorldTransform.m);
 
-      Instance = new P3DStemModelGMeshInstance(MeshData,&WorldTransform);
+      InstanceTransform = &WorldTransform;
      }
     else
      {
-      Instance = new P3DStemModelGMeshInstance(MeshData,0);
+      InstanceTransform = 0;
      }
    }
   else
    {
     P3DMatrix4x4f                      ParentTransform;
-    P3DMatrix4x4f                      WorldTransform;
     P3DQuaternionf                     ParentOrientation;
     P3DQuaternionf                     InstanceOrientation;
     P3DVector3f                        ParentAxisPos;
@@ -386,13 +454,34 @@ P3DStemModelInstance
                               ParentTransform.m,
                               TempTransform.m);
 
-    Instance = new P3DStemModelGMeshInstance
-                    (MeshData,&WorldTransform);
+    InstanceTransform = &WorldTransform;
+   }
+
+  if (Arena != 0)
+   {
+    Instance = new(Arena->Allocate(sizeof(P3DStemModelGMeshInstance)))
+                P3DStemModelGMeshInstance(MeshData,InstanceTransform);
+   }
+  else
+   {
+    Instance = new P3DStemModelGMeshInstance(MeshData,InstanceTransform);
    }
 
   return(Instance);
  }
 
+P3DStemModelInstance
+                  *P3DStemModelGMesh::CreateInstance
+                                      (P3DMathRNG         *RNG,
+                                       const P3DStemModelInstance
+                                                          *Parent,
+                                       float               Offset,
+                                       const P3DQuaternionf
+                                                          *Orientation) const
+ {
+  return(CreateInstanceIn(0,RNG,Parent,Offset,Orientation));
+ }
+
 void               P3DStemModelGMesh::ReleaseInstance
                                       (P3DStemModelInstance
                                                           *Instance) const
@@ -400,6 +489,26 @@ void               P3DStemModelGMesh::ReleaseInstance
   delete Instance;
  }
 
+P3DStemModelInstance
+                  *P3DStemModelGMesh::CreateArenaInstance
+                                      (P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *RNG,
+                                       const P3DStemModelInstance
+                                                          *Parent,
+                                       float               Offset,
+                                       const P3DQuaternionf
+                                                          *Orientation) const
+ {
+  return(CreateInstanceIn(Arena,RNG,Parent,Offset,Orientation));
+ }
+
+void               P3DStemModelGMesh::ReleaseArenaInstance
+                                      (P3DStemModelInstance
+                                                          *Instance) const
+ {
+  Instance->~P3DStemModelInstance();
+ }
+
 P3DStemModel      *P3DStemModelGMesh::CreateCopy
                                       () const
  {
@@ -655,39 +764,6 @@ static void        SaveVAttr          (P3DOutputStringFmtStream
    }
  }
 
-static void        LoadVAttr          (P3DInputStringFmtStream
-                                                          *FmtStream,
-                                       P3DGMeshData       *MeshData,
-                                       unsigned_int32        Attr,
-                                       const char         *AttrName)
- {
-  unsigned_int32                         AttrIndex;
-  unsigned_int32                         AttrCount;
-  float                               *Buffer;
-
-  Buffer    = MeshData->GetVAttrBuffer(Attr);
-  AttrCount = MeshData->GetVAttrCount(Attr);
-
-  if (Attr == P3D_ATTR_TEXCOORD0)
-   {
-    for (AttrIndex = 0; AttrIndex < AttrCount; AttrIndex++)
-     {
-      FmtStream->ReadFmtStringTagged(AttrName,"ff",&Buffer[0],&Buffer[1]);
-
-      Buffer += 2;
-     }
-   }
-  else
-   {
-    for (AttrIndex = 0; AttrIndex < AttrCount; AttrIndex++)
-     {
-      FmtStream->ReadFmtStringTagged(AttrName,"fff",&Buffer[0],&Buffer[1],&Buffer[2]);
-
-      Buffer += 3;
-     }
-   }
- }
-
 static void        SaveVAttrI         (P3DOutputStringFmtStream
                                                           *FmtStream,
                                        const P3DGMeshData *MeshData,
@@ -721,39 +797,6 @@ static void        SaveVAttrI         (P3DOutputStringFmtStream
    }
  }
 
-static void        LoadVAttrI         (P3DInputStringFmtStream
-                                                          *FmtStream,
-                                       P3DGMeshData       *MeshData,
-                                       unsigned_int32        Attr,
-                                       const char         *AttrName)
- {
-  unsigned_int32                         AttrIndex;
-  unsigned_int32                         AttrCount;
-  float                               *Buffer;
-
-  Buffer    = MeshData->GetVAttrBufferI(Attr);
-  AttrCount = MeshData->GetVAttrCountI();
-
-  if (Attr == P3D_ATTR_TEXCOORD0)
-   {
-    for (AttrIndex = 0; AttrIndex < AttrCount; AttrIndex++)
-     {
-      FmtStream->ReadFmtStringTagged(AttrName,"ff",&Buffer[0],&Buffer[1]);
-
-      Buffer += 2;
-     }
-   }
-  else
-   {
-    for (AttrIndex = 0; AttrIndex < AttrCount; AttrIndex++)
-     {
-      FmtStream->ReadFmtStringTagged(AttrName,"fff",&Buffer[0],&Buffer[1],&Buffer[2]);
-
-      Buffer += 3;
-     }
-   }
- }
-
 void               P3DStemModelGMesh::Save
                                       (P3DOutputStringStream
                                                           *TargetStream) const
@@ -859,171 +902,387 @@ void               P3DStemModelGMesh::Save
    }
  }
 
-void               P3DStemModelGMesh::Load
+#define P3D_GMESH_LOAD_STAGE_HEADER     (0)
+#define P3D_GMESH_LOAD_STAGE_VATTR      (1)
+#define P3D_GMESH_LOAD_STAGE_PRIMITIVES (2)
+#define P3D_GMESH_LOAD_STAGE_VATTRI     (3)
+#define P3D_GMESH_LOAD_STAGE_INDICESI   (4)
+#define P3D_GMESH_LOAD_STAGE_DONE       (5)
+
+static const char *P3DGMeshAttrNames[P3D_GMESH_MAX_ATTRS] =
+ {
+  "Vertex", "Normal", "TexCoord0", "Tangent", "Binormal"
+ };
+
+static void        LoadVAttrValue     (P3DInputStringFmtStream
+                                                          *FmtStream,
+                                       float              *Buffer,
+                                       unsigned_int32        Attr)
+ {
+  if (Attr == P3D_ATTR_TEXCOORD0)
+   {
+    FmtStream->ReadFmtStringTagged(P3DGMeshAttrNames[Attr],"ff",&Buffer[0],&Buffer[1]);
+   }
+  else
+   {
+    FmtStream->ReadFmtStringTagged(P3DGMeshAttrNames[Attr],"fff",&Buffer[0],&Buffer[1],&Buffer[2]);
+   }
+ }
+
+static unsigned_int32 GetVAttrElementCount
+                                      (unsigned_int32        Attr)
+ {
+  return(Attr == P3D_ATTR_TEXCOORD0 ? 2 : 3);
+ }
+
+/* adds size of Count items to Size, returns false if result exceeds Limit */
+static bool        AddDataSize        (unsigned_int32       *Size,
+                                       unsigned_int32        Count,
+                                       unsigned_int32        ItemSize,
+                                       unsigned_int32        Limit)
+ {
+  if (Count > (Limit - *Size) / ItemSize)
+   {
+    return(false);
+   }
+
+  *Size += Count * ItemSize;
+
+  return(true);
+ }
+
+                   P3DGMeshDataLoader::P3DGMeshDataLoader
                                       (P3DInputStringFmtStream
                                                           *SourceStream,
-                                       const P3DFileVersion
-                                                          *Version P3D_UNUSED_ATTR)
+                                       unsigned_int32        MaxDataSize)
+ {
+  this->SourceStream = SourceStream;
+  this->MaxDataSize  = MaxDataSize;
+
+  MeshData          = 0;
+  Stage             = P3D_GMESH_LOAD_STAGE_HEADER;
+  Attr              = 0;
+  ItemIndex         = 0;
+  VertexIndex       = 0;
+  VertexCount       = 0;
+  IndexPos          = 0;
+  RecordCount       = 0;
+  LoadedRecordCount = 0;
+ }
+
+                   P3DGMeshDataLoader::~P3DGMeshDataLoader
+                                      ()
+ {
+  delete MeshData;
+ }
+
+void               P3DGMeshDataLoader::LoadHeader
+                                      ()
  {
-  P3DGMeshData                        *NewMeshData;
   unsigned_int32                         VAttrCounts[P3D_GMESH_MAX_ATTRS];
-  unsigned_int32                         PrimitiveIndex;
   unsigned_int32                         PrimitiveCount;
   unsigned_int32                         IndexCount;
   unsigned_int32                         VAttrCountI;
   unsigned_int32                         IndexCountI;
-  unsigned_int32                         IndexCounter;
-  unsigned_int32                        *PrimitiveBuffer;
-  unsigned_int32                        *IndexBuffer[P3D_GMESH_MAX_ATTRS];
+  unsigned_int32                         DataSize;
+  unsigned_int32                         Limit;
+  unsigned_int32                         Index;
+  bool                                 Fits;
+
+  SourceStream->ReadFmtStringTagged("VAttrVertexCount","u",&VAttrCounts[P3D_ATTR_VERTEX]);
+  SourceStream->ReadFmtStringTagged("VAttrNormalCount","u",&VAttrCounts[P3D_ATTR_NORMAL]);
+  SourceStream->ReadFmtStringTagged("VAttrTexCoord0Count","u",&VAttrCounts[P3D_ATTR_TEXCOORD0]);
+  SourceStream->ReadFmtStringTagged("VAttrTangentCount","u",&VAttrCounts[P3D_ATTR_TANGENT]);
+  SourceStream->ReadFmtStringTagged("VAttrBinormalCount","u",&VAttrCounts[P3D_ATTR_BINORMAL]);
+
+  SourceStream->ReadFmtStringTagged("PrimitiveCount","u",&PrimitiveCount);
+  SourceStream->ReadFmtStringTagged("IndexCount","u",&IndexCount);
+  SourceStream->ReadFmtStringTagged("VAttrCountI","u",&VAttrCountI);
+  SourceStream->ReadFmtStringTagged("IndexCountI","u",&IndexCountI);
+
+  if ((VAttrCounts[P3D_ATTR_VERTEX] == 0)    ||
+      (VAttrCounts[P3D_ATTR_NORMAL] == 0)    ||
+      (VAttrCounts[P3D_ATTR_TEXCOORD0] == 0) ||
+      (VAttrCounts[P3D_ATTR_TANGENT] == 0)   ||
+      (VAttrCounts[P3D_ATTR_BINORMAL] == 0)  ||
+      (VAttrCountI == 0))
+   {
+    throw P3DExceptionGeneric("invalid vertex attribute count in g-mesh data");
+   }
+
+  if (PrimitiveCount == 0)
+   {
+    throw P3DExceptionGeneric("invalid primitive count in g-mesh data");
+   }
+
+  if ((IndexCount == 0) || (IndexCountI == 0) || ((IndexCountI % 3) != 0))
+   {
+    throw P3DExceptionGeneric("invalid index count in g-mesh data");
+   }
+
+  /* sizes are checked before allocation, so damaged or too large mesh */
+  /* is rejected without allocating memory for it                      */
+  Limit    = MaxDataSize > 0 ? MaxDataSize : 0xFFFFFFFF;
+  DataSize = 0;
+  Fits     = true;
+
+  for (Index = 0; Index < P3D_GMESH_MAX_ATTRS; Index++)
+   {
+    Fits = Fits &&
+           AddDataSize(&DataSize,VAttrCounts[Index],GetVAttrElementCount(Index) * sizeof(float),Limit) &&
+           AddDataSize(&DataSize,IndexCount,sizeof(unsigned_int32),Limit) &&
+           AddDataSize(&DataSize,VAttrCountI,GetVAttrElementCount(Index) * sizeof(float),Limit);
+   }
+
+  Fits = Fits &&
+         AddDataSize(&DataSize,PrimitiveCount,sizeof(unsigned_int32),Limit) &&
+         AddDataSize(&DataSize,IndexCountI,sizeof(unsigned_int32),Limit);
+
+  if (!Fits)
+   {
+    throw P3DExceptionGeneric("g-mesh data size limit exceeded");
+   }
+
+  MeshData = new P3DGMeshData(VAttrCounts,PrimitiveCount,IndexCount,VAttrCountI,IndexCountI);
 
-  NewMeshData = 0;
+  /* record count can not overflow - every record takes at least */
+  /* 4 bytes of data                                             */
+  RecordCount = PrimitiveCount + IndexCount + P3D_GMESH_MAX_ATTRS * VAttrCountI + IndexCountI / 3;
 
-  try
+  for (Index = 0; Index < P3D_GMESH_MAX_ATTRS; Index++)
    {
-    SourceStream->ReadFmtStringTagged("VAttrVertexCount","u",&VAttrCounts[P3D_ATTR_VERTEX]);
-    SourceStream->ReadFmtStringTagged("VAttrNormalCount","u",&VAttrCounts[P3D_ATTR_NORMAL]);
-    SourceStream->ReadFmtStringTagged("VAttrTexCoord0Count","u",&VAttrCounts[P3D_ATTR_TEXCOORD0]);
-    SourceStream->ReadFmtStringTagged("VAttrTangentCount","u",&VAttrCounts[P3D_ATTR_TANGENT]);
-    SourceStream->ReadFmtStringTagged("VAttrBinormalCount","u",&VAttrCounts[P3D_ATTR_BINORMAL]);
+    RecordCount += VAttrCounts[Index];
+   }
 
-    SourceStream->ReadFmtStringTagged("PrimitiveCount","u",&PrimitiveCount);
-    SourceStream->ReadFmtStringTagged("IndexCount","u",&IndexCount);
-    SourceStream->ReadFmtStringTagged("VAttrCountI","u",&VAttrCountI);
-    SourceStream->ReadFmtStringTagged("IndexCountI","u",&IndexCountI);
+  Stage     = P3D_GMESH_LOAD_STAGE_VATTR;
+  Attr      = 0;
+  ItemIndex = 0;
+ }
 
-    if ((VAttrCounts[P3D_ATTR_VERTEX] == 0)    ||
-        (VAttrCounts[P3D_ATTR_NORMAL] == 0)    ||
-        (VAttrCounts[P3D_ATTR_TEXCOORD0] == 0) ||
-        (VAttrCounts[P3D_ATTR_TANGENT] == 0)   ||
-        (VAttrCounts[P3D_ATTR_BINORMAL] == 0)  ||
-        (VAttrCountI == 0))
+void               P3DGMeshDataLoader::LoadVAttrRecord
+                                      ()
+ {
+  LoadVAttrValue(SourceStream,
+                 MeshData->GetVAttrBuffer(Attr) + ItemIndex * GetVAttrElementCount(Attr),
+                 Attr);
+
+  ItemIndex++;
+
+  if (ItemIndex >= MeshData->GetVAttrCount(Attr))
+   {
+    ItemIndex = 0;
+    Attr++;
+
+    if (Attr >= P3D_GMESH_MAX_ATTRS)
      {
-      throw P3DExceptionGeneric("invalid vertex attribute count in g-mesh data");
+      Stage       = P3D_GMESH_LOAD_STAGE_PRIMITIVES;
+      VertexIndex = 0;
+      IndexPos    = 0;
      }
+   }
+ }
+
+void               P3DGMeshDataLoader::LoadPrimitiveRecord
+                                      ()
+ {
+  unsigned_int32                        *PrimitiveBuffer;
+  unsigned_int32                         Pos;
 
-    if (PrimitiveCount == 0)
+  if (VertexIndex == 0)
+   {
+    PrimitiveBuffer = MeshData->GetPrimitiveBuffer();
+
+    SourceStream->ReadFmtStringTagged("PrimType","u",&PrimitiveBuffer[ItemIndex]);
+
+    if      (PrimitiveBuffer[ItemIndex] == P3D_TRIANGLE)
+     {
+      VertexCount = 3;
+     }
+    else if (PrimitiveBuffer[ItemIndex] == P3D_QUAD)
      {
-      throw P3DExceptionGeneric("invalid primitive count in g-mesh data");
+      VertexCount = 4;
+     }
+    else
+     {
+      throw P3DExceptionGeneric("invalid primitive type in g-mesh data");
      }
 
-    if ((IndexCount == 0) || (IndexCountI == 0) || ((IndexCountI % 3) != 0))
+    if (VertexCount > MeshData->GetIndexCount() - IndexPos)
      {
-      throw P3DExceptionGeneric("invalid index count in g-mesh data");
+      throw P3DExceptionGeneric("primitive types/index count inconsistency found in g-mesh data");
      }
 
-    NewMeshData = new P3DGMeshData(VAttrCounts,PrimitiveCount,IndexCount,VAttrCountI,IndexCountI);
+    VertexIndex = 1;
+   }
+  else
+   {
+    Pos = IndexPos + VertexIndex - 1;
 
-    LoadVAttr(SourceStream,NewMeshData,P3D_ATTR_VERTEX,"Vertex");
-    LoadVAttr(SourceStream,NewMeshData,P3D_ATTR_NORMAL,"Normal");
-    LoadVAttr(SourceStream,NewMeshData,P3D_ATTR_TEXCOORD0,"TexCoord0");
-    LoadVAttr(SourceStream,NewMeshData,P3D_ATTR_TANGENT,"Tangent");
-    LoadVAttr(SourceStream,NewMeshData,P3D_ATTR_BINORMAL,"Binormal");
+    SourceStream->ReadFmtStringTagged("PrimVert","uuuuu",
+                                      &MeshData->GetIndexBuffer(P3D_ATTR_VERTEX)[Pos],
+                                      &MeshData->GetIndexBuffer(P3D_ATTR_NORMAL)[Pos],
+                                      &MeshData->GetIndexBuffer(P3D_ATTR_TEXCOORD0)[Pos],
+                                      &MeshData->GetIndexBuffer(P3D_ATTR_TANGENT)[Pos],
+                                      &MeshData->GetIndexBuffer(P3D_ATTR_BINORMAL)[Pos]);
 
-    PrimitiveBuffer = NewMeshData->GetPrimitiveBuffer();
+    if (VertexIndex < VertexCount)
+     {
+      VertexIndex++;
+     }
+    else
+     {
+      IndexPos   += VertexCount;
+      VertexIndex = 0;
+      ItemIndex++;
 
-    IndexBuffer[P3D_ATTR_VERTEX]    = NewMeshData->GetIndexBuffer(P3D_ATTR_VERTEX);
-    IndexBuffer[P3D_ATTR_NORMAL]    = NewMeshData->GetIndexBuffer(P3D_ATTR_NORMAL);
-    IndexBuffer[P3D_ATTR_TEXCOORD0] = NewMeshData->GetIndexBuffer(P3D_ATTR_TEXCOORD0);
-    IndexBuffer[P3D_ATTR_TANGENT]   = NewMeshData->GetIndexBuffer(P3D_ATTR_TANGENT);
-    IndexBuffer[P3D_ATTR_BINORMAL]  = NewMeshData->GetIndexBuffer(P3D_ATTR_BINORMAL);
+      if (ItemIndex >= MeshData->GetPrimitiveCount())
+       {
+        Stage     = P3D_GMESH_LOAD_STAGE_VATTRI;
+        Attr      = 0;
+        ItemIndex = 0;
+       }
+     }
+   }
+ }
+
+void               P3DGMeshDataLoader::LoadVAttrIRecord
+                                      ()
+ {
+  LoadVAttrValue(SourceStream,
+                 MeshData->GetVAttrBufferI(Attr) + ItemIndex * GetVAttrElementCount(Attr),
+                 Attr);
 
-    IndexCounter = 0;
+  ItemIndex++;
 
-    for (PrimitiveIndex = 0; PrimitiveIndex < PrimitiveCount; PrimitiveIndex++)
+  if (ItemIndex >= MeshData->GetVAttrCountI())
+   {
+    ItemIndex = 0;
+    Attr++;
+
+    if (Attr >= P3D_GMESH_MAX_ATTRS)
      {
-      SourceStream->ReadFmtStringTagged("PrimType","u",&PrimitiveBuffer[PrimitiveIndex]);
+      Stage = P3D_GMESH_LOAD_STAGE_INDICESI;
+     }
+   }
+ }
 
-      if      (PrimitiveBuffer[PrimitiveIndex] == P3D_TRIANGLE)
-       {
-        IndexCounter += 3;
-       }
-      else if (PrimitiveBuffer[PrimitiveIndex] == P3D_QUAD)
-       {
-        IndexCounter += 4;
-       }
-      else
+void               P3DGMeshDataLoader::LoadIndexIRecord
+                                      ()
+ {
+  unsigned_int32                        *IndexBuffer;
+
+  IndexBuffer = MeshData->GetIndexBufferI() + ItemIndex * 3;
+
+  SourceStream->ReadFmtStringTagged("PrimVert","uuu",
+                                    &IndexBuffer[0],
+                                    &IndexBuffer[1],
+                                    &IndexBuffer[2]);
+
+  ItemIndex++;
+
+  if (ItemIndex >= MeshData->GetIndexCountI() / 3)
+   {
+    Stage = P3D_GMESH_LOAD_STAGE_DONE;
+   }
+ }
+
+bool               P3DGMeshDataLoader::Step
+                                      (unsigned_int32        MaxRecordCount)
+ {
+  if (Stage == P3D_GMESH_LOAD_STAGE_HEADER)
+   {
+    LoadHeader();
+   }
+
+  while ((MaxRecordCount > 0) && (Stage != P3D_GMESH_LOAD_STAGE_DONE))
+   {
+    switch (Stage)
+     {
+      case (P3D_GMESH_LOAD_STAGE_VATTR) :
        {
-        throw P3DExceptionGeneric("invalid primitive type in g-mesh data");
-       }
+        LoadVAttrRecord();
+       } break;
 
-      if (IndexCounter > IndexCount)
+      case (P3D_GMESH_LOAD_STAGE_PRIMITIVES) :
        {
-        throw P3DExceptionGeneric("primitive types/index count inconsistency found in g-mesh data");
-       }
+        LoadPrimitiveRecord();
+       } break;
 
-      SourceStream->ReadFmtStringTagged("PrimVert","uuuuu",
-                                        &IndexBuffer[P3D_ATTR_VERTEX][0],
-                                        &IndexBuffer[P3D_ATTR_NORMAL][0],
-                                        &IndexBuffer[P3D_ATTR_TEXCOORD0][0],
-                                        &IndexBuffer[P3D_ATTR_TANGENT][0],
-                                        &IndexBuffer[P3D_ATTR_BINORMAL][0]);
-
-      SourceStream->ReadFmtStringTagged("PrimVert","uuuuu",
-                                        &IndexBuffer[P3D_ATTR_VERTEX][1],
-                                        &IndexBuffer[P3D_ATTR_NORMAL][1],
-                                        &IndexBuffer[P3D_ATTR_TEXCOORD0][1],
-                                        &IndexBuffer[P3D_ATTR_TANGENT][1],
-                                        &IndexBuffer[P3D_ATTR_BINORMAL][1]);
-
-      SourceStream->ReadFmtStringTagged("PrimVert","uuuuu",
-                                        &IndexBuffer[P3D_ATTR_VERTEX][2],
-                                        &IndexBuffer[P3D_ATTR_NORMAL][2],
-                                        &IndexBuffer[P3D_ATTR_TEXCOORD0][2],
-                                        &IndexBuffer[P3D_ATTR_TANGENT][2],
-                                        &IndexBuffer[P3D_ATTR_BINORMAL][2]);
-
-      if (PrimitiveBuffer[PrimitiveIndex] == P3D_QUAD)
+      case (P3D_GMESH_LOAD_STAGE_VATTRI) :
        {
-        SourceStream->ReadFmtStringTagged("PrimVert","uuuuu",
-                                          &IndexBuffer[P3D_ATTR_VERTEX][3],
-                                          &IndexBuffer[P3D_ATTR_NORMAL][3],
-                                          &IndexBuffer[P3D_ATTR_TEXCOORD0][3],
-                                          &IndexBuffer[P3D_ATTR_TANGENT][3],
-                                          &IndexBuffer[P3D_ATTR_BINORMAL][3]);
-
-        IndexBuffer[P3D_ATTR_VERTEX]    += 4;
-        IndexBuffer[P3D_ATTR_NORMAL]    += 4;
-        IndexBuffer[P3D_ATTR_TEXCOORD0] += 4;
-        IndexBuffer[P3D_ATTR_TANGENT]   += 4;
-        IndexBuffer[P3D_ATTR_BINORMAL]  += 4;
-       }
-      else
+        LoadVAttrIRecord();
+       } break;
+
+      default :
        {
-        IndexBuffer[P3D_ATTR_VERTEX]    += 3;
-        IndexBuffer[P3D_ATTR_NORMAL]    += 3;
-        IndexBuffer[P3D_ATTR_TEXCOORD0] += 3;
-        IndexBuffer[P3D_ATTR_TANGENT]   += 3;
-        IndexBuffer[P3D_ATTR_BINORMAL]  += 3;
+        LoadIndexIRecord();
        }
      }
 
-    LoadVAttrI(SourceStream,NewMeshData,P3D_ATTR_VERTEX,"Vertex");
-    LoadVAttrI(SourceStream,NewMeshData,P3D_ATTR_NORMAL,"Normal");
-    LoadVAttrI(SourceStream,NewMeshData,P3D_ATTR_TEXCOORD0,"TexCoord0");
-    LoadVAttrI(SourceStream,NewMeshData,P3D_ATTR_TANGENT,"Tangent");
-    LoadVAttrI(SourceStream,NewMeshData,P3D_ATTR_BINORMAL,"Binormal");
+    LoadedRecordCount++;
+    MaxRecordCount--;
+   }
 
-    PrimitiveCount = IndexCountI / 3;
-    IndexBuffer[0] = NewMeshData->GetIndexBufferI();
+  return(Stage == P3D_GMESH_LOAD_STAGE_DONE);
+ }
 
-    for (PrimitiveIndex = 0; PrimitiveIndex < PrimitiveCount; PrimitiveIndex++)
-     {
-      SourceStream->ReadFmtStringTagged("PrimVert","uuu",
-                                        &IndexBuffer[0][0],
-                                        &IndexBuffer[0][1],
-                                        &IndexBuffer[0][2]);
+bool               P3DGMeshDataLoader::IsDone
+                                      () const
+ {
+  return(Stage == P3D_GMESH_LOAD_STAGE_DONE);
+ }
 
-      IndexBuffer[0] += 3;
-     }
+unsigned_int32       P3DGMeshDataLoader::GetRecordCount
+                                      () const
+ {
+  return(RecordCount);
+ }
+
+unsigned_int32       P3DGMeshDataLoader::GetLoadedRecordCount
+                                      () const
+ {
+  return(LoadedRecordCount);
+ }
+
+P3DGMeshData      *P3DGMeshDataLoader::DetachMeshData
+                                      ()
+ {
+  P3DGMeshData                        *Result;
+
+  if (Stage != P3D_GMESH_LOAD_STAGE_DONE)
+   {
+    throw P3DExceptionAssert();
    }
-  catch (...)
+
+  Result   = MeshData;
+  MeshData = 0;
+
+  return(Result);
+ }
+
+void               P3DStemModelGMesh::Load
+                                      (P3DInputStringFmtStream
+                                                          *SourceStream,
+                                       const P3DFileVersion
+                                                          *Version P3D_UNUSED_ATTR)
+ {
+  P3DGMeshDataLoader                   Loader(SourceStream,SourceStream->GetMaxBlockSize());
+  P3DLoadProgress                     *Progress;
+  bool                                 Done;
+
+  Progress = SourceStream->GetProgress();
+
+  do
    {
-    delete NewMeshData;
+    Done = Loader.Step(P3D_GMESH_LOAD_CHUNK_SIZE);
 
-    throw;
-   }
+    if (Progress != 0)
+     {
+      Progress->OnProgress(Loader.GetLoadedRecordCount(),Loader.GetRecordCount());
+     }
+   } while (!Done);
 
-  SetMeshData(NewMeshData);
+  SetMeshData(Loader.DetachMeshData());
  }
 
 void               P3DStemModelGMesh::SetMeshData
@@ -1032,5 +1291,7 @@ void               P3DStemModelGMesh::SetMeshData
   delete this->MeshData;
 
   this->MeshData = MeshData;
+
+  Touch();
  }
 
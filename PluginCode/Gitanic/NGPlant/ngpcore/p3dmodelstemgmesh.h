@@ -36,11 +36,73 @@
 
 #include <ngpcore/p3dgmeshdata.h>
 
+#define P3D_GMESH_LOAD_CHUNK_SIZE (4096)
+
+/* Loads g-mesh data section in steps, each step parses limited number */
+/* of records, so loading of large meshes may be spread over several   */
+/* frames. Records are read directly into P3DGMeshData buffers, which  */
+/* are allocated once section header is read and checked against size */
+/* limit. Loader must not be used after it has thrown exception.       */
+class P3DGMeshDataLoader
+ {
+  public           :
+
+  /* MaxDataSize - limit (in bytes) for loaded data, 0 means no limit */
+                   P3DGMeshDataLoader (P3DInputStringFmtStream
+                                                          *SourceStream,
+                                       unsigned_int32        MaxDataSize = 0);
+                  ~P3DGMeshDataLoader ();
+
+  /* Parses up to MaxRecordCount records, returns true when loading */
+  /* is finished. Section header is read by first step and is not   */
+  /* counted.                                                       */
+  bool             Step               (unsigned_int32        MaxRecordCount);
+
+  bool             IsDone             () const;
+
+  /* total number of records, valid after first step */
+  unsigned_int32     GetRecordCount     () const;
+  unsigned_int32     GetLoadedRecordCount
+                                      () const;
+
+  /* Caller becomes owner of returned data, loading must be finished */
+  P3DGMeshData    *DetachMeshData     ();
+
+  private          :
+
+                   P3DGMeshDataLoader (const P3DGMeshDataLoader
+                                                          &Source);
+  P3DGMeshDataLoader
+                  &operator =         (const P3DGMeshDataLoader
+                                                          &Source);
+
+  void             LoadHeader         ();
+  void             LoadVAttrRecord    ();
+  void             LoadPrimitiveRecord();
+  void             LoadVAttrIRecord   ();
+  void             LoadIndexIRecord   ();
+
+  P3DInputStringFmtStream             *SourceStream;
+  unsigned_int32                         MaxDataSize;
+  P3DGMeshData                        *MeshData;
+  unsigned_int32                         Stage;
+  unsigned_int32                         Attr;
+  /* index of attribute value or primitive in current stage */
+  unsigned_int32                         ItemIndex;
+  /* primitive record being read: 0 - type, 1..N - vertices */
+  unsigned_int32                         VertexIndex;
+  unsigned_int32                         VertexCount;
+  unsigned_int32                         IndexPos;
+  unsigned_int32                         RecordCount;
+  unsigned_int32                         LoadedRecordCount;
+ };
+
 class P3DStemModelGMesh : public P3DStemModel
  {
   public           :
 
                    P3DStemModelGMesh  ();
+  virtual         ~P3DStemModelGMesh  ();
 
   virtual P3DStemModelInstance
                   *CreateInstance     (P3DMathRNG         *RNG,
@@ -53,6 +115,19 @@ class P3DStemModelGMesh : public P3DStemModel
   virtual void     ReleaseInstance    (P3DStemModelInstance
                                                           *Instance) const;
 
+  virtual P3DStemModelInstance
+                  *CreateArenaInstance(P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *RNG,
+                                       const P3DStemModelInstance
+                                                          *Parent,
+                                       float               Offset,
+                                       const P3DQuaternionf
+                                                          *Orientation) const;
+
+  virtual void     ReleaseArenaInstance
+                                      (P3DStemModelInstance
+                                                          *Instance) const;
+
   virtual P3DStemModel
                   *CreateCopy         () const;
 
@@ -117,6 +192,16 @@ class P3DStemModelGMesh : public P3DStemModel
 
   private          :
 
+  /* create instance in Arena, or in heap if Arena is 0 */
+  P3DStemModelInstance
+                  *CreateInstanceIn   (P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *RNG,
+                                       const P3DStemModelInstance
+                                                          *Parent,
+                                       float               Offset,
+                                       const P3DQuaternionf
+                                                          *Orientation) const;
+
   P3DGMeshData    *MeshData;
  };
 
@@ -29,6 +29,7 @@
 
 ***************************************************************************/
 #include <stdafx.h>
+#include <new>
 #include <ngpcore/p3dmodel.h>
 
 #include <ngpcore/p3dmodelstemquad.h>
@@ -66,6 +67,18 @@ class P3DStemModelQuadInstance : public P3DStemModelInstance
                                        unsigned_int32        Attr,
                                        unsigned_int32        Index) const;
 
+  virtual void     GetVAttrValues     (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const;
+
+  virtual void     GetVAttrValuesI    (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const;
+
   virtual void     GetBoundBox        (float              *Min,
                                        float              *Max) const;
 
@@ -371,6 +384,90 @@ void               P3DStemModelQuadInstance::GetVAttrValueI
    }
  }
 
+void               P3DStemModelQuadInstance::GetVAttrValues
+                                      (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const
+ {
+  unsigned char                       *Dest;
+
+  Dest = (unsigned char*)Buffer;
+
+  for (unsigned_int32 Index = FirstIndex; Index < FirstIndex + Count; Index++)
+   {
+    P3DStemModelQuadInstance::GetVAttrValue((float*)Dest,Attr,Index);
+
+    Dest += Stride;
+   }
+ }
+
+void               P3DStemModelQuadInstance::GetVAttrValuesI
+                                      (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const
+ {
+  unsigned char                       *Dest;
+  float                                Value[3];
+
+  Dest = (unsigned char*)Buffer;
+
+  if ((FirstIndex + Count < FirstIndex) || (FirstIndex + Count > GetVAttrCountI()))
+   {
+    throw P3DExceptionGeneric("invalid vertex index");
+   }
+
+  if (Attr == P3D_ATTR_BILLBOARD_POS)
+   {
+    /* billboard position is the same for all vertices */
+    P3DStemModelQuadInstance::GetVAttrValueI(Value,Attr,0);
+
+    for (unsigned_int32 Index = 0; Index < Count; Index++)
+     {
+      ((float*)Dest)[0] = Value[0];
+      ((float*)Dest)[1] = Value[1];
+      ((float*)Dest)[2] = Value[2];
+
+      Dest += Stride;
+     }
+   }
+  else
+   {
+    if ((Attr == P3D_ATTR_NORMAL)  ||
+        (Attr == P3D_ATTR_TANGENT) ||
+        (Attr == P3D_ATTR_BINORMAL))
+     {
+      unsigned_int32                     Section;
+
+      /* both vertices of section share single value */
+      Section = 0xFFFFFFFFU;
+
+      for (unsigned_int32 Index = FirstIndex; Index < FirstIndex + Count; Index++)
+       {
+        if ((Index / 2) != Section)
+         {
+          Section = Index / 2;
+
+          P3DStemModelQuadInstance::GetVAttrValue(Value,Attr,Section);
+         }
+
+        ((float*)Dest)[0] = Value[0];
+        ((float*)Dest)[1] = Value[1];
+        ((float*)Dest)[2] = Value[2];
+
+        Dest += Stride;
+       }
+     }
+    else
+     {
+      P3DStemModelQuadInstance::GetVAttrValues(Buffer,Stride,Attr,FirstIndex,Count);
+     }
+   }
+ }
+
 void               P3DStemModelQuadInstance::GetBoundBox
                                       (float              *Min,
                                        float              *Max) const
@@ -499,8 +596,9 @@ P3DStemModel      *P3DStemModelQuad::CreateCopy
  }
 
 P3DStemModelInstance
-                  *P3DStemModelQuad::CreateInstance
-                                      (P3DMathRNG         *RNG P3D_UNUSED_ATTR,
+                  *P3DStemModelQuad::CreateInstanceIn
+                                      (P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *RNG P3D_UNUSED_ATTR,
                                        const P3DStemModelInstance
                                                           *Parent,
                                        float               Offset,
@@ -508,6 +606,8 @@ P3DStemModelInstance
                                                           *Orientation) const
  {
   P3DStemModelQuadInstance            *Instance;
+  P3DMatrix4x4f                        WorldTransform;
+  const P3DMatrix4x4f                 *InstanceTransform;
   float                                Scale;
 
   Scale = ScalingCurve.GetValue(Offset);
@@ -516,37 +616,18 @@ P3DStemModelInstance
    {
     if (Orientation != 0)
      {
-      P3DMatrix4x4f                    WorldTransform;
-
       Orientation->ToMatrix(WorldTransform.m);
 
-      Instance = new P3DStemModelQuadInstance
-                      ( Scale,
-                        Length,
-                        Width,
-                        BillboardMode,
-                        SectionCount,
-                       &Curvature,
-                        Thickness,
-                       &WorldTransform);
+      InstanceTransform = &WorldTransform;
      }
     else
      {
-      Instance = new P3DStemModelQuadInstance
-                      ( Scale,
-                        Length,
-                        Width,
-                        BillboardMode,
-                        SectionCount,
-                       &Curvature,
-                        Thickness,
-                        0);
+      InstanceTransform = 0;
      }
    }
   else
    {
     P3DMatrix4x4f                      ParentTransform;
-    P3DMatrix4x4f                      WorldTransform;
     P3DQuaternionf                     ParentOrientation;
     P3DQuaternionf                     InstanceOrientation;
     P3DVector3f                        ParentAxisPos;
@@ -577,6 +658,24 @@ P3DStemModelInstance
                               ParentTransform.m,
                               TempTransform.m);
 
+    InstanceTransform = &WorldTransform;
+   }
+
+  if (Arena != 0)
+   {
+    Instance = new(Arena->Allocate(sizeof(P3DStemModelQuadInstance)))
+                P3DStemModelQuadInstance
+                 ( Scale,
+                   Length,
+                   Width,
+                   BillboardMode,
+                   SectionCount,
+                  &Curvature,
+                   Thickness,
+                   InstanceTransform);
+   }
+  else
+   {
     Instance = new P3DStemModelQuadInstance
                     ( Scale,
                       Length,
@@ -585,12 +684,24 @@ P3DStemModelInstance
                       SectionCount,
                      &Curvature,
                       Thickness,
-                     &WorldTransform);
+                      InstanceTransform);
    }
 
   return(Instance);
  }
 
+P3DStemModelInstance
+                  *P3DStemModelQuad::CreateInstance
+                                      (P3DMathRNG         *RNG,
+                                       const P3DStemModelInstance
+                                                          *Parent,
+                                       float               Offset,
+                                       const P3DQuaternionf
+                                                          *Orientation) const
+ {
+  return(CreateInstanceIn(0,RNG,Parent,Offset,Orientation));
+ }
+
 void               P3DStemModelQuad::ReleaseInstance
                                       (P3DStemModelInstance
                                                           *Instance) const
@@ -598,6 +709,26 @@ void               P3DStemModelQuad::ReleaseInstance
   delete Instance;
  }
 
+P3DStemModelInstance
+                  *P3DStemModelQuad::CreateArenaInstance
+                                      (P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *RNG,
+                                       const P3DStemModelInstance
+                                                          *Parent,
+                                       float               Offset,
+                                       const P3DQuaternionf
+                                                          *Orientation) const
+ {
+  return(CreateInstanceIn(Arena,RNG,Parent,Offset,Orientation));
+ }
+
+void               P3DStemModelQuad::ReleaseArenaInstance
+                                      (P3DStemModelInstance
+                                                          *Instance) const
+ {
+  Instance->~P3DStemModelInstance();
+ }
+
 bool               P3DStemModelQuad::IsCloneable
                                       (bool AllowScaling) const
  {
@@ -880,6 +1011,8 @@ void               P3DStemModelQuad::SetLength
                                       (float               Length)
  {
   this->Length = P3DMath::Clampf(0.0f,100.0f,Length);
+
+  Touch();
  }
 
 float              P3DStemModelQuad::GetLength
@@ -892,6 +1025,8 @@ void               P3DStemModelQuad::SetWidth
                                       (float               Width)
  {
   this->Width = P3DMath::Clampf(0.0f,100.0f,Width);
+
+  Touch();
  }
 
 float              P3DStemModelQuad::GetWidth
@@ -910,6 +1045,8 @@ void               P3DStemModelQuad::SetBillboardMode
                                       (unsigned_int32        Mode)
  {
   BillboardMode = Mode;
+
+  Touch();
  }
 
 bool               P3DStemModelQuad::IsBillboard
@@ -923,6 +1060,8 @@ void               P3DStemModelQuad::SetScalingCurve
                                                           *Curve)
  {
   ScalingCurve.CopyFrom(*Curve);
+
+  Touch();
  }
 
 const P3DMathNaturalCubicSpline
@@ -943,6 +1082,8 @@ void               P3DStemModelQuad::SetSectionCount
    {
     this->SectionCount = 1;
    }
+
+  Touch();
  }
 
 unsigned_int32       P3DStemModelQuad::GetSectionCount
@@ -956,6 +1097,8 @@ void               P3DStemModelQuad::SetCurvature
                                                           *Curve)
  {
   Curvature.CopyFrom(*Curve);
+
+  Touch();
  }
 
 const P3DMathNaturalCubicSpline
@@ -976,6 +1119,8 @@ void               P3DStemModelQuad::SetThickness
    {
     this->Thickness = 0.0f;
    }
+
+  Touch();
  }
 
 float              P3DStemModelQuad::GetThickness
@@ -1036,5 +1181,7 @@ void               P3DStemModelQuad::Load
     Curvature.SetConstant(0.5f);
     Thickness    = 0.0f;
    }
+
+  Touch();
  }
 
@@ -53,6 +53,19 @@ class P3DStemModelQuad : public P3DStemModel
   virtual void     ReleaseInstance    (P3DStemModelInstance
                                                           *Instance) const;
 
+  virtual P3DStemModelInstance
+                  *CreateArenaInstance(P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *RNG,
+                                       const P3DStemModelInstance
+                                                          *Parent,
+                                       float               Offset,
+                                       const P3DQuaternionf
+                                                          *Orientation) const;
+
+  virtual void     ReleaseArenaInstance
+                                      (P3DStemModelInstance
+                                                          *Instance) const;
+
   virtual P3DStemModel
                   *CreateCopy         () const;
 
@@ -140,6 +153,16 @@ class P3DStemModelQuad : public P3DStemModel
 
   private          :
 
+  /* create instance in Arena, or in heap if Arena is 0 */
+  P3DStemModelInstance
+                  *CreateInstanceIn   (P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *RNG,
+                                       const P3DStemModelInstance
+                                                          *Parent,
+                                       float               Offset,
+                                       const P3DQuaternionf
+                                                          *Orientation) const;
+
   float                                Length;
   float                                Width;
 
@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdafx.h>
+#include <new>
 #include <ngpcore/p3ddefs.h>
 #include <ngpcore/p3dtypes.h>
 
@@ -60,8 +61,9 @@ enum /* These constants are needed for pre-0.9.3 compatibility only */
                                        float               UScale,
                                        unsigned_int32        VMode,
                                        float               VScale,
-                                       const P3DMatrix4x4f*Transform)
-                   : Axis(Length,AxisResolution),
+                                       const P3DMatrix4x4f*Transform,
+                                       P3DMemoryArena     *Arena)
+                   : Axis(Length,AxisResolution,Arena),
                      Profile(ProfileResolution),
                      ProfileScale(0.0f,ProfileScaleBase,ScaleProfileCurve)
  {
@@ -286,6 +288,310 @@ void               P3DStemModelTubeInstance::CalcVertexTexCoord
   TexCoord[0] = ((float)(VertexIndex % (Profile.GetResolution() + 1))) / (Profile.GetResolution()) * UScale;
  }
 
+/* number of ring vertices processed at once by ring kernel */
+#define P3D_TUBE_RING_BATCH_SIZE (16)
+
+/* vectors of ring vertices batch in SoA layout */
+class P3DTubeRingBatch
+ {
+  public           :
+
+  float                                X[P3D_TUBE_RING_BATCH_SIZE];
+  float                                Y[P3D_TUBE_RING_BATCH_SIZE];
+  float                                Z[P3D_TUBE_RING_BATCH_SIZE];
+ };
+
+/* per-lane equivalent of P3DQuaternionf::RotateVector */
+static void        P3DTubeRingRotate  (P3DTubeRingBatch   *Batch,
+                                       const float        *q,
+                                       unsigned_int32        Count)
+ {
+  for (unsigned_int32 Lane = 0; Lane < Count; Lane++)
+   {
+    float                              x,y,z;
+    float                              q1[4];
+
+    x = Batch->X[Lane];
+    y = Batch->Y[Lane];
+    z = Batch->Z[Lane];
+
+    q1[3] = (-q[0] * x) - (q[1] * y + q[2] * z);
+    q1[0] = ( q[3] * x) + (q[1] * z - q[2] * y);
+    q1[1] = ( q[3] * y) + (q[2] * x - q[0] * z);
+    q1[2] = ( q[3] * z) + (q[0] * y - q[1] * x);
+
+    Batch->X[Lane] = (q1[0] * q[3] - q1[3] * q[0]) + (q1[2] * q[1] - q1[1] * q[2]);
+    Batch->Y[Lane] = (q1[1] * q[3] - q1[3] * q[1]) + (q1[0] * q[2] - q1[2] * q[0]);
+    Batch->Z[Lane] = (q1[2] * q[3] - q1[3] * q[2]) + (q1[1] * q[0] - q1[0] * q[1]);
+   }
+ }
+
+/* per-lane equivalent of P3DVector3f::MultMatrix */
+static void        P3DTubeRingTransform
+                                      (P3DTubeRingBatch   *Batch,
+                                       const P3DMatrix4x4f*M,
+                                       unsigned_int32        Count)
+ {
+  for (unsigned_int32 Lane = 0; Lane < Count; Lane++)
+   {
+    float                              x,y,z;
+
+    x = Batch->X[Lane];
+    y = Batch->Y[Lane];
+    z = Batch->Z[Lane];
+
+    Batch->X[Lane] = M->m[0] * x + M->m[4] * y + M->m[8]  * z + M->m[12];
+    Batch->Y[Lane] = M->m[1] * x + M->m[5] * y + M->m[9]  * z + M->m[13];
+    Batch->Z[Lane] = M->m[2] * x + M->m[6] * y + M->m[10] * z + M->m[14];
+   }
+ }
+
+/* per-lane equivalent of P3DVector3f::Normalize */
+static void        P3DTubeRingNormalize
+                                      (P3DTubeRingBatch   *Batch,
+                                       unsigned_int32        Count)
+ {
+  for (unsigned_int32 Lane = 0; Lane < Count; Lane++)
+   {
+    float                              l;
+
+    l = P3DMath::Sqrtf(Batch->X[Lane] * Batch->X[Lane] +
+                       Batch->Y[Lane] * Batch->Y[Lane] +
+                       Batch->Z[Lane] * Batch->Z[Lane]);
+
+    Batch->X[Lane] /= l; Batch->Y[Lane] /= l; Batch->Z[Lane] /= l;
+   }
+ }
+
+static void        P3DTubeRingStore   (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       const P3DTubeRingBatch
+                                                          *Batch,
+                                       unsigned_int32        Count)
+ {
+  unsigned char                       *Dest;
+
+  Dest = (unsigned char*)Buffer;
+
+  for (unsigned_int32 Lane = 0; Lane < Count; Lane++)
+   {
+    ((float*)Dest)[0] = Batch->X[Lane];
+    ((float*)Dest)[1] = Batch->Y[Lane];
+    ((float*)Dest)[2] = Batch->Z[Lane];
+
+    Dest += Stride;
+   }
+ }
+
+void               P3DStemModelTubeInstance::GetVAttrRingValuesI
+                                      (void *const        *Buffers,
+                                       const unsigned_int32 *Strides,
+                                       unsigned_int32        RingIndex) const
+ {
+  CalcRingVAttrValues(Buffers,Strides,RingIndex,0,Profile.GetResolution() + 1);
+ }
+
+/* Frame of the ring (axis point, orientation, profile scale and binormal) */
+/* is calculated once, then ring vertices are processed in SoA batches.    */
+/* Every lane does exactly the same operations as CalcVertex* functions.   */
+void               P3DStemModelTubeInstance::CalcRingVAttrValues
+                                      (void *const        *Buffers,
+                                       const unsigned_int32 *Strides,
+                                       unsigned_int32        RingIndex,
+                                       unsigned_int32        FirstVertex,
+                                       unsigned_int32        VertexCount) const
+ {
+  unsigned_int32                         AxisResolution;
+  unsigned_int32                         ProfileResolution;
+  float                                HeightFraction;
+  bool                                 NeedPos;
+  bool                                 NeedNormal;
+  bool                                 NeedBiNormal;
+  float                                PScale;
+  float                                NormalY;
+  float                                TexCoordV;
+  P3DQuaternionf                       SegOrient;
+  P3DVector3f                          AxisPoint;
+  P3DVector3f                          VertexBiNormal(0.0f,1.0f,0.0f);
+  P3DMatrix4x4f                        Rotation;
+
+  AxisResolution    = Axis.GetResolution();
+  ProfileResolution = Profile.GetResolution();
+
+  if (RingIndex > AxisResolution)
+   {
+    throw P3DExceptionGeneric("ring index out of range");
+   }
+
+  NeedPos      = Buffers[P3D_ATTR_VERTEX] != 0;
+  NeedNormal   = (Buffers[P3D_ATTR_NORMAL] != 0) || (Buffers[P3D_ATTR_TANGENT] != 0);
+  NeedBiNormal = (Buffers[P3D_ATTR_BINORMAL] != 0) || (Buffers[P3D_ATTR_TANGENT] != 0);
+
+  HeightFraction = ((float)(AxisResolution - RingIndex)) / AxisResolution;
+
+  PScale  = 0.0f;
+  NormalY = 0.0f;
+
+  if (NeedPos || NeedNormal || NeedBiNormal)
+   {
+    Axis.GetOrientationAt(SegOrient.q,AxisResolution - RingIndex);
+
+    P3DMatrix4x4f::GetRotationOnly(Rotation.m,WorldTransform.m);
+   }
+
+  if (NeedPos)
+   {
+    PScale = ProfileScale.GetScale(HeightFraction);
+
+    Axis.GetPointAt(AxisPoint.v,HeightFraction);
+   }
+
+  if (NeedNormal)
+   {
+    NormalY = -ProfileScale.GetTangent(HeightFraction);
+   }
+
+  if (NeedBiNormal)
+   {
+    P3DQuaternionf::RotateVector(VertexBiNormal.v,SegOrient.q);
+    VertexBiNormal.MultMatrix(&Rotation);
+    VertexBiNormal.Normalize();
+   }
+
+  if (VMode == P3DTexCoordModeRelative)
+   {
+    TexCoordV = HeightFraction * VScale;
+   }
+  else
+   {
+    TexCoordV = HeightFraction * Axis.GetLength() / Axis.GetResolution() * VScale;
+   }
+
+  for (unsigned_int32 First = FirstVertex; First < FirstVertex + VertexCount; First += P3D_TUBE_RING_BATCH_SIZE)
+   {
+    unsigned_int32                       Count;
+    unsigned_int32                       Offset;
+    unsigned_int32                       Lane;
+    float                              SinLane[P3D_TUBE_RING_BATCH_SIZE];
+    float                              CosLane[P3D_TUBE_RING_BATCH_SIZE];
+    P3DTubeRingBatch                   Batch;
+    P3DTubeRingBatch                   Normals;
+
+    Count  = FirstVertex + VertexCount - First;
+    Offset = First - FirstVertex;
+
+    if (Count > P3D_TUBE_RING_BATCH_SIZE)
+     {
+      Count = P3D_TUBE_RING_BATCH_SIZE;
+     }
+
+    if (NeedPos || NeedNormal)
+     {
+      for (Lane = 0; Lane < Count; Lane++)
+       {
+        /* last vertex of ring duplicates first one */
+        Profile.GetPoint(SinLane[Lane],CosLane[Lane],(First + Lane) % ProfileResolution);
+       }
+     }
+
+    if (NeedPos)
+     {
+      for (Lane = 0; Lane < Count; Lane++)
+       {
+        Batch.X[Lane] = SinLane[Lane] * PScale;
+        Batch.Y[Lane] = 0.0f;
+        Batch.Z[Lane] = CosLane[Lane] * PScale;
+       }
+
+      P3DTubeRingRotate(&Batch,SegOrient.q,Count);
+
+      for (Lane = 0; Lane < Count; Lane++)
+       {
+        Batch.X[Lane] += AxisPoint.v[0];
+        Batch.Y[Lane] += AxisPoint.v[1];
+        Batch.Z[Lane] += AxisPoint.v[2];
+       }
+
+      P3DTubeRingTransform(&Batch,&WorldTransform,Count);
+
+      P3DTubeRingStore(((char*)Buffers[P3D_ATTR_VERTEX]) + Offset * Strides[P3D_ATTR_VERTEX],
+                       Strides[P3D_ATTR_VERTEX],
+                       &Batch,
+                       Count);
+     }
+
+    if (NeedNormal)
+     {
+      for (Lane = 0; Lane < Count; Lane++)
+       {
+        Normals.X[Lane] = SinLane[Lane];
+        Normals.Y[Lane] = NormalY;
+        Normals.Z[Lane] = CosLane[Lane];
+       }
+
+      P3DTubeRingNormalize(&Normals,Count);
+      P3DTubeRingRotate(&Normals,SegOrient.q,Count);
+      P3DTubeRingTransform(&Normals,&Rotation,Count);
+      P3DTubeRingNormalize(&Normals,Count);
+
+      if (Buffers[P3D_ATTR_NORMAL] != 0)
+       {
+        P3DTubeRingStore(((char*)Buffers[P3D_ATTR_NORMAL]) + Offset * Strides[P3D_ATTR_NORMAL],
+                         Strides[P3D_ATTR_NORMAL],
+                         &Normals,
+                         Count);
+       }
+     }
+
+    if (Buffers[P3D_ATTR_TANGENT] != 0)
+     {
+      const float *B = VertexBiNormal.v;
+
+      for (Lane = 0; Lane < Count; Lane++)
+       {
+        Batch.X[Lane] = B[1] * Normals.Z[Lane] - B[2] * Normals.Y[Lane];
+        Batch.Y[Lane] = B[2] * Normals.X[Lane] - B[0] * Normals.Z[Lane];
+        Batch.Z[Lane] = B[0] * Normals.Y[Lane] - B[1] * Normals.X[Lane];
+       }
+
+      P3DTubeRingStore(((char*)Buffers[P3D_ATTR_TANGENT]) + Offset * Strides[P3D_ATTR_TANGENT],
+                       Strides[P3D_ATTR_TANGENT],
+                       &Batch,
+                       Count);
+     }
+
+    if (Buffers[P3D_ATTR_BINORMAL] != 0)
+     {
+      for (Lane = 0; Lane < Count; Lane++)
+       {
+        Batch.X[Lane] = VertexBiNormal.v[0];
+        Batch.Y[Lane] = VertexBiNormal.v[1];
+        Batch.Z[Lane] = VertexBiNormal.v[2];
+       }
+
+      P3DTubeRingStore(((char*)Buffers[P3D_ATTR_BINORMAL]) + Offset * Strides[P3D_ATTR_BINORMAL],
+                       Strides[P3D_ATTR_BINORMAL],
+                       &Batch,
+                       Count);
+     }
+
+    if (Buffers[P3D_ATTR_TEXCOORD0] != 0)
+     {
+      unsigned char                   *Dest;
+
+      Dest = ((unsigned char*)Buffers[P3D_ATTR_TEXCOORD0]) + Offset * Strides[P3D_ATTR_TEXCOORD0];
+
+      for (Lane = 0; Lane < Count; Lane++)
+       {
+        ((float*)Dest)[0] = ((float)(First + Lane)) / (ProfileResolution) * UScale;
+        ((float*)Dest)[1] = TexCoordV;
+
+        Dest += Strides[P3D_ATTR_TEXCOORD0];
+       }
+     }
+   }
+ }
+
 unsigned_int32       P3DStemModelTubeInstance::GetVAttrCountI
                                       () const
  {
@@ -335,6 +641,94 @@ void               P3DStemModelTubeInstance::GetVAttrValueI
    }
  }
 
+void               P3DStemModelTubeInstance::GetVAttrValues
+                                      (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const
+ {
+  if ((FirstIndex + Count < FirstIndex) || (FirstIndex + Count > GetVAttrCount(Attr)))
+   {
+    throw P3DExceptionGeneric("vertex index out of range");
+   }
+
+  /* in per-attribute mode only texture coordinates have duplicated */
+  /* seam vertex                                                    */
+  if (Attr == P3D_ATTR_TEXCOORD0)
+   {
+    CalcVAttrRangeValues(Buffer,Stride,Attr,FirstIndex,Count,Profile.GetResolution() + 1);
+   }
+  else
+   {
+    CalcVAttrRangeValues(Buffer,Stride,Attr,FirstIndex,Count,Profile.GetResolution());
+   }
+ }
+
+void               P3DStemModelTubeInstance::GetVAttrValuesI
+                                      (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const
+ {
+  if ((FirstIndex + Count < FirstIndex) || (FirstIndex + Count > GetVAttrCountI()))
+   {
+    throw P3DExceptionGeneric("vertex index out of range");
+   }
+
+  CalcVAttrRangeValues(Buffer,Stride,Attr,FirstIndex,Count,Profile.GetResolution() + 1);
+ }
+
+void               P3DStemModelTubeInstance::CalcVAttrRangeValues
+                                      (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count,
+                                       unsigned_int32        RingSize) const
+ {
+  void                                *Buffers[P3D_MAX_ATTRS];
+  unsigned_int32                         Strides[P3D_MAX_ATTRS];
+  unsigned_int32                         AttrIndex;
+
+  if (Attr >= P3D_MAX_ATTRS)
+   {
+    return;
+   }
+
+  for (AttrIndex = 0; AttrIndex < P3D_MAX_ATTRS; AttrIndex++)
+   {
+    Buffers[AttrIndex] = 0;
+    Strides[AttrIndex] = 0;
+   }
+
+  Buffers[Attr] = Buffer;
+  Strides[Attr] = Stride;
+
+  while (Count > 0)
+   {
+    unsigned_int32                       RingIndex;
+    unsigned_int32                       FirstVertex;
+    unsigned_int32                       VertexCount;
+
+    RingIndex   = FirstIndex / RingSize;
+    FirstVertex = FirstIndex % RingSize;
+    VertexCount = RingSize - FirstVertex;
+
+    if (VertexCount > Count)
+     {
+      VertexCount = Count;
+     }
+
+    CalcRingVAttrValues(Buffers,Strides,RingIndex,FirstVertex,VertexCount);
+
+    Buffers[Attr] = ((char*)Buffers[Attr]) + VertexCount * Stride;
+    FirstIndex   += VertexCount;
+    Count        -= VertexCount;
+   }
+ }
+
 unsigned_int32       P3DStemModelTubeInstance::GetPrimitiveCount
                                       () const
  {
@@ -602,6 +996,9 @@ void               P3DStemModelTube::ApplyPhototropism
    }
  }
 
+/* number of axis segments which random values are fetched at once */
+#define P3D_TUBE_AXIS_VARIATION_BLOCK (32)
+
 void               P3DStemModelTube::ApplyAxisVariation
                                       (P3DMathRNG         *RNG,
                                        P3DStemModelTubeInstance
@@ -613,28 +1010,48 @@ void               P3DStemModelTube::ApplyAxisVariation
   float                                CosAngle1;
   P3DQuaternionf                       Q;
   unsigned_int32                         SegIndex;
+  double                               Units[P3D_TUBE_AXIS_VARIATION_BLOCK * 2];
 
   if (RNG == 0)
    {
     return;
    }
 
-  for (SegIndex = 0; SegIndex < (AxisResolution - 1); SegIndex++)
+  SegIndex = 0;
+
+  while (SegIndex < (AxisResolution - 1))
    {
-    Angle1 = RNG->UniformFloat(0,P3DMATH_PI * 2.0f);
-    Angle2 = RNG->UniformFloat(-AxisVariation,AxisVariation) * P3DMATH_PI;
+    unsigned_int32                       BlockSize;
+
+    BlockSize = AxisResolution - 1 - SegIndex;
+
+    if (BlockSize > P3D_TUBE_AXIS_VARIATION_BLOCK)
+     {
+      BlockSize = P3D_TUBE_AXIS_VARIATION_BLOCK;
+     }
 
-    P3DMath::SinCosf(&SinAngle1,&CosAngle1,Angle1);
+    RNG->UniformUnits(Units,BlockSize * 2);
+
+    for (unsigned_int32 Index = 0; Index < BlockSize; Index++)
+     {
+      Angle1 = P3DMathRNG::UnitToFloat(Units[Index * 2],0,P3DMATH_PI * 2.0f);
+      Angle2 = P3DMathRNG::UnitToFloat(Units[Index * 2 + 1],-AxisVariation,AxisVariation) * P3DMATH_PI;
 
-    Q.FromAxisAndAngle(CosAngle1,0.0f,SinAngle1,Angle2);
+      P3DMath::SinCosf(&SinAngle1,&CosAngle1,Angle1);
 
-    Instance->SetSegOrientation(SegIndex,Q.q);
+      Q.FromAxisAndAngle(CosAngle1,0.0f,SinAngle1,Angle2);
+
+      Instance->SetSegOrientation(SegIndex,Q.q);
+
+      SegIndex++;
+     }
    }
  }
 
-P3DStemModelInstance
-                  *P3DStemModelTube::CreateInstance
-                                      (P3DMathRNG         *rng,
+P3DStemModelTubeInstance
+                  *P3DStemModelTube::CreateInstanceIn
+                                      (P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *rng,
                                        const P3DStemModelInstance
                                                           *parent,
                                        float               offset,
@@ -642,11 +1059,13 @@ P3DStemModelInstance
                                                           *orientation) const
  {
   P3DStemModelTubeInstance            *Instance;
+  P3DMatrix4x4f                        WorldTransform;
+  const P3DMatrix4x4f                 *InstanceTransform;
+  float                                InstanceLength;
+  float                                InstanceProfileScaleBase;
 
   if (parent == 0)
    {
-    float                              InstanceLength;
-
     InstanceLength = Length;
 
     if (rng != 0)
@@ -656,48 +1075,26 @@ P3DStemModelInstance
 
     if (orientation != 0)
      {
-      P3DMatrix4x4f                    WorldTransform;
-
       orientation->ToMatrix(WorldTransform.m);
 
-      Instance = new P3DStemModelTubeInstance
-                      ( InstanceLength,
-                        AxisResolution,
-                        ProfileScaleBase,
-                       &ProfileScaleCurve,
-                        ProfileResolution,
-                        UMode,
-                        UScale,
-                        VMode,
-                        VScale,
-                       &WorldTransform);
+      InstanceTransform = &WorldTransform;
      }
     else
      {
-      Instance = new P3DStemModelTubeInstance
-                      ( InstanceLength,
-                        AxisResolution,
-                        ProfileScaleBase,
-                       &ProfileScaleCurve,
-                        ProfileResolution,
-                        UMode,
-                        UScale,
-                        VMode,
-                        VScale,
-                        0);
+      InstanceTransform = 0;
      }
+
+    InstanceProfileScaleBase = ProfileScaleBase;
    }
   else
    {
     P3DMatrix4x4f                      ParentTransform;
-    P3DMatrix4x4f                      WorldTransform;
     P3DQuaternionf                     ParentOrientation;
     P3DQuaternionf                     InstanceOrientation;
     P3DVector3f                        ParentAxisPos;
     P3DMatrix4x4f                      TempTransform;
     P3DMatrix4x4f                      TempTransform2;
     P3DMatrix4x4f                      TranslateTransform;
-    float                              InstanceLength;
 
     parent->GetAxisOrientationAt(ParentOrientation.q,offset);
     parent->GetAxisPointAt(ParentAxisPos.v,offset);
@@ -729,17 +1126,39 @@ P3DStemModelInstance
       InstanceLength += rng->UniformFloat(-LengthV,LengthV) * InstanceLength;
      }
 
+    InstanceTransform        = &WorldTransform;
+    InstanceProfileScaleBase = parent->GetMinRadiusAt(offset) * ProfileScaleBase;
+   }
+
+  if (Arena != 0)
+   {
+    Instance = new(Arena->Allocate(sizeof(P3DStemModelTubeInstance)))
+                P3DStemModelTubeInstance
+                 ( InstanceLength,
+                   AxisResolution,
+                   InstanceProfileScaleBase,
+                  &ProfileScaleCurve,
+                   ProfileResolution,
+                   UMode,
+                   UScale,
+                   VMode,
+                   VScale,
+                   InstanceTransform,
+                   Arena);
+   }
+  else
+   {
     Instance = new P3DStemModelTubeInstance
                     ( InstanceLength,
                       AxisResolution,
-                      parent->GetMinRadiusAt(offset) * ProfileScaleBase,
+                      InstanceProfileScaleBase,
                      &ProfileScaleCurve,
                       ProfileResolution,
                       UMode,
                       UScale,
                       VMode,
                       VScale,
-                     &WorldTransform);
+                      InstanceTransform);
    }
 
   ApplyAxisVariation(rng,Instance);
@@ -748,6 +1167,18 @@ P3DStemModelInstance
   return(Instance);
  }
 
+P3DStemModelInstance
+                  *P3DStemModelTube::CreateInstance
+                                      (P3DMathRNG         *rng,
+                                       const P3DStemModelInstance
+                                                          *parent,
+                                       float               offset,
+                                       const P3DQuaternionf
+                                                          *orientation) const
+ {
+  return(CreateInstanceIn(0,rng,parent,offset,orientation));
+ }
+
 void               P3DStemModelTube::ReleaseInstance
                                       (P3DStemModelInstance
                                                           *Instance) const
@@ -755,6 +1186,26 @@ void               P3DStemModelTube::ReleaseInstance
   delete Instance;
  }
 
+P3DStemModelInstance
+                  *P3DStemModelTube::CreateArenaInstance
+                                      (P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *rng,
+                                       const P3DStemModelInstance
+                                                          *parent,
+                                       float               offset,
+                                       const P3DQuaternionf
+                                                          *orientation) const
+ {
+  return(CreateInstanceIn(Arena,rng,parent,offset,orientation));
+ }
+
+void               P3DStemModelTube::ReleaseArenaInstance
+                                      (P3DStemModelInstance
+                                                          *Instance) const
+ {
+  Instance->~P3DStemModelInstance();
+ }
+
 bool               P3DStemModelTube::IsCloneable
                                       (bool AllowScaling) const
  {
@@ -991,28 +1442,35 @@ void               P3DLoadSplineCurve (P3DMathNaturalCubicSpline
  {
   unsigned_int32                         CPCount;
   unsigned_int32                         CPIndex;
-  float                                X,Y;
+  float                                X[P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT];
+  float                                Y[P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT];
+  float                                SkippedX,SkippedY;
 
   if (strcmp(CurveName,"CubicSpline") != 0)
    {
     throw P3DExceptionGeneric("Unsupported curve type");
    }
 
-  CPCount = Spline->GetCPCount();
-
-  for (CPIndex = 0; CPIndex < CPCount; CPIndex++)
-   {
-    Spline->DelCP(0);
-   }
-
   SourceStream->ReadFmtStringTagged("CPCount","u",&CPCount);
 
+  /* points are set at once, so spline is recalculated only once. */
+  /* Points which do not fit into spline are read and ignored, as */
+  /* AddCP does.                                                  */
   for (CPIndex = 0; CPIndex < CPCount; CPIndex++)
    {
-    SourceStream->ReadFmtStringTagged("Point","ff",&X,&Y);
-
-    Spline->AddCP(X,Y);
+    if (CPIndex < P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT)
+     {
+      SourceStream->ReadFmtStringTagged("Point","ff",&X[CPIndex],&Y[CPIndex]);
+     }
+    else
+     {
+      SourceStream->ReadFmtStringTagged("Point","ff",&SkippedX,&SkippedY);
+     }
    }
+
+  Spline->SetCPs(CPCount < P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT ?
+                  CPCount : P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT,
+                 X,Y);
  }
 
 void               P3DStemModelTube::Save
@@ -1145,6 +1603,8 @@ void               P3DStemModelTube::Load
 
   SourceStream->ReadFmtStringTagged("BaseTexVScale","f",&FloatValue);
   SetTexCoordVScale(FloatValue);
+
+  Touch();
  }
 
 void               P3DStemModelTube::SetLength
@@ -1158,6 +1618,8 @@ void               P3DStemModelTube::SetLength
    {
     this->Length = 0.1f;
    }
+
+  Touch();
  }
 
 float              P3DStemModelTube::GetLength
@@ -1170,6 +1632,8 @@ void               P3DStemModelTube::SetLengthV
                                       (float               LengthV)
  {
   this->LengthV = P3DMath::Clampf(0.0f,1.0f,LengthV);
+
+  Touch();
  }
 
 float              P3DStemModelTube::GetLengthV
@@ -1182,6 +1646,8 @@ void               P3DStemModelTube::SetAxisVariation
                                       (float               AxisVariation)
  {
   this->AxisVariation = P3DMath::Clampf(0.0f,1.0f,AxisVariation);
+
+  Touch();
  }
 
 float              P3DStemModelTube::GetAxisVariation
@@ -1201,6 +1667,8 @@ void               P3DStemModelTube::SetAxisResolution
    {
     AxisResolution = 1;
    }
+
+  Touch();
  }
 
 unsigned_int32       P3DStemModelTube::GetAxisResolution
@@ -1220,6 +1688,8 @@ void               P3DStemModelTube::SetProfileResolution
    {
     ProfileResolution = 3;
    }
+
+  Touch();
  }
 
 unsigned_int32       P3DStemModelTube::GetProfileResolution
@@ -1232,6 +1702,8 @@ void               P3DStemModelTube::SetProfileScaleBase
                                       (float               Scale)
  {
   this->ProfileScaleBase = Scale;
+
+  Touch();
  }
 
 float              P3DStemModelTube::GetProfileScaleBase
@@ -1245,6 +1717,8 @@ void               P3DStemModelTube::SetProfileScaleCurve
                                                           *Curve)
  {
   ProfileScaleCurve.CopyFrom(*Curve);
+
+  Touch();
  }
 
 const P3DMathNaturalCubicSpline
@@ -1259,6 +1733,8 @@ void               P3DStemModelTube::SetLengthOffsetInfluenceCurve
                                                           *Curve)
  {
   LengthOffsetInfluenceCurve.CopyFrom(*Curve);
+
+  Touch();
  }
 
 const P3DMathNaturalCubicSpline
@@ -1273,6 +1749,8 @@ void               P3DStemModelTube::SetPhototropismCurve
                                                           *Curve)
  {
   PhototropismCurve.CopyFrom(*Curve);
+
+  Touch();
  }
 
 const P3DMathNaturalCubicSpline
@@ -1293,6 +1771,8 @@ void               P3DStemModelTube::SetTexCoordUMode
    {
     UMode = P3DTexCoordModeRelative;
    }
+
+  Touch();
  }
 
 unsigned_int32       P3DStemModelTube::GetTexCoordUMode
@@ -1305,6 +1785,8 @@ void               P3DStemModelTube::SetTexCoordUScale
                                       (float               Scale)
  {
   UScale = Scale;
+
+  Touch();
  }
 
 float              P3DStemModelTube::GetTexCoordUScale
@@ -1324,6 +1806,8 @@ void               P3DStemModelTube::SetTexCoordVMode
    {
     VMode = P3DTexCoordModeRelative;
    }
+
+  Touch();
  }
 
 unsigned_int32       P3DStemModelTube::GetTexCoordVMode
@@ -1336,6 +1820,8 @@ void               P3DStemModelTube::SetTexCoordVScale
                                       (float               Scale)
  {
   VScale = Scale;
+
+  Touch();
  }
 
 float              P3DStemModelTube::GetTexCoordVScale
@@ -57,7 +57,8 @@ class P3DStemModelTubeInstance : public P3DStemModelInstance
                                        float               UScale,
                                        unsigned_int32        VMode,
                                        float               VScale,
-                                       const P3DMatrix4x4f*Transform);
+                                       const P3DMatrix4x4f*Transform,
+                                       P3DMemoryArena     *Arena = 0);
 
   virtual
   unsigned_int32     GetVAttrCount      (unsigned_int32        Attr) const;
@@ -77,6 +78,18 @@ class P3DStemModelTubeInstance : public P3DStemModelInstance
                                        unsigned_int32        Attr,
                                        unsigned_int32        Index) const;
 
+  virtual void     GetVAttrValues     (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const;
+
+  virtual void     GetVAttrValuesI    (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const;
+
   virtual float    GetLength          () const;
   virtual float    GetMinRadiusAt     (float               Offset) const;
   virtual float    GetScale           () const;
@@ -96,6 +109,15 @@ class P3DStemModelTubeInstance : public P3DStemModelInstance
     return(Axis.GetSegOrientation(SegIndex));
    }
 
+  /* Ring mode: fill attributes of all (profile resolution + 1) vertices */
+  /* of ring RingIndex (0 - top ring) in indexed mode order, i.e. values */
+  /* of GetVAttrValueI for the same index range. Buffers and Strides (in */
+  /* bytes) are indexed by attribute, attributes with zero buffer are    */
+  /* not filled.                                                         */
+  void             GetVAttrRingValuesI(void *const        *Buffers,
+                                       const unsigned_int32 *Strides,
+                                       unsigned_int32        RingIndex) const;
+
   private          :
 
   void             CalcVertexPos      (float              *Pos,
@@ -114,6 +136,23 @@ class P3DStemModelTubeInstance : public P3DStemModelInstance
   void             CalcVertexTexCoord (float              *TexCoord,
                                        unsigned_int32        VertexIndex) const;
 
+  /* fill vertices [FirstVertex .. FirstVertex + VertexCount) of ring */
+  void             CalcRingVAttrValues(void *const        *Buffers,
+                                       const unsigned_int32 *Strides,
+                                       unsigned_int32        RingIndex,
+                                       unsigned_int32        FirstVertex,
+                                       unsigned_int32        VertexCount) const;
+
+  /* fill range of values of single attribute, RingSize - number */
+  /* of attribute values per ring                                */
+  void             CalcVAttrRangeValues
+                                      (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count,
+                                       unsigned_int32        RingSize) const;
+
   P3DMatrix4x4f                        WorldTransform;
   P3DTubeAxisSegLine                   Axis;
   P3DTubeProfileCircle                 Profile;
@@ -142,6 +181,19 @@ class P3DStemModelTube : public P3DStemModel
   virtual void     ReleaseInstance    (P3DStemModelInstance
                                                           *instance) const;
 
+  virtual P3DStemModelInstance
+                  *CreateArenaInstance(P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *rng,
+                                       const P3DStemModelInstance
+                                                          *parent,
+                                       float               offset,
+                                       const P3DQuaternionf
+                                                          *orientation) const;
+
+  virtual void     ReleaseArenaInstance
+                                      (P3DStemModelInstance
+                                                          *instance) const;
+
   virtual P3DStemModel
                   *CreateCopy         () const;
 
@@ -259,6 +311,16 @@ class P3DStemModelTube : public P3DStemModel
 
   private          :
 
+  /* create instance in Arena, or in heap if Arena is 0 */
+  P3DStemModelTubeInstance
+                  *CreateInstanceIn   (P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *rng,
+                                       const P3DStemModelInstance
+                                                          *parent,
+                                       float               offset,
+                                       const P3DQuaternionf
+                                                          *orientation) const;
+
   void             ApplyPhototropism  (P3DStemModelTubeInstance
                                                           *Instance) const;
 
@@ -29,12 +29,24 @@
 
 ***************************************************************************/
 #include <stdafx.h>
+#include <new>
 #include <ngpcore/p3dmath.h>
 #include <ngpcore/p3dmodel.h>
 
 #include <ngpcore/p3dmodelstemtube.h>
 #include <ngpcore/p3dmodelstemwings.h>
 
+/* values shared by all vertices of single row of wings */
+class P3DStemModelWingsRow
+ {
+  public           :
+
+  int                                  YSect;
+  P3DQuaternionf                       AxisOrientation;
+  P3DVector3f                          AxisPoint;
+  P3DMatrix4x4f                        WorldRotation;
+ };
+
 class P3DStemModelWingsInstance : public P3DStemModelInstance
  {
   public           :
@@ -74,6 +86,20 @@ class P3DStemModelWingsInstance : public P3DStemModelInstance
                                        unsigned_int32        Attr,
                                        unsigned_int32        Index) const;
 
+  /* Bulk mode */
+
+  virtual void     GetVAttrValues     (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const;
+
+  virtual void     GetVAttrValuesI    (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const;
+
   virtual float    GetLength          () const;
   virtual float    GetMinRadiusAt     (float               Offset) const;
   virtual float    GetScale           () const;
@@ -87,23 +113,39 @@ class P3DStemModelWingsInstance : public P3DStemModelInstance
 
   private          :
 
+  void             CalcVAttrValues    (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count,
+                                       bool                Indexed) const;
+
+  void             CalcRow            (P3DStemModelWingsRow
+                                                          *Row,
+                                       int                 YSect,
+                                       bool                NeedAxisPoint) const;
+
   void             CalcVertexPosAt    (float              *Pos,
                                        int                 XSect,
-                                       int                 YSect) const;
+                                       const P3DStemModelWingsRow
+                                                          *Row) const;
 
   void             CalcVertexNormalAt (float              *Normal,
                                        int                 XSect,
-                                       int                 YSect,
-                                       bool                Opposite) const;
+                                       bool                Opposite,
+                                       const P3DStemModelWingsRow
+                                                          *Row) const;
 
   void             CalcVertexBiNormalAt
                                       (float              *BiNormal,
-                                       int                 YSect) const;
+                                       const P3DStemModelWingsRow
+                                                          *Row) const;
 
   void             CalcVertexTangentAt(float              *Tangent,
                                        int                 XSect,
-                                       int                 YSect,
-                                       bool                Opposite) const;
+                                       bool                Opposite,
+                                       const P3DStemModelWingsRow
+                                                          *Row) const;
 
   void             CalcVertexTexCoord0At
                                       (float              *TexCoord,
@@ -175,73 +217,12 @@ void               P3DStemModelWingsInstance::GetVAttrValue
                                        unsigned_int32        Attr,
                                        unsigned_int32        Index) const
  {
-  int                                  XSect;
-  int                                  YSect;
-  unsigned_int32                         RowSize;
-
   if (Index >= GetVAttrCount(Attr))
    {
     throw P3DExceptionGeneric("invalid attribute index");
    }
 
-  if      (Attr == P3D_ATTR_NORMAL)
-   {
-    RowSize = (SectionCount + 1) * 2;
-
-    YSect = Index / RowSize;
-    XSect = Index % RowSize;
-
-    if (XSect < (int)(RowSize / 2))
-     {
-      CalcVertexNormalAt(Value,RowSize / 2 - XSect - 1,YSect,false);
-     }
-    else
-     {
-      CalcVertexNormalAt(Value,RowSize / 2 - XSect,YSect,true);
-     }
-   }
-  else if (Attr == P3D_ATTR_BINORMAL)
-   {
-    RowSize = (SectionCount + 1) * 2;
-
-    CalcVertexBiNormalAt(Value,Index / RowSize);
-   }
-  else if (Attr == P3D_ATTR_TANGENT)
-   {
-    RowSize = (SectionCount + 1) * 2;
-
-    YSect = Index / RowSize;
-    XSect = Index % RowSize;
-
-    if (XSect < (int)(RowSize / 2))
-     {
-      CalcVertexTangentAt(Value,RowSize / 2 - XSect - 1,YSect,false);
-     }
-    else
-     {
-      CalcVertexTangentAt(Value,RowSize / 2 - XSect,YSect,true);
-     }
-   }
-  else
-   {
-    RowSize = SectionCount * 2 + 1;
-
-    YSect = Index / RowSize;
-    XSect = (int)(RowSize / 2) - (Index % RowSize);
-
-    if      (Attr == P3D_ATTR_VERTEX)
-     {
-      CalcVertexPosAt(Value,XSect,YSect);
-     }
-    else if (Attr == P3D_ATTR_TEXCOORD0)
-     {
-      CalcVertexTexCoord0At(Value,XSect,YSect);
-     }
-    else
-     {
-      throw P3DExceptionGeneric("invalid attribute");
-     }
-   }
+  CalcVAttrValues(Value,0,Attr,Index,1,false);
  }
 
 unsigned_int32       P3DStemModelWingsInstance::GetVAttrCountI
@@ -255,51 +236,141 @@ void               P3DStemModelWingsInstance::GetVAttrValueI
                                        unsigned_int32        Attr,
                                        unsigned_int32        Index) const
  {
-  unsigned_int32                         RowSize;
-  int                                  XSect;
-  int                                  YSect;
-  bool                                 Opposite;
-
   if (Index >= GetVAttrCountI())
    {
     throw P3DExceptionGeneric("invalid attribute index");
    }
 
-  RowSize = (SectionCount + 1) * 2;
-
-  YSect = Index / RowSize;
-  XSect = Index % RowSize;
+  CalcVAttrValues(Value,0,Attr,Index,1,true);
+ }
 
-  if (XSect < (int)(RowSize / 2))
-   {
-    XSect    = RowSize / 2 - XSect - 1;
-    Opposite = false;
-   }
-  else
+void               P3DStemModelWingsInstance::GetVAttrValues
+                                      (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const
+ {
+  if ((FirstIndex + Count < FirstIndex) || (FirstIndex + Count > GetVAttrCount(Attr)))
    {
-    XSect    = RowSize / 2 - XSect;
-    Opposite = true;
+    throw P3DExceptionGeneric("invalid attribute index");
    }
 
-  if      (Attr == P3D_ATTR_VERTEX)
-   {
-    CalcVertexPosAt(Value,XSect,YSect);
-   }
-  else if (Attr == P3D_ATTR_NORMAL)
+  CalcVAttrValues(Buffer,Stride,Attr,FirstIndex,Count,false);
+ }
+
+void               P3DStemModelWingsInstance::GetVAttrValuesI
+                                      (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count) const
+ {
+  if ((FirstIndex + Count < FirstIndex) || (FirstIndex + Count > GetVAttrCountI()))
    {
-    CalcVertexNormalAt(Value,XSect,YSect,Opposite);
+    throw P3DExceptionGeneric("invalid attribute index");
    }
-  else if (Attr == P3D_ATTR_BINORMAL)
+
+  CalcVAttrValues(Buffer,Stride,Attr,FirstIndex,Count,true);
+ }
+
+/* parent axis point and orientation are calculated once per row */
+void               P3DStemModelWingsInstance::CalcVAttrValues
+                                      (void               *Buffer,
+                                       unsigned_int32        Stride,
+                                       unsigned_int32        Attr,
+                                       unsigned_int32        FirstIndex,
+                                       unsigned_int32        Count,
+                                       bool                Indexed) const
+ {
+  unsigned char                       *Dest;
+  unsigned_int32                         RowSize;
+  bool                                 DoubleSided;
+  P3DStemModelWingsRow                 Row;
+
+  /* normals, binormals and tangents (and all attributes in indexed */
+  /* mode) have separate values for both sides of the wing          */
+  DoubleSided = Indexed                    ||
+                (Attr == P3D_ATTR_NORMAL)   ||
+                (Attr == P3D_ATTR_BINORMAL) ||
+                (Attr == P3D_ATTR_TANGENT);
+
+  if (DoubleSided)
    {
-    CalcVertexBiNormalAt(Value,YSect);
+    RowSize = (SectionCount + 1) * 2;
    }
-  else if (Attr == P3D_ATTR_TANGENT)
+  else
    {
-    CalcVertexTangentAt(Value,XSect,YSect,Opposite);
+    if ((Attr != P3D_ATTR_VERTEX) && (Attr != P3D_ATTR_TEXCOORD0))
+     {
+      throw P3DExceptionGeneric("invalid attribute");
+     }
+
+    RowSize = SectionCount * 2 + 1;
    }
-  else if (Attr == P3D_ATTR_TEXCOORD0)
+
+  Dest      = (unsigned char*)Buffer;
+  Row.YSect = -1;
+
+  for (unsigned_int32 Index = FirstIndex; Index < FirstIndex + Count; Index++)
    {
-    CalcVertexTexCoord0At(Value,XSect,YSect);
+    int                                XSect;
+    int                                YSect;
+    bool                               Opposite;
+
+    YSect = Index / RowSize;
+
+    if (DoubleSided)
+     {
+      XSect = Index % RowSize;
+
+      if (XSect < (int)(RowSize / 2))
+       {
+        XSect    = RowSize / 2 - XSect - 1;
+        Opposite = false;
+       }
+      else
+       {
+        XSect    = RowSize / 2 - XSect;
+        Opposite = true;
+       }
+     }
+    else
+     {
+      XSect    = (int)(RowSize / 2) - (Index % RowSize);
+      Opposite = false;
+     }
+
+    if      (Attr == P3D_ATTR_TEXCOORD0)
+     {
+      CalcVertexTexCoord0At((float*)Dest,XSect,YSect);
+     }
+    else if (Attr < P3D_ATTR_BILLBOARD_POS)
+     {
+      if (YSect != Row.YSect)
+       {
+        CalcRow(&Row,YSect,Attr == P3D_ATTR_VERTEX);
+       }
+
+      if      (Attr == P3D_ATTR_VERTEX)
+       {
+        CalcVertexPosAt((float*)Dest,XSect,&Row);
+       }
+      else if (Attr == P3D_ATTR_NORMAL)
+       {
+        CalcVertexNormalAt((float*)Dest,XSect,Opposite,&Row);
+       }
+      else if (Attr == P3D_ATTR_BINORMAL)
+       {
+        CalcVertexBiNormalAt((float*)Dest,&Row);
+       }
+      else if (Attr == P3D_ATTR_TANGENT)
+       {
+        CalcVertexTangentAt((float*)Dest,XSect,Opposite,&Row);
+       }
+     }
+
+    Dest += Stride;
    }
  }
 
@@ -358,19 +429,38 @@ void               P3DStemModelWingsInstance::GetAxisOrientationAt
   ParentInstance->GetAxisOrientationAt(Orientation,Offset);
  }
 
+void               P3DStemModelWingsInstance::CalcRow
+                                      (P3DStemModelWingsRow
+                                                          *Row,
+                                       int                 YSect,
+                                       bool                NeedAxisPoint) const
+ {
+  float                                YFraction;
+
+  YFraction = (float)YSect / ParentStemModel->GetAxisResolution();
+
+  ParentInstance->GetAxisOrientationAt(Row->AxisOrientation.q,YFraction);
+
+  if (NeedAxisPoint)
+   {
+    ParentInstance->GetAxisPointAt(Row->AxisPoint.v,YFraction);
+   }
+
+  P3DMatrix4x4f::GetRotationOnly(Row->WorldRotation.m,WorldTransform.m);
+
+  Row->YSect = YSect;
+ }
+
 void               P3DStemModelWingsInstance::CalcVertexPosAt
                                       (float              *Pos,
                                        int                 XSect,
-                                       int                 YSect) const
+                                       const P3DStemModelWingsRow
+                                                          *Row) const
  {
-  P3DVector3f                          AxisPoint;
-  P3DQuaternionf                       AxisOrientation;
   P3DVector3f                          TempPos;
   float                                XFraction;
-  float                                YFraction;
 
   XFraction = (float)XSect / SectionCount;
-  YFraction = (float)YSect / ParentStemModel->GetAxisResolution();
 
   TempPos.X() = Width * XFraction;
   TempPos.Y() = 0.0f;
@@ -384,13 +474,10 @@ void               P3DStemModelWingsInstance::CalcVertexPosAt
     TempPos.Z() = (Curvature->GetValue(XFraction) - 0.5f) * Thickness;
    }
 
-  ParentInstance->GetAxisOrientationAt(AxisOrientation.q,YFraction);
-  ParentInstance->GetAxisPointAt(AxisPoint.v,YFraction);
-
   P3DQuaternionf::RotateVector(TempPos.v,Rotation.q);
-  P3DQuaternionf::RotateVector(TempPos.v,AxisOrientation.q);
+  P3DQuaternionf::RotateVector(TempPos.v,Row->AxisOrientation.q);
 
-  TempPos += AxisPoint;
+  TempPos += Row->AxisPoint;
 
   P3DVector3f::MultMatrix(Pos,&WorldTransform,TempPos.v);
  }
@@ -398,14 +485,12 @@ void               P3DStemModelWingsInstance::CalcVertexPosAt
 void               P3DStemModelWingsInstance::CalcVertexNormalAt
                                       (float              *Normal,
                                        int                 XSect,
-                                       int                 YSect,
-                                       bool                Opposite) const
+                                       bool                Opposite,
+                                       const P3DStemModelWingsRow
+                                                          *Row) const
  {
-  P3DQuaternionf                       AxisOrientation;
   float                                XFraction;
-  float                                YFraction;
   P3DVector3f                          VertexNormal(0.0f,0.0f,1.0f);
-  P3DMatrix4x4f                        WorldRotation;
 
   if (XSect < 0)
    {
@@ -413,7 +498,6 @@ void               P3DStemModelWingsInstance::CalcVertexNormalAt
    }
 
   XFraction = (float)XSect / SectionCount;
-  YFraction = (float)YSect / ParentStemModel->GetAxisResolution();
 
   VertexNormal.X() = Curvature->GetTangent(XFraction);
 
@@ -424,14 +508,10 @@ void               P3DStemModelWingsInstance::CalcVertexNormalAt
 
   VertexNormal.Normalize();
 
-  ParentInstance->GetAxisOrientationAt(AxisOrientation.q,YFraction);
-
   P3DQuaternionf::RotateVector(VertexNormal.v,Rotation.q);
-  P3DQuaternionf::RotateVector(VertexNormal.v,AxisOrientation.q);
+  P3DQuaternionf::RotateVector(VertexNormal.v,Row->AxisOrientation.q);
 
-  P3DMatrix4x4f::GetRotationOnly(WorldRotation.m,WorldTransform.m);
-
-  VertexNormal.MultMatrix(&WorldRotation);
+  VertexNormal.MultMatrix(&Row->WorldRotation);
   VertexNormal.Normalize();
 
   Normal[0] = VertexNormal.X();
@@ -441,22 +521,14 @@ void               P3DStemModelWingsInstance::CalcVertexNormalAt
 
 void               P3DStemModelWingsInstance::CalcVertexBiNormalAt
                                       (float              *BiNormal,
-                                       int                 YSect) const
+                                       const P3DStemModelWingsRow
+                                                          *Row) const
  {
-  P3DQuaternionf                       AxisOrientation;
-  float                                YFraction;
   P3DVector3f                          VertexBiNormal(0.0f,1.0f,0.0f);
-  P3DMatrix4x4f                        WorldRotation;
 
-  YFraction = (float)YSect / ParentStemModel->GetAxisResolution();
+  P3DQuaternionf::RotateVector(VertexBiNormal.v,Row->AxisOrientation.q);
 
-  ParentInstance->GetAxisOrientationAt(AxisOrientation.q,YFraction);
-
-  P3DQuaternionf::RotateVector(VertexBiNormal.v,AxisOrientation.q);
-
-  P3DMatrix4x4f::GetRotationOnly(WorldRotation.m,WorldTransform.m);
-
-  VertexBiNormal.MultMatrix(&WorldRotation);
+  VertexBiNormal.MultMatrix(&Row->WorldRotation);
   VertexBiNormal.Normalize();
 
   BiNormal[0] = VertexBiNormal.X();
@@ -468,14 +540,15 @@ void               P3DStemModelWingsInstance::CalcVertexBiNormalAt
 void               P3DStemModelWingsInstance::CalcVertexTangentAt
                                       (float              *Tangent,
                                        int                 XSect,
-                                       int                 YSect,
-                                       bool                Opposite) const
+                                       bool                Opposite,
+                                       const P3DStemModelWingsRow
+                                                          *Row) const
  {
   float                                Normal[3];
   float                                BiNormal[3];
 
-  CalcVertexNormalAt(Normal,XSect,YSect,Opposite);
-  CalcVertexBiNormalAt(BiNormal,YSect);
+  CalcVertexNormalAt(Normal,XSect,Opposite,Row);
+  CalcVertexBiNormalAt(BiNormal,Row);
 
   P3DVector3f::CrossProduct(Tangent,BiNormal,Normal);
  }
@@ -514,7 +587,7 @@ P3DStemModel      *P3DStemModelWings::CreateCopy
  {
   P3DStemModelWings                   *Result;
 
-  Result = new P3DStemModelWings(0);
+  Result = new P3DStemModelWings(ParentStemModel);
 
   Result->WingsAngle   = WingsAngle;
   Result->Width        = Width;
@@ -526,8 +599,9 @@ P3DStemModel      *P3DStemModelWings::CreateCopy
  }
 
 P3DStemModelInstance
-                  *P3DStemModelWings::CreateInstance
-                                      (P3DMathRNG         *RNG P3D_UNUSED_ATTR,
+                  *P3DStemModelWings::CreateInstanceIn
+                                      (P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *RNG P3D_UNUSED_ATTR,
                                        const P3DStemModelInstance
                                                           *Parent,
                                        float               Offset P3D_UNUSED_ATTR,
@@ -546,14 +620,41 @@ P3DStemModelInstance
 
   Parent->GetWorldTransform(ParentTransform.m);
 
-  return(new P3DStemModelWingsInstance( ParentStemModel,
-                                        ParentInstance,
-                                        SectionCount,
-                                        Width,
-                                       &Curvature,
-                                        Thickness,
-                                       &ParentTransform,
-                                        Orientation));
+  if (Arena != 0)
+   {
+    return(new(Arena->Allocate(sizeof(P3DStemModelWingsInstance)))
+            P3DStemModelWingsInstance( ParentStemModel,
+                                       ParentInstance,
+                                       SectionCount,
+                                       Width,
+                                      &Curvature,
+                                       Thickness,
+                                      &ParentTransform,
+                                       Orientation));
+   }
+  else
+   {
+    return(new P3DStemModelWingsInstance( ParentStemModel,
+                                          ParentInstance,
+                                          SectionCount,
+                                          Width,
+                                         &Curvature,
+                                          Thickness,
+                                         &ParentTransform,
+                                          Orientation));
+   }
+ }
+
+P3DStemModelInstance
+                  *P3DStemModelWings::CreateInstance
+                                      (P3DMathRNG         *RNG,
+                                       const P3DStemModelInstance
+                                                          *Parent,
+                                       float               Offset,
+                                       const P3DQuaternionf
+                                                          *Orientation) const
+ {
+  return(CreateInstanceIn(0,RNG,Parent,Offset,Orientation));
  }
 
 void               P3DStemModelWings::ReleaseInstance
@@ -563,6 +664,26 @@ void               P3DStemModelWings::ReleaseInstance
   delete Instance;
  }
 
+P3DStemModelInstance
+                  *P3DStemModelWings::CreateArenaInstance
+                                      (P3DMemoryArena     *Arena,
+                                       P3DMathRNG         *RNG,
+                                       const P3DStemModelInstance
+                                                          *Parent,
+                                       float               Offset,
+                                       const P3DQuaternionf
+                                                          *Orientation) const
+ {
+  return(CreateInstanceIn(Arena,RNG,Parent,Offset,Orientation));
+ }
+
+void               P3DStemModelWings::ReleaseArenaInstance
+                                      (P3DStemModelInstance
+                                                          *Instance) const
+ {
+  Instance->~P3DStemModelInstance();
+ }
+
 bool               P3DStemModelWings::IsCloneable
                                       (bool AllowScaling) const
  {
@@ -830,12 +951,16 @@ void               P3DStemModelWings::Load
   P3DLoadSplineCurve(&Curvature,SourceStream,StrValue);
   SourceStream->ReadFmtStringTagged("Thickness","f",&FloatValue);
   SetThickness(FloatValue);
+
+  Touch();
  }
 
 void               P3DStemModelWings::SetWingsAngle
                                       (float               Angle)
  {
   this->WingsAngle = P3DMath::Clampf(-P3DMATH_PI / 2.0f,P3DMATH_PI / 2.0f,Angle);
+
+  Touch();
  }
 
 float              P3DStemModelWings::GetWingsAngle
@@ -848,6 +973,8 @@ void               P3DStemModelWings::SetWidth
                                       (float               Width)
  {
   this->Width = P3DMath::Clampf(0.0f,100.0f,Width);
+
+  Touch();
  }
 
 float              P3DStemModelWings::GetWidth
@@ -867,6 +994,8 @@ void               P3DStemModelWings::SetSectionCount
    {
     this->SectionCount = 1;
    }
+
+  Touch();
  }
 
 unsigned_int32       P3DStemModelWings::GetSectionCount
@@ -880,6 +1009,8 @@ void               P3DStemModelWings::SetCurvature
                                                           *Curve)
  {
   Curvature.CopyFrom(*Curve);
+
+  Touch();
  }
 
 const P3DMathNaturalCubicSpline
@@ -900,6 +1031,8 @@ void               P3DStemModelWings::SetThickness
    {
     this->Thickness = 0.0f;
    }
+
+  Touch();
  }
 
 float              P3DStemModelWings::GetThickness
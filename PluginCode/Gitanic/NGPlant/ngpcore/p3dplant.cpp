@@ -34,6 +34,8 @@
 
 #include <ngpcore/p3dmath.h>
 
+#include <ngpcore/p3dthread.h>
+
 #include <ngpcore/p3dplant.h>
 
                    P3DTubeAxisLine::P3DTubeAxisLine
@@ -80,14 +82,24 @@ void               P3DTubeAxisLine::GetOrientationAt
 
                    P3DTubeAxisSegLine::P3DTubeAxisSegLine
                                       (float               Length,
-                                       unsigned_int32        Resolution)
+                                       unsigned_int32        Resolution,
+                                       P3DMemoryArena     *Arena)
  {
   this->Length     = Length;
   this->Resolution = Resolution;
 
+  SegOrientationsOwned = Arena == 0;
+
   if (Resolution > 1)
    {
-    SegOrientations = new float[4 * (Resolution - 1)];
+    if (Arena != 0)
+     {
+      SegOrientations = (float*)Arena->Allocate(sizeof(float) * 4 * (Resolution - 1));
+     }
+    else
+     {
+      SegOrientations = new float[4 * (Resolution - 1)];
+     }
 
     for (unsigned_int32 SegIndex = 0; SegIndex < (Resolution - 1); SegIndex++)
      {
@@ -104,7 +116,10 @@ void               P3DTubeAxisLine::GetOrientationAt
                    P3DTubeAxisSegLine::~P3DTubeAxisSegLine
                                       ()
  {
-  delete[] SegOrientations;
+  if (SegOrientationsOwned)
+   {
+    delete[] SegOrientations;
+   }
  }
 
 unsigned_int32       P3DTubeAxisSegLine::GetResolution
@@ -295,10 +310,126 @@ void               P3DTubeAxisSegLine::SetSegOrientation
    }
  }
 
+/* Sin/cos tables are shared between all circle profiles of the same  */
+/* resolution. Table is never modified after it is built, so it may be */
+/* read from any number of threads; only lookup is serialized.         */
+class P3DTubeProfileCircleTableCache
+ {
+  public           :
+
+                   P3DTubeProfileCircleTableCache
+                                      ();
+                  ~P3DTubeProfileCircleTableCache
+                                      ();
+
+  const float     *GetTable           (unsigned_int32        Resolution);
+
+  private          :
+
+  struct TableEntry
+   {
+    unsigned_int32                       Resolution;
+    float                             *SinCos;
+    TableEntry                        *Next;
+   };
+
+  P3DMutex                             Mutex;
+  TableEntry                          *Tables;
+ };
+
+                   P3DTubeProfileCircleTableCache::P3DTubeProfileCircleTableCache
+                                      ()
+ {
+  Tables = 0;
+ }
+
+                   P3DTubeProfileCircleTableCache::~P3DTubeProfileCircleTableCache
+                                      ()
+ {
+  while (Tables != 0)
+   {
+    TableEntry                        *Entry;
+
+    Entry  = Tables;
+    Tables = Entry->Next;
+
+    delete[] Entry->SinCos;
+    delete Entry;
+   }
+ }
+
+const float       *P3DTubeProfileCircleTableCache::GetTable
+                                      (unsigned_int32        Resolution)
+ {
+  TableEntry                          *Entry;
+
+  Mutex.Lock();
+
+  Entry = Tables;
+
+  while ((Entry != 0) && (Entry->Resolution != Resolution))
+   {
+    Entry = Entry->Next;
+   }
+
+  if (Entry == 0)
+   {
+    try
+     {
+      Entry = new TableEntry;
+
+      Entry->Resolution = Resolution;
+      Entry->SinCos     = 0;
+
+      Entry->SinCos = new float[Resolution * 2];
+
+      for (unsigned_int32 t = 0; t < Resolution; t++)
+       {
+        float                          a;
+
+        /* must be computed exactly as in P3DTubeProfileCircle::GetPoint */
+        a = ((float)t / Resolution) * 2.0f * P3DMATH_PI;
+
+        P3DMath::SinCosf(&Entry->SinCos[t * 2],&Entry->SinCos[t * 2 + 1],a);
+       }
+
+      Entry->Next = Tables;
+      Tables      = Entry;
+     }
+    catch (...)
+     {
+      if (Entry != 0)
+       {
+        delete[] Entry->SinCos;
+        delete Entry;
+       }
+
+      Mutex.Unlock();
+
+      throw;
+     }
+   }
+
+  Mutex.Unlock();
+
+  return(Entry->SinCos);
+ }
+
+static P3DTubeProfileCircleTableCache  P3DTubeProfileCircleTables;
+
                    P3DTubeProfileCircle::P3DTubeProfileCircle
                                       (unsigned_int32        Resolution)
  {
   this->Resolution = Resolution;
+
+  if (Resolution > 0)
+   {
+    SinCosTable = P3DTubeProfileCircleTables.GetTable(Resolution);
+   }
+  else
+   {
+    SinCosTable = 0;
+   }
  }
 
 unsigned_int32       P3DTubeProfileCircle::GetResolution
@@ -312,11 +443,19 @@ void               P3DTubeProfileCircle::GetPoint
                                        float              &y,
                                        unsigned_int32        t) const
  {
-  float                              a;
+  if (t < Resolution)
+   {
+    x = SinCosTable[t * 2];
+    y = SinCosTable[t * 2 + 1];
+   }
+  else
+   {
+    float                              a;
 
-  a = ((float)t / Resolution) * 2.0f * P3DMATH_PI;
+    a = ((float)t / Resolution) * 2.0f * P3DMATH_PI;
 
-  P3DMath::SinCosf(&x,&y,a);
+    P3DMath::SinCosf(&x,&y,a);
+   }
  }
 
 void               P3DTubeProfileCircle::GetNormal
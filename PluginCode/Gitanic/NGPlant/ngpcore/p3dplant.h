@@ -34,6 +34,7 @@
 
 #include <ngpcore/p3dtypes.h>
 #include <ngpcore/p3dmathspline.h>
+#include <ngpcore/p3dmemarena.h>
 
 class P3DTubeAxis
  {
@@ -123,7 +124,8 @@ class P3DTubeAxisSegLine : public P3DTubeAxis
   public           :
 
                    P3DTubeAxisSegLine (float               Length,
-                                       unsigned_int32        Resolution);
+                                       unsigned_int32        Resolution,
+                                       P3DMemoryArena     *Arena = 0);
 
   virtual         ~P3DTubeAxisSegLine ();
 
@@ -157,6 +159,8 @@ class P3DTubeAxisSegLine : public P3DTubeAxis
 	  unsigned_int32     Resolution;
   float            Length;
   float           *SegOrientations;
+  /* false if SegOrientations are allocated from arena */
+  bool             SegOrientationsOwned;
  };
 
 class P3DTubeProfileCircle : public P3DTubeProfile
@@ -180,6 +184,9 @@ class P3DTubeProfileCircle : public P3DTubeProfile
   private          :
 
   unsigned_int32     Resolution;
+  /* shared immutable table of (sin,cos) pairs for each profile point, */
+  /* built once per resolution and owned by the table cache             */
+  const float     *SinCosTable;
  };
 
 class P3DTubeProfileScaleLinear : public P3DTubeProfileScale
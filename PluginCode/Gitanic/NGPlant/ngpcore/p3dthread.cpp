@@ -0,0 +1,761 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#include <stdafx.h>
+
+#if defined(_WIN32)
+ #include <windows.h>
+ #include <process.h>
+#else
+ #include <pthread.h>
+ #include <unistd.h>
+#endif
+
+#include <ngpcore/p3dexcept.h>
+#include <ngpcore/p3dthread.h>
+
+#if defined(_WIN32)
+
+                   P3DMutex::P3DMutex ()
+ {
+  CRITICAL_SECTION                    *CriticalSection;
+
+  CriticalSection = new CRITICAL_SECTION;
+
+  InitializeCriticalSection(CriticalSection);
+
+  Handle = CriticalSection;
+ }
+
+                   P3DMutex::~P3DMutex()
+ {
+  DeleteCriticalSection((CRITICAL_SECTION*)Handle);
+
+  delete (CRITICAL_SECTION*)Handle;
+ }
+
+void               P3DMutex::Lock     ()
+ {
+  EnterCriticalSection((CRITICAL_SECTION*)Handle);
+ }
+
+void               P3DMutex::Unlock   ()
+ {
+  LeaveCriticalSection((CRITICAL_SECTION*)Handle);
+ }
+
+                   P3DCondition::P3DCondition
+                                      ()
+ {
+  CONDITION_VARIABLE                  *Condition;
+
+  Condition = new CONDITION_VARIABLE;
+
+  InitializeConditionVariable(Condition);
+
+  Handle = Condition;
+ }
+
+                   P3DCondition::~P3DCondition
+                                      ()
+ {
+  delete (CONDITION_VARIABLE*)Handle;
+ }
+
+void               P3DCondition::Wait (P3DMutex           *Mutex)
+ {
+  SleepConditionVariableCS((CONDITION_VARIABLE*)Handle,
+                           (CRITICAL_SECTION*)Mutex->Handle,
+                           INFINITE);
+ }
+
+void               P3DCondition::Signal
+                                      ()
+ {
+  WakeConditionVariable((CONDITION_VARIABLE*)Handle);
+ }
+
+void               P3DCondition::Broadcast
+                                      ()
+ {
+  WakeAllConditionVariable((CONDITION_VARIABLE*)Handle);
+ }
+
+static unsigned __stdcall P3DThreadEntry
+                                      (void               *Param)
+ {
+  ((P3DThread*)Param)->Run();
+
+  return(0);
+ }
+
+void               P3DThread::Start   ()
+ {
+  uintptr_t                            ThreadHandle;
+
+  ThreadHandle = _beginthreadex(NULL,0,P3DThreadEntry,this,0,NULL);
+
+  if (ThreadHandle == 0)
+   {
+    throw P3DExceptionGeneric("unable to create thread");
+   }
+
+  Handle = (void*)ThreadHandle;
+ }
+
+void               P3DThread::Join    ()
+ {
+  if (Handle != 0)
+   {
+    WaitForSingleObject((HANDLE)Handle,INFINITE);
+    CloseHandle((HANDLE)Handle);
+
+    Handle = 0;
+   }
+ }
+
+unsigned_int32       P3DThread::GetProcessorCount
+                                      ()
+ {
+  SYSTEM_INFO                          SystemInfo;
+
+  GetSystemInfo(&SystemInfo);
+
+  return(SystemInfo.dwNumberOfProcessors > 0 ? SystemInfo.dwNumberOfProcessors : 1);
+ }
+
+void              *P3DAtomic::CompareExchangePointer
+                                      (void *volatile     *Target,
+                                       void               *NewValue,
+                                       void               *Comparand)
+ {
+  return(InterlockedCompareExchangePointer(Target,NewValue,Comparand));
+ }
+
+void              *P3DAtomic::ExchangePointer
+                                      (void *volatile     *Target,
+                                       void               *NewValue)
+ {
+  return(InterlockedExchangePointer(Target,NewValue));
+ }
+
+int32              P3DAtomic::Add     (volatile int32     *Target,
+                                       int32               Value)
+ {
+  return(InterlockedExchangeAdd((volatile LONG*)Target,Value) + Value);
+ }
+
+#else
+
+                   P3DMutex::P3DMutex ()
+ {
+  pthread_mutex_t                     *Mutex;
+
+  Mutex = new pthread_mutex_t;
+
+  pthread_mutex_init(Mutex,NULL);
+
+  Handle = Mutex;
+ }
+
+                   P3DMutex::~P3DMutex()
+ {
+  pthread_mutex_destroy((pthread_mutex_t*)Handle);
+
+  delete (pthread_mutex_t*)Handle;
+ }
+
+void               P3DMutex::Lock     ()
+ {
+  pthread_mutex_lock((pthread_mutex_t*)Handle);
+ }
+
+void               P3DMutex::Unlock   ()
+ {
+  pthread_mutex_unlock((pthread_mutex_t*)Handle);
+ }
+
+                   P3DCondition::P3DCondition
+                                      ()
+ {
+  pthread_cond_t                      *Condition;
+
+  Condition = new pthread_cond_t;
+
+  pthread_cond_init(Condition,NULL);
+
+  Handle = Condition;
+ }
+
+                   P3DCondition::~P3DCondition
+                                      ()
+ {
+  pthread_cond_destroy((pthread_cond_t*)Handle);
+
+  delete (pthread_cond_t*)Handle;
+ }
+
+void               P3DCondition::Wait (P3DMutex           *Mutex)
+ {
+  pthread_cond_wait((pthread_cond_t*)Handle,(pthread_mutex_t*)Mutex->Handle);
+ }
+
+void               P3DCondition::Signal
+                                      ()
+ {
+  pthread_cond_signal((pthread_cond_t*)Handle);
+ }
+
+void               P3DCondition::Broadcast
+                                      ()
+ {
+  pthread_cond_broadcast((pthread_cond_t*)Handle);
+ }
+
+extern "C"
+{
+static void       *P3DThreadEntry     (void               *Param)
+ {
+  ((P3DThread*)Param)->Run();
+
+  return(NULL);
+ }
+}
+
+void               P3DThread::Start   ()
+ {
+  pthread_t                           *Thread;
+
+  Thread = new pthread_t;
+
+  if (pthread_create(Thread,NULL,P3DThreadEntry,this) != 0)
+   {
+    delete Thread;
+
+    throw P3DExceptionGeneric("unable to create thread");
+   }
+
+  Handle = Thread;
+ }
+
+void               P3DThread::Join    ()
+ {
+  if (Handle != 0)
+   {
+    pthread_join(*((pthread_t*)Handle),NULL);
+
+    delete (pthread_t*)Handle;
+
+    Handle = 0;
+   }
+ }
+
+unsigned_int32       P3DThread::GetProcessorCount
+                                      ()
+ {
+  long                                 Count;
+
+  Count = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return(Count > 0 ? (unsigned_int32)Count : 1);
+ }
+
+void              *P3DAtomic::CompareExchangePointer
+                                      (void *volatile     *Target,
+                                       void               *NewValue,
+                                       void               *Comparand)
+ {
+  return(__sync_val_compare_and_swap(Target,Comparand,NewValue));
+ }
+
+void              *P3DAtomic::ExchangePointer
+                                      (void *volatile     *Target,
+                                       void               *NewValue)
+ {
+  void                                *Value;
+  void                                *PrevValue;
+
+  /* __sync_lock_test_and_set is only an acquire barrier */
+  Value = 0;
+
+  while ((PrevValue = __sync_val_compare_and_swap(Target,Value,NewValue)) != Value)
+   {
+    Value = PrevValue;
+   }
+
+  return(Value);
+ }
+
+int32              P3DAtomic::Add     (volatile int32     *Target,
+                                       int32               Value)
+ {
+  return(__sync_add_and_fetch(Target,Value));
+ }
+
+#endif
+
+                   P3DThread::P3DThread
+                                      ()
+ {
+  Handle = 0;
+ }
+
+                   P3DThread::~P3DThread
+                                      ()
+ {
+  Join();
+ }
+
+#if defined(_WIN32)
+ #define P3DThreadLocal __declspec(thread)
+#else
+ #define P3DThreadLocal __thread
+#endif
+
+/* pool worker running in current thread, 0 for other threads */
+static P3DThreadLocal P3DThreadPoolWorker *CurrentWorker = 0;
+
+/* task deque, protected by its own mutex, which is contended only */
+/* when other threads steal tasks                                  */
+class P3DTaskDeque
+ {
+  public           :
+
+                   P3DTaskDeque       ()
+   {
+    Tasks    = 0;
+    Groups   = 0;
+    Capacity = 0;
+    First    = 0;
+    Count    = 0;
+   }
+
+                  ~P3DTaskDeque       ()
+   {
+    delete[] Tasks;
+    delete[] Groups;
+   }
+
+  void             PushBack           (P3DTask            *Task,
+                                       P3DTaskGroup       *Group)
+   {
+    Mutex.Lock();
+
+    if (Count == Capacity)
+     {
+      P3DTask                        **NewTasks;
+      P3DTaskGroup                   **NewGroups;
+      unsigned_int32                     NewCapacity;
+
+      NewCapacity = Capacity == 0 ? 16 : Capacity * 2;
+      NewTasks    = 0;
+      NewGroups   = 0;
+
+      try
+       {
+        NewTasks  = new P3DTask*[NewCapacity];
+        NewGroups = new P3DTaskGroup*[NewCapacity];
+       }
+      catch (...)
+       {
+        delete[] NewTasks;
+
+        Mutex.Unlock();
+
+        throw;
+       }
+
+      for (unsigned_int32 Index = 0; Index < Count; Index++)
+       {
+        NewTasks[Index]  = Tasks[(First + Index) % Capacity];
+        NewGroups[Index] = Groups[(First + Index) % Capacity];
+       }
+
+      delete[] Tasks;
+      delete[] Groups;
+
+      Tasks    = NewTasks;
+      Groups   = NewGroups;
+      Capacity = NewCapacity;
+      First    = 0;
+     }
+
+    Tasks[(First + Count) % Capacity]  = Task;
+    Groups[(First + Count) % Capacity] = Group;
+
+    Count++;
+
+    Mutex.Unlock();
+   }
+
+  bool             PopBack            (P3DTask           **Task,
+                                       P3DTaskGroup      **Group)
+   {
+    bool                               Result;
+
+    Mutex.Lock();
+
+    Result = Count > 0;
+
+    if (Result)
+     {
+      Count--;
+
+      *Task  = Tasks[(First + Count) % Capacity];
+      *Group = Groups[(First + Count) % Capacity];
+     }
+
+    Mutex.Unlock();
+
+    return(Result);
+   }
+
+  bool             PopFront           (P3DTask           **Task,
+                                       P3DTaskGroup      **Group)
+   {
+    bool                               Result;
+
+    Mutex.Lock();
+
+    Result = Count > 0;
+
+    if (Result)
+     {
+      *Task  = Tasks[First];
+      *Group = Groups[First];
+      First  = (First + 1) % Capacity;
+
+      Count--;
+     }
+
+    Mutex.Unlock();
+
+    return(Result);
+   }
+
+  private          :
+
+  P3DMutex                             Mutex;
+  P3DTask                            **Tasks;
+  P3DTaskGroup                       **Groups;
+  unsigned_int32                         Capacity;
+  unsigned_int32                         First;
+  unsigned_int32                         Count;
+ };
+
+class P3DThreadPoolWorker : public P3DThread
+ {
+  public           :
+
+                   P3DThreadPoolWorker(P3DThreadPool      *Pool,
+                                       unsigned_int32        WorkerIndex)
+   {
+    this->Pool        = Pool;
+    this->WorkerIndex = WorkerIndex;
+   }
+
+  virtual void     Run                ()
+   {
+    P3DTask                           *Task;
+    P3DTaskGroup                      *Group;
+
+    CurrentWorker = this;
+
+    while (true)
+     {
+      if (Pool->FindTask(this,&Task,&Group))
+       {
+        Pool->RunTask(Task,Group);
+       }
+      else if (!Pool->Sleep(0))
+       {
+        break;
+       }
+     }
+
+    CurrentWorker = 0;
+   }
+
+  P3DThreadPool                       *Pool;
+  unsigned_int32                         WorkerIndex;
+ };
+
+                   P3DTaskGroup::P3DTaskGroup
+                                      ()
+ {
+  PendingCount = 0;
+ }
+
+                   P3DThreadPool::P3DThreadPool
+                                      (unsigned_int32        ThreadCount)
+ {
+  if (ThreadCount == 0)
+   {
+    ThreadCount = P3DThread::GetProcessorCount();
+   }
+
+  this->ThreadCount = ThreadCount;
+
+  QueuedCount   = 0;
+  SleepingCount = 0;
+  NextDeque     = 0;
+  Shutdown      = false;
+
+  Deques  = new P3DTaskDeque[ThreadCount];
+  Workers = new P3DThreadPoolWorker*[ThreadCount];
+
+  for (unsigned_int32 WorkerIndex = 0; WorkerIndex < ThreadCount; WorkerIndex++)
+   {
+    Workers[WorkerIndex] = 0;
+   }
+
+  try
+   {
+    for (unsigned_int32 WorkerIndex = 0; WorkerIndex < ThreadCount; WorkerIndex++)
+     {
+      Workers[WorkerIndex] = new P3DThreadPoolWorker(this,WorkerIndex);
+      Workers[WorkerIndex]->Start();
+     }
+   }
+  catch (...)
+   {
+    StopWorkers();
+
+    throw;
+   }
+ }
+
+                   P3DThreadPool::~P3DThreadPool
+                                      ()
+ {
+  StopWorkers();
+ }
+
+void               P3DThreadPool::StopWorkers
+                                      ()
+ {
+  Mutex.Lock();
+
+  Shutdown = true;
+
+  Condition.Broadcast();
+
+  Mutex.Unlock();
+
+  for (unsigned_int32 WorkerIndex = 0; WorkerIndex < ThreadCount; WorkerIndex++)
+   {
+    if (Workers[WorkerIndex] != 0)
+     {
+      Workers[WorkerIndex]->Join();
+
+      delete Workers[WorkerIndex];
+     }
+   }
+
+  delete[] Workers;
+  delete[] Deques;
+ }
+
+unsigned_int32       P3DThreadPool::GetThreadCount
+                                      () const
+ {
+  return(ThreadCount);
+ }
+
+P3DThreadPoolWorker
+                  *P3DThreadPool::GetCurrentWorker
+                                      () const
+ {
+  if ((CurrentWorker != 0) && (CurrentWorker->Pool == this))
+   {
+    return(CurrentWorker);
+   }
+
+  return(0);
+ }
+
+void               P3DThreadPool::Submit
+                                      (P3DTask            *Task,
+                                       P3DTaskGroup       *Group)
+ {
+  P3DThreadPoolWorker                 *Worker;
+  unsigned_int32                         DequeIndex;
+
+  Worker = GetCurrentWorker();
+
+  if (Worker != 0)
+   {
+    DequeIndex = Worker->WorkerIndex;
+   }
+  else
+   {
+    DequeIndex = (unsigned_int32)P3DAtomic::Add(&NextDeque,1) % ThreadCount;
+   }
+
+  /* counters are increased before task becomes visible, */
+  /* so they never get below actual values               */
+  P3DAtomic::Add(&Group->PendingCount,1);
+  P3DAtomic::Add(&QueuedCount,1);
+
+  try
+   {
+    Deques[DequeIndex].PushBack(Task,Group);
+   }
+  catch (...)
+   {
+    P3DAtomic::Add(&QueuedCount,-1);
+    P3DAtomic::Add(&Group->PendingCount,-1);
+
+    throw;
+   }
+
+  WakeUp(false);
+ }
+
+void               P3DThreadPool::Wait(P3DTaskGroup       *Group)
+ {
+  P3DThreadPoolWorker                 *Worker;
+  P3DTask                             *Task;
+  P3DTaskGroup                        *TaskGroup;
+
+  Worker = GetCurrentWorker();
+
+  while (P3DAtomic::Add(&Group->PendingCount,0) > 0)
+   {
+    if (FindTask(Worker,&Task,&TaskGroup))
+     {
+      RunTask(Task,TaskGroup);
+     }
+    else
+     {
+      Sleep(Group);
+     }
+   }
+ }
+
+bool               P3DThreadPool::FindTask
+                                      (P3DThreadPoolWorker*Worker,
+                                       P3DTask           **Task,
+                                       P3DTaskGroup      **Group)
+ {
+  unsigned_int32                         FirstDeque;
+  bool                                 Found;
+
+  if (Worker != 0)
+   {
+    FirstDeque = Worker->WorkerIndex;
+    Found      = Deques[FirstDeque].PopBack(Task,Group);
+   }
+  else
+   {
+    FirstDeque = 0;
+    Found      = false;
+   }
+
+  for (unsigned_int32 Index = Worker != 0 ? 1 : 0; (!Found) && (Index < ThreadCount); Index++)
+   {
+    Found = Deques[(FirstDeque + Index) % ThreadCount].PopFront(Task,Group);
+   }
+
+  if (Found)
+   {
+    P3DAtomic::Add(&QueuedCount,-1);
+   }
+
+  return(Found);
+ }
+
+void               P3DThreadPool::RunTask
+                                      (P3DTask            *Task,
+                                       P3DTaskGroup       *Group)
+ {
+  try
+   {
+    Task->Run();
+   }
+  catch (...)
+   {
+   }
+
+  if (P3DAtomic::Add(&Group->PendingCount,-1) == 0)
+   {
+    /* thread waiting for this group may sleep */
+    WakeUp(true);
+   }
+ }
+
+/* Sleeping thread increases SleepingCount before it checks conditions */
+/* under Mutex, and waking thread changes conditions before it checks  */
+/* SleepingCount, so at least one of them sees the change of other one */
+bool               P3DThreadPool::Sleep
+                                      (P3DTaskGroup       *Group)
+ {
+  bool                                 Result;
+
+  Mutex.Lock();
+
+  P3DAtomic::Add(&SleepingCount,1);
+
+  while ((P3DAtomic::Add(&QueuedCount,0) == 0) &&
+         (!Shutdown) &&
+         ((Group == 0) || (P3DAtomic::Add(&Group->PendingCount,0) > 0)))
+   {
+    Condition.Wait(&Mutex);
+   }
+
+  P3DAtomic::Add(&SleepingCount,-1);
+
+  Result = (!Shutdown) || (P3DAtomic::Add(&QueuedCount,0) > 0);
+
+  Mutex.Unlock();
+
+  return(Result);
+ }
+
+void               P3DThreadPool::WakeUp
+                                      (bool                All)
+ {
+  if (P3DAtomic::Add(&SleepingCount,0) > 0)
+   {
+    Mutex.Lock();
+
+    if (All)
+     {
+      Condition.Broadcast();
+     }
+    else
+     {
+      Condition.Signal();
+     }
+
+    Mutex.Unlock();
+   }
+ }
@@ -0,0 +1,210 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#ifndef __P3DTHREAD_H__
+#define __P3DTHREAD_H__
+
+#include <ngpcore/p3ddefs.h>
+
+class P3D_DLL_ENTRY P3DMutex
+ {
+  public           :
+
+                   P3DMutex           ();
+                  ~P3DMutex           ();
+
+  void             Lock               ();
+  void             Unlock             ();
+
+  private          :
+
+                   P3DMutex           (const P3DMutex     &Source);
+  P3DMutex        &operator =         (const P3DMutex     &Source);
+
+  void                                *Handle;
+
+  friend class P3DCondition;
+ };
+
+class P3D_DLL_ENTRY P3DCondition
+ {
+  public           :
+
+                   P3DCondition       ();
+                  ~P3DCondition       ();
+
+  /* Mutex must be locked by calling thread */
+  void             Wait               (P3DMutex           *Mutex);
+  void             Signal             ();
+  void             Broadcast          ();
+
+  private          :
+
+                   P3DCondition       (const P3DCondition &Source);
+  P3DCondition    &operator =         (const P3DCondition &Source);
+
+  void                                *Handle;
+ };
+
+class P3D_DLL_ENTRY P3DThread
+ {
+  public           :
+
+                   P3DThread          ();
+  virtual         ~P3DThread          ();
+
+  void             Start              ();
+  void             Join               ();
+
+  virtual void     Run                () = 0;
+
+  static
+  unsigned_int32     GetProcessorCount  ();
+
+  private          :
+
+                   P3DThread          (const P3DThread    &Source);
+  P3DThread       &operator =         (const P3DThread    &Source);
+
+  void                                *Handle;
+ };
+
+class P3D_DLL_ENTRY P3DAtomic
+ {
+  public           :
+
+  /* Stores NewValue to *Target if *Target is equal to Comparand, */
+  /* returns initial value of *Target. Both functions act as full */
+  /* memory barrier.                                              */
+  static void     *CompareExchangePointer
+                                      (void *volatile     *Target,
+                                       void               *NewValue,
+                                       void               *Comparand);
+
+  static void     *ExchangePointer    (void *volatile     *Target,
+                                       void               *NewValue);
+
+  /* Adds Value to *Target and returns new value of *Target, */
+  /* acts as full memory barrier. Add(Target,0) reads value. */
+  static int32     Add                (volatile int32     *Target,
+                                       int32               Value);
+ };
+
+class P3D_DLL_ENTRY P3DTask
+ {
+  public           :
+
+  virtual         ~P3DTask            () {};
+
+  /* must not throw exceptions */
+  virtual void     Run                () = 0;
+ };
+
+class P3DTaskDeque;
+class P3DThreadPoolWorker;
+
+/* Set of tasks which may be waited for together. Group must not be */
+/* destroyed until all its tasks are completed.                     */
+class P3D_DLL_ENTRY P3DTaskGroup
+ {
+  public           :
+
+                   P3DTaskGroup       ();
+
+  private          :
+
+                   P3DTaskGroup       (const P3DTaskGroup &Source);
+  P3DTaskGroup    &operator =         (const P3DTaskGroup &Source);
+
+  /* submitted but not completed tasks */
+  volatile int32                       PendingCount;
+
+  friend class P3DThreadPool;
+ };
+
+/* Work-stealing thread pool. Each worker has its own task deque, takes */
+/* tasks from its back and steals from the front of other workers'      */
+/* deques when its own one is empty. Tasks submitted by worker are put  */
+/* into its own deque, other tasks are spread between all deques. Pool  */
+/* mutex is used only to put idle threads to sleep and wake them up.    */
+/* Pool does not own submitted tasks.                                   */
+class P3D_DLL_ENTRY P3DThreadPool
+ {
+  public           :
+
+                   P3DThreadPool      (unsigned_int32        ThreadCount = 0);
+                  ~P3DThreadPool      ();
+
+  unsigned_int32     GetThreadCount     () const;
+
+  void             Submit             (P3DTask            *Task,
+                                       P3DTaskGroup       *Group);
+  /* Wait until all tasks of Group are completed. Calling thread runs  */
+  /* queued tasks (of any group) meanwhile, so tasks may submit tasks  */
+  /* of their own groups and wait for them without blocking the pool.  */
+  void             Wait               (P3DTaskGroup       *Group);
+
+  private          :
+
+                   P3DThreadPool      (const P3DThreadPool&Source);
+  P3DThreadPool   &operator =         (const P3DThreadPool&Source);
+
+  /* returns false if there are no queued tasks, Worker is 0 */
+  /* if calling thread is not a worker of this pool          */
+  bool             FindTask           (P3DThreadPoolWorker*Worker,
+                                       P3DTask           **Task,
+                                       P3DTaskGroup      **Group);
+  void             RunTask            (P3DTask            *Task,
+                                       P3DTaskGroup       *Group);
+  /* sleep until task is queued, pool is shut down or Group (if not 0) */
+  /* is completed; returns false if pool is shut down and idle         */
+  bool             Sleep              (P3DTaskGroup       *Group);
+  void             WakeUp             (bool                All);
+  P3DThreadPoolWorker
+                  *GetCurrentWorker   () const;
+  void             StopWorkers        ();
+
+  unsigned_int32                         ThreadCount;
+  P3DTaskDeque                        *Deques;
+  P3DThreadPoolWorker                **Workers;
+  P3DMutex                             Mutex;
+  P3DCondition                         Condition;
+  volatile int32                       QueuedCount;
+  volatile int32                       SleepingCount;
+  volatile int32                       NextDeque;
+  /* protected by Mutex */
+  bool                                 Shutdown;
+
+  friend class P3DThreadPoolWorker;
+ };
+
+#endif
+
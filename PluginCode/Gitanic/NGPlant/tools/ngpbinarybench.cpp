@@ -0,0 +1,445 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+/* Binary .ngp format benchmark. Converts text model to binary one,    */
+/* checks that binary file holds the same model (same text when saved  */
+/* back and the same generated geometry) and compares template load    */
+/* time of binary format with original text loader (which is the 10x   */
+/* speedup target) and with current text loader. Built-in test model   */
+/* is used if no file is given.                                        */
+/*                                                                     */
+/* Usage: ngpbinarybench [model.ngp [repeat count]]                    */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+
+#include <ngpcore/p3dexcept.h>
+#include <ngpcore/p3diostream.h>
+#include <ngpcore/p3diostreamadd.h>
+
+#include <tools/ngptools.h>
+
+#define DEFAULT_REPEAT_COUNT  (200)
+#define TEXT_TEMP_FILE_NAME   "ngpbinarybench.tmp.ngp"
+#define BINARY_TEMP_FILE_NAME "ngpbinarybench.tmp.ngpb"
+#define SPEEDUP_TARGET        (10.0)
+/* loads of every kind are timed in turns, best pass is taken */
+#define PASS_COUNT            (5)
+#define LINE_BUFFER_SIZE      (1024)
+#define VALUE_BUFFER_SIZE     (256)
+
+/* Text stream which reads file the way text models were loaded before */
+/* text loading was optimized: file is read by fgetc, numeric locale   */
+/* is switched to "C" (with copy of old locale name) for every line    */
+/* and every number is parsed by sscanf. Lines are parsed once more by */
+/* P3DInputStringFmtStream, so it is slightly slower than original     */
+/* loader was.                                                         */
+class ReferenceTextStream : public P3DInputStringStream
+ {
+  public           :
+
+                   ReferenceTextStream(const char         *FileName)
+   {
+    Source = fopen(FileName,"rb");
+
+    if (Source == NULL)
+     {
+      throw P3DExceptionIO();
+     }
+   }
+
+  virtual         ~ReferenceTextStream()
+   {
+    fclose(Source);
+   }
+
+  virtual
+  void             ReadString         (char               *Buffer,
+                                       unsigned_int32        BufferSize)
+   {
+    char                              *OldLocale;
+    const char                        *CurrLocale;
+
+    CurrLocale = setlocale(LC_NUMERIC,NULL);
+    OldLocale  = CurrLocale != NULL ? strdup(CurrLocale) : NULL;
+
+    setlocale(LC_NUMERIC,"C");
+
+    ReadLine(Buffer,BufferSize);
+    ScanNumbers(Buffer);
+
+    if (OldLocale != NULL)
+     {
+      setlocale(LC_NUMERIC,OldLocale);
+
+      free(OldLocale);
+     }
+   }
+
+  virtual bool     Eof                () const
+   {
+    int                                TempChar;
+
+    TempChar = fgetc(Source);
+
+    ungetc(TempChar,Source);
+
+    return(TempChar == EOF);
+   }
+
+  private          :
+
+  void             ReadLine           (char               *Buffer,
+                                       unsigned_int32        BufferSize)
+   {
+    int                                CurrChar;
+    unsigned_int32                       Index;
+
+    Index = 0;
+
+    while (Index < (BufferSize - 1))
+     {
+      CurrChar = fgetc(Source);
+
+      if      (CurrChar == EOF)
+       {
+        if (ferror(Source))
+         {
+          throw P3DExceptionIO();
+         }
+
+        break;
+       }
+      else if (CurrChar == '\n')
+       {
+        break;
+       }
+      else if (CurrChar != '\r')
+       {
+        Buffer[Index++] = (char)CurrChar;
+       }
+     }
+
+    Buffer[Index] = 0;
+   }
+
+  /* Words after tag are parsed as floats if they contain decimal */
+  /* point and as unsigned integers if they start with digit,     */
+  /* like "f" and "u" fields were                                 */
+  static void      ScanNumbers        (const char         *Line)
+   {
+    char                               Value[VALUE_BUFFER_SIZE];
+    const char                        *WordStart;
+    const char                        *WordEnd;
+    size_t                             Length;
+    float                              FloatValue;
+    unsigned int                       UIntValue;
+
+    WordEnd = Line + strspn(Line," \t");
+    WordEnd = WordEnd + strcspn(WordEnd," \t");
+
+    while (*WordEnd != 0)
+     {
+      WordStart = WordEnd + strspn(WordEnd," \t");
+      Length    = strcspn(WordStart," \t");
+      WordEnd   = WordStart + Length;
+
+      if ((Length == 0) || (Length >= sizeof(Value)))
+       {
+        continue;
+       }
+
+      memcpy(Value,WordStart,Length);
+
+      Value[Length] = 0;
+
+      if      (strchr(Value,'.') != NULL)
+       {
+        sscanf(Value,"%f",&FloatValue);
+       }
+      else if ((Value[0] >= '0') && (Value[0] <= '9'))
+       {
+        sscanf(Value,"%u",&UIntValue);
+       }
+     }
+   }
+
+  FILE                                *Source;
+ };
+
+/* Loads model from text or binary file and saves it as text to Target */
+static void        SaveAsText         (const char         *FileName,
+                                       P3DOutputStringStreamMemory
+                                                          *TargetStream)
+ {
+  P3DPlantModel                        Model;
+  P3DToolsMaterialFactory              MaterialFactory;
+  P3DToolsMaterialSaver                MaterialSaver;
+
+  if (P3DInputBinaryStreamFile::IsBinaryFile(FileName))
+   {
+    P3DInputBinaryStreamFile           SourceStream;
+
+    SourceStream.Open(FileName);
+
+    Model.Load(&SourceStream,&MaterialFactory);
+   }
+  else
+   {
+    P3DInputStringStreamFile           SourceStream;
+
+    SourceStream.Open(FileName);
+
+    Model.Load(&SourceStream,&MaterialFactory);
+   }
+
+  Model.Save(TargetStream,&MaterialSaver);
+ }
+
+static unsigned_int32 HashTemplateGeometry
+                                      (const char         *FileName)
+ {
+  P3DHLIPlantTemplate                 *Template;
+  P3DHLIPlantGeometry                  Geometry;
+
+  Template = P3DToolsLoadTemplate(FileName);
+
+  try
+   {
+    Geometry.Generate(Template,0,P3D_ATTR_MASK_ALL);
+   }
+  catch (...)
+   {
+    delete Template;
+
+    throw;
+   }
+
+  delete Template;
+
+  return(P3DToolsHashGeometry(&Geometry));
+ }
+
+static double      LoadTemplates      (const char         *FileName,
+                                       unsigned_int32        RepeatCount)
+ {
+  double                               StartTime;
+
+  StartTime = P3DToolsGetTime();
+
+  for (unsigned_int32 Repeat = 0; Repeat < RepeatCount; Repeat++)
+   {
+    delete P3DToolsLoadTemplate(FileName);
+   }
+
+  return(P3DToolsGetTime() - StartTime);
+ }
+
+static double      LoadReferenceTemplates
+                                      (const char         *FileName,
+                                       unsigned_int32        RepeatCount)
+ {
+  double                               StartTime;
+
+  StartTime = P3DToolsGetTime();
+
+  for (unsigned_int32 Repeat = 0; Repeat < RepeatCount; Repeat++)
+   {
+    ReferenceTextStream                SourceStream(FileName);
+
+    delete new P3DHLIPlantTemplate(&SourceStream);
+   }
+
+  return(P3DToolsGetTime() - StartTime);
+ }
+
+static long        GetFileSize        (const char         *FileName)
+ {
+  FILE                                *File;
+  long                                 Size;
+
+  File = fopen(FileName,"rb");
+
+  if (File == NULL)
+   {
+    throw P3DExceptionIO();
+   }
+
+  fseek(File,0,SEEK_END);
+
+  Size = ftell(File);
+
+  fclose(File);
+
+  return(Size);
+ }
+
+int                main               (int                 argc,
+                                       char               *argv[])
+ {
+  const char                          *TextFileName;
+  unsigned_int32                         RepeatCount;
+  bool                                 TextSame;
+  bool                                 GeometrySame;
+  long                                 TextSize;
+  long                                 BinarySize;
+  double                               ReferenceTime;
+  double                               TextTime;
+  double                               BinaryTime;
+  double                               Speedup;
+
+  RepeatCount = argc > 2 ? (unsigned_int32)atoi(argv[2]) : DEFAULT_REPEAT_COUNT;
+
+  if (RepeatCount == 0)
+   {
+    RepeatCount = DEFAULT_REPEAT_COUNT;
+   }
+
+  try
+   {
+    if (argc > 1)
+     {
+      TextFileName = argv[1];
+
+      if (P3DInputBinaryStreamFile::IsBinaryFile(TextFileName))
+       {
+        printf("%s is binary already, text model is needed\n",TextFileName);
+
+        return(1);
+       }
+     }
+    else
+     {
+      P3DPlantModel                   *Model;
+
+      Model = P3DToolsCreateTestModel();
+
+      try
+       {
+        P3DToolsSaveModel(Model,TEXT_TEMP_FILE_NAME);
+       }
+      catch (...)
+       {
+        delete Model;
+
+        throw;
+       }
+
+      delete Model;
+
+      TextFileName = TEXT_TEMP_FILE_NAME;
+     }
+
+    P3DPlantModel::ConvertFile(TextFileName,BINARY_TEMP_FILE_NAME);
+
+    P3DOutputStringStreamMemory        TextModel;
+    P3DOutputStringStreamMemory        BinaryModel;
+
+    SaveAsText(TextFileName,&TextModel);
+    SaveAsText(BINARY_TEMP_FILE_NAME,&BinaryModel);
+
+    TextSame     = strcmp(TextModel.GetData(),BinaryModel.GetData()) == 0;
+    GeometrySame = HashTemplateGeometry(TextFileName) ==
+                    HashTemplateGeometry(BINARY_TEMP_FILE_NAME);
+
+    TextSize   = GetFileSize(TextFileName);
+    BinarySize = GetFileSize(BINARY_TEMP_FILE_NAME);
+
+    /* first loads are not timed, so both files are in file cache */
+    LoadReferenceTemplates(TextFileName,1);
+    LoadTemplates(TextFileName,1);
+    LoadTemplates(BINARY_TEMP_FILE_NAME,1);
+
+    ReferenceTime = 0.0;
+    TextTime      = 0.0;
+    BinaryTime    = 0.0;
+
+    for (unsigned_int32 Pass = 0; Pass < PASS_COUNT; Pass++)
+     {
+      double                           Time;
+
+      Time = LoadReferenceTemplates(TextFileName,RepeatCount);
+
+      if ((Pass == 0) || (Time < ReferenceTime))
+       {
+        ReferenceTime = Time;
+       }
+
+      Time = LoadTemplates(TextFileName,RepeatCount);
+
+      if ((Pass == 0) || (Time < TextTime))
+       {
+        TextTime = Time;
+       }
+
+      Time = LoadTemplates(BINARY_TEMP_FILE_NAME,RepeatCount);
+
+      if ((Pass == 0) || (Time < BinaryTime))
+       {
+        BinaryTime = Time;
+       }
+     }
+   }
+  catch (P3DException &Error)
+   {
+    printf("error: %s\n",Error.GetMessage());
+
+    remove(TEXT_TEMP_FILE_NAME);
+    remove(BINARY_TEMP_FILE_NAME);
+
+    return(1);
+   }
+
+  remove(TEXT_TEMP_FILE_NAME);
+  remove(BINARY_TEMP_FILE_NAME);
+
+  Speedup = ReferenceTime / BinaryTime;
+
+  printf("text %ld bytes, binary %ld bytes\n",TextSize,BinarySize);
+  printf("binary model: text %s, geometry %s\n",
+         TextSame ? "same" : "differs",
+         GeometrySame ? "same" : "differs");
+  printf("template loading x %u (best of %u): original text %.3f ms, text %.3f ms, binary %.3f ms per load\n",
+         RepeatCount,
+         PASS_COUNT,
+         ReferenceTime * 1000.0 / RepeatCount,
+         TextTime * 1000.0 / RepeatCount,
+         BinaryTime * 1000.0 / RepeatCount);
+  printf("binary speedup: %.1fx over original text loader (target %.0fx %s), %.1fx over text loader\n",
+         Speedup,
+         SPEEDUP_TARGET,
+         Speedup >= SPEEDUP_TARGET ? "met" : "not met",
+         TextTime / BinaryTime);
+
+  return((TextSame && GeometrySame && (Speedup >= SPEEDUP_TARGET)) ? 0 : 1);
+ }
@@ -0,0 +1,325 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+/* .ngp load throughput benchmark. Reads each file line by line with    */
+/* P3DInputStringStreamFile and with per-character fgetc reader (as it  */
+/* was before block buffering), checks that both return the same lines  */
+/* and compares read speed. Also measures time of template loading.     */
+/* Without arguments, built-in test model is saved to temporary file    */
+/* and used instead.                                                    */
+/*                                                                      */
+/* Usage: ngploadbench [-n repeat count] [file.ngp ...]                 */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ngpcore/p3dexcept.h>
+#include <ngpcore/p3diostream.h>
+
+#include <tools/ngptools.h>
+
+#define DEFAULT_REPEAT_COUNT (200)
+#define TEMP_FILE_NAME       "ngploadbench.tmp.ngp"
+#define LINE_BUFFER_SIZE     (1024)
+
+/* Reads line the way P3DInputStringStreamFile did before block */
+/* buffering was introduced. Returns false at end of file.      */
+static bool        ReadLineByChar     (FILE               *Source,
+                                       char               *Buffer,
+                                       unsigned_int32        BufferSize)
+ {
+  int                                  CurrChar;
+  unsigned_int32                         Index;
+
+  Index = 0;
+
+  while (true)
+   {
+    CurrChar = fgetc(Source);
+
+    if      (CurrChar == EOF)
+     {
+      if (ferror(Source))
+       {
+        throw P3DExceptionIO();
+       }
+
+      Buffer[Index] = 0;
+
+      return(Index > 0);
+     }
+    else if (CurrChar == '\r')
+     {
+      /* ignore it */
+     }
+    else if (CurrChar == '\n')
+     {
+      Buffer[Index] = 0;
+
+      return(true);
+     }
+    else
+     {
+      Buffer[Index++] = (char)CurrChar;
+
+      if (Index >= (BufferSize - 1))
+       {
+        Buffer[Index] = 0;
+
+        return(true);
+       }
+     }
+   }
+ }
+
+/* returns number of lines which differ, Size is set to file size */
+static unsigned_int32 CompareLines     (const char         *FileName,
+                                       unsigned_int32       *Size)
+ {
+  P3DInputStringStreamFile             Stream;
+  FILE                                *Source;
+  char                                 Line[LINE_BUFFER_SIZE];
+  char                                 RefLine[LINE_BUFFER_SIZE];
+  unsigned_int32                         DiffCount;
+
+  Source = fopen(FileName,"rb");
+
+  if (Source == NULL)
+   {
+    throw P3DExceptionIO();
+   }
+
+  DiffCount = 0;
+
+  try
+   {
+    Stream.Open(FileName);
+
+    while (!Stream.Eof())
+     {
+      Stream.ReadString(Line,sizeof(Line));
+
+      if ((!ReadLineByChar(Source,RefLine,sizeof(RefLine))) ||
+          (strcmp(Line,RefLine) != 0))
+       {
+        DiffCount++;
+       }
+     }
+
+    if (ReadLineByChar(Source,RefLine,sizeof(RefLine)))
+     {
+      DiffCount++;
+     }
+
+    *Size = (unsigned_int32)ftell(Source);
+   }
+  catch (...)
+   {
+    fclose(Source);
+
+    throw;
+   }
+
+  fclose(Source);
+
+  return(DiffCount);
+ }
+
+static double      ReadFileByChar     (const char         *FileName)
+ {
+  FILE                                *Source;
+  char                                 Line[LINE_BUFFER_SIZE];
+  double                               StartTime;
+
+  StartTime = P3DToolsGetTime();
+
+  Source = fopen(FileName,"rb");
+
+  if (Source == NULL)
+   {
+    throw P3DExceptionIO();
+   }
+
+  while (ReadLineByChar(Source,Line,sizeof(Line)))
+   {
+   }
+
+  fclose(Source);
+
+  return(P3DToolsGetTime() - StartTime);
+ }
+
+static double      ReadFileByBlock    (const char         *FileName)
+ {
+  P3DInputStringStreamFile             Stream;
+  char                                 Line[LINE_BUFFER_SIZE];
+  double                               StartTime;
+
+  StartTime = P3DToolsGetTime();
+
+  Stream.Open(FileName);
+
+  while (!Stream.Eof())
+   {
+    Stream.ReadString(Line,sizeof(Line));
+   }
+
+  Stream.Close();
+
+  return(P3DToolsGetTime() - StartTime);
+ }
+
+static double      LoadTemplate       (const char         *FileName)
+ {
+  P3DHLIPlantTemplate                 *Template;
+  double                               StartTime;
+
+  StartTime = P3DToolsGetTime();
+
+  Template = P3DToolsLoadTemplate(FileName);
+
+  delete Template;
+
+  return(P3DToolsGetTime() - StartTime);
+ }
+
+int                main               (int                 argc,
+                                       char               *argv[])
+ {
+  unsigned_int32                         RepeatCount;
+  int                                  FirstFile;
+  int                                  FileCount;
+  const char                          *TempFileName;
+  unsigned_int32                         DiffCount;
+  double                               TotalSize;
+  double                               CharTime;
+  double                               BlockTime;
+  double                               LoadTime;
+
+  RepeatCount = DEFAULT_REPEAT_COUNT;
+  FirstFile   = 1;
+
+  if ((argc > 2) && (strcmp(argv[1],"-n") == 0))
+   {
+    RepeatCount = (unsigned_int32)atoi(argv[2]);
+    FirstFile   = 3;
+
+    if (RepeatCount == 0)
+     {
+      RepeatCount = DEFAULT_REPEAT_COUNT;
+     }
+   }
+
+  TempFileName = 0;
+  FileCount    = argc - FirstFile;
+
+  try
+   {
+    if (FileCount == 0)
+     {
+      P3DPlantModel                   *Model;
+
+      Model = P3DToolsCreateTestModel();
+
+      try
+       {
+        P3DToolsSaveModel(Model,TEMP_FILE_NAME);
+       }
+      catch (...)
+       {
+        delete Model;
+
+        throw;
+       }
+
+      delete Model;
+
+      TempFileName = TEMP_FILE_NAME;
+      FileCount    = 1;
+     }
+
+    DiffCount = 0;
+    TotalSize = 0.0;
+    CharTime  = 0.0;
+    BlockTime = 0.0;
+    LoadTime  = 0.0;
+
+    for (int FileIndex = 0; FileIndex < FileCount; FileIndex++)
+     {
+      const char                      *FileName;
+      unsigned_int32                     FileSize;
+
+      FileName = TempFileName != 0 ? TempFileName : argv[FirstFile + FileIndex];
+
+      DiffCount += CompareLines(FileName,&FileSize);
+      TotalSize += (double)FileSize * RepeatCount;
+
+      for (unsigned_int32 Repeat = 0; Repeat < RepeatCount; Repeat++)
+       {
+        CharTime  += ReadFileByChar(FileName);
+        BlockTime += ReadFileByBlock(FileName);
+        LoadTime  += LoadTemplate(FileName);
+       }
+     }
+   }
+  catch (P3DException &Error)
+   {
+    printf("error: %s\n",Error.GetMessage());
+
+    if (TempFileName != 0)
+     {
+      remove(TempFileName);
+     }
+
+    return(1);
+   }
+
+  if (TempFileName != 0)
+   {
+    remove(TempFileName);
+   }
+
+  printf("%d file(s) x %u, %.2f MB: %u lines differ\n",
+         FileCount,
+         RepeatCount,
+         TotalSize / (1024.0 * 1024.0),
+         DiffCount);
+  printf("line reading: fgetc %.1f MB/s, block %.1f MB/s (%.1fx)\n",
+         TotalSize / (1024.0 * 1024.0) / CharTime,
+         TotalSize / (1024.0 * 1024.0) / BlockTime,
+         CharTime / BlockTime);
+  printf("template loading: %.3f ms per file, %.1f MB/s\n",
+         LoadTime * 1000.0 / (FileCount * RepeatCount),
+         TotalSize / (1024.0 * 1024.0) / LoadTime);
+
+  return(DiffCount == 0 ? 0 : 1);
+ }
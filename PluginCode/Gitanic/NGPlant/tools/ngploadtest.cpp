@@ -0,0 +1,353 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+/* Text .ngp number conversion and concurrent loading test. Checks     */
+/* that 'f' and 'u' fields are written as printf("%f"/"%u") does and   */
+/* parsed as strtof/strtoul do, that saved model is loaded and saved   */
+/* again without changes and that several threads loading the same     */
+/* file at once get the same model. If locale with decimal comma is    */
+/* available, round-trip is repeated with it.                          */
+/*                                                                     */
+/* Usage: ngploadtest [thread count [loads per thread]]                */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+
+#include <ngpcore/p3dexcept.h>
+#include <ngpcore/p3diostream.h>
+#include <ngpcore/p3diostreamadd.h>
+#include <ngpcore/p3dthread.h>
+
+#include <tools/ngptools.h>
+
+#define DEFAULT_THREAD_COUNT (8)
+#define DEFAULT_LOAD_COUNT   (50)
+#define MAX_THREAD_COUNT     (64)
+#define NUMBER_CHECK_COUNT   (200000)
+#define TEMP_FILE_NAME       "ngploadtest.tmp.ngp"
+
+/* simple LCG, so test does not depend on rand() implementation */
+static unsigned_int32 NextRandom       (unsigned_int32       *State)
+ {
+  *State = *State * 1664525U + 1013904223U;
+
+  return(*State);
+ }
+
+/* random finite float, with exponent limited to range used in models */
+static float       RandomFloat        (unsigned_int32       *State)
+ {
+  unsigned_int32                         Bits;
+  float                                Value;
+
+  Bits = NextRandom(State);
+  Bits = (Bits & 0x807FFFFFU) | ((100 + (NextRandom(State) >> 8) % 56) << 23);
+
+  memcpy(&Value,&Bits,sizeof(Value));
+
+  return(Value);
+ }
+
+/* returns number of values which are written or parsed differently  */
+/* from C library                                                    */
+static unsigned_int32 CheckNumbers     (unsigned_int32        Seed)
+ {
+  unsigned_int32                         DiffCount;
+  unsigned_int32                         State;
+  char                                 Line[128];
+
+  DiffCount = 0;
+  State     = Seed;
+
+  for (unsigned_int32 Index = 0; Index < NUMBER_CHECK_COUNT; Index++)
+   {
+    float                              Value;
+    float                              Parsed;
+    unsigned_int32                       UValue;
+    unsigned_int32                       UParsed;
+
+    Value  = RandomFloat(&State);
+    UValue = NextRandom(&State);
+
+    P3DOutputStringStreamMemory        TargetStream;
+    P3DOutputStringFmtStream           FmtStream(&TargetStream);
+
+    FmtStream.WriteString("sfu","Value",Value,UValue);
+
+    snprintf(Line,sizeof(Line),"Value %f %u\n",Value,UValue);
+
+    if (strcmp(TargetStream.GetData(),Line) != 0)
+     {
+      DiffCount++;
+     }
+
+    /* shortest exact form is parsed as well as writer's output */
+    snprintf(Line,sizeof(Line),"Value %.9g %u",Value,UValue);
+
+    P3DInputStringStreamString         SourceStream(Line);
+    P3DInputStringFmtStream            SourceFmtStream(&SourceStream);
+
+    SourceFmtStream.ReadFmtStringTagged("Value","fu",&Parsed,&UParsed);
+
+    if ((Parsed != strtof(&Line[6],NULL)) || (UParsed != UValue))
+     {
+      DiffCount++;
+     }
+   }
+
+  return(DiffCount);
+ }
+
+/* Model is loaded from text data, result (with materials) is saved */
+/* to Target                                                        */
+static void        LoadAndSave        (P3DInputStringStream
+                                                          *SourceStream,
+                                       P3DOutputStringStreamMemory
+                                                          *TargetStream)
+ {
+  P3DPlantModel                        Model;
+  P3DToolsMaterialFactory              MaterialFactory;
+  P3DToolsMaterialSaver                MaterialSaver;
+
+  Model.Load(SourceStream,&MaterialFactory);
+  Model.Save(TargetStream,&MaterialSaver);
+ }
+
+class LoadThread : public P3DThread
+ {
+  public           :
+
+  virtual void     Run                ()
+   {
+    DiffCount  = CheckNumbers(Seed);
+    ErrorCount = 0;
+
+    for (unsigned_int32 Index = 0; Index < LoadCount; Index++)
+     {
+      try
+       {
+        P3DInputStringStreamFile       SourceStream;
+        P3DOutputStringStreamMemory    TargetStream;
+
+        SourceStream.Open(TEMP_FILE_NAME);
+
+        LoadAndSave(&SourceStream,&TargetStream);
+
+        if (strcmp(TargetStream.GetData(),Reference) != 0)
+         {
+          DiffCount++;
+         }
+       }
+      catch (...)
+       {
+        ErrorCount++;
+       }
+     }
+   }
+
+  const char                          *Reference;
+  unsigned_int32                         Seed;
+  unsigned_int32                         LoadCount;
+  unsigned_int32                         DiffCount;
+  unsigned_int32                         ErrorCount;
+ };
+
+/* Adds materials with colors and fade values which are not exactly */
+/* representable in text                                            */
+static void        AddMaterials       (P3DPlantModel      *Model)
+ {
+  P3DToolsMaterialFactory              MaterialFactory;
+  P3DBranchModel                      *BranchModel;
+  unsigned_int32                         Index;
+
+  Index = 0;
+
+  while ((BranchModel = P3DPlantModel::GetBranchModelByIndex(Model,Index)) != 0)
+   {
+    P3DMaterialDef                     MaterialDef;
+
+    MaterialDef.SetColor(1.0f / (Index + 3),0.1f * Index,2.0f / 3.0f);
+    MaterialDef.SetTexName(0,"bark texture.png");
+    MaterialDef.SetAlphaCtrlState(true);
+    MaterialDef.SetAlphaFadeIn(0.15f + 0.01f * Index);
+    MaterialDef.SetAlphaFadeOut(1e-5f);
+
+    BranchModel->SetMaterialInstance(MaterialFactory.CreateMaterial(MaterialDef));
+
+    Index++;
+   }
+ }
+
+/* returns true if re-saved model differs from Reference */
+static bool        CheckRoundTrip     (const char         *Reference)
+ {
+  P3DInputStringStreamView             SourceStream(Reference,(unsigned_int32)strlen(Reference));
+  P3DOutputStringStreamMemory          TargetStream;
+
+  LoadAndSave(&SourceStream,&TargetStream);
+
+  return(strcmp(TargetStream.GetData(),Reference) != 0);
+ }
+
+static const char *CommaLocales[] =
+ {
+  "de_DE.UTF-8", "de_DE", "ru_RU.UTF-8", "fr_FR.UTF-8", "German", 0
+ };
+
+int                main               (int                 argc,
+                                       char               *argv[])
+ {
+  LoadThread                           Threads[MAX_THREAD_COUNT];
+  unsigned_int32                         ThreadCount;
+  unsigned_int32                         LoadCount;
+  unsigned_int32                         DiffCount;
+  unsigned_int32                         ErrorCount;
+  P3DPlantModel                       *Model;
+  P3DToolsMaterialSaver                MaterialSaver;
+  P3DOutputStringStreamMemory          Reference;
+  bool                                 RoundTripFailed;
+  bool                                 LocaleFound;
+
+  ThreadCount = argc > 1 ? (unsigned_int32)atoi(argv[1]) : DEFAULT_THREAD_COUNT;
+  LoadCount   = argc > 2 ? (unsigned_int32)atoi(argv[2]) : DEFAULT_LOAD_COUNT;
+
+  if ((ThreadCount == 0) || (ThreadCount > MAX_THREAD_COUNT))
+   {
+    ThreadCount = DEFAULT_THREAD_COUNT;
+   }
+
+  DiffCount = CheckNumbers(1);
+
+  printf("%u numbers: %u written or parsed differently\n",
+         NUMBER_CHECK_COUNT,
+         DiffCount);
+
+  try
+   {
+    Model = P3DToolsCreateTestModel();
+
+    try
+     {
+      AddMaterials(Model);
+
+      Model->Save(&Reference,&MaterialSaver);
+
+      P3DToolsSaveModel(Model,TEMP_FILE_NAME);
+     }
+    catch (...)
+     {
+      delete Model;
+
+      throw;
+     }
+
+    delete Model;
+
+    RoundTripFailed = CheckRoundTrip(Reference.GetData());
+   }
+  catch (P3DException &Error)
+   {
+    printf("error: %s\n",Error.GetMessage());
+
+    remove(TEMP_FILE_NAME);
+
+    return(1);
+   }
+
+  printf("model round-trip: %s\n",RoundTripFailed ? "differs" : "same");
+
+  for (unsigned_int32 ThreadIndex = 0; ThreadIndex < ThreadCount; ThreadIndex++)
+   {
+    Threads[ThreadIndex].Reference = Reference.GetData();
+    Threads[ThreadIndex].Seed      = ThreadIndex + 2;
+    Threads[ThreadIndex].LoadCount = LoadCount;
+
+    Threads[ThreadIndex].Start();
+   }
+
+  ErrorCount = 0;
+
+  for (unsigned_int32 ThreadIndex = 0; ThreadIndex < ThreadCount; ThreadIndex++)
+   {
+    Threads[ThreadIndex].Join();
+
+    DiffCount  += Threads[ThreadIndex].DiffCount;
+    ErrorCount += Threads[ThreadIndex].ErrorCount;
+   }
+
+  remove(TEMP_FILE_NAME);
+
+  printf("%u threads x %u loads: %u differences, %u errors\n",
+         ThreadCount,
+         LoadCount,
+         DiffCount,
+         ErrorCount);
+
+  /* writer and parser must ignore decimal comma of current locale */
+  LocaleFound = false;
+
+  for (unsigned_int32 Index = 0; (CommaLocales[Index] != 0) && (!LocaleFound); Index++)
+   {
+    if (setlocale(LC_NUMERIC,CommaLocales[Index]) != NULL)
+     {
+      LocaleFound = true;
+
+      try
+       {
+        if (CheckRoundTrip(Reference.GetData()))
+         {
+          RoundTripFailed = true;
+         }
+       }
+      catch (P3DException &Error)
+       {
+        printf("error: %s\n",Error.GetMessage());
+
+        RoundTripFailed = true;
+       }
+
+      printf("model round-trip in %s locale: %s\n",
+             CommaLocales[Index],
+             RoundTripFailed ? "differs" : "same");
+
+      setlocale(LC_NUMERIC,"C");
+     }
+   }
+
+  if (!LocaleFound)
+   {
+    printf("no locale with decimal comma, locale round-trip skipped\n");
+   }
+
+  return(((DiffCount == 0) && (ErrorCount == 0) && (!RoundTripFailed)) ? 0 : 1);
+ }
@@ -0,0 +1,187 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+/* Forest generation scaling benchmark. Generates geometry of many  */
+/* instances of one template with 1 to 64 pool threads and checks   */
+/* that every thread count produces the same geometry.              */
+/*                                                                  */
+/* Usage: ngppoolbench [model.ngp [instance count]]                 */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <ngpcore/p3dexcept.h>
+
+#include <tools/ngptools.h>
+
+#define DEFAULT_INSTANCE_COUNT (128)
+
+class HashCallback : public P3DHLIForestCallback
+ {
+  public           :
+
+                   HashCallback       (unsigned_int32       *Hashes)
+   {
+    this->Hashes = Hashes;
+    ErrorCount   = 0;
+   }
+
+  /* every instance index is reported by single thread */
+  virtual void     OnInstanceReady    (unsigned_int32        InstanceIndex,
+                                       P3DHLIPlantGeometry*Geometry)
+   {
+    Hashes[InstanceIndex] = P3DToolsHashGeometry(Geometry);
+
+    delete Geometry;
+   }
+
+  virtual void     OnInstanceError    (unsigned_int32        InstanceIndex,
+                                       const char         *Message)
+   {
+    printf("instance %u failed: %s\n",InstanceIndex,Message);
+
+    Hashes[InstanceIndex] = 0;
+    ErrorCount            = 1;
+   }
+
+  unsigned_int32                        *Hashes;
+  volatile int                         ErrorCount;
+ };
+
+int                main               (int                 argc,
+                                       char               *argv[])
+ {
+  static const unsigned_int32 ThreadCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+  P3DPlantModel                       *Model;
+  P3DHLIPlantTemplate                 *Template;
+  unsigned_int32                        *Seeds;
+  unsigned_int32                        *Hashes;
+  unsigned_int32                        *BaseHashes;
+  unsigned_int32                         InstanceCount;
+  double                               BaseTime;
+  int                                  Result;
+
+  Model         = 0;
+  InstanceCount = argc > 2 ? (unsigned_int32)atoi(argv[2]) : DEFAULT_INSTANCE_COUNT;
+  Result        = 0;
+
+  if (InstanceCount == 0)
+   {
+    InstanceCount = DEFAULT_INSTANCE_COUNT;
+   }
+
+  try
+   {
+    if (argc > 1)
+     {
+      Template = P3DToolsLoadTemplate(argv[1]);
+     }
+    else
+     {
+      Model    = P3DToolsCreateTestModel();
+      Template = new P3DHLIPlantTemplate(Model);
+     }
+   }
+  catch (P3DException &Error)
+   {
+    printf("unable to load model: %s\n",Error.GetMessage());
+
+    return(1);
+   }
+
+  Seeds      = new unsigned_int32[InstanceCount];
+  Hashes     = new unsigned_int32[InstanceCount];
+  BaseHashes = new unsigned_int32[InstanceCount];
+
+  for (unsigned_int32 Index = 0; Index < InstanceCount; Index++)
+   {
+    Seeds[Index] = Index * 7919 + 1;
+   }
+
+  printf("%u instances, %u processors\n",InstanceCount,P3DThread::GetProcessorCount());
+  printf("threads     time,ms  speedup\n");
+
+  BaseTime = 0.0;
+
+  for (unsigned_int32 TestIndex = 0; TestIndex < sizeof(ThreadCounts) / sizeof(ThreadCounts[0]); TestIndex++)
+   {
+    P3DHLIForestGenerator              Generator(ThreadCounts[TestIndex]);
+    HashCallback                       Callback(TestIndex == 0 ? BaseHashes : Hashes);
+    double                             StartTime;
+    double                             Time;
+    bool                               Same;
+
+    StartTime = P3DToolsGetTime();
+
+    Generator.Generate(Template,Seeds,InstanceCount,P3D_ATTR_MASK_ALL,&Callback);
+
+    Time = P3DToolsGetTime() - StartTime;
+
+    if (TestIndex == 0)
+     {
+      BaseTime = Time;
+      Same     = true;
+     }
+    else
+     {
+      Same = true;
+
+      for (unsigned_int32 Index = 0; Index < InstanceCount; Index++)
+       {
+        if (Hashes[Index] != BaseHashes[Index])
+         {
+          Same = false;
+         }
+       }
+     }
+
+    printf("%7u %11.1f %8.2f%s\n",
+           ThreadCounts[TestIndex],
+           Time * 1000.0,
+           Time > 0.0 ? BaseTime / Time : 0.0,
+           Same ? "" : "  geometry differs");
+
+    if ((!Same) || (Callback.ErrorCount != 0))
+     {
+      Result = 1;
+     }
+   }
+
+  delete[] BaseHashes;
+  delete[] Hashes;
+  delete[] Seeds;
+  delete Template;
+  delete Model;
+
+  return(Result);
+ }
+
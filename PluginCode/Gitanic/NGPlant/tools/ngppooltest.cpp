@@ -0,0 +1,432 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+/* Thread pool and parallel generation test. Checks that:              */
+/*  - forest generator produces the same geometry as serial generation */
+/*  - pool tasks may materialize instances using the same pool         */
+/*  - single instance may be queried by several threads at once        */
+/* Model is generated with shared and per-subtree random streams.      */
+/* Build it (with ngpcore) using -fsanitize=thread to check for races. */
+/*                                                                     */
+/* Usage: ngppooltest                                                  */
+
+#include <stdio.h>
+
+#include <ngpcore/p3dexcept.h>
+
+#include <tools/ngptools.h>
+
+#define INSTANCE_COUNT     (16)
+#define QUERY_REPEAT_COUNT (4)
+
+static const unsigned_int32 PoolThreadCounts[] = { 1, 3, 8 };
+
+#define POOL_TEST_COUNT (sizeof(PoolThreadCounts) / sizeof(PoolThreadCounts[0]))
+
+/* hash of branch count and vertex positions of group */
+static unsigned_int32 HashGroup        (const P3DHLIPlantInstance
+                                                          *Instance,
+                                       unsigned_int32        GroupIndex)
+ {
+  unsigned_int32                         Hash;
+  unsigned_int32                         BranchCount;
+  unsigned_int32                         VAttrCount;
+  float                               *Vertices;
+  P3DHLIVAttrBuffers                   VAttrBuffers;
+
+  BranchCount = Instance->GetBranchCount(GroupIndex);
+  VAttrCount  = Instance->GetVAttrCountI(GroupIndex);
+  Vertices    = new float[VAttrCount * 3 + 1];
+
+  VAttrBuffers.AddAttr(P3D_ATTR_VERTEX,Vertices,0,sizeof(float) * 3);
+
+  try
+   {
+    Instance->FillVAttrBuffersI(&VAttrBuffers,GroupIndex);
+   }
+  catch (...)
+   {
+    delete[] Vertices;
+
+    throw;
+   }
+
+  Hash = P3DToolsHashData(P3D_TOOLS_HASH_INIT,&BranchCount,sizeof(BranchCount));
+  Hash = P3DToolsHashData(Hash,Vertices,VAttrCount * 3 * sizeof(float));
+
+  delete[] Vertices;
+
+  return(Hash);
+ }
+
+static unsigned_int32 HashInstance     (const P3DHLIPlantInstance
+                                                          *Instance,
+                                       unsigned_int32        GroupCount)
+ {
+  unsigned_int32                         Hash;
+
+  Hash = P3D_TOOLS_HASH_INIT;
+
+  for (unsigned_int32 GroupIndex = 0; GroupIndex < GroupCount; GroupIndex++)
+   {
+    unsigned_int32                       GroupHash;
+
+    GroupHash = HashGroup(Instance,GroupIndex);
+    Hash      = P3DToolsHashData(Hash,&GroupHash,sizeof(GroupHash));
+   }
+
+  return(Hash);
+ }
+
+static bool        CheckHashes        (const char         *TestName,
+                                       unsigned_int32        ThreadCount,
+                                       const unsigned_int32 *Hashes,
+                                       const unsigned_int32 *ExpectedHashes,
+                                       unsigned_int32        Count)
+ {
+  for (unsigned_int32 Index = 0; Index < Count; Index++)
+   {
+    if (Hashes[Index] != ExpectedHashes[Index])
+     {
+      printf("  %s, %u threads: result %u differs\n",TestName,ThreadCount,Index);
+
+      return(false);
+     }
+   }
+
+  return(true);
+ }
+
+class ForestCallback : public P3DHLIForestCallback
+ {
+  public           :
+
+                   ForestCallback     (unsigned_int32       *Hashes)
+   {
+    this->Hashes = Hashes;
+   }
+
+  virtual void     OnInstanceReady    (unsigned_int32        InstanceIndex,
+                                       P3DHLIPlantGeometry*Geometry)
+   {
+    Hashes[InstanceIndex] = P3DToolsHashGeometry(Geometry);
+
+    delete Geometry;
+   }
+
+  virtual void     OnInstanceError    (unsigned_int32        InstanceIndex,
+                                       const char         *Message P3D_UNUSED_ATTR)
+   {
+    Hashes[InstanceIndex] = 0;
+   }
+
+  private          :
+
+  unsigned_int32                        *Hashes;
+ };
+
+static bool        TestForest         (const P3DHLIPlantTemplate
+                                                          *Template,
+                                       const unsigned_int32 *Seeds)
+ {
+  unsigned_int32                         ExpectedHashes[INSTANCE_COUNT];
+  unsigned_int32                         Hashes[INSTANCE_COUNT];
+  bool                                 Result;
+
+  for (unsigned_int32 Index = 0; Index < INSTANCE_COUNT; Index++)
+   {
+    P3DHLIPlantGeometry                Geometry;
+
+    Geometry.Generate(Template,Seeds[Index],P3D_ATTR_MASK_ALL);
+
+    ExpectedHashes[Index] = P3DToolsHashGeometry(&Geometry);
+   }
+
+  Result = true;
+
+  for (unsigned_int32 TestIndex = 0; TestIndex < POOL_TEST_COUNT; TestIndex++)
+   {
+    P3DHLIForestGenerator              Generator(PoolThreadCounts[TestIndex]);
+    ForestCallback                     Callback(Hashes);
+
+    Generator.Generate(Template,Seeds,INSTANCE_COUNT,P3D_ATTR_MASK_ALL,&Callback);
+
+    if (!CheckHashes("forest",PoolThreadCounts[TestIndex],Hashes,ExpectedHashes,INSTANCE_COUNT))
+     {
+      Result = false;
+     }
+   }
+
+  return(Result);
+ }
+
+/* materializes instance using pool it runs in */
+class MaterializeTask : public P3DTask
+ {
+  public           :
+
+  virtual void     Run                ()
+   {
+    P3DHLIPlantInstance               *Instance;
+
+    Hash = 0;
+
+    try
+     {
+      Instance = Template->CreateInstance(Seed);
+
+      try
+       {
+        Instance->Materialize(Pool);
+
+        Hash = HashInstance(Instance,Template->GetGroupCount());
+       }
+      catch (...)
+       {
+        delete Instance;
+
+        throw;
+       }
+
+      delete Instance;
+     }
+    catch (...)
+     {
+     }
+   }
+
+  const P3DHLIPlantTemplate           *Template;
+  P3DThreadPool                       *Pool;
+  unsigned_int32                         Seed;
+  unsigned_int32                         Hash;
+ };
+
+static bool        TestNestedMaterialize
+                                      (const P3DHLIPlantTemplate
+                                                          *Template,
+                                       const unsigned_int32 *Seeds)
+ {
+  unsigned_int32                         ExpectedHashes[INSTANCE_COUNT];
+  unsigned_int32                         Hashes[INSTANCE_COUNT];
+  MaterializeTask                      Tasks[INSTANCE_COUNT];
+  bool                                 Result;
+
+  for (unsigned_int32 Index = 0; Index < INSTANCE_COUNT; Index++)
+   {
+    P3DHLIPlantInstance               *Instance;
+
+    Instance = Template->CreateInstance(Seeds[Index]);
+
+    ExpectedHashes[Index] = HashInstance(Instance,Template->GetGroupCount());
+
+    delete Instance;
+   }
+
+  Result = true;
+
+  for (unsigned_int32 TestIndex = 0; TestIndex < POOL_TEST_COUNT; TestIndex++)
+   {
+    P3DThreadPool                      Pool(PoolThreadCounts[TestIndex]);
+    P3DTaskGroup                       TaskGroup;
+
+    for (unsigned_int32 Index = 0; Index < INSTANCE_COUNT; Index++)
+     {
+      Tasks[Index].Template = Template;
+      Tasks[Index].Pool     = &Pool;
+      Tasks[Index].Seed     = Seeds[Index];
+
+      Pool.Submit(&Tasks[Index],&TaskGroup);
+     }
+
+    Pool.Wait(&TaskGroup);
+
+    for (unsigned_int32 Index = 0; Index < INSTANCE_COUNT; Index++)
+     {
+      Hashes[Index] = Tasks[Index].Hash;
+     }
+
+    if (!CheckHashes("nested materialize",PoolThreadCounts[TestIndex],Hashes,ExpectedHashes,INSTANCE_COUNT))
+     {
+      Result = false;
+     }
+   }
+
+  return(Result);
+ }
+
+/* queries single group of shared instance */
+class QueryTask : public P3DTask
+ {
+  public           :
+
+  virtual void     Run                ()
+   {
+    try
+     {
+      Hash = HashGroup(Instance,GroupIndex);
+     }
+    catch (...)
+     {
+      Hash = 0;
+     }
+   }
+
+  const P3DHLIPlantInstance           *Instance;
+  unsigned_int32                         GroupIndex;
+  unsigned_int32                         Hash;
+ };
+
+static bool        TestSharedInstance (const P3DHLIPlantTemplate
+                                                          *Template,
+                                       unsigned_int32        Seed)
+ {
+  P3DHLIPlantInstance                 *Instance;
+  unsigned_int32                         GroupCount;
+  unsigned_int32                         TaskCount;
+  unsigned_int32                        *ExpectedHashes;
+  unsigned_int32                        *Hashes;
+  QueryTask                           *Tasks;
+  bool                                 Result;
+
+  GroupCount = Template->GetGroupCount();
+  TaskCount  = GroupCount * QUERY_REPEAT_COUNT;
+
+  ExpectedHashes = new unsigned_int32[TaskCount];
+  Hashes         = new unsigned_int32[TaskCount];
+  Tasks          = new QueryTask[TaskCount];
+
+  Instance = Template->CreateInstance(Seed);
+
+  for (unsigned_int32 Index = 0; Index < TaskCount; Index++)
+   {
+    ExpectedHashes[Index] = HashGroup(Instance,Index % GroupCount);
+   }
+
+  delete Instance;
+
+  Result = true;
+
+  for (unsigned_int32 TestIndex = 0; TestIndex < POOL_TEST_COUNT; TestIndex++)
+   {
+    P3DThreadPool                      Pool(PoolThreadCounts[TestIndex]);
+    P3DTaskGroup                       TaskGroup;
+
+    /* instance must be prepared before it is shared between threads */
+    Instance = Template->CreateInstance(Seed);
+
+    Instance->RecordCheckpoints();
+
+    for (unsigned_int32 Index = 0; Index < TaskCount; Index++)
+     {
+      Tasks[Index].Instance   = Instance;
+      Tasks[Index].GroupIndex = Index % GroupCount;
+
+      Pool.Submit(&Tasks[Index],&TaskGroup);
+     }
+
+    Pool.Wait(&TaskGroup);
+
+    for (unsigned_int32 Index = 0; Index < TaskCount; Index++)
+     {
+      Hashes[Index] = Tasks[Index].Hash;
+     }
+
+    if (!CheckHashes("shared instance",PoolThreadCounts[TestIndex],Hashes,ExpectedHashes,TaskCount))
+     {
+      Result = false;
+     }
+
+    delete Instance;
+   }
+
+  delete[] Tasks;
+  delete[] Hashes;
+  delete[] ExpectedHashes;
+
+  return(Result);
+ }
+
+int                main               ()
+ {
+  static const unsigned_int32 ModelFlags[] = { 0, P3D_MODEL_FLAG_SUBTREE_RNG };
+
+  P3DPlantModel                       *Model;
+  unsigned_int32                         Seeds[INSTANCE_COUNT];
+  bool                                 Passed;
+
+  for (unsigned_int32 Index = 0; Index < INSTANCE_COUNT; Index++)
+   {
+    Seeds[Index] = Index * 7919 + 1;
+   }
+
+  Model  = P3DToolsCreateTestModel();
+  Passed = true;
+
+  try
+   {
+    for (unsigned_int32 FlagsIndex = 0; FlagsIndex < sizeof(ModelFlags) / sizeof(ModelFlags[0]); FlagsIndex++)
+     {
+      P3DHLIPlantTemplate              Template(Model);
+
+      Model->SetFlags(ModelFlags[FlagsIndex]);
+
+      printf("model flags %u\n",ModelFlags[FlagsIndex]);
+
+      if (!TestForest(&Template,Seeds))
+       {
+        Passed = false;
+       }
+
+      if (!TestNestedMaterialize(&Template,Seeds))
+       {
+        Passed = false;
+       }
+
+      if (!TestSharedInstance(&Template,Seeds[0]))
+       {
+        Passed = false;
+       }
+     }
+   }
+  catch (P3DException &Error)
+   {
+    printf("error: %s\n",Error.GetMessage());
+
+    Passed = false;
+   }
+
+  delete Model;
+
+  printf("%s\n",Passed ? "ok" : "FAILED");
+
+  return(Passed ? 0 : 1);
+ }
+
@@ -0,0 +1,207 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+/* Circle tube profile benchmark. Checks that table-based profile      */
+/* points are the same as directly computed ones (also when profiles   */
+/* are created by several threads at once) and compares table lookup   */
+/* with direct sin/cos evaluation.                                     */
+/*                                                                     */
+/* Usage: ngpprofilebench [iteration count]                            */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <ngpcore/p3dmath.h>
+#include <ngpcore/p3dplant.h>
+#include <ngpcore/p3dthread.h>
+
+#include <tools/ngptools.h>
+
+#define DEFAULT_ITERATION_COUNT (2000000)
+#define MAX_CHECK_RESOLUTION    (200)
+#define CHECK_THREAD_COUNT      (8)
+#define BENCH_RESOLUTION        (16)
+
+/* profile point as it was computed before tables were introduced */
+static void        CalcPointDirect    (float              *x,
+                                       float              *y,
+                                       unsigned_int32        t,
+                                       unsigned_int32        Resolution)
+ {
+  float                                a;
+
+  a = ((float)t / Resolution) * 2.0f * P3DMATH_PI;
+
+  P3DMath::SinCosf(x,y,a);
+ }
+
+/* returns number of points which differ from directly computed ones */
+static unsigned_int32 CheckProfiles    ()
+ {
+  unsigned_int32                         DiffCount;
+
+  DiffCount = 0;
+
+  for (unsigned_int32 Resolution = 1; Resolution < MAX_CHECK_RESOLUTION; Resolution++)
+   {
+    P3DTubeProfileCircle               Profile(Resolution);
+
+    /* points past resolution are computed directly */
+    for (unsigned_int32 t = 0; t <= Resolution; t++)
+     {
+      float                            x,y;
+      float                            nx,ny;
+      float                            ex,ey;
+
+      Profile.GetPoint(x,y,t);
+      Profile.GetNormal(nx,ny,t);
+
+      CalcPointDirect(&ex,&ey,t,Resolution);
+
+      if ((x != ex) || (y != ey) || (nx != ex) || (ny != ey))
+       {
+        DiffCount++;
+       }
+     }
+   }
+
+  return(DiffCount);
+ }
+
+class CheckThread : public P3DThread
+ {
+  public           :
+
+  virtual void     Run                ()
+   {
+    DiffCount = CheckProfiles();
+   }
+
+  unsigned_int32                         DiffCount;
+ };
+
+int                main               (int                 argc,
+                                       char               *argv[])
+ {
+  CheckThread                          Threads[CHECK_THREAD_COUNT];
+  unsigned_int32                         IterationCount;
+  unsigned_int32                         DiffCount;
+  float                                Sum;
+  double                               StartTime;
+  double                               DirectTime;
+  double                               TableTime;
+  double                               CreateTime;
+
+  IterationCount = argc > 1 ? (unsigned_int32)atoi(argv[1]) : DEFAULT_ITERATION_COUNT;
+
+  if (IterationCount == 0)
+   {
+    IterationCount = DEFAULT_ITERATION_COUNT;
+   }
+
+  /* tables are created by checking threads concurrently */
+  for (unsigned_int32 ThreadIndex = 0; ThreadIndex < CHECK_THREAD_COUNT; ThreadIndex++)
+   {
+    Threads[ThreadIndex].Start();
+   }
+
+  DiffCount = 0;
+
+  for (unsigned_int32 ThreadIndex = 0; ThreadIndex < CHECK_THREAD_COUNT; ThreadIndex++)
+   {
+    Threads[ThreadIndex].Join();
+
+    DiffCount += Threads[ThreadIndex].DiffCount;
+   }
+
+  printf("%u threads, resolutions 1-%u: %u points differ\n",
+         CHECK_THREAD_COUNT,
+         MAX_CHECK_RESOLUTION - 1,
+         DiffCount);
+
+  Sum = 0.0f;
+
+  StartTime = P3DToolsGetTime();
+
+  for (unsigned_int32 Iteration = 0; Iteration < IterationCount; Iteration++)
+   {
+    for (unsigned_int32 t = 0; t < BENCH_RESOLUTION; t++)
+     {
+      float                            x,y;
+
+      CalcPointDirect(&x,&y,t,BENCH_RESOLUTION);
+
+      Sum += x + y;
+     }
+   }
+
+  DirectTime = P3DToolsGetTime() - StartTime;
+
+  P3DTubeProfileCircle                 Profile(BENCH_RESOLUTION);
+
+  StartTime = P3DToolsGetTime();
+
+  for (unsigned_int32 Iteration = 0; Iteration < IterationCount; Iteration++)
+   {
+    for (unsigned_int32 t = 0; t < BENCH_RESOLUTION; t++)
+     {
+      float                            x,y;
+
+      Profile.GetPoint(x,y,t);
+
+      Sum += x + y;
+     }
+   }
+
+  TableTime = P3DToolsGetTime() - StartTime;
+  StartTime = P3DToolsGetTime();
+
+  for (unsigned_int32 Iteration = 0; Iteration < IterationCount; Iteration++)
+   {
+    P3DTubeProfileCircle               TempProfile(BENCH_RESOLUTION + Iteration % 4);
+
+    Sum += (float)TempProfile.GetResolution();
+   }
+
+  CreateTime = P3DToolsGetTime() - StartTime;
+
+  printf("%u x %u points: sin/cos %.1f ms, table %.1f ms\n",
+         IterationCount,
+         BENCH_RESOLUTION,
+         DirectTime * 1000.0,
+         TableTime * 1000.0);
+  printf("profile creation: %.1f ns (checksum %g)\n",
+         CreateTime * 1.0e9 / IterationCount,
+         Sum);
+
+  return(DiffCount == 0 ? 0 : 1);
+ }
+
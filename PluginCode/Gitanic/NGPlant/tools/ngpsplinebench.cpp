@@ -0,0 +1,328 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+/* Natural cubic spline benchmark. Compares GetValue and GetTangent of */
+/* random curves with direct evaluation of the same splines in double  */
+/* precision, checks that curves pass exactly through control points   */
+/* and measures evaluation time for 4, 8 and 32 control points.        */
+/*                                                                     */
+/* Usage: ngpsplinebench [curve count]                                 */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <ngpcore/p3dmathspline.h>
+
+#include <tools/ngptools.h>
+
+#define DEFAULT_CURVE_COUNT  (20000)
+#define SAMPLE_COUNT         (500)
+#define BENCH_CALL_COUNT     (10000000)
+#define MAX_VALUE_ERROR      (2.0e-5)
+#define MAX_TANGENT_ERROR    (1.0e-5)
+
+/* simple LCG, so benchmark does not depend on rand() implementation */
+static float       RandomFloat        (unsigned_int32       *State)
+ {
+  *State = *State * 1664525U + 1013904223U;
+
+  return((float)(*State >> 8) / 16777216.0f);
+ }
+
+/* Random curve on [0,1] as edited in curve control: first and last */
+/* points at ends of range, y in [0,1]                              */
+static void        RandomCurve        (P3DMathNaturalCubicSpline
+                                                          *Curve,
+                                       unsigned_int32        CPCount,
+                                       unsigned_int32       *State)
+ {
+  Curve->SetLinear(0.0f,RandomFloat(State),1.0f,RandomFloat(State));
+
+  while (Curve->GetCPCount() < CPCount)
+   {
+    float                              x;
+    bool                               Used;
+
+    x    = 0.01f + 0.98f * RandomFloat(State);
+    Used = false;
+
+    for (unsigned_int32 cp = 0; cp < Curve->GetCPCount(); cp++)
+     {
+      if (fabs(Curve->GetCPX(cp) - x) < 0.005f)
+       {
+        Used = true;
+       }
+     }
+
+    if (!Used)
+     {
+      Curve->AddCP(x,RandomFloat(State));
+     }
+   }
+ }
+
+/* Natural cubic spline through the same control points, evaluated */
+/* directly in double precision                                    */
+class ReferenceSpline
+ {
+  public           :
+
+                   ReferenceSpline    (const P3DMathNaturalCubicSpline
+                                                          *Curve)
+   {
+    double                             u[P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT];
+
+    Count = Curve->GetCPCount();
+
+    for (unsigned_int32 cp = 0; cp < Count; cp++)
+     {
+      x[cp] = Curve->GetCPX(cp);
+      y[cp] = Curve->GetCPY(cp);
+     }
+
+    y2[0] = 0.0;
+    u[0]  = 0.0;
+
+    for (unsigned_int32 i = 1; i + 1 < Count; i++)
+     {
+      double                           sig;
+      double                           p;
+
+      sig   = (x[i] - x[i - 1]) / (x[i + 1] - x[i - 1]);
+      p     = sig * y2[i - 1] + 2.0;
+      y2[i] = (sig - 1.0) / p;
+      u[i]  = (y[i + 1] - y[i]) / (x[i + 1] - x[i]) - (y[i] - y[i - 1]) / (x[i] - x[i - 1]);
+      u[i]  = (6.0 * u[i] / (x[i + 1] - x[i - 1]) - sig * u[i - 1]) / p;
+     }
+
+    y2[Count - 1] = 0.0;
+
+    for (int k = (int)Count - 2; k >= 0; k--)
+     {
+      y2[k] = y2[k] * y2[k + 1] + u[k];
+     }
+   }
+
+  /* Value or tangent inside of control points range, outside of it */
+  /* GetValue is clamped and GetTangent is extrapolated             */
+  double           GetValue           (double              t,
+                                       bool                Tangent) const
+   {
+    unsigned_int32                       base;
+    double                             h,a,b;
+
+    base = 1;
+
+    while ((base + 1 < Count) && (x[base] < t))
+     {
+      base++;
+     }
+
+    h = x[base] - x[base - 1];
+    a = (x[base] - t) / h;
+    b = (t - x[base - 1]) / h;
+
+    if (Tangent)
+     {
+      return((y[base] - y[base - 1]) / h -
+             (3.0 * a * a - 1.0) * h * y2[base - 1] / 6.0 +
+             (3.0 * b * b - 1.0) * h * y2[base] / 6.0);
+     }
+    else
+     {
+      return(a * y[base - 1] + b * y[base] +
+             ((a * a * a - a) * y2[base - 1] + (b * b * b - b) * y2[base]) * h * h / 6.0);
+     }
+   }
+
+  private          :
+
+  unsigned_int32                         Count;
+  double                               x[P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT];
+  double                               y[P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT];
+  double                               y2[P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT];
+ };
+
+/* ValueError is absolute, TangentError is relative to largest */
+/* tangent of curve                                            */
+static void        CheckCurve         (const P3DMathNaturalCubicSpline
+                                                          *Curve,
+                                       double             *ValueError,
+                                       double             *TangentError,
+                                       double             *CPError)
+ {
+  ReferenceSpline                      Reference(Curve);
+  double                               MaxTangent;
+  double                               MaxTangentDiff;
+
+  MaxTangent     = 1.0;
+  MaxTangentDiff = 0.0;
+
+  for (unsigned_int32 Sample = 0; Sample <= SAMPLE_COUNT; Sample++)
+   {
+    float                              t;
+    double                             Tangent;
+
+    t       = (float)Sample / SAMPLE_COUNT;
+    Tangent = Reference.GetValue(t,true);
+
+    if (fabs(Tangent) > MaxTangent)
+     {
+      MaxTangent = fabs(Tangent);
+     }
+
+    if (fabs(Curve->GetValue(t) - Reference.GetValue(t,false)) > *ValueError)
+     {
+      *ValueError = fabs(Curve->GetValue(t) - Reference.GetValue(t,false));
+     }
+
+    if (fabs(Curve->GetTangent(t) - Tangent) > MaxTangentDiff)
+     {
+      MaxTangentDiff = fabs(Curve->GetTangent(t) - Tangent);
+     }
+   }
+
+  if (MaxTangentDiff / MaxTangent > *TangentError)
+   {
+    *TangentError = MaxTangentDiff / MaxTangent;
+   }
+
+  for (unsigned_int32 cp = 0; cp < Curve->GetCPCount(); cp++)
+   {
+    if (fabs(Curve->GetValue(Curve->GetCPX(cp)) - Curve->GetCPY(cp)) > *CPError)
+     {
+      *CPError = fabs(Curve->GetValue(Curve->GetCPX(cp)) - Curve->GetCPY(cp));
+     }
+   }
+ }
+
+/* returns time of single call in ns */
+static double      BenchCurve         (const P3DMathNaturalCubicSpline
+                                                          *Curve,
+                                       bool                Tangent,
+                                       float              *Sum)
+ {
+  double                               StartTime;
+
+  StartTime = P3DToolsGetTime();
+
+  for (unsigned_int32 Index = 0; Index < BENCH_CALL_COUNT; Index++)
+   {
+    float                              t;
+
+    t = (float)(Index & 1023) * (1.0f / 1023.0f);
+
+    if (Tangent)
+     {
+      *Sum += Curve->GetTangent(t);
+     }
+    else
+     {
+      *Sum += Curve->GetValue(t);
+     }
+   }
+
+  return((P3DToolsGetTime() - StartTime) * 1.0e9 / BENCH_CALL_COUNT);
+ }
+
+int                main               (int                 argc,
+                                       char               *argv[])
+ {
+  static const unsigned_int32 CPCounts[] = { 4, 8, 32 };
+
+  unsigned_int32                         CurveCount;
+  unsigned_int32                         State;
+  double                               ValueError;
+  double                               TangentError;
+  double                               CPError;
+  float                                Sum;
+  bool                                 Failed;
+
+  CurveCount = argc > 1 ? (unsigned_int32)atoi(argv[1]) : DEFAULT_CURVE_COUNT;
+
+  if (CurveCount == 0)
+   {
+    CurveCount = DEFAULT_CURVE_COUNT;
+   }
+
+  ValueError   = 0.0;
+  TangentError = 0.0;
+  CPError      = 0.0;
+  State        = 1;
+
+  for (unsigned_int32 Index = 0; Index < CurveCount; Index++)
+   {
+    P3DMathNaturalCubicSpline          Curve;
+
+    RandomCurve(&Curve,3 + Index % (P3DMATH_NATURAL_CUBIC_SPLINE_CP_MAX_COUNT - 2),&State);
+
+    CheckCurve(&Curve,&ValueError,&TangentError,&CPError);
+   }
+
+  Failed = (ValueError > MAX_VALUE_ERROR) ||
+           (CPError > 0.0) ||
+           (TangentError > MAX_TANGENT_ERROR);
+
+  printf("%u curves x %u samples: max value error %.2g, at control points %.2g, tangent %.2g (relative)\n",
+         CurveCount,
+         SAMPLE_COUNT + 1,
+         ValueError,
+         CPError,
+         TangentError);
+  printf("bounds: value %.0g, tangent %.0g: %s\n",
+         MAX_VALUE_ERROR,
+         MAX_TANGENT_ERROR,
+         Failed ? "exceeded" : "ok");
+
+  Sum = 0.0f;
+
+  for (unsigned_int32 Index = 0; Index < sizeof(CPCounts) / sizeof(CPCounts[0]); Index++)
+   {
+    P3DMathNaturalCubicSpline          Curve;
+    double                             ValueTime;
+    double                             TangentTime;
+
+    RandomCurve(&Curve,CPCounts[Index],&State);
+
+    ValueTime   = BenchCurve(&Curve,false,&Sum);
+    TangentTime = BenchCurve(&Curve,true,&Sum);
+
+    printf("%2u control points: GetValue %.1f ns, GetTangent %.1f ns\n",
+           CPCounts[Index],
+           ValueTime,
+           TangentTime);
+   }
+
+  printf("checksum %g\n",Sum);
+
+  return(Failed ? 1 : 0);
+ }
@@ -0,0 +1,330 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#if defined(_WIN32)
+ #include <windows.h>
+#else
+ #include <sys/time.h>
+#endif
+
+#include <ngpcore/p3dexcept.h>
+#include <ngpcore/p3diostream.h>
+#include <ngpcore/p3dmodelstemtube.h>
+#include <ngpcore/p3dmodelstemquad.h>
+#include <ngpcore/p3dmodelstemwings.h>
+#include <ngpcore/p3dbalgbase.h>
+#include <ngpcore/p3dbalgstd.h>
+#include <ngpcore/p3dbalgwings.h>
+
+#include <tools/ngptools.h>
+
+double             P3DToolsGetTime    ()
+ {
+  #if defined(_WIN32)
+  LARGE_INTEGER                        Counter;
+  LARGE_INTEGER                        Frequency;
+
+  QueryPerformanceCounter(&Counter);
+  QueryPerformanceFrequency(&Frequency);
+
+  return((double)Counter.QuadPart / (double)Frequency.QuadPart);
+  #else
+  struct timeval                       Time;
+
+  gettimeofday(&Time,NULL);
+
+  return(Time.tv_sec + Time.tv_usec * 1e-6);
+  #endif
+ }
+
+static P3DBranchModel
+                  *CreateBranchModel  (P3DBranchModel     *Parent,
+                                       P3DStemModel       *StemModel,
+                                       P3DBranchingAlg    *BranchingAlg)
+ {
+  P3DBranchModel                      *BranchModel;
+
+  BranchModel = new P3DBranchModel();
+
+  BranchModel->SetStemModel(StemModel);
+  BranchModel->SetBranchingAlg(BranchingAlg);
+
+  Parent->AppendSubBranch(BranchModel);
+
+  return(BranchModel);
+ }
+
+P3DPlantModel     *P3DToolsCreateTestModel
+                                      ()
+ {
+  P3DPlantModel                       *Model;
+  P3DBranchModel                      *Trunk;
+  P3DBranchModel                      *Branch;
+  P3DBranchModel                      *Twig;
+  P3DStemModelTube                    *TrunkStem;
+  P3DStemModelTube                    *BranchStem;
+  P3DStemModelTube                    *TwigStem;
+  P3DStemModelQuad                    *LeafStem;
+  P3DStemModelQuad                    *FruitStem;
+  P3DStemModelWings                   *WingsStem;
+  P3DBranchingAlgStd                  *BranchAlg;
+  P3DBranchingAlgStd                  *TwigAlg;
+  P3DBranchingAlgStd                  *LeafAlg;
+  P3DBranchingAlgStd                  *FruitAlg;
+
+  Model = new P3DPlantModel();
+
+  TrunkStem = new P3DStemModelTube();
+
+  TrunkStem->SetLength(2.0f);
+  TrunkStem->SetLengthV(0.2f);
+  TrunkStem->SetAxisVariation(0.1f);
+  TrunkStem->SetAxisResolution(8);
+  TrunkStem->SetProfileResolution(12);
+
+  Trunk = CreateBranchModel(Model->GetPlantBase(),TrunkStem,new P3DBranchingAlgBase());
+
+  BranchStem = new P3DStemModelTube();
+
+  BranchStem->SetLength(3.0f);
+  BranchStem->SetLengthV(0.3f);
+  BranchStem->SetAxisVariation(0.2f);
+  BranchStem->SetAxisResolution(6);
+  BranchStem->SetProfileResolution(8);
+  BranchStem->SetProfileScaleBase(0.3f);
+
+  BranchAlg = new P3DBranchingAlgStd();
+
+  BranchAlg->SetDensity(2.0f);
+  BranchAlg->SetDensityV(0.3f);
+  BranchAlg->SetRevAngleV(0.2f);
+  BranchAlg->SetDeclinationV(0.2f);
+  BranchAlg->SetMultiplicity(2);
+
+  Branch = CreateBranchModel(Trunk,BranchStem,BranchAlg);
+
+  TwigStem = new P3DStemModelTube();
+
+  TwigStem->SetLength(1.0f);
+  TwigStem->SetAxisVariation(0.3f);
+  TwigStem->SetAxisResolution(4);
+  TwigStem->SetProfileResolution(6);
+  TwigStem->SetProfileScaleBase(0.1f);
+
+  TwigAlg = new P3DBranchingAlgStd();
+
+  TwigAlg->SetDensity(5.0f);
+  TwigAlg->SetDensityV(0.2f);
+
+  Twig = CreateBranchModel(Branch,TwigStem,TwigAlg);
+
+  LeafStem = new P3DStemModelQuad();
+
+  LeafStem->SetLength(0.2f);
+  LeafStem->SetWidth(0.1f);
+
+  LeafAlg = new P3DBranchingAlgStd();
+
+  LeafAlg->SetDensity(20.0f);
+  LeafAlg->SetDensityV(0.5f);
+
+  CreateBranchModel(Twig,LeafStem,LeafAlg);
+
+  FruitStem = new P3DStemModelQuad();
+
+  FruitStem->SetLength(0.3f);
+  FruitStem->SetWidth(0.2f);
+  FruitStem->SetSectionCount(3);
+  FruitStem->SetThickness(0.05f);
+
+  FruitAlg = new P3DBranchingAlgStd();
+
+  FruitAlg->SetDensity(3.0f);
+  FruitAlg->SetDeclinationV(0.5f);
+
+  CreateBranchModel(Branch,FruitStem,FruitAlg);
+
+  WingsStem = new P3DStemModelWings(BranchStem);
+
+  WingsStem->SetWidth(0.2f);
+  WingsStem->SetSectionCount(2);
+
+  CreateBranchModel(Branch,WingsStem,new P3DBranchingAlgWings());
+
+  Model->SetBaseSeed(1234);
+
+  return(Model);
+ }
+
+class P3DToolsMaterialInstance : public P3DMaterialInstance
+ {
+  public           :
+
+                   P3DToolsMaterialInstance
+                                      (const P3DMaterialDef
+                                                          &MaterialDef)
+                   : MaterialDef(MaterialDef)
+   {
+   }
+
+  virtual
+  const
+  P3DMaterialDef  *GetMaterialDef     () const
+   {
+    return(&MaterialDef);
+   }
+
+  virtual
+  P3DMaterialInstance
+                  *CreateCopy         () const
+   {
+    return(new P3DToolsMaterialInstance(MaterialDef));
+   }
+
+  private          :
+
+  P3DMaterialDef                       MaterialDef;
+ };
+
+P3DMaterialInstance
+                  *P3DToolsMaterialFactory::CreateMaterial
+                                      (const P3DMaterialDef
+                                                          &MaterialDef) const
+ {
+  return(new P3DToolsMaterialInstance(MaterialDef));
+ }
+
+void               P3DToolsMaterialSaver::Save
+                                      (P3DOutputStringStream
+                                                          *TargetStream,
+                                       const P3DMaterialInstance
+                                                          *Material) const
+ {
+  Material->GetMaterialDef()->Save(TargetStream);
+ }
+
+void               P3DToolsSaveModel  (const P3DPlantModel*Model,
+                                       const char         *FileName)
+ {
+  P3DOutputStringStreamFile            TargetStream;
+  P3DToolsMaterialSaver                MaterialSaver;
+
+  TargetStream.Open(FileName);
+
+  Model->Save(&TargetStream,&MaterialSaver);
+
+  TargetStream.Close();
+ }
+
+P3DHLIPlantTemplate
+                  *P3DToolsLoadTemplate
+                                      (const char         *FileName)
+ {
+  P3DInputBinaryStreamFile             BinaryStream;
+
+  if (BinaryStream.OpenIfBinary(FileName))
+   {
+    return(new P3DHLIPlantTemplate(&BinaryStream));
+   }
+  else
+   {
+    P3DInputStringStreamFile           SourceStream;
+
+    SourceStream.Open(FileName);
+
+    return(new P3DHLIPlantTemplate(&SourceStream));
+   }
+ }
+
+unsigned_int32       P3DToolsHashData   (unsigned_int32        Hash,
+                                       const void         *Data,
+                                       unsigned_int32        Size)
+ {
+  const unsigned char                 *Bytes;
+
+  Bytes = (const unsigned char*)Data;
+
+  for (unsigned_int32 Index = 0; Index < Size; Index++)
+   {
+    Hash = (Hash ^ Bytes[Index]) * 16777619U;
+   }
+
+  return(Hash);
+ }
+
+unsigned_int32       P3DToolsHashGeometry
+                                      (const P3DHLIPlantGeometry
+                                                          *Geometry)
+ {
+  unsigned_int32                         Hash;
+  float                                Min[3];
+  float                                Max[3];
+
+  Hash = P3D_TOOLS_HASH_INIT;
+
+  for (unsigned_int32 GroupIndex = 0; GroupIndex < Geometry->GetGroupCount(); GroupIndex++)
+   {
+    unsigned_int32                       VAttrCount;
+    unsigned_int32                       IndexCount;
+
+    VAttrCount = Geometry->GetVAttrCountI(GroupIndex);
+    IndexCount = Geometry->GetIndexCount(GroupIndex);
+
+    Hash = P3DToolsHashData(Hash,&VAttrCount,sizeof(VAttrCount));
+    Hash = P3DToolsHashData(Hash,&IndexCount,sizeof(IndexCount));
+
+    for (unsigned_int32 Attr = 0; Attr < P3D_MAX_ATTRS; Attr++)
+     {
+      const float                     *Buffer;
+
+      Buffer = Geometry->GetVAttrBufferI(GroupIndex,Attr);
+
+      if (Buffer != 0)
+       {
+        Hash = P3DToolsHashData(Hash,
+                                Buffer,
+                                VAttrCount * (Attr == P3D_ATTR_TEXCOORD0 ? 2 : 3) * sizeof(float));
+       }
+     }
+
+    Hash = P3DToolsHashData(Hash,
+                            Geometry->GetIndexBuffer(GroupIndex),
+                            IndexCount * sizeof(unsigned_int32));
+   }
+
+  Geometry->GetBoundingBox(Min,Max);
+
+  Hash = P3DToolsHashData(Hash,Min,sizeof(Min));
+  Hash = P3DToolsHashData(Hash,Max,sizeof(Max));
+
+  return(Hash);
+ }
+
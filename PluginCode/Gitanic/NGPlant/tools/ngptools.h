@@ -0,0 +1,99 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+#ifndef __NGPTOOLS_H__
+#define __NGPTOOLS_H__
+
+#include <ngpcore/p3dmodel.h>
+#include <ngpcore/p3dhli.h>
+#include <ngpcore/p3dhliforest.h>
+
+/* Helpers shared by benchmark and test programs. Programs print their */
+/* results to stdout and return non-zero exit code if check failed.    */
+
+/* wall-clock time in seconds */
+extern double      P3DToolsGetTime    ();
+
+/* Creates model with trunk, two levels of tube branches, leaves of */
+/* both quad kinds and wings, so all stem models and branching      */
+/* algorithms are used. Caller owns returned model.                 */
+extern P3DPlantModel
+                  *P3DToolsCreateTestModel
+                                      ();
+
+/* Material factory and saver which copy material definitions as is, */
+/* without creating real materials                                   */
+class P3DToolsMaterialFactory : public P3DMaterialFactory
+ {
+  public           :
+
+  virtual P3DMaterialInstance
+                  *CreateMaterial     (const P3DMaterialDef
+                                                          &MaterialDef) const;
+ };
+
+class P3DToolsMaterialSaver : public P3DMaterialSaver
+ {
+  public           :
+
+  virtual void     Save               (P3DOutputStringStream
+                                                          *TargetStream,
+                                       const P3DMaterialInstance
+                                                          *Material) const;
+ };
+
+/* Saves model to text .ngp file, materials are saved as is */
+extern void        P3DToolsSaveModel  (const P3DPlantModel*Model,
+                                       const char         *FileName);
+
+/* Loads template from text or binary .ngp file. */
+/* Caller owns returned template.                */
+extern P3DHLIPlantTemplate
+                  *P3DToolsLoadTemplate
+                                      (const char         *FileName);
+
+/* FNV-1a hash of data, Hash is result of previous call or */
+/* P3D_TOOLS_HASH_INIT                                     */
+#define P3D_TOOLS_HASH_INIT (2166136261U)
+
+extern unsigned_int32
+                   P3DToolsHashData   (unsigned_int32        Hash,
+                                       const void         *Data,
+                                       unsigned_int32        Size);
+
+/* hash of all buffers and bounding box of geometry */
+extern unsigned_int32
+                   P3DToolsHashGeometry
+                                      (const P3DHLIPlantGeometry
+                                                          *Geometry);
+
+#endif
+
@@ -0,0 +1,271 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+/* Tube ring kernel benchmark. Compares vertex attributes produced by  */
+/* P3DStemModelTubeInstance::GetVAttrRingValuesI with per-vertex       */
+/* GetVAttrValueI for range of axis/profile resolutions and texture    */
+/* V modes, then measures both paths on 16x16 tube.                    */
+/*                                                                     */
+/* Usage: ngptubebench [iteration count]                               */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <ngpcore/p3dmathrng.h>
+#include <ngpcore/p3dmodelstemtube.h>
+
+#include <tools/ngptools.h>
+
+#define DEFAULT_ITERATION_COUNT (2000)
+
+/* ring kernel must match per-vertex path within this tolerance */
+#define MAX_ABS_ERROR           (1.0e-5f)
+
+/* attributes generated by tube stems */
+#define TUBE_ATTR_COUNT         (P3D_ATTR_BILLBOARD_POS)
+
+static unsigned_int32 GetAttrSize      (unsigned_int32        Attr)
+ {
+  return(Attr == P3D_ATTR_TEXCOORD0 ? 2 : 3);
+ }
+
+/* fill all rings of Instance, Buffers hold (profile resolution + 1) */
+/* vertices per ring                                                 */
+static void        FillRings          (const P3DStemModelTubeInstance
+                                                          *Instance,
+                                       unsigned_int32        RingCount,
+                                       unsigned_int32        RingVAttrCount,
+                                       float             **Buffers,
+                                       const unsigned_int32 *Strides)
+ {
+  void                                *RingBuffers[P3D_MAX_ATTRS];
+
+  for (unsigned_int32 RingIndex = 0; RingIndex < RingCount; RingIndex++)
+   {
+    for (unsigned_int32 Attr = 0; Attr < P3D_MAX_ATTRS; Attr++)
+     {
+      RingBuffers[Attr] = Buffers[Attr] != 0 ?
+                           (char*)Buffers[Attr] + RingIndex * RingVAttrCount * Strides[Attr] : 0;
+     }
+
+    Instance->GetVAttrRingValuesI(RingBuffers,Strides,RingIndex);
+   }
+ }
+
+/* returns max absolute difference between paths */
+static float       CompareTube        (P3DStemModelTube   *StemModel,
+                                       P3DMathRNG         *RNG,
+                                       unsigned_int32       *ValueCount,
+                                       unsigned_int32       *DiffCount)
+ {
+  P3DQuaternionf                       Orientation;
+  P3DStemModelTubeInstance            *Parent;
+  P3DStemModelTubeInstance            *Instance;
+  float                               *Buffers[P3D_MAX_ATTRS];
+  unsigned_int32                         Strides[P3D_MAX_ATTRS];
+  unsigned_int32                         VAttrCount;
+  float                                MaxError;
+
+  Orientation.FromAxisAndAngle(0.3f,0.5f,0.8f,0.7f);
+
+  Parent   = (P3DStemModelTubeInstance*)StemModel->CreateInstance(RNG,0,0.0f,&Orientation);
+  Instance = (P3DStemModelTubeInstance*)StemModel->CreateInstance(RNG,Parent,0.4f,&Orientation);
+
+  VAttrCount = Instance->GetVAttrCountI();
+
+  for (unsigned_int32 Attr = 0; Attr < P3D_MAX_ATTRS; Attr++)
+   {
+    Buffers[Attr] = Attr < TUBE_ATTR_COUNT ? new float[VAttrCount * 3] : 0;
+    Strides[Attr] = sizeof(float) * 3;
+   }
+
+  FillRings(Instance,
+            StemModel->GetAxisResolution() + 1,
+            StemModel->GetProfileResolution() + 1,
+            Buffers,
+            Strides);
+
+  MaxError = 0.0f;
+
+  for (unsigned_int32 Attr = 0; Attr < TUBE_ATTR_COUNT; Attr++)
+   {
+    for (unsigned_int32 Index = 0; Index < VAttrCount; Index++)
+     {
+      float                            Value[3];
+
+      Instance->GetVAttrValueI(Value,Attr,Index);
+
+      for (unsigned_int32 Element = 0; Element < GetAttrSize(Attr); Element++)
+       {
+        float                          Error;
+
+        Error = (float)fabs(Value[Element] - Buffers[Attr][Index * 3 + Element]);
+
+        if (Value[Element] != Buffers[Attr][Index * 3 + Element])
+         {
+          (*DiffCount)++;
+         }
+
+        if (Error > MaxError)
+         {
+          MaxError = Error;
+         }
+
+        (*ValueCount)++;
+       }
+     }
+   }
+
+  for (unsigned_int32 Attr = 0; Attr < P3D_MAX_ATTRS; Attr++)
+   {
+    delete[] Buffers[Attr];
+   }
+
+  StemModel->ReleaseInstance(Instance);
+  StemModel->ReleaseInstance(Parent);
+
+  return(MaxError);
+ }
+
+int                main               (int                 argc,
+                                       char               *argv[])
+ {
+  P3DMathRNGSimple                     RNG(77);
+  P3DStemModelTube                     StemModel;
+  P3DStemModelTubeInstance            *Instance;
+  unsigned_int32                         IterationCount;
+  unsigned_int32                         ValueCount;
+  unsigned_int32                         DiffCount;
+  unsigned_int32                         VAttrCount;
+  float                                MaxError;
+  float                               *Buffers[P3D_MAX_ATTRS];
+  unsigned_int32                         Strides[P3D_MAX_ATTRS];
+  float                               *Output;
+  double                               StartTime;
+  double                               VertexTime;
+  double                               RingTime;
+
+  IterationCount = argc > 1 ? (unsigned_int32)atoi(argv[1]) : DEFAULT_ITERATION_COUNT;
+
+  if (IterationCount == 0)
+   {
+    IterationCount = DEFAULT_ITERATION_COUNT;
+   }
+
+  ValueCount = 0;
+  DiffCount  = 0;
+  MaxError   = 0.0f;
+
+  StemModel.SetLength(2.5f);
+  StemModel.SetAxisVariation(0.3f);
+  StemModel.SetTexCoordUScale(1.7f);
+  StemModel.SetTexCoordVScale(0.6f);
+
+  for (unsigned_int32 AxisResolution = 1; AxisResolution <= 12; AxisResolution += 3)
+   {
+    for (unsigned_int32 ProfileResolution = 3; ProfileResolution <= 40; ProfileResolution += 5)
+     {
+      for (unsigned_int32 VMode = 0; VMode < 2; VMode++)
+       {
+        float                          Error;
+
+        StemModel.SetAxisResolution(AxisResolution);
+        StemModel.SetProfileResolution(ProfileResolution);
+        StemModel.SetTexCoordVMode(VMode);
+
+        Error = CompareTube(&StemModel,&RNG,&ValueCount,&DiffCount);
+
+        if (Error > MaxError)
+         {
+          MaxError = Error;
+         }
+       }
+     }
+   }
+
+  printf("compared %u values: %u not bit-identical, max error %g\n",ValueCount,DiffCount,MaxError);
+
+  StemModel.SetAxisResolution(16);
+  StemModel.SetProfileResolution(16);
+  StemModel.SetTexCoordVMode(0);
+
+  Instance   = (P3DStemModelTubeInstance*)StemModel.CreateInstance(&RNG,0,0.0f,0);
+  VAttrCount = Instance->GetVAttrCountI();
+  Output     = new float[VAttrCount * TUBE_ATTR_COUNT * 3];
+
+  /* interleaved output, as in fused fill */
+  for (unsigned_int32 Attr = 0; Attr < P3D_MAX_ATTRS; Attr++)
+   {
+    Buffers[Attr] = Attr < TUBE_ATTR_COUNT ? Output + Attr * 3 : 0;
+    Strides[Attr] = sizeof(float) * 3 * TUBE_ATTR_COUNT;
+   }
+
+  StartTime = P3DToolsGetTime();
+
+  for (unsigned_int32 Iteration = 0; Iteration < IterationCount; Iteration++)
+   {
+    for (unsigned_int32 Attr = 0; Attr < TUBE_ATTR_COUNT; Attr++)
+     {
+      for (unsigned_int32 Index = 0; Index < VAttrCount; Index++)
+       {
+        Instance->GetVAttrValueI(Buffers[Attr] + Index * 3 * TUBE_ATTR_COUNT,Attr,Index);
+       }
+     }
+   }
+
+  VertexTime = P3DToolsGetTime() - StartTime;
+  StartTime  = P3DToolsGetTime();
+
+  for (unsigned_int32 Iteration = 0; Iteration < IterationCount; Iteration++)
+   {
+    FillRings(Instance,
+              StemModel.GetAxisResolution() + 1,
+              StemModel.GetProfileResolution() + 1,
+              Buffers,
+              Strides);
+   }
+
+  RingTime = P3DToolsGetTime() - StartTime;
+
+  printf("16x16 tube, %u vertices x %u: per-vertex %.1f ms, ring kernel %.1f ms\n",
+         VAttrCount,
+         IterationCount,
+         VertexTime * 1000.0,
+         RingTime * 1000.0);
+
+  delete[] Output;
+
+  StemModel.ReleaseInstance(Instance);
+
+  return(MaxError <= MAX_ABS_ERROR ? 0 : 1);
+ }
+
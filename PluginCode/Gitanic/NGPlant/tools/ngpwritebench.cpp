@@ -0,0 +1,358 @@
+/***************************************************************************
+
+ Copyright (c) 2007 Sergey Prokhorchuk.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions
+ are met:
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of the author nor the names of contributors
+    may be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ SUCH DAMAGE.
+
+***************************************************************************/
+
+/* Text .ngp writer benchmark. Checks that lines written by            */
+/* P3DOutputStringFmtStream are the same as lines formatted field by   */
+/* field with printf and escaped as WriteStringSafe did, then measures */
+/* model saving to file and to memory and single "sfff" line writing.  */
+/* Built-in test model is used if no file is given.                    */
+/*                                                                     */
+/* Usage: ngpwritebench [model.ngp [repeat count]]                     */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ngpcore/p3dexcept.h>
+#include <ngpcore/p3diostream.h>
+#include <ngpcore/p3diostreamadd.h>
+
+#include <tools/ngptools.h>
+
+#define DEFAULT_REPEAT_COUNT (200)
+#define LINE_CHECK_COUNT     (100000)
+#define LINE_BENCH_COUNT     (1000000)
+#define MAX_CHECK_STR_LEN    (300)
+#define TEMP_FILE_NAME       "ngpwritebench.tmp.ngp"
+
+/* simple LCG, so benchmark does not depend on rand() implementation */
+static unsigned_int32 NextRandom       (unsigned_int32       *State)
+ {
+  *State = *State * 1664525U + 1013904223U;
+
+  return(*State >> 8);
+ }
+
+/* Random string, mostly plain words, some with spaces, quotes and */
+/* control chars, some longer than line buffer when escaped        */
+static void        RandomString       (char               *Str,
+                                       unsigned_int32       *State)
+ {
+  static const char                    Special[] = " \t\"\\\r";
+  unsigned_int32                         Length;
+  unsigned_int32                         Kind;
+
+  Kind   = NextRandom(State) % 8;
+  Length = Kind == 0 ? NextRandom(State) % MAX_CHECK_STR_LEN : NextRandom(State) % 24;
+
+  for (unsigned_int32 Index = 0; Index < Length; Index++)
+   {
+    if ((Kind < 3) && (NextRandom(State) % 6 == 0))
+     {
+      Str[Index] = Special[NextRandom(State) % (sizeof(Special) - 1)];
+     }
+    else
+     {
+      Str[Index] = (char)(0x21 + NextRandom(State) % 94);
+     }
+   }
+
+  Str[Length] = 0;
+ }
+
+/* string field escaped as WriteStringSafe did */
+static char       *AppendStringRef    (char               *Dest,
+                                       const char         *Str)
+ {
+  const char                          *SrcPtr;
+  char                                 Ch;
+
+  for (SrcPtr = Str; *SrcPtr > 0x20; SrcPtr++) ;
+
+  if (*SrcPtr == '\0')
+   {
+    strcpy(Dest,Str);
+
+    return(Dest + strlen(Dest));
+   }
+
+  *Dest++ = '\"';
+
+  for (SrcPtr = Str; *SrcPtr != '\0'; SrcPtr++)
+   {
+    Ch = *SrcPtr;
+
+    if (Ch <= 0x20 || Ch == '\"' || Ch == '\\')
+     {
+      Dest += sprintf(Dest,"\\%02X",(unsigned)Ch);
+     }
+    else
+     {
+      *Dest++ = Ch;
+     }
+   }
+
+  *Dest++ = '\"';
+  *Dest   = 0;
+
+  return(Dest);
+ }
+
+/* returns number of "ssfub" lines which differ from reference */
+static unsigned_int32 CheckLines       ()
+ {
+  unsigned_int32                         DiffCount;
+  unsigned_int32                         State;
+  char                                 Str1[MAX_CHECK_STR_LEN + 1];
+  char                                 Str2[MAX_CHECK_STR_LEN + 1];
+  char                                 Line[MAX_CHECK_STR_LEN * 6 + 128];
+  P3DOutputStringStreamMemory          TargetStream;
+  P3DOutputStringFmtStream             FmtStream(&TargetStream);
+
+  DiffCount = 0;
+  State     = 1;
+
+  for (unsigned_int32 Index = 0; Index < LINE_CHECK_COUNT; Index++)
+   {
+    float                              FloatValue;
+    unsigned_int32                       UValue;
+    bool                               BoolValue;
+    char                              *LineEnd;
+
+    RandomString(Str1,&State);
+    RandomString(Str2,&State);
+
+    FloatValue = ((float)NextRandom(&State) - 8388608.0f) / (float)(1 << (NextRandom(&State) % 24));
+    UValue     = NextRandom(&State) << (NextRandom(&State) % 9);
+    BoolValue  = (NextRandom(&State) & 1) != 0;
+
+    LineEnd  = AppendStringRef(Line,Str1);
+    *LineEnd++ = ' ';
+    LineEnd  = AppendStringRef(LineEnd,Str2);
+
+    sprintf(LineEnd," %f %u %s\n",FloatValue,UValue,BoolValue ? "true" : "false");
+
+    TargetStream.Clear();
+
+    FmtStream.WriteString("ssfub",Str1,Str2,FloatValue,UValue,BoolValue);
+
+    if (strcmp(TargetStream.GetData(),Line) != 0)
+     {
+      DiffCount++;
+     }
+   }
+
+  return(DiffCount);
+ }
+
+static double      SaveToFile         (const P3DPlantModel*Model,
+                                       unsigned_int32        RepeatCount)
+ {
+  P3DToolsMaterialSaver                MaterialSaver;
+  double                               StartTime;
+
+  StartTime = P3DToolsGetTime();
+
+  for (unsigned_int32 Repeat = 0; Repeat < RepeatCount; Repeat++)
+   {
+    P3DOutputStringStreamFile          TargetStream;
+
+    TargetStream.Open(TEMP_FILE_NAME);
+
+    Model->Save(&TargetStream,&MaterialSaver);
+
+    TargetStream.Close();
+   }
+
+  return(P3DToolsGetTime() - StartTime);
+ }
+
+/* Size is set to size of saved model */
+static double      SaveToMemory       (const P3DPlantModel*Model,
+                                       unsigned_int32        RepeatCount,
+                                       unsigned_int32       *Size)
+ {
+  P3DToolsMaterialSaver                MaterialSaver;
+  P3DOutputStringStreamMemory          TargetStream;
+  double                               StartTime;
+
+  StartTime = P3DToolsGetTime();
+
+  for (unsigned_int32 Repeat = 0; Repeat < RepeatCount; Repeat++)
+   {
+    TargetStream.Clear();
+
+    Model->Save(&TargetStream,&MaterialSaver);
+   }
+
+  *Size = TargetStream.GetDataSize();
+
+  return(P3DToolsGetTime() - StartTime);
+ }
+
+static double      WriteLines         (bool                Reference)
+ {
+  P3DOutputStringStreamMemory          TargetStream;
+  P3DOutputStringFmtStream             FmtStream(&TargetStream);
+  char                                 Line[256];
+  double                               StartTime;
+
+  StartTime = P3DToolsGetTime();
+
+  for (unsigned_int32 Index = 0; Index < LINE_BENCH_COUNT; Index++)
+   {
+    float                              Value;
+
+    Value = (float)(Index % 1000) * 0.013f;
+
+    if ((Index % 1024) == 0)
+     {
+      TargetStream.Clear();
+     }
+
+    if (Reference)
+     {
+      sprintf(Line,"%s %f %f %f","BaseColor",Value,Value + 0.5f,Value * 2.0f);
+
+      TargetStream.WriteString(Line);
+     }
+    else
+     {
+      FmtStream.WriteString("sfff","BaseColor",Value,Value + 0.5f,Value * 2.0f);
+     }
+   }
+
+  return(P3DToolsGetTime() - StartTime);
+ }
+
+int                main               (int                 argc,
+                                       char               *argv[])
+ {
+  P3DPlantModel                       *Model;
+  unsigned_int32                         RepeatCount;
+  unsigned_int32                         DiffCount;
+  unsigned_int32                         ModelSize;
+  double                               FileTime;
+  double                               MemoryTime;
+  double                               LineTime;
+  double                               RefLineTime;
+
+  RepeatCount = argc > 2 ? (unsigned_int32)atoi(argv[2]) : DEFAULT_REPEAT_COUNT;
+
+  if (RepeatCount == 0)
+   {
+    RepeatCount = DEFAULT_REPEAT_COUNT;
+   }
+
+  DiffCount = CheckLines();
+
+  printf("%u lines: %u differ\n",LINE_CHECK_COUNT,DiffCount);
+
+  try
+   {
+    if (argc > 1)
+     {
+      P3DToolsMaterialFactory          MaterialFactory;
+
+      Model = new P3DPlantModel();
+
+      try
+       {
+        if (P3DInputBinaryStreamFile::IsBinaryFile(argv[1]))
+         {
+          P3DInputBinaryStreamFile     SourceStream;
+
+          SourceStream.Open(argv[1]);
+
+          Model->Load(&SourceStream,&MaterialFactory);
+         }
+        else
+         {
+          P3DInputStringStreamFile     SourceStream;
+
+          SourceStream.Open(argv[1]);
+
+          Model->Load(&SourceStream,&MaterialFactory);
+         }
+       }
+      catch (...)
+       {
+        delete Model;
+
+        throw;
+       }
+     }
+    else
+     {
+      Model = P3DToolsCreateTestModel();
+     }
+
+    try
+     {
+      FileTime   = SaveToFile(Model,RepeatCount);
+      MemoryTime = SaveToMemory(Model,RepeatCount,&ModelSize);
+     }
+    catch (...)
+     {
+      delete Model;
+
+      throw;
+     }
+
+    delete Model;
+   }
+  catch (P3DException &Error)
+   {
+    printf("error: %s\n",Error.GetMessage());
+
+    remove(TEMP_FILE_NAME);
+
+    return(1);
+   }
+
+  remove(TEMP_FILE_NAME);
+
+  RefLineTime = WriteLines(true);
+  LineTime    = WriteLines(false);
+
+  printf("model %u bytes x %u: file %.3f ms (%.1f MB/s), memory %.3f ms (%.1f MB/s)\n",
+         ModelSize,
+         RepeatCount,
+         FileTime * 1000.0 / RepeatCount,
+         (double)ModelSize * RepeatCount / (1024.0 * 1024.0) / FileTime,
+         MemoryTime * 1000.0 / RepeatCount,
+         (double)ModelSize * RepeatCount / (1024.0 * 1024.0) / MemoryTime);
+  printf("\"sfff\" line: FmtStream %.1f ns, sprintf %.1f ns\n",
+         LineTime * 1.0e9 / LINE_BENCH_COUNT,
+         RefLineTime * 1.0e9 / LINE_BENCH_COUNT);
+
+  return(DiffCount == 0 ? 0 : 1);
+ }